@@ -0,0 +1,215 @@
+// 存储引擎的微基准（Google Benchmark）。构建示例：
+//   g++ -std=c++20 -O2 -DNDEBUG -Iinclude bench/micro_bench.cpp src/db/*.cpp -lbenchmark -lpthread -o micro_bench
+// 在可写的临时目录下运行，文件名都以 bench_ 开头，结束时删除。
+#include <db/BTreeFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <string>
+
+using namespace db;
+
+namespace {
+const TupleDesc fixed_td({type_t::INT, type_t::DOUBLE, type_t::CHAR}, {"id", "value", "name"});
+const TupleDesc varchar_td({type_t::INT, type_t::VARCHAR, type_t::INT}, {"id", "name", "flag"});
+
+Tuple fixed_row(int i) { return Tuple({i, i * 0.5, std::string("name-") + std::to_string(i)}); }
+
+void unlink_file(const std::string &name) {
+    std::remove(name.c_str());
+    std::remove((name + ".fsm").c_str());
+}
+
+// 注册到 Database 的临时文件，析构时摘除并删掉
+class TempFile {
+    std::string name;
+
+public:
+    explicit TempFile(std::unique_ptr<DbFile> file) : name(file->getName()) { getDatabase().add(std::move(file)); }
+
+    ~TempFile() {
+        getDatabase().remove(name).reset();
+        unlink_file(name);
+    }
+
+    DbFile &operator*() const { return getDatabase().get(name); }
+};
+
+std::string fresh_name(const char *kind) {
+    static size_t seq = 0;
+    const std::string name = std::string("bench_") + kind + "_" + std::to_string(seq++) + ".dat";
+    unlink_file(name);
+    return name;
+}
+
+void use_pool(size_t pages) {
+    BufferPool &pool = getDatabase().getBufferPool();
+    if (pool.getNumPages() != pages) {
+        pool.resize(pages);
+    }
+}
+
+size_t scan_all(const DbFile &f) {
+    size_t n = 0;
+    const Iterator end = f.end();
+    for (Iterator it = f.begin(); it != end; f.next(it)) {
+        benchmark::DoNotOptimize(f.getTuple(it));
+        ++n;
+    }
+    return n;
+}
+} // namespace
+
+// range(0)：1 为经 BufferPool，0 为每次直接读写页
+void BM_HeapInsertSequential(benchmark::State &state) {
+    use_pool(1024);
+    TempFile f(std::make_unique<HeapFile>(fresh_name("heap"), fixed_td, state.range(0) != 0));
+    int i = 0;
+    for (auto _ : state) {
+        (*f).insertTuple(fixed_row(i++));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HeapInsertSequential)->Arg(0)->Arg(1);
+
+void BM_HeapInsertBatch(benchmark::State &state) {
+    use_pool(1024);
+    TempFile f(std::make_unique<HeapFile>(fresh_name("heap"), fixed_td, true));
+    std::vector<Tuple> batch;
+    for (int i = 0; i < state.range(0); ++i) {
+        batch.push_back(fixed_row(i));
+    }
+    for (auto _ : state) {
+        (*f).insertTuples(batch);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HeapInsertBatch)->Arg(1024);
+
+// range(0) 行；文件能装进缓冲池
+void BM_HeapScan(benchmark::State &state) {
+    use_pool(4096);
+    TempFile f(std::make_unique<HeapFile>(fresh_name("heap"), fixed_td, true));
+    std::vector<Tuple> rows;
+    for (int i = 0; i < state.range(0); ++i) {
+        rows.push_back(fixed_row(i));
+    }
+    (*f).insertTuples(rows);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scan_all(*f));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_HeapScan)->Arg(10'000)->Arg(100'000);
+
+// range(0)：0 为顺序 key，1 为随机 key
+void BM_BTreeInsert(benchmark::State &state) {
+    use_pool(4096);
+    TempFile f(std::make_unique<BTreeFile>(fresh_name("btree"), fixed_td, 0));
+    std::vector<int> keys(1 << 20);
+    std::iota(keys.begin(), keys.end(), 0);
+    if (state.range(0) != 0) {
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        // key 用完后加偏移继续，保持唯一
+        const int k = keys[i % keys.size()] + static_cast<int>(i / keys.size()) * static_cast<int>(keys.size());
+        (*f).insertTuple(fixed_row(k));
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BTreeInsert)->Arg(0)->Arg(1);
+
+void BM_BTreeScan(benchmark::State &state) {
+    use_pool(4096);
+    TempFile f(std::make_unique<BTreeFile>(fresh_name("btree"), fixed_td, 0));
+    std::vector<Tuple> rows;
+    for (int i = 0; i < state.range(0); ++i) {
+        rows.push_back(fixed_row(i));
+    }
+    (*f).insertTuples(rows);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(scan_all(*f));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_BTreeScan)->Arg(10'000)->Arg(100'000);
+
+// range(0)：0 为定长 schema，1 为带 VARCHAR 的 schema
+void BM_TupleSerialize(benchmark::State &state) {
+    const bool varchar = state.range(0) != 0;
+    const TupleDesc &td = varchar ? varchar_td : fixed_td;
+    const Tuple t = varchar ? Tuple({7, std::string("a varchar value"), 1}) : fixed_row(7);
+    std::vector<uint8_t> buf(td.max_length());
+    for (auto _ : state) {
+        td.serialize(buf.data(), t);
+        benchmark::DoNotOptimize(buf.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(td.length_of(t)));
+}
+BENCHMARK(BM_TupleSerialize)->Arg(0)->Arg(1);
+
+void BM_TupleDeserialize(benchmark::State &state) {
+    const bool varchar = state.range(0) != 0;
+    const TupleDesc &td = varchar ? varchar_td : fixed_td;
+    const Tuple t = varchar ? Tuple({7, std::string("a varchar value"), 1}) : fixed_row(7);
+    std::vector<uint8_t> buf(td.max_length());
+    td.serialize(buf.data(), t);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(td.deserialize(buf.data()));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(td.length_of(t)));
+}
+BENCHMARK(BM_TupleDeserialize)->Arg(0)->Arg(1);
+
+// range(0) 帧；访问的页全在池中，每次都命中
+void BM_BufferPoolHit(benchmark::State &state) {
+    const size_t frames = static_cast<size_t>(state.range(0));
+    use_pool(frames);
+    TempFile f(std::make_unique<HeapFile>(fresh_name("pool"), fixed_td, true));
+    const file_id_t id = (*f).getFileId();
+    BufferPool &pool = getDatabase().getBufferPool();
+    for (size_t p = 0; p < frames; ++p) {
+        pool.getPage({id, p});
+    }
+    size_t p = 0;
+    for (auto _ : state) {
+        PageGuard guard = pool.pinPage({id, p});
+        benchmark::DoNotOptimize(&*guard);
+        p = p + 1 == frames ? 0 : p + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BufferPoolHit)->Arg(64)->Arg(1024)->Arg(16384);
+
+// range(0) 帧；循环访问两倍于池的页，LRU 下每次都缺页（读的是已在页缓存中的文件）
+void BM_BufferPoolMiss(benchmark::State &state) {
+    const size_t frames = static_cast<size_t>(state.range(0));
+    use_pool(frames);
+    TempFile f(std::make_unique<HeapFile>(fresh_name("pool"), fixed_td, true));
+    const file_id_t id = (*f).getFileId();
+    {
+        const Page zero{};
+        for (size_t p = 0; p < 2 * frames; ++p) {
+            (*f).writePage(zero, p);
+        }
+    }
+    BufferPool &pool = getDatabase().getBufferPool();
+    size_t p = 0;
+    for (auto _ : state) {
+        PageGuard guard = pool.pinPage({id, p});
+        benchmark::DoNotOptimize(&*guard);
+        p = p + 1 == 2 * frames ? 0 : p + 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_BufferPoolMiss)->Arg(64)->Arg(1024)->Arg(16384);
+
+BENCHMARK_MAIN();
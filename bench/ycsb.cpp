@@ -0,0 +1,196 @@
+// YCSB 风格的混合负载：在一个 INT 主键的 BTreeFile 上做读、更新、插入与短范围扫描，
+// 报告吞吐与各操作的 p50/p99 延迟。构建示例：
+//   g++ -std=c++20 -O2 -DNDEBUG -Iinclude bench/ycsb.cpp src/db/*.cpp -lpthread -o ycsb
+// 用法：ycsb [workload=a|b|c|e] [records] [ops] [threads] [zipf|uniform] [pool pages]
+//   a：50% 读 50% 更新；b：95% 读 5% 更新；c：只读；e：95% 扫描 5% 插入
+#include <db/BTreeFile.hpp>
+#include <db/Database.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace db;
+
+namespace {
+enum Op { READ, UPDATE, INSERT, SCAN, OP_COUNT };
+
+const char *const op_names[OP_COUNT] = {"read", "update", "insert", "scan"};
+
+constexpr int SCAN_LENGTH = 50;
+
+struct Workload {
+    double read, update, insert, scan;   // 各操作所占比例
+};
+
+Workload workload_of(char w) {
+    switch (w) {
+        case 'a': return {0.5, 0.5, 0, 0};
+        case 'b': return {0.95, 0.05, 0, 0};
+        case 'c': return {1, 0, 0, 0};
+        case 'e': return {0, 0, 0.05, 0.95};
+        default: throw std::invalid_argument(std::string("unknown workload ") + w);
+    }
+}
+
+// YCSB 的 Zipfian 生成器（Gray 等人的方法），theta = 0.99；返回 [0, n)，0 最热
+class Zipfian {
+    uint64_t n;
+    double theta{0.99}, alpha, zetan, eta;
+
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i) {
+            sum += 1 / std::pow(static_cast<double>(i), theta);
+        }
+        return sum;
+    }
+
+public:
+    explicit Zipfian(uint64_t n) : n(n), alpha(1 / (1 - theta)), zetan(zeta(n, theta)) {
+        eta = (1 - std::pow(2.0 / static_cast<double>(n), 1 - theta)) / (1 - zeta(2, theta) / zetan);
+    }
+
+    uint64_t operator()(std::mt19937_64 &rng) const {
+        const double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        const double uz = u * zetan;
+        if (uz < 1) return 0;
+        if (uz < 1 + std::pow(0.5, theta)) return 1;
+        return std::min<uint64_t>(n - 1, static_cast<uint64_t>(static_cast<double>(n) *
+                                                               std::pow(eta * u - eta + 1, alpha)));
+    }
+};
+
+// 打散热点，使热门 key 不集中在同一片叶子上（YCSB 的 scrambled zipfian）
+int32_t scramble(uint64_t i, uint64_t n) { return static_cast<int32_t>((i * 0x9E3779B97F4A7C15ULL >> 11) % n); }
+
+Tuple row(int32_t key, int32_t version) {
+    return Tuple({key, version, std::string("payload-") + std::to_string(key)});
+}
+
+uint64_t percentile(const std::vector<uint64_t> &sorted, double q) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(q * static_cast<double>(sorted.size())))];
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    const char w = argc > 1 ? argv[1][0] : 'a';
+    const size_t records = argc > 2 ? std::stoul(argv[2]) : 100'000;
+    const size_t ops = argc > 3 ? std::stoul(argv[3]) : 200'000;
+    const size_t threads = argc > 4 ? std::stoul(argv[4]) : 4;
+    const bool zipf = argc > 5 ? std::string(argv[5]) != "uniform" : true;
+    const size_t pool_pages = argc > 6 ? std::stoul(argv[6]) : 4096;
+    const Workload mix = workload_of(w);
+
+    const std::string name = "bench_ycsb.dat";
+    std::remove(name.c_str());
+    getDatabase().getBufferPool().resize(pool_pages);
+    const TupleDesc td({type_t::INT, type_t::INT, type_t::CHAR}, {"key", "version", "payload"});
+    getDatabase().add(std::make_unique<BTreeFile>(name, td, 0));
+    auto &file = static_cast<BTreeFile &>(getDatabase().get(name));
+
+    const auto load_start = std::chrono::steady_clock::now();
+    int32_t next_key = 0;
+    file.bulkLoad([&]() -> std::optional<Tuple> {
+        if (static_cast<size_t>(next_key) == records) return std::nullopt;
+        const int32_t k = next_key++;
+        return row(k, 0);
+    });
+    const double load_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - load_start).count();
+
+    const Zipfian zipfian(records);
+    std::atomic<int32_t> insert_key{static_cast<int32_t>(records)};
+    std::vector<std::vector<uint64_t>> latencies[OP_COUNT];
+    for (auto &l : latencies) {
+        l.resize(threads);
+    }
+    std::atomic<size_t> misses{0};
+
+    const auto run = [&](size_t t) {
+        std::mt19937_64 rng(t + 1);
+        std::uniform_real_distribution<double> pick(0, 1);
+        const auto key = [&] {
+            // 新插入的 key 也可能被读到；上限取当前已插入的最大值
+            const uint64_t n = static_cast<uint64_t>(insert_key.load(std::memory_order_relaxed));
+            return zipf ? scramble(zipfian(rng), records)
+                        : static_cast<int32_t>(std::uniform_int_distribution<uint64_t>(0, n - 1)(rng));
+        };
+        const size_t n = ops / threads + (t < ops % threads ? 1 : 0);
+        for (size_t i = 0; i < n; ++i) {
+            const double p = pick(rng);
+            const Op op = p < mix.read ? READ : p < mix.read + mix.update ? UPDATE
+                                                : p < mix.read + mix.update + mix.insert ? INSERT : SCAN;
+            const auto start = std::chrono::steady_clock::now();
+            switch (op) {
+                case READ: {
+                    const Iterator it = file.find(key());
+                    if (it == file.end()) {
+                        misses.fetch_add(1, std::memory_order_relaxed);
+                    } else {
+                        (void)file.getTuple(it);
+                    }
+                    break;
+                }
+                case UPDATE: {
+                    // 相同 key 再插入即替换
+                    const int32_t k = key();
+                    file.insertTuple(row(k, static_cast<int32_t>(i)));
+                    break;
+                }
+                case INSERT: file.insertTuple(row(insert_key.fetch_add(1), 0)); break;
+                case SCAN: {
+                    const Iterator end = file.end();
+                    Iterator it = file.lowerBound(key());
+                    for (int j = 0; j < SCAN_LENGTH && it != end; ++j, file.next(it)) {
+                        (void)file.getTuple(it);
+                    }
+                    break;
+                }
+                case OP_COUNT: break;
+            }
+            latencies[op][t].push_back(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                            .count()));
+        }
+    };
+
+    const auto run_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back(run, t);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    const double run_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
+
+    std::printf("workload %c, %zu records, %zu ops, %zu threads, %s keys, %zu pool pages\n", w, records, ops,
+                threads, zipf ? "zipfian" : "uniform", pool_pages);
+    std::printf("load: %.3f s (%.0f records/s)\n", load_s, static_cast<double>(records) / load_s);
+    std::printf("run:  %.3f s (%.0f ops/s), %zu reads missed\n", run_s, static_cast<double>(ops) / run_s,
+                misses.load());
+    for (size_t op = 0; op < OP_COUNT; ++op) {
+        std::vector<uint64_t> all;
+        for (const auto &l : latencies[op]) {
+            all.insert(all.end(), l.begin(), l.end());
+        }
+        if (all.empty()) continue;
+        std::sort(all.begin(), all.end());
+        std::printf("  %-6s %9zu ops  p50 %8.2f us  p99 %8.2f us  max %9.2f us\n", op_names[op], all.size(),
+                    static_cast<double>(percentile(all, 0.5)) / 1e3, static_cast<double>(percentile(all, 0.99)) / 1e3,
+                    static_cast<double>(all.back()) / 1e3);
+    }
+    const BufferPoolStats stats = getDatabase().getBufferPool().getStats();
+    std::printf("buffer pool: %llu hits, %llu misses, %llu evictions\n", static_cast<unsigned long long>(stats.hits),
+                static_cast<unsigned long long>(stats.misses), static_cast<unsigned long long>(stats.evictions));
+
+    getDatabase().remove(name).reset();
+    std::remove(name.c_str());
+    return 0;
+}
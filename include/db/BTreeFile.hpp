@@ -1,6 +1,14 @@
 #pragma once
 
+#include <db/BloomFilter.hpp>
 #include <db/DbFile.hpp>
+#include <db/KeyTraits.hpp>
+#include <db/Task.hpp>
+#include <atomic>     // std::atomic
+#include <functional> // std::function
+#include <memory>     // std::unique_ptr
+#include <mutex>      // std::mutex
+#include <optional>   // std::optional
 #include <utility>   // std::pair
 #include <vector>    // std::vector
 #include <cstddef>   // size_t
@@ -11,22 +19,71 @@ namespace db {
 class Tuple;
 class TupleDesc;
 class Iterator;
+class PageGuard;
 
-class IndexPage; // 前置声明，避免在头文件包含实现
-class LeafPage;  // 前置声明
+template <typename K> struct BasicIndexPage; // 前置声明，避免在头文件包含实现
+template <typename K> struct BasicLeafPage;  // 前置声明
+struct UpperLevels;                           // 常驻的上层索引页，定义见 BTreeFile.cpp
+
+// bulkLoad 默认的页填充率：留出少量空位，随后的插入不会立刻引发分裂
+constexpr double DEFAULT_FILL_FACTOR = 0.9;
+
+/**
+ * @brief Pull-style source of tuples for BTreeFile::bulkLoad.
+ * @return The next tuple, or std::nullopt once the source is exhausted.
+ */
+using TupleSource = std::function<std::optional<Tuple>()>;
+
+/**
+ * @brief A B+ tree file ordered by a key of type K.
+ * @details K is one of the types with a KeyTraits specialization: `int32_t`, `double`, CharKey or the composite
+ * IntPairKey. Index and leaf pages store the keys as plain K arrays, so descending the tree never decodes a tuple
+ * field; int32_t keys additionally use the vectorized search of KeySearch.hpp.
+ * @tparam K The key type; use the BTreeFile alias for the original single INT key.
+ * @note Lookups, inserts and deletes may run concurrently. They couple the BufferPool frame latches top-down:
+ * readers hold shared latches on at most a node and its child; an insert first descends with shared latches and
+ * takes only the leaf exclusively, and falls back to exclusive latch crabbing, which releases all ancestors of a
+ * node that cannot split, only when the leaf would split. Leaves are latched left to right. An Iterator is a
+ * position, so concurrent inserts and deletes in its leaf may shift the tuple it refers to. While it is on a leaf it
+ * keeps the leaf pinned (see next()), so BufferPool::resize fails until such iterators are gone.
+ * @note The root and the index level below it are made resident in the BufferPool (BufferPool::pinResident) on first
+ * use, as far as the pool's resident budget allows; lookups, optimistic inserts and begin() latch those frames
+ * directly instead of looking the pages up in the pool.
+ * @note Splits and merges run inside a LogGroup, so with the write-ahead log enabled a crash never leaves a split
+ * half applied.
+ */
+template <typename K>
+class BasicBTreeFile : public DbFile {
+  using IndexPage = BasicIndexPage<K>;
+  using LeafPage = BasicLeafPage<K>;
 
-class BTreeFile : public DbFile {
   // 根页页号恒为 0（文件创建即为索引页）
   static constexpr size_t root_id = 0;
 
-  // 被排序的 key 所在字段下标（整型）
-  size_t key_index;
+  // 组成 key 的字段下标
+  KeyFields<K> key_fields;
+
+  // 保护新页号的分配（numPages++）
+  std::mutex alloc_mtx;
+
+  // 上层索引页常驻缓冲池后的帧表（见 pin_node）；缓冲池放开常驻页后换新表，旧表留到析构，
+  // 没加锁读旧表的线程不会读到释放的内存。upper 指向 upper_tables 的最后一张
+  mutable std::mutex upper_mtx;
+  mutable std::vector<std::unique_ptr<UpperLevels>> upper_tables;
+  mutable std::atomic<UpperLevels *> upper{nullptr};
+
+  // 可选的 key Bloom 过滤器（enableKeyFilter）：插入都记入 key_filter，filter_ready 之后才用它回答查找；
+  // 换下的过滤器同样留到析构
+  std::mutex filter_mtx;
+  std::vector<std::unique_ptr<BloomFilter>> key_filters;
+  std::atomic<BloomFilter *> key_filter{nullptr};
+  std::atomic<bool> filter_ready{false};
 
   // ---------- 私有类型与工具 ----------
   using PathElem = std::pair<size_t /*index page id*/, size_t /*child slot*/>;
 
   struct SplitResult {
-    int32_t up_key = 0;                                     // 上推的中位键
+    K       up_key{};                                       // 上推的中位键
     size_t  new_page_id = static_cast<size_t>(-1);          // 新页id
     bool    did_split = false;                              // 是否发生分裂
   };
@@ -35,8 +92,17 @@ class BTreeFile : public DbFile {
   size_t index_page_max_keys() const;
   size_t leaf_page_max_tuples() const;
 
-  static size_t choose_child_slot(const IndexPage &ip, int32_t key);
-  std::vector<PathElem> descend_path(int32_t key) const;
+  static size_t choose_child_slot(const IndexPage &ip, const K &key);
+  // 以共享 latch 取索引页；upper_level 为真（root 及其下一层）时经常驻帧，不查缓冲池
+  PageGuard pin_node(size_t page_id, bool upper_level) const;
+  // missing 非空时不读盘：下一页不在缓冲池中就停下，把页号记入 *missing 并返回 0（leaf 为空）
+  size_t descend_shared(const K &key, PageGuard &leaf, std::optional<size_t> *missing = nullptr) const;
+  // leaf 为下降到的叶（持共享 latch）；返回 key 所在位置或 end()
+  Iterator find_in_leaf(const PageGuard &leaf, size_t leaf_id, const K &key) const;
+  // 插入写完叶之后把 key 记入过滤器；may_contain 为假时 key 一定不在树中
+  void note_key(const K &key);
+  bool may_contain(const K &key) const;
+  Iterator first_in_chain(PageGuard &guard) const;
 
   // Page 类型来自 types.hpp/DbFile 的 I/O
   Page  read_page(size_t page_id) const;
@@ -45,9 +111,14 @@ class BTreeFile : public DbFile {
 
   void ensure_root_initialized();
 
+  bool insert_optimistic(const Tuple &t, const K &k);
+  void insert_pessimistic(const Tuple &t, const K &k);
+  // 批量插入：从 rows[first] 起，把落在同一叶 key 区间内的元组一次下降插完，返回插入条数
+  size_t insert_run(const std::vector<std::pair<K, const Tuple *>> &rows, size_t first);
+
   SplitResult leaf_insert(size_t leaf_id, const Tuple &t);
   SplitResult index_insert_chain(size_t parent_id, size_t insert_after_child_slot,
-                                 int32_t up_key, size_t right_child_id,
+                                 const K &up_key, size_t right_child_id,
                                  bool child_level_is_leaf);
 
   void split_root_and_rebuild(const SplitResult &root_split, bool child_level_is_leaf);
@@ -55,13 +126,38 @@ class BTreeFile : public DbFile {
   Iterator leftmost_begin() const;
   void     advance_with_leaf_link(Iterator &it) const;
 
+  // 把一批页号连续的新页直接写入文件（不经过 BufferPool）
+  void write_run(std::vector<Page> &run, size_t first_id) const;
+
+  // 删除后的合并：held 为仍持有排他 latch 的索引页（自上而下），slots 为各页通往下一层的槽位
+  void merge_index_levels(std::vector<PageGuard> &held, const std::vector<size_t> &slots);
+  // root 只剩一个孩子且孩子是索引页时把孩子提升为 root，树高减一
+  void collapse_root(std::vector<PageGuard> &held);
+
 public:
   /**
    * @brief Initialize a BTreeFile
    *
+   * @param key_fields the indices of the fields the key is made of, in comparison order
+   * @param compression the on-disk page format (see PageCompression); half-empty leaves compress well.
+   * @param access FileAccess::MMAP_READ_ONLY maps the file; lookups and scans read straight from the mapping, and
+   * every modification throws std::logic_error.
+   * @throws std::logic_error if the field types do not match `KeyTraits<K>::types`.
+   */
+  BasicBTreeFile(const std::string &name, const TupleDesc &td, const KeyFields<K> &key_fields,
+                 PageCompression compression = PageCompression::NONE, FileAccess access = FileAccess::READ_WRITE);
+
+  /**
+   * @brief Initialize a BTreeFile with a single-field key
+   *
    * @param key_index the index of the key in the tuple
    */
-  BTreeFile(const std::string &name, const TupleDesc &td, size_t key_index);
+  BasicBTreeFile(const std::string &name, const TupleDesc &td, size_t key_index,
+                 PageCompression compression = PageCompression::NONE, FileAccess access = FileAccess::READ_WRITE)
+    requires (KeyTraits<K>::types.size() == 1)
+      : BasicBTreeFile(name, td, KeyFields<K>{key_index}, compression, access) {}
+
+  ~BasicBTreeFile() override;
 
   /**
    * @brief Insert a tuple into the file
@@ -73,8 +169,61 @@ public:
    */
   void insertTuple(const Tuple &t) override;
 
+  /**
+   * @brief Insert a batch of tuples
+   * @details The batch is stably sorted by key (so of several tuples with the same key the last one wins, as with
+   * insertTuple one by one). Then one descent per leaf inserts the whole run of keys that falls below the leaf's
+   * upper separator, as long as the leaf has room; a tuple that needs a split goes through the regular insert path.
+   * @param tuples the tuples to insert
+   */
+  void insertTuples(std::span<const Tuple> tuples) override;
+
+  /**
+   * @brief Build the tree bottom-up from tuples sorted by key.
+   * @details Leaves are filled left to right to `fill_factor` of their capacity and chained through `next_leaf`; then
+   * each index level is built from the first keys of the level below until the remaining nodes fit into the root.
+   * New pages are written to the file sequentially in coalesced runs without going through the BufferPool; only
+   * the root is updated in the pool (with the write-ahead log enabled, the new pages are synced before it). A key that repeats the previous one replaces it, like insertTuple.
+   * @param next The source of tuples in ascending key order.
+   * @param fill_factor The fraction of each page to fill, in (0, 1]. Pages are never filled completely, so the
+   * first insert into a page does not have to split it.
+   * @throws std::logic_error if the tree is not empty, `fill_factor` is out of range, a tuple does not match the
+   * schema, or the keys are not in ascending order.
+   */
+  void bulkLoad(const TupleSource &next, double fill_factor = DEFAULT_FILL_FACTOR);
+
+  /**
+   * @brief Build the tree from all tuples of another file.
+   * @details The tuples are stably sorted by key with an ExternalSort, so the source may be larger than memory (of
+   * several tuples with the same key the last one wins), and loaded with bulkLoad(const TupleSource &, double).
+   * @param source The file to load, e.g. a HeapFile with the same schema.
+   * @param fill_factor The fraction of each page to fill, in (0, 1].
+   */
+  void bulkLoad(const DbFile &source, double fill_factor = DEFAULT_FILL_FACTOR);
+
+  /**
+   * @brief Delete the tuple an iterator points to.
+   * @details The slot is removed from its leaf. Merging is lazy: only a leaf that falls below a quarter of its
+   * capacity is merged with an adjacent leaf of the same parent, or evens out its tuples with it if both do not fit
+   * into one page. A merge removes a separator from the parent, which is merged in turn once it is underfull, and a
+   * root left with a single index child is replaced by that child, so height and leaf count follow the live data.
+   * @param it The iterator to the tuple to delete.
+   * @throws std::out_of_range if the iterator does not point to a tuple of this file.
+   * @note Deleting invalidates all other iterators into the tree; re-seek with lowerBound to continue a scan.
+   * Pages freed by a merge are unlinked from the tree but not reused.
+   */
   void deleteTuple(const Iterator &it) override;
 
+  /**
+   * @brief Delete the tuple with the given key.
+   * @details Same as deleteTuple, but the tuple is located under the latches of the delete itself, so it is the
+   * form to use while other threads modify the tree.
+   * @param key The key of the tuple to delete.
+   * @return Whether a tuple with this key existed.
+   * @note Like find(), consults the key filter first.
+   */
+  bool erase(const K &key);
+
   /**
    * @brief Get a tuple from the database file.
    * @details Get a tuple from the database file by reading the tuple from the page.
@@ -83,11 +232,16 @@ public:
    */
   Tuple getTuple(const Iterator &it) const override;
 
+  TupleView getView(const Iterator &it) const override;
+
   /**
    * @brief Advance the iterator to the next tuple.
    * @details Advance the iterator to the next tuple by moving to the next slot of the page.
    * If the iterator is at the end of the page, move to the next page.
    * @param it The iterator to be advanced.
+   * @note The iterator keeps its leaf pinned, without a latch, from the first getTuple, getView or next on it until
+   * it moves to another leaf or is destroyed; steps within the leaf only take the frame's shared latch, so the
+   * BufferPool is looked up once per leaf. Inside a Snapshot every call fetches the leaf the snapshot sees.
    */
   void next(Iterator &it) const override;
 
@@ -104,6 +258,87 @@ public:
    * @return The iterator to the end of the file.
    */
   Iterator end() const override;
+
+  /**
+   * @brief Find the tuple with the given key.
+   * @details Descend from the root with the same separator logic as insertTuple, then binary-search the leaf; this
+   * costs one page access per level instead of a scan of the leaf chain.
+   * @param key The key to look up.
+   * @return The iterator to the tuple, or `end()` if there is no tuple with this key.
+   * @note With a key filter (enableKeyFilter), a key the filter rules out returns `end()` without touching a page.
+   */
+  Iterator find(const K &key) const;
+
+  /**
+   * @brief Asynchronous find().
+   * @details The descent stops at the first page that is not in the BufferPool, releases its latches, waits for the
+   * page with BufferPool::getPageAsync (keeping it pinned) and starts again from the root. Inside an IoScheduler the
+   * pages of all probes waiting at the same time are read in one batch, so one thread can keep hundreds of lookups'
+   * reads in flight; outside a scheduler it behaves like find().
+   * @note The key is copied into the coroutine; the Iterator refers to this file, which must outlive the Task.
+   */
+  Task<Iterator> findAsync(K key) const;
+
+  /**
+   * @brief Get the iterator to the first tuple whose key is not less than `key`.
+   * @param key The key to seek to.
+   * @return The iterator to the tuple, or `end()` if every key is less than `key`.
+   * @note The iterator is positioned exactly where next() would land, so it can be compared with a scanning iterator.
+   */
+  Iterator lowerBound(const K &key) const;
+
+  /**
+   * @brief Get the tuples with keys in [lo, hi).
+   * @return The pair {lowerBound(lo), lowerBound(hi)}; both are equal if the range is empty or `hi <= lo`.
+   */
+  std::pair<Iterator, Iterator> range(const K &lo, const K &hi) const;
+
+  /**
+   * @brief Read the tuples of the current leaf.
+   * @details The leaf is fetched from the BufferPool once; when it is exhausted the iterator follows `next_leaf`.
+   */
+  size_t scanPage(Iterator &it, std::vector<Tuple> &out, size_t limit) const override;
+
+  /**
+   * @brief Read the tuples of the current leaf that satisfy a predicate.
+   * @details A predicate on the key field of an `int32_t` or `double` tree is evaluated over the leaf's dense key
+   * array in one pass (slotted leaves); any other predicate is evaluated row by row on the tuple bytes. Only
+   * matching tuples are deserialized.
+   */
+  size_t scanPageWhere(Iterator &it, std::vector<Tuple> &out, size_t limit, const Predicate &pred) const override;
+
+  /**
+   * @brief Split the tree into ranges of leaves.
+   * @details The tree is expanded level by level from the root until a level has at least `parts` subtrees (or the
+   * leaves are reached); each range starts at the first tuple of the leftmost leaf of an evenly spaced subtree, so
+   * the ranges are contiguous key ranges of about the same number of leaves. Costs a few index pages per level.
+   */
+  std::vector<Iterator> split(size_t parts) const override;
+
+  /**
+   * @brief Keep an in-memory Bloom filter of the keys, so find() and erase() answer most lookups of absent keys
+   * without descending the tree.
+   * @details The filter is sized for `expected_keys` keys and filled with the keys in the file; every later insert
+   * adds its key. Deletes leave their keys in the filter, which only costs false positives. The filter is not
+   * persisted. Call it again to rebuild the filter once the file outgrows it or after many deletes.
+   * @param expected_keys The number of keys to size the filter for; past it the false positive rate grows.
+   * @param bits_per_key Bits of filter per key; the default gives about 1% false positives.
+   * @throws std::logic_error if bits_per_key is 0.
+   * @note Safe to call while other threads insert and look up; lookups keep descending until the filter is built.
+   */
+  void enableKeyFilter(size_t expected_keys, size_t bits_per_key = DEFAULT_BLOOM_BITS_PER_KEY);
+
+  /**
+   * @brief Drop the key filter; lookups descend the tree again.
+   */
+  void disableKeyFilter();
+
+  /**
+   * @brief The key filter find() consults, or nullptr if there is none.
+   */
+  const BloomFilter *getKeyFilter() const;
 };
 
+using BTreeFile = BasicBTreeFile<int32_t>;
+
 } // namespace db
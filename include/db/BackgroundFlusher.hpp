@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+namespace db {
+    class BufferPool;
+
+    constexpr size_t DEFAULT_CLEAN_FRAMES = 8;
+    constexpr std::chrono::milliseconds DEFAULT_FLUSH_INTERVAL{10};
+
+/**
+ * @brief Background dirty-page writer for a BufferPool.
+ * @details A worker thread periodically (and whenever a miss had to write a dirty victim itself) writes back the
+ * dirty pages among the coldest unpinned frames of every shard, so the frames the replacement policy picks next are
+ * already clean and a miss only pays for its read. Written pages are sorted by (file, page) and adjacent pages are
+ * coalesced into one `pwritev`.
+ * @note Write-back is best effort: a failed write leaves the pages dirty for the next pass or for eviction.
+ */
+    class BackgroundFlusher {
+        BufferPool &pool;
+        const size_t clean_frames;
+        const std::chrono::milliseconds interval;
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool pending{false};
+        bool stopping{false};
+
+        std::thread worker;
+
+        void run();
+
+    public:
+        /**
+         * @param pool The pool whose dirty pages are written back.
+         * @param clean_frames The number of coldest frames per shard to keep clean.
+         * @param interval The time between two passes when nothing wakes the flusher earlier.
+         */
+        BackgroundFlusher(BufferPool &pool, size_t clean_frames, std::chrono::milliseconds interval);
+
+        /**
+         * @brief Stops the background thread after the pass in progress, if any.
+         */
+        ~BackgroundFlusher();
+
+        BackgroundFlusher(const BackgroundFlusher &) = delete;
+
+        BackgroundFlusher &operator=(const BackgroundFlusher &) = delete;
+
+        size_t getCleanFrames() const;
+
+        std::chrono::milliseconds getInterval() const;
+
+        /**
+         * @brief Start a pass now instead of at the end of the interval.
+         */
+        void wake();
+    };
+} // namespace db
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace db {
+    /// Default size of a BloomFilter per key; about 1% of absent keys pass the filter.
+    constexpr size_t DEFAULT_BLOOM_BITS_PER_KEY = 10;
+
+/**
+ * @brief In-memory split-block Bloom filter over 64-bit key hashes.
+ * @details The filter is an array of 256-bit blocks. A hash picks one block and sets one bit in each of its eight
+ * 32-bit words, so adding or probing a key touches a single cache line.
+ * @note add() and mayContain() may run concurrently: bits are set with relaxed atomic ORs and never cleared.
+ */
+    class BloomFilter {
+        static constexpr size_t WORDS_PER_BLOCK = 8;
+
+        std::unique_ptr<std::atomic<uint32_t>[]> words;
+        size_t blocks;
+
+    public:
+        /**
+         * @brief Size the filter for `keys` keys at `bits_per_key` bits each (at least one block).
+         */
+        BloomFilter(size_t keys, size_t bits_per_key = DEFAULT_BLOOM_BITS_PER_KEY);
+
+        void add(uint64_t hash);
+
+        /**
+         * @brief Whether a key with this hash may have been added; false means it certainly was not.
+         */
+        bool mayContain(uint64_t hash) const;
+
+        /// Size of the bit array in bytes.
+        size_t sizeBytes() const { return blocks * WORDS_PER_BLOCK * sizeof(uint32_t); }
+
+        /**
+         * @brief A 64-bit hash of `n` bytes, suitable for add() and mayContain().
+         */
+        static uint64_t hash(const void *data, size_t n);
+    };
+} // namespace db
@@ -1,13 +1,72 @@
 #pragma once
 
+#include <db/BackgroundFlusher.hpp>
+#include <db/IoEngine.hpp>
+#include <db/IoScheduler.hpp>
+#include <db/LogManager.hpp>
+#include <db/ReadAhead.hpp>
 #include <db/types.hpp>
+#include <db/VersionStore.hpp>
+#include <atomic>
+#include <coroutine>
+#include <deque>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace db {
     constexpr size_t DEFAULT_NUM_PAGES = 50;
+    constexpr size_t DEFAULT_SCAN_RING_PAGES = 8;
+    // 常驻页（pinResident）至多占帧数的 1 / RESIDENT_FRACTION
+    constexpr size_t RESIDENT_FRACTION = 8;
+
+    class PageGuard;
+    class PageFetch;
+    class LogGroup;
+    class Snapshot;
+
+    /**
+     * @brief Page replacement policy of a BufferPool.
+     * @details LRU keeps an exact recency list. CLOCK keeps a reference bit per frame and sweeps a clock hand over
+     * the frames on a miss; a hit is a single store, and pages touched only once (e.g. by a scan) are evicted before
+     * pages that were referenced again.
+     */
+    enum class ReplacementPolicy {
+        LRU, CLOCK
+    };
+
+    /**
+     * @brief How the caller is going to use a page.
+     * @details NORMAL pages take part in the regular replacement policy. SCAN pages (e.g. from a sequential scan
+     * that will not revisit them) are admitted as the coldest pages and recycled through a small ring of frames,
+     * so a large scan does not push the rest of the working set out of the pool.
+     */
+    enum class AccessIntent {
+        NORMAL, SCAN
+    };
+
+    /**
+     * @brief Content latch a PageGuard takes on its frame.
+     */
+    enum class LatchMode {
+        NONE, SHARED, EXCLUSIVE
+    };
+
+    /**
+     * @brief Counters of a BufferPool since it was created (see BufferPool::getStats).
+     * @details Pages of read-only mapped files are served from the mapping and are not counted.
+     */
+    struct BufferPoolStats {
+        uint64_t hits{0};         ///< Page requests served from a frame.
+        uint64_t misses{0};       ///< Page requests that had to read the page.
+        uint64_t prefetched{0};   ///< Pages read ahead of use by prefetch() or read-ahead.
+        uint64_t evictions{0};    ///< Pages dropped to free a frame for another page.
+        uint64_t flushes{0};      ///< Dirty pages written back.
+    };
 
 /**
  * @brief Represents a buffer pool for database pages.
@@ -15,22 +74,195 @@ namespace db {
  * It provides functions to get a page, mark a page as dirty, and check the status of pages.
  * The class also supports flushing pages to disk and discarding pages from the buffer pool.
  * @note A BufferPool owns the Page objects that are stored in it.
+ * @note A page can be pinned; pinned pages are never evicted or discarded, so a `Page &` to a pinned page stays
+ * valid across later calls to getPage. Use PageGuard to pin a page for the duration of a scope.
+ * @note The pool is thread-safe. Pages are hash-partitioned across shards; each shard owns a contiguous range of
+ * frames with its own mapping table, replacement state and mutex, so lookups and evictions in different shards
+ * never contend. Every frame also has a reader/writer latch that PageGuard can hold to protect the page contents.
+ * Concurrent users must access pages through PageGuard: an unpinned `Page &` may be evicted by another thread.
+ * @note Pages of files opened with FileAccess::MMAP_READ_ONLY never enter a frame: getPage and pinPage return the
+ * page inside the file's mapping, which stays valid while the file is open. Read-ahead on such files becomes
+ * `madvise` hints.
+ * @note With the write-ahead log enabled (enableLog), PageGuard::markDirty defers logging the page until the marking
+ * thread's guard on it is released (or, inside a LogGroup, until the group ends), so the record reflects the finished
+ * change; until then the page is not written back. BufferPool::markDirty logs the page right away. Every frame remembers the LSN of its last record, and a page is
+ * only written once the log is durable up to it, so commit() makes changes durable without writing data pages.
+ * Every frame also remembers the end of the log when it was first marked dirty after being written (its recovery
+ * LSN); checkpoint() records these as the dirty-page table, which bounds how much of the log a restart reads.
+ * @note With versioning enabled (enableVersioning), a thread holding a Snapshot reads every page as it was when the
+ * snapshot was taken: a writer that latches a page exclusively leaves a copy of it behind, which pinPage and getPage
+ * hand to snapshot readers once the page has changed. Readers of old versions take no latch, and writers never wait
+ * for them; readers of the current content hold the shared latch for one page at a time, as other readers do.
  */
     class BufferPool {
         // TODO pa0: add private members
-        std::array<Page, DEFAULT_NUM_PAGES> pages;
-        std::array<PageId, DEFAULT_NUM_PAGES> pos_to_pid;
-        std::unordered_map< PageId, size_t> pid_to_pos;
-        std::unordered_set<size_t> dirty;
-        std::vector<size_t> available;
-        std::list<size_t> lru_list;
-        std::unordered_map<size_t, std::list<size_t>::iterator> pos_to_lru;
+        struct FrameDeleter {
+            void operator()(Page *frames) const;
+        };
+
+        // 一个分片：独占帧区间 [first, first + count)，其映射表与替换状态由 mtx 保护
+        struct Shard {
+            mutable std::mutex mtx;
+            size_t first{0};
+            size_t count{0};
+            std::unordered_map<PageId, size_t> pid_to_pos;
+            std::unordered_set<size_t> dirty;
+            std::vector<size_t> available;
+            std::list<size_t> lru_list;
+            std::unordered_map<size_t, std::list<size_t>::iterator> pos_to_lru;
+            size_t clock_hand{0};           // 相对 first 的偏移
+            std::deque<size_t> scan_ring;   // SCAN 调入的帧，最老的在前
+            // 计数，在分片锁内更新
+            uint64_t hits{0};
+            uint64_t misses{0};
+            uint64_t prefetched{0};
+            uint64_t evictions{0};
+        };
+
+        size_t capacity;
+        ReplacementPolicy policy;
+        std::unique_ptr<Page[], FrameDeleter> pages;   // 单次（大页对齐）分配的帧数组
+        // 以下按帧下标索引；某帧的元数据只在其所属分片的锁内访问
+        std::vector<PageId> pos_to_pid;
+        std::vector<size_t> pin_count;
+        std::vector<uint8_t> ref_bit;   // CLOCK: 每帧的引用位
+        std::unique_ptr<std::shared_mutex[]> latches;
+        std::vector<std::unique_ptr<Shard>> shards;
+        IoEngine io;
+        size_t scan_ring_pages{DEFAULT_SCAN_RING_PAGES};
+        std::unique_ptr<ReadAhead> read_ahead;   // 为空表示未开启预读
+        // 后台写回期间持有；flushPage/flushFile 先取它，保证返回时在途的写回也已落盘
+        std::mutex writeback_mtx;
+        std::unique_ptr<BackgroundFlusher> flusher;   // 为空表示未开启后台写回
+        std::atomic<uint64_t> flushes{0};   // 写回的脏页数；写回可能在分片锁外进行，所以不记在分片里
+
+        // 预写日志，为空表示未开启；以下按帧下标索引
+        std::unique_ptr<LogManager> wal;
+        std::unique_ptr<std::atomic<lsn_t>[]> page_lsn;     // 帧内容最后一条日志记录的 LSN
+        std::unique_ptr<std::atomic<uint8_t>[]> need_image; // 写回（或调入）后还没记过日志：下一条须为整页
+        std::unique_ptr<std::atomic<lsn_t>[]> rec_lsn;      // 上次写回后第一次置脏时的日志尾；干净为 NO_LSN
+        std::vector<std::unique_ptr<Page>> logged;          // 帧上次记日志时的内容，用来求差量
+        std::vector<uint32_t> hold;   // 改动尚未记录或所在 LogGroup 未结束，不能写回；分片锁内访问
+        std::mutex unsynced_mtx;
+        std::unordered_set<file_id_t> unsynced;             // 上次检查点后写回过页的文件
+
+        // 多版本，为空表示未开启；before 按帧下标索引：帧当前内容的副本，写者加排他 latch 时拷贝
+        std::unique_ptr<VersionStore> versions;
+        std::vector<std::shared_ptr<const Page>> before;
+
+        // 常驻页：各持一个 pin，放开时 resident_epoch 递增，调用方缓存的帧随之作废
+        std::mutex resident_mtx;
+        std::vector<PageId> resident;
+        std::atomic<uint64_t> resident_epoch{0};
+
+        friend class PageGuard;
+        friend class BackgroundFlusher;
+        friend class LogGroup;
+        friend class Snapshot;
+
+        Shard &shardOf(const PageId &pid) const;
+        void layoutShards(size_t num_pages);
+
+        size_t scanRingLimit(const Shard &shard) const;
+        bool takeFromScanRing(Shard &shard, size_t &pos);
+        void leaveScanRing(Shard &shard, size_t pos);
+
+        void touch(Shard &shard, size_t pos);
+        void admit(Shard &shard, size_t pos, AccessIntent intent);
+        size_t chooseVictim(Shard &shard);
+        std::vector<size_t> residentByRecency(const Shard &shard) const;
+        void resizeFrames(size_t num_pages);
+        std::vector<size_t> coldestUnpinned(const Shard &shard, size_t n) const;
+
+        // 按 (file, page) 排序后写出，相邻页合并为一次 pwritev
+        void writeSorted(std::vector<size_t> &positions);
+        // 后台写回：把分片最冷的 target 个未 pin 帧中的脏页写回
+        void cleanShard(size_t s, size_t target);
+
+        // 以下均要求调用方已持有 shard.mtx
+        size_t reserveFrameLocked(Shard &shard, AccessIntent intent);
+        size_t fetchLocked(Shard &shard, const PageId &pid, AccessIntent intent);
+        void flushBatchLocked(Shard &shard, std::vector<size_t> &positions);
+        void flushLocked(Shard &shard, const PageId &pid);
+        void discardLocked(Shard &shard, const PageId &pid);
+
+        // 取页并 pin 住，返回帧下标（供 PageGuard 使用）
+        size_t acquire(const PageId &pid, AccessIntent intent);
+
+        // 以 FileAccess::MMAP_READ_ONLY 打开的文件的页不占帧，直接取映射中的页；其它情况为 nullptr
+        static Page *mapped(const PageId &pid);
+
+        // 预写日志：为本线程置脏的帧生成记录；组内只收集，组结束时整体追加
+        void allocateLogState(size_t num_pages);
+        void setDirty(const PageId &pid, bool defer);
+        void logFrame(size_t pos, const PageId &pid);
+        void logIfPending(size_t pos, const PageId &pid);
+        void unhold(size_t pos, const PageId &pid, lsn_t lsn);
+        void beginGroup();
+        void endGroup();
+        // 写回前先让日志落盘到这些帧的 LSN；写回后计数，并记下文件待同步、下一条记录为整页
+        void logBeforeWrite(const std::vector<size_t> &positions);
+        void noteWritten(const std::vector<size_t> &positions);
+
+        // 多版本：写操作的时间戳按线程分配，组内共用一个，最外层组结束时提交
+        void captureBefore(size_t pos);
+        void noteModified(size_t pos, const PageId &pid);
+        void commitVersions();
+        void openSnapshot();
+        void closeSnapshot();
 
     public:
         /**
-         * @brief: Constructs a BufferPool object with the default number of pages.
+         * @brief: Constructs a BufferPool object with the specified number of pages.
+         * @param num_pages: The number of frames in the pool.
+         * @param policy: The page replacement policy.
+         * @param num_shards: The number of independently latched partitions; each gets an equal share of frames.
+         * @throws std::logic_error if num_pages is 0, num_shards is 0 or num_shards > num_pages.
+         * @note All frames are carved out of one allocation, aligned to 2 MiB (and advised as huge-page backed)
+         * when the pool is at least that large.
+         * @note Replacement decisions (LRU order, CLOCK hand, scan ring) are made per shard.
          */
-        explicit BufferPool();
+        explicit BufferPool(size_t num_pages = DEFAULT_NUM_PAGES,
+                            ReplacementPolicy policy = ReplacementPolicy::LRU,
+                            size_t num_shards = 1);
+
+        /**
+         * @brief: Returns the page replacement policy of the pool.
+         */
+        ReplacementPolicy getPolicy() const;
+
+        /**
+         * @brief: Returns the number of frames in the pool.
+         */
+        size_t getNumPages() const;
+
+        /**
+         * @brief: Returns the number of shards of the pool.
+         */
+        size_t getNumShards() const;
+
+        /**
+         * @brief: Returns the pool's counters.
+         * @details Each shard counts under its own lock, so counting adds no shared cache line to the hot path;
+         * the totals are summed shard by shard and are not an atomic snapshot while other threads use the pool.
+         */
+        BufferPoolStats getStats() const;
+
+        /**
+         * @brief: Returns whether the calling thread reads the pool through a Snapshot.
+         */
+        bool inSnapshot() const;
+
+        /**
+         * @brief: Changes the number of frames in the pool.
+         * @param num_pages: The new number of frames.
+         * @details The most recently used pages are kept (with their dirty state) up to the new capacity; any
+         * other page is flushed if dirty and dropped.
+         * Resident pages (pinResident) are released first.
+         * @throws std::logic_error if num_pages is 0 or less than the number of shards, or if any page is pinned.
+         * @note Must not run concurrently with any other use of the pool.
+         */
+        void resize(size_t num_pages);
 
         /**
          * @brief: Destructs a BufferPool object after flushing all dirty pages to disk.
@@ -48,14 +280,251 @@ namespace db {
         /**
          * @brief: Returns the page with the specified page id.
          * @param pid: The page id of the page to return.
+         * @param intent: How the page is going to be used; see AccessIntent.
          * @return: The page with the specified page id.
-         * @note This method should make this page the most recently used page.
+         * @note This method should make this page the most recently used page (LRU) or set its reference bit (CLOCK).
+         * @note With AccessIntent::SCAN a hit does not change the page's recency, and a miss reuses the oldest frame
+         * of the scan ring once the ring holds min(DEFAULT_SCAN_RING_PAGES, shard frames / 4) frames (the ring is
+         * larger while read-ahead is enabled).
+         * @note The returned page is not pinned; it may be evicted by a later call unless it is pinned.
+         * @throws std::runtime_error if the page is not cached and every frame is pinned.
+         * @note Inside a Snapshot the version the snapshot sees is returned; an old version stays valid until the
+         * snapshot ends.
+         */
+        Page &getPage(const PageId &pid, AccessIntent intent = AccessIntent::NORMAL);
+
+        /**
+         * @brief: Returns the page with the specified page id and pins it.
+         * @param pid: The page id of the page to return.
+         * @param intent: How the page is going to be used; see AccessIntent.
+         * @param latch: The content latch to hold on the frame while the guard is alive.
+         * @return: A guard that unpins the page when it goes out of scope.
+         * @throws std::logic_error if the page belongs to a read-only mapped file and latch is LatchMode::EXCLUSIVE.
+         * @throws std::logic_error if latch is LatchMode::EXCLUSIVE and the calling thread holds a Snapshot.
+         * @note Inside a Snapshot the guard holds the version the snapshot sees: either the current page under a
+         * shared latch (whatever latch was asked for), or an old version with no pin and no latch.
+         */
+        PageGuard pinPage(const PageId &pid, AccessIntent intent = AccessIntent::NORMAL,
+                          LatchMode latch = LatchMode::NONE);
+
+        /**
+         * @brief: Returns an awaitable for the page with the specified page id: `co_await pool.getPageAsync(pid)`
+         * gives the same guard as pinPage(pid, intent, latch).
+         * @details If the page is cached (see isCached) or the calling thread runs no IoScheduler, the page is pinned
+         * right away. Otherwise the coroutine is suspended, and the IoScheduler loads the page together with the
+         * pages its other coroutines wait for before it resumes the coroutine and pins the page.
+         * @note The latch is taken after the coroutine resumes, never held while it is suspended.
+         */
+        PageFetch getPageAsync(const PageId &pid, AccessIntent intent = AccessIntent::NORMAL,
+                               LatchMode latch = LatchMode::NONE);
+
+        /**
+         * @brief: Returns whether pinning the page needs no read: it is in the pool or in a read-only mapping.
+         */
+        bool isCached(const PageId &pid) const;
+
+        /**
+         * @brief: Pins a page until it is released with releaseResident, for pages used by nearly every operation
+         * (e.g. the upper levels of a B-tree), so callers can keep the frame and skip the page lookup.
+         * @param pid: The page id of the page to pin.
+         * @return: The frame holding the page, or nullptr if resident pages already take
+         * getNumPages() / RESIDENT_FRACTION frames. Read the frame through latchResident. For a read-only mapped
+         * file the page in the mapping is returned.
+         * @throws std::runtime_error if the page is not cached and every frame is pinned.
+         * @note The frame stays valid while getResidentEpoch() returns the value it had before the call. resize,
+         * enableLog and Database::remove release resident pages and advance the epoch.
+         */
+        Page *pinResident(const PageId &pid);
+
+        /**
+         * @brief: Unpins the resident pages of a file, or of every file if file is INVALID_FILE_ID.
+         */
+        void releaseResident(file_id_t file = INVALID_FILE_ID);
+
+        /**
+         * @brief: Returns the number of times resident pages were released.
+         */
+        uint64_t getResidentEpoch() const { return resident_epoch.load(std::memory_order_acquire); }
+
+        /**
+         * @brief: Returns a guard holding the shared latch of a frame returned by pinResident, without looking the
+         * page up.
+         * @details The guard takes no pin of its own; the resident pin keeps the page in its frame. Inside a Snapshot
+         * use pinPage instead, which returns the version the snapshot sees.
+         */
+        PageGuard latchResident(const PageId &pid, Page *frame);
+
+        /**
+         * @brief: Loads the specified pages into the pool with batched reads.
+         * @param pids: The pages to load; pages that are already cached are left alone.
+         * @param intent: How the pages are going to be used; see AccessIntent.
+         * @details The uncached pages of each shard are read with a single IoEngine batch (one system call with
+         * io_uring). At most half of a shard's frames are filled by one call.
+         */
+        void prefetch(const std::vector<PageId> &pids, AccessIntent intent = AccessIntent::NORMAL);
+
+        /**
+         * @brief: Turns on background read-ahead.
+         * @param max_window: The largest number of pages loaded ahead of a cursor.
+         * @details The window is further limited to half of a shard's scan ring, which is enlarged to hold two
+         * windows (but never more than a quarter of a shard), so read-ahead pages are not recycled before use.
+         * @note Must not run concurrently with any other use of the pool.
+         */
+        void enableReadAhead(size_t max_window = DEFAULT_READ_AHEAD_PAGES);
+
+        /**
+         * @brief: Turns off background read-ahead; pending loads are dropped.
+         * @note Must not run concurrently with any other use of the pool.
+         */
+        void disableReadAhead();
+
+        /**
+         * @brief: Reports that a sequential cursor moved onto a page; see ReadAhead::onSequential.
+         * @note No-op unless read-ahead is enabled.
+         */
+        void readAhead(const PageId &pid, size_t num_pages);
+
+        /**
+         * @brief: Reports that a cursor moved onto a page of a linked chain; see ReadAhead::onChain.
+         * @note No-op unless read-ahead is enabled.
+         */
+        void readAheadChain(const PageId &pid, NextPageFn next);
+
+        /**
+         * @brief: Waits until all queued read-ahead loads have finished.
+         */
+        void drainReadAhead();
+
+        /**
+         * @brief: Starts a background thread that keeps the coldest frames of every shard clean.
+         * @param clean_frames: The number of coldest unpinned frames per shard (capped at a quarter of the shard)
+         * whose dirty pages are written back ahead of eviction.
+         * @param interval: The time between two passes; a miss that has to write a dirty victim starts one early.
+         * @details While the writer keeps up, evictions pick clean frames and a miss costs one read. See
+         * BackgroundFlusher.
+         * @note Must not run concurrently with any other use of the pool.
+         */
+        void enableBackgroundFlush(size_t clean_frames = DEFAULT_CLEAN_FRAMES,
+                                   std::chrono::milliseconds interval = DEFAULT_FLUSH_INTERVAL);
+
+        /**
+         * @brief: Stops the background writer; pages it has not written stay dirty.
+         * @note Must not run concurrently with any other use of the pool.
+         */
+        void disableBackgroundFlush();
+
+        /**
+         * @brief: Returns whether batched I/O goes through io_uring.
+         */
+        bool usesIoUring() const;
+
+        /**
+         * @brief: Turns on the write-ahead log, after replaying the log a crash left at `path`.
+         * @details The log is read from the redo point of its last checkpoint (see LogManager::read()), and the
+         * changes are partitioned by page across `redo_threads` threads; each thread reads its pages, applies their
+         * changes in log order and writes them back, so pages are recovered in parallel while every page still sees
+         * its changes in order. Records of files that are not in the Database are skipped. The recovered files are
+         * synced, cached copies are dropped, and the log is started empty. From then on every change marked with
+         * markDirty is logged; see LogManager.
+         * @param redo_threads The number of redo threads; 0 for the number of hardware threads.
+         * @throws std::runtime_error if the log cannot be read or created, or a page cannot be read or written.
+         * @throws std::logic_error if a page to recover is pinned (resident pages are released first).
+         * @note Call it at startup, after adding the files and before using them; must not run concurrently with any
+         * other use of the pool. Pages written outside the pool (unbuffered HeapFiles) are not logged.
+         */
+        void enableLog(const std::string &path, size_t redo_threads = 0);
+
+        /**
+         * @brief: Flushes and closes the write-ahead log.
+         * @note Must not run concurrently with any other use of the pool.
+         */
+        void disableLog();
+
+        /**
+         * @brief: Returns whether the write-ahead log is enabled.
+         */
+        bool isLogEnabled() const;
+
+        /**
+         * @brief: Returns the write-ahead log, or nullptr if it is not enabled.
+         */
+        LogManager *getLog() const;
+
+        /**
+         * @brief: Makes every change logged so far durable.
+         * @details Flushes the log (group commit: threads committing at the same time share one `fdatasync`); no
+         * data page is written. No-op unless the log is enabled.
+         */
+        void commit();
+
+        /**
+         * @brief: Takes a fuzzy checkpoint.
+         * @details Collects the dirty-page table (every frame with changes that may not be on disk, with its recovery
+         * LSN), syncs the files pages were written to since the last checkpoint, and records the table in the log
+         * (LogManager::checkpoint()). Pages are not written and other threads keep working, so the checkpoint is
+         * cheap enough to take often; restart then only reads the log from the oldest recovery LSN, and the log
+         * space before it is released. Changes of an unfinished LogGroup are not in the log yet and need no entry.
+         * @param write_pages Write the dirty pages first (except those with unlogged changes), so the table is almost
+         * empty and nearly the whole log can be released.
+         * @throws std::logic_error if the log is not enabled.
+         */
+        void checkpoint(bool write_pages = false);
+
+        /**
+         * @brief: Turns on multi-versioning, so threads can read through a Snapshot.
+         * @details From then on every exclusive latch a writer takes on a frame copies the page once (until it
+         * changes), and the changes of each operation — one markDirty, or all of a LogGroup — get a timestamp in a
+         * VersionStore.
+         * @note Must not run concurrently with any other use of the pool. Writers must hold the exclusive latch of a
+         * page while they change it and mark it dirty; pages changed without it have no old version, and snapshots
+         * see their current content.
+         */
+        void enableVersioning();
+
+        /**
+         * @brief: Turns off multi-versioning and drops all old versions.
+         * @throws std::logic_error if a Snapshot is open on the calling thread.
+         * @note Must not run concurrently with any other use of the pool.
+         */
+        void disableVersioning();
+
+        /**
+         * @brief: Returns whether multi-versioning is enabled.
+         */
+        bool isVersioningEnabled() const;
+
+        /**
+         * @brief: Returns the version store, or nullptr if versioning is not enabled.
+         */
+        VersionStore *getVersions() const;
+
+        /**
+         * @brief: Increments the pin count of a page that is in the buffer pool.
+         * @param pid: The page id of the page to pin.
+         * @throws std::logic_error if the page is not in the buffer pool.
+         */
+        void pin(const PageId &pid);
+
+        /**
+         * @brief: Decrements the pin count of a page.
+         * @param pid: The page id of the page to unpin.
+         * @note Unpinning a page that is not pinned has no effect. A change this thread marked through a PageGuard
+         * and has not logged yet is logged first.
+         */
+        void unpin(const PageId &pid);
+
+        /**
+         * @brief: Returns whether the page with the specified page id is pinned.
+         * @param pid: The page id of the page to check.
+         * @return: True if the page is in the buffer pool and has a non-zero pin count.
          */
-        Page &getPage(const PageId &pid);
+        bool isPinned(const PageId &pid) const;
 
         /**
          * @brief: Marks the page with the specified page id as dirty.
          * @param pid: The page id of the page to mark as dirty.
+         * @note With the log enabled the page is logged at once, so call it after the change is complete; use
+         * PageGuard::markDirty to mark a page before changing it.
          */
         void markDirty(const PageId &pid);
 
@@ -78,6 +547,7 @@ namespace db {
          * @param pid: The page id of the page to discard.
          * @note This method does NOT flush the page to disk.
          * @note This method also updates the LRU and dirty pages to exclude tracking this page.
+         * @throws std::logic_error if the page is pinned, or its change has not been logged yet.
          */
         void discardPage(const PageId &pid);
 
@@ -85,14 +555,164 @@ namespace db {
          * @brief: Flushes the page with the specified page id to disk.
          * @param pid: The page id of the page to flush.
          * @note This method should remove the page from dirty pages.
+         * @note Also waits for a background write-back of the page that is in progress.
+         * @note With the log enabled, the log is flushed up to the page first, and a page whose change is not logged
+         * yet stays dirty.
          */
         void flushPage(const PageId &pid);
 
         /**
          * @brief: Flushes all dirty pages in the specified file to disk.
          * @param file: The name of the associated file.
-         * @note This method should call BufferPool::flushPage(pid).
+         * @note The dirty pages are written in (file, page) order; runs of adjacent pages are coalesced into one
+         * `pwritev`, the remaining single pages go out as one IoEngine batch per shard.
          */
         void flushFile(const std::string &file);
+
+        /**
+         * @brief: Flushes all dirty pages in the file with the specified id to disk.
+         * @param file: The id of the associated file.
+         */
+        void flushFile(file_id_t file);
+    };
+
+/**
+ * @brief RAII handle to a pinned BufferPool page.
+ * @details The page stays pinned (and therefore resident) for the lifetime of the guard. Optionally the guard also
+ * holds the frame's shared or exclusive content latch.
+ */
+    class PageGuard {
+        BufferPool *pool{nullptr};
+        PageId pid{};
+        Page *page{nullptr};
+        size_t pos{0};
+        LatchMode latch{LatchMode::NONE};
+        bool pinned{true};   // 常驻页（latchResident）只加 latch，不另 pin
+        std::shared_ptr<const Page> version;   // 快照读到的旧版本：不 pin、不加 latch，由它保活
+
+        friend class BufferPool;
+
+        // 只读映射中的页：不 pin、不加 latch
+        PageGuard(const PageId &pid, Page *page) : pid(pid), page(page) {}
+
+        PageGuard(const PageId &pid, std::shared_ptr<const Page> version)
+            : pid(pid), page(const_cast<Page *>(version.get())), version(std::move(version)) {}
+
+    public:
+        PageGuard() = default;
+
+        /**
+         * @brief: Fetches and pins the page with the specified page id, then takes the requested latch.
+         * @throws std::logic_error if latch is LatchMode::EXCLUSIVE and the calling thread holds a Snapshot.
+         * @note This always returns the current page; use BufferPool::pinPage to read through a Snapshot.
+         */
+        PageGuard(BufferPool &pool, const PageId &pid, AccessIntent intent = AccessIntent::NORMAL,
+                  LatchMode latch = LatchMode::NONE);
+
+        /**
+         * @brief: Releases the latch and unpins the page, if any.
+         */
+        ~PageGuard();
+
+        PageGuard(const PageGuard &) = delete;
+
+        PageGuard &operator=(const PageGuard &) = delete;
+
+        PageGuard(PageGuard &&other) noexcept;
+
+        PageGuard &operator=(PageGuard &&other) noexcept;
+
+        Page &operator*() const { return *page; }
+
+        Page *operator->() const { return page; }
+
+        const PageId &getPageId() const { return pid; }
+
+        /**
+         * @brief: Takes the frame's shared content latch for the lifetime of the returned lock.
+         * @details For a guard that keeps a page pinned across calls (e.g. the leaf a B-tree Iterator is on) and
+         * latches it only while reading. The lock is empty for pages of read-only mapped files and old versions,
+         * which are never latched.
+         * @throws std::logic_error if the guard itself holds a latch.
+         */
+        std::shared_lock<std::shared_mutex> readLatch() const;
+
+        /**
+         * @brief: Marks the guarded page as dirty.
+         * @details With the log enabled the page is logged when the guard is released (or the LogGroup ends), so it
+         * may be marked before it is changed.
+         */
+        void markDirty() const;
+
+        /**
+         * @brief: Releases the latch and unpins the page early; the guard becomes empty.
+         * @details If the page was marked dirty by this thread and the log is enabled, the change is logged first.
+         */
+        void release();
+    };
+
+/**
+ * @brief Awaitable returned by BufferPool::getPageAsync.
+ */
+    class PageFetch {
+        BufferPool &pool;
+        PageId pid;
+        AccessIntent intent;
+        LatchMode latch;
+
+    public:
+        PageFetch(BufferPool &pool, const PageId &pid, AccessIntent intent, LatchMode latch)
+            : pool(pool), pid(pid), intent(intent), latch(latch) {}
+
+        bool await_ready() const;
+
+        void await_suspend(std::coroutine_handle<> handle) const;
+
+        PageGuard await_resume() const;
+    };
+
+/**
+ * @brief Makes the page changes of a multi-page operation (e.g. a B-tree split) one atomic unit of the log.
+ * @details While a group is alive, the records of the changes its thread makes are collected, and the pages are not
+ * written back; when the outermost group of the thread ends they are appended to the log together, so recovery
+ * replays all of the operation or none of it. Groups nest. No-op unless the log is enabled.
+ * @note Create the group before the PageGuards of the operation, so the guards are released (and their changes
+ * recorded) before it ends.
+ */
+    class LogGroup {
+        BufferPool &pool;
+
+    public:
+        explicit LogGroup(BufferPool &pool);
+
+        ~LogGroup();
+
+        LogGroup(const LogGroup &) = delete;
+
+        LogGroup &operator=(const LogGroup &) = delete;
+    };
+
+/**
+ * @brief Makes the calling thread read a consistent snapshot of the buffered pages.
+ * @details While the snapshot is alive, BufferPool::pinPage and BufferPool::getPage return every page as it was
+ * when the snapshot was taken: changes of operations that committed later, or were in flight then, are invisible,
+ * including the pages a B-tree split touched. A long scan therefore sees one state of the data while writers go on
+ * changing it. The snapshot is read-only: latching a page exclusively inside it throws.
+ * @throws std::logic_error if versioning is not enabled or the thread already holds a snapshot.
+ * @note Pages of unbuffered files are read from disk and are not versioned. The number of pages of a file is not
+ * versioned either: pages added after the snapshot read as they were before they were first written (empty), and a
+ * heap scan should stop at the page count it saw when it started rather than compare against a fresh end().
+ */
+    class Snapshot {
+        BufferPool &pool;
+
+    public:
+        explicit Snapshot(BufferPool &pool);
+
+        ~Snapshot();
+
+        Snapshot(const Snapshot &) = delete;
+
+        Snapshot &operator=(const Snapshot &) = delete;
     };
 } // namespace db
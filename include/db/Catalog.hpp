@@ -0,0 +1,127 @@
+#pragma once
+
+#include <db/DbFile.hpp>
+#include <db/HeapPage.hpp>
+#include <db/Statistics.hpp>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace db {
+    /// The kind of DbFile a catalog entry opens.
+    enum class FileKind : uint8_t {
+        HEAP, BTREE, HASH
+    };
+
+    /**
+     * @brief What the catalog records about a file: everything needed to open it again.
+     */
+    struct CatalogEntry {
+        std::string name;
+        FileKind kind{FileKind::HEAP};
+        std::vector<type_t> types;               ///< Field types of the schema.
+        std::vector<std::string> field_names;    ///< Field names of the schema.
+        std::vector<size_t> key_fields;          ///< BTREE: the key fields, in comparison order; HASH: the key field.
+        bool buffered{false};                    ///< HEAP: see HeapFile.
+        PageLayout layout{PageLayout::ROW};      ///< HEAP: see HeapFile.
+        PageCompression compression{PageCompression::NONE};
+        FileAccess access{FileAccess::READ_WRITE};
+        size_t num_pages{0};                     ///< The page count when the catalog was last saved.
+        /// Set by Database::analyze. saveCatalog also records here the exact row count of files that keep one; such
+        /// stats have no columns until the file is analyzed.
+        std::optional<TableStats> stats;
+
+        /**
+         * @brief The schema of the file.
+         * @throws std::logic_error if the types and names do not make a valid TupleDesc.
+         */
+        TupleDesc tupleDesc() const;
+
+        /**
+         * @brief Open the file the entry describes.
+         * @details The key type of a B-tree follows from its key fields: a single INT, DOUBLE or CHAR field opens a
+         * BTreeFile, `BasicBTreeFile<double>` or `BasicBTreeFile<CharKey>`, and two INT fields a
+         * `BasicBTreeFile<IntPairKey>`. A HASH entry opens a HashFile on its single key field.
+         * @throws std::logic_error if the key fields match none of these key types, or a HASH entry has more than one.
+         * @throws std::runtime_error if the file cannot be opened (see DbFile).
+         */
+        std::unique_ptr<DbFile> open() const;
+    };
+
+/**
+ * @brief The persistent catalog: a file with one CatalogEntry per table, so a process can find its files without
+ * registering them again.
+ * @details The file is `[u64 magic][u64 count][u64 offset] * count` followed by the records, sorted by name. It is
+ * mapped, not read: opening a catalog costs the same for ten tables as for ten thousand, and find() binary-searches
+ * the offsets, decoding only the names it compares and the record it returns.
+ * put() and erase() are kept in memory, where find() sees them, until save() writes the merged catalog to
+ * `<path>.tmp`, syncs it and renames it over `<path>`; a crash leaves either the old or the new catalog.
+ * @note Not thread-safe; the Database serializes access to its catalog.
+ */
+    class Catalog {
+        std::string path;
+        int fd{-1};
+        const uint8_t *map{nullptr};
+        size_t map_size{0};
+        size_t count{0};   // 文件里的条目数
+
+        // 尚未保存的改动，按名字排序；nullopt 表示删除
+        std::map<std::string, std::optional<CatalogEntry>, std::less<>> changes;
+
+        void mapFile();
+        void unmapFile();
+        std::string_view nameAt(size_t i) const;
+        CatalogEntry entryAt(size_t i) const;
+        // 文件里名为 name 的条目的下标
+        std::optional<size_t> search(std::string_view name) const;
+
+    public:
+        /**
+         * @brief Open the catalog at `path`; a missing file is an empty catalog, created by the first save().
+         * @throws std::runtime_error if the file exists but cannot be mapped or is not a catalog.
+         */
+        explicit Catalog(const std::string &path);
+
+        /**
+         * @brief Unmaps the file. Unsaved changes are lost.
+         */
+        ~Catalog();
+
+        Catalog(const Catalog &) = delete;
+
+        Catalog &operator=(const Catalog &) = delete;
+
+        /**
+         * @brief The entry of file `name`, including unsaved changes.
+         * @return The entry, or std::nullopt if there is none.
+         * @throws std::runtime_error if the record is corrupt.
+         */
+        std::optional<CatalogEntry> find(const std::string &name) const;
+
+        /**
+         * @brief Add an entry, or replace the entry with the same name.
+         */
+        void put(const CatalogEntry &entry);
+
+        /**
+         * @brief Remove the entry of file `name`, if any.
+         */
+        void erase(const std::string &name);
+
+        /**
+         * @brief The number of entries, including unsaved changes.
+         */
+        size_t size() const;
+
+        /**
+         * @brief Write the catalog with all changes and map the new file.
+         * @throws std::runtime_error if the file cannot be written or synced.
+         * @throws std::logic_error if a name is longer than 65535 bytes or a schema has more than 65535 fields.
+         */
+        void save();
+    };
+} // namespace db
@@ -1,25 +1,54 @@
 #pragma once
 
 #include <db/BufferPool.hpp>
+#include <db/Catalog.hpp>
 #include <db/DbFile.hpp>
+#include <db/Statistics.hpp>
+#include <array>
+#include <atomic>
 #include <memory>
+#include <shared_mutex>
 
 /**
  * @brief A database is a collection of files and a BufferPool.
  * @details The Database class is responsible for managing the database files.
  * It provides functions to add new database files, get the internal id of a file, and retrieve database files.
  * The class also supports removing all files from the catalog.
+ * With a persistent Catalog (openCatalog), files are described once with create() and opened lazily by the first
+ * get() of their name in any later process, so startup does not depend on the number of tables.
  * @note A Database owns the DbFile objects that are added to it.
+ * @note Adding, removing and lazily opening files are serialized by a lock; get(file_id_t) and find() take no lock:
+ * the id table is allocated in segments that never move, and its slots are atomic.
  */
 namespace db {
     class Database {
         // TODO pa0: add private members
-        std::unordered_map<std::string, std::unique_ptr<DbFile>> files;
+        // get(name) 会按目录懒打开文件，因此注册表是 mutable 的，由 mtx 保护
+        mutable std::unordered_map<std::string, std::unique_ptr<DbFile>> files;
+
+        // 文件名 -> 稠密 id（一经分配不再回收）
+        mutable std::unordered_map<std::string, file_id_t> file_ids;
+
+        // id -> 当前注册的文件。按段分配、分配后不再搬动，get(file_id_t)/find 不持锁读；
+        // 段在 mtx 下分配，由 id_segments 持有，files_by_id 只用来发布
+        static constexpr size_t ID_SEGMENT_SIZE = 1024;
+        static constexpr size_t ID_SEGMENTS = 1024;
+        mutable std::array<std::atomic<std::atomic<DbFile *> *>, ID_SEGMENTS> files_by_id{};
+        mutable std::vector<std::unique_ptr<std::atomic<DbFile *>[]>> id_segments;
+
+        mutable std::shared_mutex mtx;
+        std::unique_ptr<Catalog> catalog;
 
         BufferPool bufferPool;
 
         Database() = default;
 
+        // 调用方持有 mtx 的排他锁
+        DbFile &registerLocked(std::unique_ptr<DbFile> file) const;
+
+        // id 的槽位，所在的段必须已经分配；调用方持有 mtx 的排他锁
+        std::atomic<DbFile *> &slotLocked(file_id_t id) const;
+
     public:
         friend Database &getDatabase();
 
@@ -39,8 +68,11 @@ namespace db {
 
         /**
          * @brief Adds a new file to the Database.
+         * @details The file name is interned to a dense file id, which is stored in the file and used in PageIds.
+         * A name keeps its id if it is removed and added again.
          * @param file The file to add.
          * @throws std::logic_error if the file name already exists.
+         * @throws std::length_error if all `ID_SEGMENTS * ID_SEGMENT_SIZE` file ids are taken by other names.
          * @note This method takes ownership of the DbFile.
          */
         void add(std::unique_ptr<DbFile> file);
@@ -51,6 +83,7 @@ namespace db {
          * @return The removed file.
          * @throws std::logic_error if the name does not exist.
          * @note This method should call BufferPool::flushFile(name)
+         * @note The resident pages of the file (BufferPool::pinResident) are released.
          * @note This method moves the DbFile ownership to the caller.
          */
         std::unique_ptr<DbFile> remove(const std::string &name);
@@ -60,8 +93,75 @@ namespace db {
          * @param name The name of the file.
          * @return The DbFile object.
          * @throws std::logic_error if the name does not exist.
+         * @note A file that is not registered but has an entry in the catalog is opened and registered now.
          */
         DbFile &get(const std::string &name) const;
+
+        /**
+         * @brief Returns the DbFile with the specified file id.
+         * @param id The id of the file.
+         * @return The DbFile object.
+         * @throws std::out_of_range if no file with this id is registered.
+         */
+        DbFile &get(file_id_t id) const;
+
+        /**
+         * @brief Returns the DbFile with the specified file id, if any.
+         * @param id The id of the file.
+         * @return The DbFile object, or nullptr if no file with this id is registered.
+         */
+        DbFile *find(file_id_t id) const noexcept;
+
+        /**
+         * @brief Use the persistent catalog at `path` (see Catalog).
+         * @details Only the catalog file is opened and mapped; the files it lists are opened by get() when first
+         * asked for. Unsaved changes to a previous catalog are lost.
+         * @throws std::runtime_error if the catalog exists but cannot be read.
+         */
+        void openCatalog(const std::string &path);
+
+        /**
+         * @brief Record a file in the catalog and open it.
+         * @details The entry is saved by the next saveCatalog(). A registered file of the same name is replaced, as
+         * by add().
+         * @return The opened file.
+         * @throws std::logic_error if no catalog is open or the entry cannot be opened (see CatalogEntry::open).
+         */
+        DbFile &create(const CatalogEntry &entry);
+
+        /**
+         * @brief The catalog entry of a file, without opening it.
+         * @details The page count of a registered file is its current one, and so is its row count if the file keeps
+         * one; otherwise they are the counts when the catalog was last saved.
+         * @return The entry, or std::nullopt if no catalog is open or it has no entry for `name`.
+         */
+        std::optional<CatalogEntry> describe(const std::string &name) const;
+
+        /**
+         * @brief Remove a file from the catalog, and from the Database if it is registered.
+         * @return The removed file, or nullptr if it was not registered. The file on disk is left alone.
+         * @throws std::logic_error if no catalog is open or it has no entry for `name`.
+         */
+        std::unique_ptr<DbFile> drop(const std::string &name);
+
+        /**
+         * @brief Write the catalog, with the current page counts (and row counts, see DbFile::getRowCount) of the
+         * registered files it lists.
+         * @throws std::logic_error if no catalog is open.
+         * @throws std::runtime_error if the catalog cannot be written.
+         */
+        void saveCatalog();
+
+        /**
+         * @brief Collect the statistics of a file (see collectStats) and record them in its catalog entry.
+         * @details A file that did not know its row count keeps the exact count of a complete scan and maintains it
+         * from then on. The entry is saved by the next saveCatalog(); without a catalog, or for a file the catalog does
+         * not list, the statistics are only returned.
+         * @return The statistics.
+         * @throws std::logic_error if the file does not exist or `sample_pages` or `buckets` is 0.
+         */
+        TableStats analyze(const std::string &name, size_t sample_pages = DEFAULT_SAMPLE_PAGES,
+                           size_t buckets = DEFAULT_HISTOGRAM_BUCKETS);
     };
 
 /**
@@ -1,14 +1,42 @@
 #pragma once
 
+#include <db/IoStats.hpp>
 #include <db/Iterator.hpp>
+#include <db/PageTable.hpp>
+#include <db/Predicate.hpp>
 #include <db/types.hpp>
 #include <vector>
 #pragma once
+#include <atomic>   // std::atomic
+#include <chrono>   // std::chrono::steady_clock
+#include <memory>   // std::unique_ptr
 #include <mutex>    // std::mutex
+#include <optional> // std::optional
+#include <span>     // std::span
 #include <string>   // std::string
 
 namespace db {
 
+    /**
+     * @brief On-disk page format of a DbFile.
+     * @details NONE stores page `i` raw at offset `i * DEFAULT_PAGE_SIZE`. LZ stores each page compressed (see
+     * compress_page) in a variable-size extent and finds it through a PageTable saved in `<name>.ptt`. Pages in the
+     * BufferPool are always uncompressed.
+     */
+    enum class PageCompression {
+        NONE, LZ
+    };
+
+    /**
+     * @brief How a DbFile opens its file.
+     * @details READ_WRITE reads and writes pages with pread/pwrite. MMAP_READ_ONLY maps the whole file read-only:
+     * page wrappers point straight into the mapping, the BufferPool hands out the mapped pages without copying them
+     * into frames, and every write throws.
+     */
+    enum class FileAccess {
+        READ_WRITE, MMAP_READ_ONLY
+    };
+
 /**
  * @brief Represents a database file.
  * @details It provides functions to read and write pages to the file, as well as to insert and delete tuples.
@@ -16,45 +44,143 @@ namespace db {
  * @note A `DbFile` object owns the `TupleDesc` object that describes the schema of the tuples in the file.
  */
     class DbFile {
-        mutable std::vector<size_t> reads;
-        mutable std::vector<size_t> writes;
+        // 最近读写过的页号
+        mutable PageHistory reads;
+        mutable PageHistory writes;
 
         // TODO pa1: add private members
     private:
         int fd{-1};                 // POSIX file
-        mutable std::mutex io_mtx;
+        mutable FileIoStats io_stats;
+
+        // 压缩格式下的页转换表；未压缩时为空
+        std::unique_ptr<PageTable> ptt;
+        mutable std::mutex ptt_mtx;
+
+        // MMAP_READ_ONLY：整个文件的只读映射，覆盖 [0, mapped_pages) 页
+        const uint8_t *map{nullptr};
+        size_t mapped_pages{0};
+        bool read_only{false};
+
+        // 行数 = row_base + row_delta；row_base 为 -1 表示未知。row_delta 是打开以来插入减删除的行数
+        std::atomic<int64_t> row_base{-1};
+        std::atomic<int64_t> row_delta{0};
+
+        // I/O 完成后记账：计数、延迟、页号记录和跟踪；start 为发起 I/O 的时刻
+        void noteRead(size_t id, std::chrono::steady_clock::time_point start) const;
+        void noteWrite(size_t first_id, size_t count, std::chrono::steady_clock::time_point start) const;
+
+        void readCompressed(Page &page, size_t id) const;
+        void writeCompressed(const Page &page, size_t id) const;
+
+        friend class Database;
+        friend class IoEngine;
+        friend class BufferPool;   // 日志重放可能让文件变长
 
     protected:
+        file_id_t file_id{INVALID_FILE_ID};   // 由 Database::add 分配
         const std::string name;
         const TupleDesc td;
-        size_t numPages;
+        // 快照扫描与插入并发读写：新页写好后 release 发布，getNumPages acquire 读
+        std::atomic<size_t> numPages{0};
+
+        // 插入、删除改变了文件的行数后调用
+        void noteRows(int64_t delta);
 
     public:
         /**
          * @brief Construct a new Db File object with the specified file name and tuple descriptor
          * @param name of the file to be opened or created.
          * @param td tuple description of tuples in the file.
-         * @throws std::runtime_error if the file cannot be opened or if the `fstat` system call fails.
+         * @param compression the on-disk page format. It is not recorded in the file; reopen a file with the format
+         * it was written with.
+         * @param access how the file is opened; FileAccess::MMAP_READ_ONLY does not create a missing file.
+         * @throws std::runtime_error if the file cannot be opened or mapped, or if the `fstat` system call fails.
+         * @throws std::logic_error if a compressed file is opened with FileAccess::MMAP_READ_ONLY.
          * @note This method calculates the number of pages in the file by dividing the file size (in bytes)
-         * by the `DEFAULT_PAGE_SIZE`.
+         * by the `DEFAULT_PAGE_SIZE`. A compressed file takes it from its page table, which is rebuilt by walking the
+         * file if `<name>.ptt` is missing or does not match the file (e.g. after a crash).
          */
-        explicit DbFile(const std::string &name, const TupleDesc &td);
+        explicit DbFile(const std::string &name, const TupleDesc &td,
+                        PageCompression compression = PageCompression::NONE,
+                        FileAccess access = FileAccess::READ_WRITE);
 
         /**
-         * @brief closes the file descriptor.
+         * @brief unmaps the file and closes the file descriptor.
          */
         virtual ~DbFile();
 
         const std::string &getName() const;
 
-        const std::vector<size_t> &getReads() const;
+        /**
+         * @brief Returns the id the Database assigned to this file's name.
+         * @return The file id, or INVALID_FILE_ID if the file has not been added to the Database.
+         */
+        file_id_t getFileId() const;
 
-        const std::vector<size_t> &getWrites() const;
+        /**
+         * @brief Whether pages are stored compressed on disk.
+         */
+        bool isCompressed() const;
+
+        /**
+         * @brief Whether the file was opened with FileAccess::MMAP_READ_ONLY.
+         */
+        bool isReadOnly() const;
+
+        /**
+         * @brief The page inside the read-only mapping.
+         * @param id The page number.
+         * @return The mapped page, valid for the lifetime of the file, or nullptr if the file is not mapped or the
+         * page is past the end of the mapping. The page must not be written.
+         */
+        const Page *mappedPage(size_t id) const;
+
+        /**
+         * @brief Tell the kernel the mapping is about to be read sequentially (`MADV_SEQUENTIAL`).
+         * @note No-op if the file is not mapped. Advice is a hint; failures are ignored.
+         */
+        void adviseSequential() const;
+
+        /**
+         * @brief Ask the kernel to start reading pages [first, first + count) of the mapping (`MADV_WILLNEED`).
+         * @note Pages past the end of the mapping are ignored; no-op if the file is not mapped.
+         */
+        void adviseWillNeed(size_t first, size_t count) const;
+
+        /**
+         * @brief A copy of the numbers of the pages read, oldest first.
+         * @details Kept for tests and debugging in a lock-free ring (see PageHistory) of the most recent ids (see
+         * setIoHistoryLimit). Use getIoStats() for monitoring.
+         */
+        std::vector<size_t> getReads() const;
+
+        /**
+         * @brief A copy of the numbers of the pages written, oldest first; see getReads().
+         */
+        std::vector<size_t> getWrites() const;
+
+        /**
+         * @brief Set how many page ids getReads() and getWrites() keep each.
+         * @param limit The limit; 0 stops recording page ids. Defaults to DEFAULT_IO_HISTORY.
+         */
+        void setIoHistoryLimit(size_t limit);
+
+        /**
+         * @brief Counters and latency histograms of the file's page I/O.
+         * @details Updated with relaxed atomics on every page read or written, so they are cheap enough to leave on.
+         * Every I/O is also recorded in getIoTrace() while that is enabled.
+         */
+        const FileIoStats &getIoStats() const;
 
         /**
          * @brief Read a page from the file.
          * @param page The page to read into.
          * @param id The page number of the page to be read. It determines the offset within the file.
+         * @throws std::runtime_error if `pread` fails, or if a compressed page is corrupt.
+         * @note Bytes past the end of the file read as zero, so a page that was never written is an empty page.
+         * @note A compressed page costs one `pread` of its extent and a decompression. A mapped page is copied out of
+         * the mapping.
          */
         void readPage(Page &page, size_t id) const;
 
@@ -63,23 +189,121 @@ namespace db {
          * @param page The page to write.
          * @param id The page number of the page to which the data will be written.
          * It determines the offset in the file.
+         * @throws std::runtime_error if `pwrite` fails.
+         * @throws std::logic_error if the file is read-only.
+         * @note A compressed page is written to its current extent if it still fits, otherwise to a free or new
+         * extent. A page that does not compress below DEFAULT_PAGE_SIZE is stored raw.
          */
         void writePage(const Page &page, size_t id) const;
 
+        /**
+         * @brief Write consecutive pages to the file with vectored writes.
+         * @param pages The pages to write; `pages[i]` is written to page `first_id + i`.
+         * @param first_id The page number of the first page.
+         * @throws std::runtime_error if `pwritev` fails.
+         * @throws std::logic_error if the file is read-only.
+         * @note A run of adjacent dirty pages costs one `pwritev` per IOV_MAX pages instead of one `pwrite` each.
+         * Compressed files write the pages one by one.
+         */
+        void writePages(const std::vector<const Page *> &pages, size_t first_id) const;
+
+        /**
+         * @brief Make the pages written so far durable (`fdatasync`).
+         * @throws std::runtime_error if `fdatasync` fails.
+         * @note No-op for a read-only file.
+         */
+        void sync() const;
+
         virtual void insertTuple(const Tuple &t);
 
+        /**
+         * @brief Insert a batch of tuples.
+         * @details The default inserts them one by one with insertTuple; files override it to touch each page once
+         * per batch.
+         * @param tuples The tuples to insert.
+         */
+        virtual void insertTuples(std::span<const Tuple> tuples);
+
         virtual void deleteTuple(const Iterator &it);
 
         virtual Tuple getTuple(const Iterator &it) const;
 
+        /**
+         * @brief Get a zero-copy view of the tuple the iterator points to.
+         * @details The view reads directly from the page frame in the BufferPool.
+         * @param it The iterator that identifies the tuple.
+         * @return A view that is valid until the page may be evicted, i.e. until the next BufferPool access.
+         * @note The page is not pinned by the view. When other threads use the pool (including background
+         * read-ahead), pin the page with a PageGuard for as long as the view is used.
+         */
+        virtual TupleView getView(const Iterator &it) const;
+
         virtual void next(Iterator &it) const;
 
         virtual Iterator begin() const;
 
         virtual Iterator end() const;
 
+        /**
+         * @brief Read a run of tuples from the page the iterator is on.
+         * @details Append up to `limit` tuples, starting at `it`, that live on the same page as `it`, then advance
+         * `it` past them (possibly onto a later page, or to `end()`). Implementations look the page up once per call.
+         * @param it The iterator to read from and advance.
+         * @param out The vector the tuples are appended to.
+         * @param limit The maximum number of tuples to append.
+         * @return The number of tuples appended; 0 only if `it` is at `end()`.
+         */
+        virtual size_t scanPage(Iterator &it, std::vector<Tuple> &out, size_t limit) const;
+
+        /**
+         * @brief Read the tuples of the page the iterator is on that satisfy a predicate.
+         * @details Like scanPage, but only tuples for which `pred` holds are appended. Implementations evaluate the
+         * predicate on the serialized page bytes and deserialize only the matching rows; the default filters the
+         * result of scanPage.
+         * @param it The iterator to read from and advance past every tuple examined.
+         * @param out The vector the matching tuples are appended to.
+         * @param limit The maximum number of tuples to examine.
+         * @param pred The predicate.
+         * @return The number of tuples examined (matching or not); 0 only if `it` is at `end()`.
+         * @throws std::logic_error if the predicate does not apply to the schema (see Predicate::check).
+         */
+        virtual size_t scanPageWhere(Iterator &it, std::vector<Tuple> &out, size_t limit, const Predicate &pred) const;
+
+        /**
+         * @brief Read a batch of tuples.
+         * @details Append up to `limit` tuples starting at `it`, crossing pages as needed, and advance `it` past them.
+         * @param it The iterator to read from and advance.
+         * @param out The vector the tuples are appended to.
+         * @param limit The maximum number of tuples to append.
+         * @return The number of tuples appended; less than `limit` only if `it` reached `end()`.
+         */
+        size_t nextBatch(Iterator &it, std::vector<Tuple> &out, size_t limit) const;
+
+        /**
+         * @brief Split the file into ranges that can be scanned independently (e.g. by ParallelScan).
+         * @details Range i runs from `starts[i]` up to `starts[i + 1]`, the last one up to `end()`, in scan order.
+         * Every start is the first tuple of a page, so a scanPage loop over a range stops exactly at the next start.
+         * The default is a single range.
+         * @param parts The desired number of ranges; fewer are returned if the file is small.
+         * @return The start positions; empty if the file has no tuples.
+         * @note The ranges describe the file at the time of the call; inserts and deletes invalidate them.
+         */
+        virtual std::vector<Iterator> split(size_t parts) const;
+
         size_t getNumPages() const;
 
+        /**
+         * @brief The number of tuples in the file, kept up to date by the inserts and deletes of the file types.
+         * @return The count, or std::nullopt if it is not known: a file that was not empty when opened has no count
+         * until setRowCount (Database::analyze and files opened from the catalog set it).
+         */
+        std::optional<uint64_t> getRowCount() const;
+
+        /**
+         * @brief Set the number of tuples in the file; later inserts and deletes adjust it.
+         */
+        void setRowCount(uint64_t rows);
+
         const TupleDesc &getTupleDesc() const;
         auto operator<=>(size_t size) const;
         bool operator==(int i) const;
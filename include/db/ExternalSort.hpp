@@ -0,0 +1,93 @@
+#pragma once
+
+#include <db/DbFile.hpp>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace db {
+    /// Memory an ExternalSort may use for tuples, in pages.
+    constexpr size_t DEFAULT_SORT_MEMORY_PAGES = 4096;
+
+/**
+ * @brief Sorts the tuples of a DbFile with a bounded amount of memory.
+ * @details The constructor reads the source and cuts it into runs of about `memory_pages` pages of serialized tuples.
+ * Each run is stably sorted in memory and written to a temporary unbuffered HeapFile that is added to the Database
+ * (`<source>.sort.<n>.<r>`); consecutive new pages go out in one vectored write. The runs are then merged with a
+ * loser tree, each run read in chunks of READ_CHUNK_PAGES pages so that the disk sees long sequential reads. If there
+ * are more runs than the memory holds chunks, groups of runs are first merged into longer runs until they fit; the
+ * last merge streams its output through next().
+ * Ties keep the source order, so the sort is stable. A source that fits into the budget is sorted in memory and no
+ * file is written.
+ * @note The run files are removed from the Database and from disk as soon as they are merged, and by the destructor.
+ * @note The source must not be modified while it is read by the constructor.
+ */
+    class ExternalSort {
+    public:
+        /// Strict weak order of the output.
+        using Less = std::function<bool(const Tuple &, const Tuple &)>;
+
+        /// Pages read from a run at a time during merging.
+        static constexpr size_t READ_CHUNK_PAGES = 16;
+
+    private:
+        class Merger;
+
+        TupleDesc td;
+        Less less;
+        size_t budget;   // 一个 run 的字节数
+        size_t fan_in;   // 一趟归并的路数
+        std::string prefix;
+        size_t created{0};
+        size_t initial_runs{0};
+
+        std::vector<std::string> run_files;
+        std::vector<Tuple> memory;   // 未溢出时的全部结果
+        size_t memory_pos{0};
+        std::unique_ptr<Merger> merger;
+
+        void writeRun();
+        std::string newRun();
+        void dropRun(const std::string &name);
+        std::string mergeRuns(size_t first, size_t count);
+
+    public:
+        /**
+         * @param source The file to sort.
+         * @param less The order of the output.
+         * @param memory_pages The memory budget in pages; it bounds the run length and the fan-in of a merge (at
+         * least two runs are merged at a time).
+         * @throws std::runtime_error if a run file cannot be written.
+         */
+        ExternalSort(const DbFile &source, Less less, size_t memory_pages = DEFAULT_SORT_MEMORY_PAGES);
+
+        /**
+         * @brief Removes the remaining run files.
+         */
+        ~ExternalSort();
+
+        ExternalSort(const ExternalSort &) = delete;
+
+        ExternalSort &operator=(const ExternalSort &) = delete;
+
+        /**
+         * @brief The next tuple in sorted order.
+         * @return The tuple, or std::nullopt once all tuples have been returned. Can be used as a TupleSource.
+         */
+        std::optional<Tuple> next();
+
+        /**
+         * @brief The number of runs written by the first pass; 0 if the source was sorted in memory.
+         */
+        size_t runs() const;
+
+        /**
+         * @brief The ascending order of one field.
+         * @details Values of a field have the same type, so they compare like their `field_t` alternatives.
+         */
+        static Less byField(size_t field);
+    };
+} // namespace db
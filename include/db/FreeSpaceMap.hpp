@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace db {
+/**
+ * @brief Persistent map of the pages of a HeapFile that have a free slot.
+ * @details One bit per page, kept in memory as 64-bit words and saved to a side file next to the heap file
+ * (`<heap file>.fsm`). find() returns the lowest page with its bit set; a cursor on the lowest word that may hold a
+ * set bit makes append-mostly workloads O(1) per insert, and freeing a page only moves the cursor back.
+ * @note The map is a hint. A page reported as free may turn out to be full (the caller clears its bit and asks
+ * again); a page wrongly marked full only wastes its space until a delete on it sets the bit again.
+ * @note Not thread-safe; HeapFile serializes its calls.
+ */
+    class FreeSpaceMap {
+        static constexpr uint64_t MAGIC = 0x46534d31;   // "FSM1"
+
+        std::string path;
+        std::vector<uint64_t> words;
+        size_t pages{0};
+        size_t cursor{0};   // words[0, cursor) 全为 0
+        bool dirty{false};
+
+    public:
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+        /**
+         * @brief Open the map stored at `path`.
+         * @details A missing or unreadable side file yields an empty map.
+         */
+        explicit FreeSpaceMap(std::string path);
+
+        /**
+         * @brief Saves the map if it changed.
+         */
+        ~FreeSpaceMap();
+
+        FreeSpaceMap(const FreeSpaceMap &) = delete;
+
+        FreeSpaceMap &operator=(const FreeSpaceMap &) = delete;
+
+        /**
+         * @brief Number of pages the map covers.
+         */
+        size_t size() const;
+
+        /**
+         * @brief Cover exactly `num_pages` pages; new pages are marked full.
+         */
+        void resize(size_t num_pages);
+
+        /**
+         * @brief Record whether page `page` has a free slot; grows the map if needed.
+         */
+        void set(size_t page, bool has_room);
+
+        /**
+         * @brief The lowest page that has a free slot, or `npos`.
+         */
+        size_t find();
+
+        /**
+         * @brief Write the map to its side file (via a temporary file and rename).
+         * @throws std::runtime_error if the file cannot be written.
+         */
+        void save();
+    };
+} // namespace db
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <db/BufferPool.hpp>
+#include <db/DbFile.hpp>
+#include <shared_mutex>
+#include <vector>
+
+namespace db {
+/**
+ * @brief A hash index file: tuples are placed in buckets by the hash of one key field (extendible hashing).
+ * @details Page 0 is a header with the global depth and the page numbers of the directory pages. The directory maps
+ * the low `global depth` bits of a key's hash to the first page of a bucket. A bucket page is slotted (VARCHAR rows
+ * are stored at their own length) and keeps each slot's hash, so a lookup compares keys only on a hash match.
+ * Every bucket has a local depth: a full bucket is split in two by the next bit of the hash, and only a bucket
+ * whose local depth has reached the global depth doubles the directory first. The new half of the directory is a copy
+ * of the old one, so a doubling writes only the directory pages of the new half. Once the directory has as many
+ * entries as its header can list pages for (2^17 with 4 KiB pages), full buckets grow a chain of overflow pages
+ * instead.
+ * Like a BTreeFile, the file holds one tuple per key: inserting an existing key replaces its tuple.
+ * @note Pages are always accessed through the BufferPool, so the file must be added to the Database before use.
+ * @note The directory is also kept in memory, loaded on first use; a lookup costs one bucket page (plus the overflow
+ * pages of its chain) and no directory page. Inside a Snapshot lookups read the directory pages the snapshot sees.
+ * @note Lookups, inserts and deletes may run concurrently. They take a bucket's first page latch for the whole chain;
+ * splits and new overflow pages hold the directory exclusively, so they wait for the operations in progress. Buckets
+ * are never merged and emptied pages are not reused.
+ * @note Iteration visits the bucket pages in page order, so the order of the tuples is unrelated to their keys. An
+ * Iterator is a position: inserts and deletes in its page may shift the tuple it refers to, and splits move tuples to
+ * other pages.
+ */
+class HashFile : public DbFile {
+  // key 所在的字段
+  size_t key_index;
+
+  // 目录的内存副本（页号数组）及其全局深度、各目录页的页号；第一次使用时从文件头与目录页载入。
+  // 查找、插入、删除持共享锁，改目录（分裂、加溢出页）与分配新页（numPages++）持排他锁
+  mutable std::shared_mutex dir_mtx;
+  mutable bool loaded{false};
+  mutable size_t global_depth{0};
+  mutable std::vector<size_t> directory;
+  mutable std::vector<size_t> dir_pages;
+
+  // 持共享锁返回；目录尚未载入时先载入
+  std::shared_lock<std::shared_mutex> lock_directory() const;
+  // 持排他锁调用：读入目录，新文件则先建好文件头、第一个目录页与第一个桶
+  void load_directory() const;
+  // hash 所在桶的首页页号；目录为空（从未写过的只读文件）时为 0
+  size_t bucket_of(uint64_t hash) const;
+  // 快照读不用内存里的目录，按快照中的文件头与目录页查找
+  size_t snapshot_bucket_of(uint64_t hash) const;
+  // 桶首页；它的 latch 管住整条溢出链
+  PageGuard pin_bucket(size_t page, LatchMode latch) const;
+
+  // 插入（或覆盖）已序列化的行；insert_fast 只改一页，需要分裂或加溢出页时返回 false
+  bool insert_fast(const uint8_t *row, size_t len, uint64_t hash, const field_t &key);
+  void insert_slow(const uint8_t *row, size_t len, uint64_t hash, const field_t &key);
+  // 以下持目录排他锁调用
+  void split_bucket(PageGuard &head, uint64_t hash);
+  void double_directory();
+  void store_header() const;
+  void store_directory(size_t first, size_t last, size_t step) const;
+
+  // 将 it 定位到第 p 页及之后第一个非空桶页的首条；没有则为 end()
+  void seek_page(Iterator &it, size_t p) const;
+
+public:
+  /**
+   * @brief Open or create a hash file.
+   * @param key_index the index of the key field; any field type can be the key.
+   * @param compression the on-disk page format (see PageCompression).
+   * @param access FileAccess::MMAP_READ_ONLY maps the file; lookups and scans read straight from the mapping, and
+   * every modification throws std::logic_error.
+   * @throws std::logic_error if `key_index` is out of range or the longest row of `td` does not fit in a bucket page.
+   * @throws std::runtime_error (on first use) if the file exists but is not a hash file.
+   */
+  HashFile(const std::string &name, const TupleDesc &td, size_t key_index,
+           PageCompression compression = PageCompression::NONE, FileAccess access = FileAccess::READ_WRITE);
+
+  /**
+   * @brief The index of the key field.
+   */
+  size_t getKeyIndex() const;
+
+  /**
+   * @brief The number of hash bits the directory is indexed by; it has `2^depth` entries.
+   */
+  size_t getGlobalDepth() const;
+
+  /**
+   * @brief Insert a tuple, replacing the tuple with the same key if there is one.
+   * @details The tuple goes into the first page of its bucket's chain that has room. When none has, the bucket is
+   * split (doubling the directory if needed) and the insert retried; all pages of a split, including the directory
+   * pages, change inside one LogGroup.
+   * @throws std::logic_error if the file is read-only or the tuple is not compatible with the schema.
+   */
+  void insertTuple(const Tuple &t) override;
+
+  /**
+   * @brief Delete the tuple an iterator points to.
+   * @throws std::out_of_range if the iterator does not point to a tuple of this file.
+   * @throws std::logic_error if the file is read-only.
+   * @note The later tuples of the page shift down by one slot; iterators into the page are invalidated.
+   */
+  void deleteTuple(const Iterator &it) override;
+
+  /**
+   * @brief Delete the tuple with the given key.
+   * @details Like deleteTuple, but the tuple is located under the latches of the delete itself, so it is the form to
+   * use while other threads modify the file.
+   * @return Whether a tuple with this key existed.
+   * @throws std::logic_error if the file is read-only or the key's type does not match the key field.
+   */
+  bool erase(const field_t &key);
+
+  /**
+   * @brief Find the tuple with the given key.
+   * @details The key is hashed, the in-memory directory gives the bucket, and only the pages of its chain are read.
+   * A CHAR or VARCHAR key is compared as stored, i.e. cut to CHAR_SIZE or VARCHAR_MAX bytes.
+   * @return The iterator to the tuple, or `end()` if there is no tuple with this key.
+   * @throws std::logic_error if the key's type does not match the key field.
+   */
+  Iterator find(const field_t &key) const;
+
+  /**
+   * @throws std::out_of_range if the iterator does not point to a tuple of this file.
+   */
+  Tuple getTuple(const Iterator &it) const override;
+
+  TupleView getView(const Iterator &it) const override;
+
+  /**
+   * @brief Advance the iterator to the next tuple, in page order.
+   * @details Pages that are not bucket pages (the header, directory pages) and empty buckets are skipped.
+   */
+  void next(Iterator &it) const override;
+
+  /**
+   * @brief Get the iterator to the first tuple of the first non-empty bucket page.
+   */
+  Iterator begin() const override;
+
+  /**
+   * @brief Get the iterator to the end of the file.
+   * @details Page 0 is the header and never holds tuples, so the end is `{0, 0}`, as for a BTreeFile.
+   */
+  Iterator end() const override;
+
+  /**
+   * @brief Read the tuples of the current bucket page.
+   * @details The page is fetched from the BufferPool once, with AccessIntent::SCAN like the other scan paths.
+   */
+  size_t scanPage(Iterator &it, std::vector<Tuple> &out, size_t limit) const override;
+
+  /**
+   * @brief Split the pages into `parts` runs of about the same length.
+   * @details Each start is found by seeking from the first page of its run to the first tuple; runs without tuples
+   * are dropped.
+   */
+  std::vector<Iterator> split(size_t parts) const override;
+};
+} // namespace db
@@ -1,23 +1,106 @@
 #pragma once
 
+#include <db/BufferPool.hpp>
 #include <db/DbFile.hpp>
+#include <db/FreeSpaceMap.hpp>
+#include <db/HeapPage.hpp>
+#include <db/Task.hpp>
+#include <mutex>      // std::mutex
 
 namespace db {
 class HeapFile : public DbFile {
+  // true: 页通过 BufferPool 访问（需先注册到 Database）；false: 直接 readPage/writePage
+  bool buffered;
+
+  // 页内数据区的排列方式；不写在文件里，重新打开时须与写入时一致
+  PageLayout layout;
+
+  // 有空槽的页；保存在 "<name>.fsm"，打开时补齐它没覆盖到的页
+  FreeSpaceMap fsm;
+
+  // 串行化插入与删除：空闲空间映射的查找/更新与文件末尾追加新页（numPages）都在它之下；扫描不取它
+  std::mutex write_mtx;
+
+  // 扫描路径（begin/next/getTuple 等）以 AccessIntent::SCAN 取页，避免冲掉缓冲池里的热页；
+  // 改页的路径持有排他 latch，快照读者因此不会读到改了一半的页
+  Page &fetchPage(size_t id, Page &scratch, PageGuard &guard, AccessIntent intent = AccessIntent::NORMAL,
+                  LatchMode latch = LatchMode::NONE) const;
+  void storePage(const Page &page, size_t id) const;
+
+  // 将 it 定位到第 p 页及之后的第一个已占用槽；没有则为 end()
+  void seekPage(Iterator &it, size_t p) const;
+
 public:
-  HeapFile(const std::string &name, const TupleDesc &td);
+  /**
+   * @brief Initialize a HeapFile
+   * @param buffered if true, pages are accessed through the Database BufferPool (the file must be added to the
+   * Database before use); otherwise every access reads/writes the page directly.
+   * @param layout the arrangement of tuples inside each page. PageLayout::PAX stores each column contiguously, so
+   * scans that read one column through HeapPage::column touch only that column's bytes.
+   * @param compression the on-disk page format; PageCompression::LZ trades CPU on every disk read and write for much
+   * less disk space and bandwidth on sparse pages. Pages in the BufferPool stay uncompressed.
+   * @param access FileAccess::MMAP_READ_ONLY maps the file: pages are read straight from the mapping (in buffered
+   * mode too) and scans pass `madvise` hints; inserts and deletes throw.
+   * @throws std::logic_error if layout is PageLayout::PAX and td has VARCHAR fields.
+   * @note The free-space map is loaded from `<name>.fsm`; pages it does not cover (e.g. a file written before the
+   * map existed) are read once to fill it in.
+   * @note The layout is not stored in the file; reopening a file with a different layout misreads its pages.
+   * @note In buffered mode, reads made while iterating use AccessIntent::SCAN, so a full scan only cycles through
+   * the BufferPool's small scan ring; inserts and deletes use the regular replacement policy.
+   * @note In buffered mode, inserts and deletes hold the page's exclusive latch while they change it, so with
+   * BufferPool versioning enabled a scan inside a Snapshot sees the file as it was when the snapshot was taken.
+   * @note Inserts and deletes may be called from several threads; they are serialized by a per-file mutex, since
+   * they share the free-space map and the end of the file. Scans do not take it and run concurrently with them.
+   */
+  HeapFile(const std::string &name, const TupleDesc &td, bool buffered = false,
+           PageLayout layout = PageLayout::ROW, PageCompression compression = PageCompression::NONE,
+           FileAccess access = FileAccess::READ_WRITE);
+
+  /**
+   * @brief Whether pages are accessed through the BufferPool.
+   */
+  bool isBuffered() const;
+
+  /**
+   * @brief The page layout the file was opened with.
+   */
+  PageLayout getLayout() const;
 
   /**
    * @brief Insert a tuple to the database file.
-   * @details Insert a tuple to the first available slot of the last page. If the last page is full, create a new page.
+   * @details Insert a tuple to the first available slot of the lowest page the free-space map reports as having
+   * room. If no page has room, create a new page. Slots freed by deleteTuple are therefore reused before the file
+   * grows.
    * @param t The tuple to be inserted.
+   * @throws std::logic_error if the file is read-only.
+   * @note In buffered mode the page is marked dirty instead of being written immediately.
    */
   void insertTuple(const Tuple &t) override;
 
+  /**
+   * @brief Insert a batch of tuples.
+   * @details Each page with room (lowest first, then new pages) is fetched once, filled with as many tuples of the
+   * batch as fit, and written (or marked dirty) once, so loading N rows costs one read and one write per page
+   * instead of per row. In unbuffered mode the new pages at the end of the file are written together in runs with
+   * writePages.
+   * @param tuples The tuples to insert, in order.
+   * @throws std::logic_error if the file is read-only or any tuple is not compatible with the schema; nothing is
+   * inserted in that case.
+   */
+  void insertTuples(std::span<const Tuple> tuples) override;
+
+  /**
+   * @brief Split the pages into `parts` runs of about the same length.
+   * @details Each start is found by seeking from the first page of its run to the first tuple, which reads one page
+   * per range; runs without tuples are dropped.
+   */
+  std::vector<Iterator> split(size_t parts) const override;
+
   /**
    * @brief Delete a tuple from the database file.
    * @details Delete a tuple from the database file by marking the slot unused.
    * @param it The iterator that identifies the tuple to be deleted.
+   * @throws std::logic_error if the file is read-only.
    */
   void deleteTuple(const Iterator &it) override;
 
@@ -29,6 +112,13 @@ public:
    */
   Tuple getTuple(const Iterator &it) const override;
 
+  /**
+   * @brief Get a zero-copy view of a tuple.
+   * @throws std::logic_error if the file is neither buffered nor mapped (there is no frame for the view to point into).
+   * @note Views into a mapped file stay valid while the file is open.
+   */
+  TupleView getView(const Iterator &it) const override;
+
   /**
    * @brief Advance the iterator to the next tuple.
    * @details Advance the iterator to the next tuple by moving to the next slot of the page.
@@ -51,5 +141,29 @@ public:
    * @return The iterator to the end of the file.
    */
   Iterator end() const override;
+
+  /**
+   * @brief Read the live tuples of the current page.
+   * @details The page is fetched and wrapped once; tuples are read slot by slot from the header bitmap.
+   */
+  size_t scanPage(Iterator &it, std::vector<Tuple> &out, size_t limit) const override;
+
+  /**
+   * @brief Read the live tuples of the current page that satisfy a predicate.
+   * @details With a fixed-length schema the predicate is evaluated once over the field's column of the page
+   * (HeapPage::column: contiguous with PageLayout::PAX, strided with PageLayout::ROW) into a bitmask, and only the
+   * live slots whose bit is set are deserialized. Slotted (VARCHAR) pages evaluate it slot by slot on a TupleView.
+   */
+  size_t scanPageWhere(Iterator &it, std::vector<Tuple> &out, size_t limit, const Predicate &pred) const override;
+
+  /**
+   * @brief Asynchronous scanPage: the page and, when it is exhausted, the pages up to the next live tuple are fetched
+   * with BufferPool::getPageAsync.
+   * @details Run inside an IoScheduler, every scan coroutine waiting for a page lets the others go on, and their
+   * pages are read in one batch; several ranges of a split() scanned this way overlap their reads on one thread.
+   * Outside a scheduler it behaves like scanPage. An unbuffered file reads synchronously, like scanPage.
+   * @note `it` and `out` must stay alive until the Task has finished.
+   */
+  Task<size_t> scanPageAsync(Iterator &it, std::vector<Tuple> &out, size_t limit) const;
 };
 } // namespace db
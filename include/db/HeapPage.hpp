@@ -4,23 +4,71 @@
 
 namespace db
 {
+  /**
+   * @brief How a HeapPage arranges the fields of its slots.
+   * @details Both layouts share the header bitmap and the capacity; only the data area differs.
+   * - ROW: slot s is the serialized tuple at `data + s * td.length()`.
+   * - PAX: each field has its own minipage of `capacity` values, starting at `data + capacity * td.offset_of(i)`;
+   *   field i of slot s is at `minipage + s * td.size_of(i)`. Scanning one column reads a contiguous array.
+   * @note The layout is not recorded on the page: a file must always be opened with the layout it was written in.
+   * @note Schemas with VARCHAR fields (`!td.fixed()`) always use a slotted page instead: a directory of
+   * (offset, length) entries after a small header, with rows allocated from the end of the page. The slot number is
+   * the directory index. Such schemas accept only PageLayout::ROW.
+   */
+  enum class PageLayout { ROW, PAX };
+
   class HeapPage
   {
     const TupleDesc &td;
+    PageLayout layout;
+    bool variable;         // 变长 schema：使用 (偏移, 长度) 目录，capacity 为目录项数
     size_t capacity;
-    uint8_t *header;
+    uint8_t *header;       // 定长：头位图；变长：页首
     uint8_t *data;
+    size_t live{0};        // 已占用的槽数，构造时按 64 位一组 popcount 得到
+    size_t free_hint{0};   // 第一个空槽不早于此
+    size_t cell_top{0};    // 变长：单元区起点
+    size_t used{0};        // 变长：存活元组的字节数
+
+    // 第一个 >= from 且占用状态为 occupied 的槽，每次检查 64 个头位；没有则为 capacity
+    size_t find(size_t from, bool occupied) const;
+
+    // 槽 slot 的第 field 个字段在数据区中的位置
+    uint8_t *field_ptr(size_t slot, size_t field) const;
+
+    // 按行存放（ROW 或变长页）时槽 slot 的行首
+    const uint8_t *rowAt(size_t slot) const;
+
+    // 变长页的目录与单元区
+    size_t entryOff(size_t slot) const;
+    size_t entryLen(size_t slot) const;
+    void setEntry(size_t slot, size_t off, size_t len);
+    size_t gap() const;
+    void compact();
 
   public:
+    /**
+     * @brief The values of one field across all slots of a page.
+     * @details Field i of slot s is at `data + s * stride`. With PageLayout::PAX the values are contiguous
+     * (`stride == td.size_of(i)`); with PageLayout::ROW `stride == td.length()`. Values of empty slots are zero.
+     */
+    struct Column {
+      const uint8_t *data;
+      size_t stride;
+    };
+
     /**
      * @brief Wrap a page with a heap page.
      * @details Wrap a page with a heap page by initializing the header and data pointers.
      * @param page The page to be wrapped.
      * @param td The tuple descriptor of the page.
+     * @param layout The arrangement of the data area; see PageLayout.
+     * @throws std::logic_error if td has VARCHAR fields and layout is PageLayout::PAX, or its longest row does not
+     * fit in a page.
      * @note header and data should point to locations inside the page buffer. Do not allocate extra memory.
      * @note initialize capacity to the number of slots that can fit in the page.
      */
-    HeapPage(Page &page, const TupleDesc &td);
+    HeapPage(Page &page, const TupleDesc &td, PageLayout layout = PageLayout::ROW);
 
     /**
      * @brief Get the first occupied slot of the page.
@@ -28,9 +76,16 @@ namespace db
      */
     size_t begin() const;
 
+    /**
+     * @brief Get the number of occupied slots.
+     * @details Counted once when the page is wrapped and kept up to date by insertTuple and deleteTuple.
+     */
+    size_t size() const;
+
     /**
      * @brief Get the end of the page.
-     * @return capacity can be used as the end of the page.
+     * @return capacity can be used as the end of the page. On a slotted (VARCHAR) page it is the number of
+     * directory entries, which grows and shrinks with inserts and deletes.
      */
     size_t end() const;
 
@@ -39,6 +94,8 @@ namespace db
      * @details Insert a tuple to the page by serializing the tuple to the page.
      * @param t The tuple to be inserted.
      * @return True if the tuple is inserted successfully, false otherwise if the page is full.
+     * @note On a slotted (VARCHAR) page the space freed by deletes is reclaimed by compacting the rows when the
+     * contiguous free space is too small.
      */
     bool insertTuple(const Tuple &t);
 
@@ -49,6 +106,13 @@ namespace db
      */
     void deleteTuple(size_t slot);
 
+    /**
+     * @brief Check whether the page has an unused slot.
+     * @details Constant time: compares the cached live count with the capacity. On a slotted (VARCHAR) page, true
+     * if a row of td.max_length() bytes fits, so that insertTuple is guaranteed to succeed.
+     */
+    bool hasFreeSlot() const;
+
     /**
      * @brief Check if the slot is occupied.
      * @details Check if the slot is empty by examining the header.
@@ -65,6 +129,22 @@ namespace db
      */
     Tuple getTuple(size_t slot) const;
 
+    /**
+     * @brief Get a view of the tuple at the specified slot.
+     * @details Like getTuple, but the fields are read in place from the page without deserializing.
+     * @param slot The slot of the tuple.
+     * @return A view into the page buffer; valid as long as the page is. On a PAX page it is a columnar view.
+     */
+    TupleView getView(size_t slot) const;
+
+    /**
+     * @brief Get the values of one field across all slots.
+     * @param field The index of the field in the tuple descriptor.
+     * @throws std::out_of_range if field is not a field of the tuple descriptor.
+     * @throws std::logic_error on a slotted (VARCHAR) page, whose rows have no fixed stride.
+     */
+    Column column(size_t field) const;
+
     /**
      * @brief Advance the slot to the next occupied slot.
      * @details Advance the slot to the next occupied slot by scanning the header.
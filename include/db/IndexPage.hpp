@@ -3,67 +3,93 @@
 #include <cstdint>
 #include <cstddef>
 #include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <db/KeyTraits.hpp>
 #include <db/types.hpp>   // Page = std::array<uint8_t, DEFAULT_PAGE_SIZE>
 
 namespace db {
 
+// 索引页格式：LEGACY 的孩子页号为 size_t；COMPACT 为 uint32_t，同样 4 KiB 的扇出约为 511（原来约 340）
+enum class IndexFormat : uint8_t {
+  LEGACY = 0,
+  COMPACT = 1,
+};
+
 // 索引页头：size = key 个数；index_children 表示 children 指向的是“索引页(1)”还是“叶页(0)”
 struct IndexPageHeader {
-  uint16_t size;
-  uint8_t  index_children;   // 0: children 指向 LeafPage；1: children 指向 IndexPage
+  uint16_t    size;
+  uint8_t     index_children;   // 0: children 指向 LeafPage；1: children 指向 IndexPage
+  IndexFormat format;           // 位于原先的填充字节中，旧页此处为 0（LEGACY）
 };
 
+static_assert(sizeof(IndexPageHeader) == 4, "index header layout must not change");
+
 // 逻辑布局：| IndexPageHeader | keys[capacity] | children[capacity+1] |
-// - keys: int32_t 升序
-// - children: size_t 指向子页（size+1 个有效）
-struct IndexPage {
-  uint16_t         capacity{};   // 最大可容纳的 key 数
+// - keys: K 升序，起点按 alignof(K) 对齐（int32_t 时紧跟 header，与原布局一致）
+// - children: 指向子页（size+1 个有效），LEGACY 为 size_t，COMPACT 为 uint32_t
+// 全 0 的页按 COMPACT 解释；非空的 LEGACY 页照旧读取，第一次修改时原地转为 COMPACT
+template <typename K>
+struct BasicIndexPage {
+  uint16_t         capacity{};   // 最大可容纳的 key 数（按当前格式）
   IndexPageHeader* header{nullptr};
-  int32_t*         keys{nullptr};
-  size_t*          children{nullptr};
+  K*               keys{nullptr};
 
-  explicit IndexPage(Page &page) {
-    // 头部
+  explicit BasicIndexPage(Page &page) {
+    constexpr size_t kbegin = (sizeof(IndexPageHeader) + alignof(K) - 1) / alignof(K) * alignof(K);
     header = reinterpret_cast<IndexPageHeader*>(page.data());
-    // 计算容量
-    uint8_t* base = reinterpret_cast<uint8_t*>(page.data()) + sizeof(IndexPageHeader);
-    const size_t rem = page.size() - sizeof(IndexPageHeader);
-    const size_t ksz = sizeof(int32_t);
-    const size_t csz = sizeof(size_t);
+    base   = reinterpret_cast<uint8_t*>(page.data()) + kbegin;
+    rem    = page.size() - kbegin;
+    keys   = reinterpret_cast<K*>(base);
 
-    // rem = capacity*ksz + (capacity+1)*csz  => capacity = (rem - csz) / (ksz + csz)
-    const size_t cap = (rem > csz) ? ((rem - csz) / (ksz + csz)) : 0;
-    capacity = static_cast<uint16_t>(cap);
-
-    // 指针切分
-    keys     = reinterpret_cast<int32_t*>(base);
-    children = reinterpret_cast<size_t*>(base + capacity * ksz);
+    // 旧格式的空根页（size 0，children[0] 为 0）与全 0 页无法区分，也无需区分
+    const bool empty = header->size == 0 && legacyChild(0) == 0;
+    layout(empty || header->format == IndexFormat::COMPACT ? IndexFormat::COMPACT : IndexFormat::LEGACY);
 
     // 防御：超界时复位
     if (header->size > capacity) header->size = 0;
   }
 
+  bool isCompact() const { return compact; }
+
+  size_t child(size_t i) const {
+    if (compact) {
+      uint32_t id;
+      std::memcpy(&id, cbase + i * sizeof(uint32_t), sizeof(id));
+      return id;
+    }
+    return legacyChild(i);
+  }
+
+  // 写孩子页号；旧格式页先转为 COMPACT
+  void setChild(size_t i, size_t id) {
+    const uint32_t narrow = narrowId(id);
+    upgrade();
+    std::memcpy(cbase + i * sizeof(uint32_t), &narrow, sizeof(narrow));
+  }
+
   // 在保持升序的前提下，把 (key, child) 插入到“合适位置的右侧”
   // 返回值：true 表示已满，需要上层 split
-  bool insert(int key, size_t child) {
+  bool insert(const K &key, size_t child) {
+    upgrade();
     const uint16_t n = header->size;
     if (n >= capacity) return true;  // 满了，交由上层 split
 
     // 找到第一个 >= key 的位置
-    uint16_t pos = 0;
-    while (pos < n && keys[pos] < key) ++pos;
+    const uint16_t pos = static_cast<uint16_t>(key_lower_bound(keys, n, key));
 
     // 右移 keys[pos..n-1] → [pos+1..n]
     if (n > pos) {
-      std::memmove(&keys[pos + 1], &keys[pos], (n - pos) * sizeof(int32_t));
+      std::memmove(&keys[pos + 1], &keys[pos], (n - pos) * sizeof(K));
     }
     // 右移 children[pos+1..n] → [pos+2..n+1]
     if (n + 1 > pos + 1) {
-      std::memmove(&children[pos + 2], &children[pos + 1], (n - pos) * sizeof(size_t));
+      std::memmove(cbase + (pos + 2) * sizeof(uint32_t), cbase + (pos + 1) * sizeof(uint32_t),
+                   (n - pos) * sizeof(uint32_t));
     }
 
-    keys[pos]       = static_cast<int32_t>(key);
-    children[pos+1] = child;
+    keys[pos] = key;
+    setChild(pos + 1, child);
 
     header->size = static_cast<uint16_t>(n + 1);
     return (header->size == capacity);
@@ -71,21 +97,21 @@ struct IndexPage {
 
   // 分裂：把中间 key 上推到父结点（不保留在左右子页中）
   // 返回值：上推的中位 key
-  int split(IndexPage &new_page) {
+  K split(BasicIndexPage &new_page) {
+    upgrade();
+    new_page.upgrade();
     const uint16_t n = header->size;
     // 约定：n>0 时才会被调用
     const uint16_t mid   = static_cast<uint16_t>(n / 2);
-    const int up_key     = keys[mid];
+    const K up_key       = keys[mid];
     const uint16_t right = static_cast<uint16_t>(n - mid - 1); // 右侧 key 个数
 
     // 把右半部分移动到新页
     if (right > 0) {
-      std::memcpy(new_page.keys, &keys[mid + 1], right * sizeof(int32_t));
+      std::memcpy(new_page.keys, &keys[mid + 1], right * sizeof(K));
     }
     // children 右半（比 keys 多 1 个）：children[mid+1 .. n]
-    if (right + 1 > 0) {
-      std::memcpy(new_page.children, &children[mid + 1], (right + 1) * sizeof(size_t));
-    }
+    std::memcpy(new_page.cbase, cbase + (mid + 1) * sizeof(uint32_t), (right + 1) * sizeof(uint32_t));
 
     // 更新两页 size
     new_page.header->size = right;
@@ -94,6 +120,81 @@ struct IndexPage {
 
     return up_key; // 上推键
   }
+
+  // 删除 keys[pos] 及其右侧孩子 children[pos+1]（合并掉的右页）
+  void remove(size_t pos) {
+    upgrade();
+    const uint16_t n = header->size;
+    std::memmove(&keys[pos], &keys[pos + 1], (n - pos - 1) * sizeof(K));
+    std::memmove(cbase + (pos + 1) * sizeof(uint32_t), cbase + (pos + 2) * sizeof(uint32_t),
+                 (n - pos - 1) * sizeof(uint32_t));
+    header->size = static_cast<uint16_t>(n - 1);
+  }
+
+  // 合并：父结点中的分隔键 sep 下移，后接右邻页 right 的全部 key 与孩子；right 清空
+  // 合并后不能正好满页（满页的插入会被拒绝），调用方保证 size + right.size + 1 < capacity
+  void merge(BasicIndexPage &right, const K &sep) {
+    upgrade();
+    right.upgrade();
+    const uint16_t n = header->size;
+    const uint16_t r = right.header->size;
+    if (n + r + 1 >= capacity) {
+      throw std::logic_error("IndexPage: merged index page would overflow");
+    }
+    keys[n] = sep;
+    std::memcpy(&keys[n + 1], right.keys, r * sizeof(K));
+    std::memcpy(cbase + (n + 1) * sizeof(uint32_t), right.cbase, (r + 1) * sizeof(uint32_t));
+    header->size = static_cast<uint16_t>(n + r + 1);
+    right.header->size = 0;
+  }
+
+private:
+  uint8_t* base{nullptr};    // keys 数组起点
+  uint8_t* cbase{nullptr};   // children 数组起点
+  size_t   rem{0};           // keys 起点之后的字节数
+  bool     compact{false};
+
+  void layout(IndexFormat format) {
+    compact = format == IndexFormat::COMPACT;
+    const size_t ksz = sizeof(K);
+    const size_t csz = compact ? sizeof(uint32_t) : sizeof(size_t);
+    // rem = capacity*ksz + (capacity+1)*csz  => capacity = (rem - csz) / (ksz + csz)
+    const size_t cap = (rem > csz) ? ((rem - csz) / (ksz + csz)) : 0;
+    capacity = static_cast<uint16_t>(cap);
+    cbase = base + capacity * ksz;
+  }
+
+  // 旧格式的 children 不一定按 size_t 对齐，用 memcpy 读
+  size_t legacyChild(size_t i) const {
+    const size_t legacy_cap = (rem - sizeof(size_t)) / (sizeof(K) + sizeof(size_t));
+    size_t id;
+    std::memcpy(&id, base + legacy_cap * sizeof(K) + i * sizeof(size_t), sizeof(id));
+    return id;
+  }
+
+  static uint32_t narrowId(size_t id) {
+    if (id > std::numeric_limits<uint32_t>::max()) {
+      throw std::out_of_range("IndexPage: child page id does not fit in 32 bits");
+    }
+    return static_cast<uint32_t>(id);
+  }
+
+  // keys 位置不变，只把 size+1 个孩子改写为 32 位
+  void upgrade() {
+    if (!compact) {
+      // 先全部读出并检查，改写过程中不会抛异常
+      const size_t n = header->size;
+      uint32_t ids[DEFAULT_PAGE_SIZE / sizeof(size_t)];
+      for (size_t i = 0; i <= n; ++i) {
+        ids[i] = narrowId(legacyChild(i));
+      }
+      layout(IndexFormat::COMPACT);
+      std::memcpy(cbase, ids, (n + 1) * sizeof(uint32_t));
+    }
+    header->format = IndexFormat::COMPACT;
+  }
 };
 
+using IndexPage = BasicIndexPage<int32_t>;
+
 } // namespace db
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <db/types.hpp>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace db {
+    class DbFile;
+
+    enum class IoOp {
+        READ, WRITE
+    };
+
+    /**
+     * @brief One page-sized read or write.
+     * @details `buf` must stay valid until the request completes. A read past the end of the file fills the rest of
+     * the page with zeros, like DbFile::readPage.
+     */
+    struct IoRequest {
+        IoOp op;
+        const DbFile *file;
+        size_t page;
+        Page *buf;
+    };
+
+/**
+ * @brief Batched page I/O engine.
+ * @details Submits a whole batch of page reads/writes with a single system call through io_uring when the kernel
+ * supports it, and falls back to one pread/pwrite per page otherwise (no header, ENOSYS, or io_uring disabled by a
+ * sandbox). Requests are accounted in the owning DbFile's I/O statistics like the synchronous path. Requests on
+ * compressed files always take the synchronous path, since their pages have no fixed offset.
+ * @note The engine is thread-safe; concurrent batches are serialized on the ring.
+ */
+    class IoEngine {
+        int ring_fd{-1};
+        unsigned entries{0};
+
+        // 映射出来的 SQ/CQ 环
+        void *sq_ring{nullptr};
+        void *cq_ring{nullptr};
+        size_t sq_ring_size{0};
+        size_t cq_ring_size{0};
+        void *sqes{nullptr};
+        size_t sqes_size{0};
+
+        unsigned *sq_head{nullptr};
+        unsigned *sq_tail{nullptr};
+        unsigned *sq_mask{nullptr};
+        unsigned *sq_array{nullptr};
+        unsigned *cq_head{nullptr};
+        unsigned *cq_tail{nullptr};
+        unsigned *cq_mask{nullptr};
+        void *cqes{nullptr};
+
+        std::mutex mtx;
+
+        bool setupRing(unsigned queue_depth);
+        void runRing(std::vector<IoRequest> &batch, size_t first, size_t count);
+        static void runSync(const IoRequest &req);
+
+    public:
+        /**
+         * @brief Create an engine.
+         * @param queue_depth The number of in-flight requests per submission; larger batches are split.
+         */
+        explicit IoEngine(unsigned queue_depth = 64);
+
+        ~IoEngine();
+
+        IoEngine(const IoEngine &) = delete;
+
+        IoEngine &operator=(const IoEngine &) = delete;
+
+        /**
+         * @brief Whether batches go through io_uring (as opposed to the pread/pwrite fallback).
+         */
+        bool usesIoUring() const;
+
+        /**
+         * @brief Submit a batch and wait until every request has completed.
+         * @param batch The requests to run.
+         * @throws std::runtime_error if any request fails; the other requests of the batch still complete.
+         */
+        void run(std::vector<IoRequest> &batch);
+    };
+} // namespace db
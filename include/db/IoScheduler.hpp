@@ -0,0 +1,81 @@
+#pragma once
+
+#include <db/Task.hpp>
+#include <db/types.hpp>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace db {
+    class BufferPool;
+    enum class AccessIntent;
+
+/**
+ * @brief Runs coroutines on the calling thread and loads the pages they wait for in batches.
+ * @details Coroutines started with spawn() run until they finish or `co_await` a page that is not in the BufferPool
+ * (BufferPool::getPageAsync). Once none can go on, the pages all of them wait for are loaded with
+ * BufferPool::prefetch, which reads the uncached pages of each shard with one IoEngine batch (one system call with
+ * io_uring), and the waiting coroutines are resumed. One thread can so keep as many page reads in flight as it has
+ * coroutines, e.g. hundreds of B-tree probes (BTreeFile::findAsync), without a thread per request.
+ * @note A scheduler belongs to the thread that calls run(); coroutines must not hold a page latch across a
+ * `co_await`, since the other coroutines of the thread may latch the same page. Pins are fine.
+ */
+    class IoScheduler {
+        struct Waiter {
+            PageId pid;
+            AccessIntent intent;
+            std::coroutine_handle<> handle;
+        };
+
+        BufferPool &pool;
+        std::deque<std::coroutine_handle<>> ready;
+        std::vector<Waiter> waiting;
+        std::vector<Task<>> tasks;
+        uint64_t rounds{0};
+        uint64_t loads{0};
+
+        // 载入所有等待的页，唤醒等待者
+        void loadWaiting();
+
+    public:
+        explicit IoScheduler(BufferPool &pool);
+
+        IoScheduler(const IoScheduler &) = delete;
+
+        IoScheduler &operator=(const IoScheduler &) = delete;
+
+        /**
+         * @brief Add a coroutine; it starts in the next run(), or in the current one if run() is in progress.
+         */
+        void spawn(Task<> task);
+
+        /**
+         * @brief Run the coroutines until all have finished.
+         * @throws The first exception a coroutine ended with (in spawn order), after all of them have finished.
+         * @throws std::logic_error if a scheduler is already running on the calling thread (e.g. run() called from a
+         * coroutine).
+         */
+        void run();
+
+        /**
+         * @brief The scheduler whose run() is executing on the calling thread, or nullptr.
+         */
+        static IoScheduler *current();
+
+        /**
+         * @brief Suspend a coroutine until the page is loaded; used by BufferPool::getPageAsync.
+         */
+        void wait(const PageId &pid, AccessIntent intent, std::coroutine_handle<> handle);
+
+        /**
+         * @brief The number of times the scheduler loaded waited-for pages.
+         */
+        uint64_t getRounds() const { return rounds; }
+
+        /**
+         * @brief The number of page waits satisfied by those loads.
+         */
+        uint64_t getLoads() const { return loads; }
+    };
+} // namespace db
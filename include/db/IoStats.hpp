@@ -0,0 +1,144 @@
+#pragma once
+
+#include <db/IoEngine.hpp>
+#include <db/types.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace db {
+    /// Default number of page ids DbFile keeps for getReads()/getWrites(); see DbFile::setIoHistoryLimit.
+    constexpr size_t DEFAULT_IO_HISTORY = 1 << 16;
+
+/**
+ * @brief Histogram of I/O latencies with power-of-two buckets.
+ * @details Bucket `i` counts latencies in [2^i, 2^(i+1)) nanoseconds, bucket 0 also 0 ns, and the last bucket
+ * everything longer. Recording is one relaxed atomic increment, so histograms can stay on in production.
+ */
+    class LatencyHistogram {
+    public:
+        static constexpr size_t BUCKETS = 40;   // 2^40 ns，约 18 分钟
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+
+    public:
+        void record(uint64_t ns);
+
+        /// The number of latencies recorded.
+        uint64_t count() const;
+
+        /// The number of latencies recorded in bucket `i`.
+        uint64_t bucket(size_t i) const;
+
+        /**
+         * @brief An upper bound of the `q`-quantile.
+         * @param q In [0, 1], e.g. 0.99.
+         * @return The upper end, in nanoseconds, of the bucket the quantile falls in; 0 if nothing was recorded.
+         */
+        uint64_t percentile(double q) const;
+    };
+
+    /**
+     * @brief Page I/O counters of one DbFile (see DbFile::getIoStats).
+     * @details A run written with one `pwritev` counts as one latency sample and as a write of each of its pages.
+     * Requests submitted through io_uring are timed from the submission of their batch.
+     */
+    struct FileIoStats {
+        std::atomic<uint64_t> reads{0};    ///< Pages read.
+        std::atomic<uint64_t> writes{0};   ///< Pages written.
+        LatencyHistogram read_latency;
+        LatencyHistogram write_latency;
+    };
+
+/**
+ * @brief The most recent page ids of one kind of I/O of a DbFile (see DbFile::getReads), in a fixed ring.
+ * @details Recording claims slots with one relaxed `fetch_add` on a cursor and stores the ids with relaxed stores:
+ * no lock, no allocation and no shifting on the I/O path. The ring is allocated by the first record(), so a file
+ * that does no I/O costs nothing.
+ * @note ids() is exact when no I/O runs concurrently; otherwise ids being recorded may be missing or stale.
+ */
+    class PageHistory {
+        struct Ring {
+            const size_t capacity;
+            std::unique_ptr<std::atomic<size_t>[]> ids;
+            std::atomic<uint64_t> recorded{0};   // 累计记录数；下一条写到 recorded % capacity
+
+            explicit Ring(size_t capacity);
+        };
+
+        std::atomic<Ring *> ring{nullptr};
+        std::atomic<size_t> limit;
+        // 分配与替换环；替换下来的环留到析构，正在记录的线程可能还在写
+        std::mutex mtx;
+        std::vector<std::unique_ptr<Ring>> rings;
+
+        Ring *allocate();
+
+    public:
+        explicit PageHistory(size_t limit = DEFAULT_IO_HISTORY);
+
+        PageHistory(const PageHistory &) = delete;
+
+        PageHistory &operator=(const PageHistory &) = delete;
+
+        /// Record the ids `first_id .. first_id + count - 1`.
+        void record(size_t first_id, size_t count);
+
+        /// The recorded ids, oldest first; at most the limit.
+        std::vector<size_t> ids() const;
+
+        /**
+         * @brief Keep the last `limit` ids from now on; 0 stops recording and drops the ids.
+         * @details The most recent ids are carried over. The replaced ring is freed with the history, so this is for
+         * tests and setup, not for calling per operation.
+         */
+        void setLimit(size_t limit);
+    };
+
+    /// One page I/O, as recorded by IoTrace.
+    struct IoTraceEvent {
+        IoOp op;
+        file_id_t file;
+        size_t page;
+        uint64_t start_ns;     ///< `steady_clock` time the request started.
+        uint64_t latency_ns;
+    };
+
+/**
+ * @brief Bounded ring buffer of the most recent page I/Os of all files, off by default.
+ * @details While disabled, the cost of tracing is one relaxed atomic load per I/O. Enabled, every page read or
+ * written appends an event under a mutex, overwriting the oldest once the ring is full.
+ */
+    class IoTrace {
+        std::atomic<bool> on{false};
+        mutable std::mutex mtx;
+        std::vector<IoTraceEvent> ring;
+        size_t recorded{0};   // 累计记录数；下一条写到 recorded % ring.size()
+
+    public:
+        /**
+         * @brief Start tracing into a ring of `capacity` events, dropping the events recorded so far.
+         * @throws std::logic_error if `capacity` is 0.
+         */
+        void enable(size_t capacity);
+
+        /// Stop tracing; the events recorded so far are kept.
+        void disable();
+
+        bool enabled() const { return on.load(std::memory_order_relaxed); }
+
+        void record(const IoTraceEvent &event);
+
+        /// The events in the ring, oldest first.
+        std::vector<IoTraceEvent> events() const;
+    };
+
+/**
+ * @brief Returns the process-wide I/O trace.
+ */
+    IoTrace &getIoTrace();
+} // namespace db
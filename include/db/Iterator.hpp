@@ -1,6 +1,7 @@
 #pragma once
 
 #include <db/Tuple.hpp>
+#include <memory>
 
 namespace db {
     class DbFile;
@@ -9,6 +10,8 @@ namespace db {
         const DbFile &file;
         size_t page;
         size_t slot;
+        // 文件私有的游标状态（BTreeFile 存当前叶的 pin），不参与比较
+        mutable std::shared_ptr<void> cache;
 
     public:
         Iterator(const DbFile &file, const size_t &page, size_t slot);
@@ -21,6 +24,12 @@ namespace db {
 
         Tuple operator*() const;
 
+        /**
+         * @brief Zero-copy access to the current tuple.
+         * @see DbFile::getView
+         */
+        TupleView view() const;
+
         Iterator &operator++();
 
         bool operator==(const Iterator &other) const { return page == other.page && slot == other.slot; }
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace db {
+/**
+ * @brief Search kernels for sorted int32 keys.
+ * @details Each search narrows the range with a binary search, then counts the keys below the search key in the
+ * last window with vector compares (AVX-512, AVX2 or NEON, whichever the translation unit is compiled for; scalar
+ * otherwise). Because the keys are sorted, that count is the insertion position, so the final probes need no
+ * data-dependent branches.
+ */
+
+    /**
+     * @brief Index of the first key that is not less than `key` (like std::lower_bound).
+     * @param keys The keys, in ascending order.
+     * @param n The number of keys.
+     */
+    size_t lower_bound_keys(const int32_t *keys, size_t n, int32_t key);
+
+    /**
+     * @brief Index of the first key that is greater than `key` (like std::upper_bound).
+     * @param keys The keys, in ascending order.
+     * @param n The number of keys.
+     */
+    size_t upper_bound_keys(const int32_t *keys, size_t n, int32_t key);
+
+    /**
+     * @brief lower_bound_keys over keys stored at a fixed stride, e.g. a key field inside serialized tuples.
+     * @param base The address of the first key; keys need not be aligned.
+     * @param stride The distance in bytes between two keys.
+     * @param n The number of keys.
+     * @note The window is loaded with gathers where available.
+     */
+    size_t lower_bound_strided(const uint8_t *base, size_t stride, size_t n, int32_t key);
+} // namespace db
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <db/KeySearch.hpp>
+#include <db/Tuple.hpp>
+#include <db/types.hpp>
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace db {
+    /// CHAR(64) key: the zero-padded field bytes, compared as unsigned bytes (like memcmp).
+    using CharKey = std::array<uint8_t, CHAR_SIZE>;
+
+    /// Composite key of two INT fields, compared lexicographically. Trivially copyable, so pages can memmove it.
+    struct IntPairKey {
+        int32_t first;
+        int32_t second;
+
+        friend constexpr auto operator<=>(const IntPairKey &, const IntPairKey &) = default;
+    };
+
+/**
+ * @brief Compile-time description of a B-tree key type.
+ * @details A specialization lists the field types the key is made of (`types`), reads a key straight from the
+ * serialized bytes of a tuple given the byte offsets of its fields (`read`), and extracts it from a Tuple given the
+ * field indices (`of`). Keys are plain values with `operator<`/`operator==`, so comparisons in the pages are
+ * resolved at compile time and never go through field_t.
+ */
+    template<typename K>
+    struct KeyTraits;
+
+    /// Field indices (or byte offsets) of the fields a key of type K is made of.
+    template<typename K>
+    using KeyFields = std::array<size_t, KeyTraits<K>::types.size()>;
+
+    template<>
+    struct KeyTraits<int32_t> {
+        static constexpr std::array<type_t, 1> types{type_t::INT};
+
+        static int32_t read(const uint8_t *tuple, const KeyFields<int32_t> &offsets) {
+            int32_t v;
+            std::memcpy(&v, tuple + offsets[0], INT_SIZE);
+            return v;
+        }
+
+        static int32_t of(const Tuple &t, const KeyFields<int32_t> &fields) {
+            return std::get<int>(t.get_field(fields[0]));
+        }
+    };
+
+    template<>
+    struct KeyTraits<double> {
+        static constexpr std::array<type_t, 1> types{type_t::DOUBLE};
+
+        static double read(const uint8_t *tuple, const KeyFields<double> &offsets) {
+            double v;
+            std::memcpy(&v, tuple + offsets[0], DOUBLE_SIZE);
+            return v;
+        }
+
+        static double of(const Tuple &t, const KeyFields<double> &fields) {
+            return std::get<double>(t.get_field(fields[0]));
+        }
+    };
+
+    template<>
+    struct KeyTraits<CharKey> {
+        static constexpr std::array<type_t, 1> types{type_t::CHAR};
+
+        static CharKey read(const uint8_t *tuple, const KeyFields<CharKey> &offsets) {
+            CharKey v;
+            std::memcpy(v.data(), tuple + offsets[0], CHAR_SIZE);
+            return v;
+        }
+
+        // 与 TupleDesc::serialize 一致：超长截断，其余补 0
+        static CharKey of(const Tuple &t, const KeyFields<CharKey> &fields) {
+            const std::string &s = std::get<std::string>(t.get_field(fields[0]));
+            CharKey v{};
+            std::memcpy(v.data(), s.data(), std::min(s.size(), CHAR_SIZE));
+            return v;
+        }
+    };
+
+    template<>
+    struct KeyTraits<IntPairKey> {
+        static constexpr std::array<type_t, 2> types{type_t::INT, type_t::INT};
+
+        static IntPairKey read(const uint8_t *tuple, const KeyFields<IntPairKey> &offsets) {
+            IntPairKey v;
+            std::memcpy(&v.first, tuple + offsets[0], INT_SIZE);
+            std::memcpy(&v.second, tuple + offsets[1], INT_SIZE);
+            return v;
+        }
+
+        static IntPairKey of(const Tuple &t, const KeyFields<IntPairKey> &fields) {
+            return {std::get<int>(t.get_field(fields[0])), std::get<int>(t.get_field(fields[1]))};
+        }
+    };
+
+    /// Index of the first key that is not less than `key`; int32 keys use the vectorized kernel.
+    template<typename K>
+    size_t key_lower_bound(const K *keys, size_t n, const K &key) {
+        if constexpr (std::is_same_v<K, int32_t>) {
+            return lower_bound_keys(keys, n, key);
+        } else {
+            return static_cast<size_t>(std::lower_bound(keys, keys + n, key) - keys);
+        }
+    }
+
+    /// Index of the first key that is greater than `key`; int32 keys use the vectorized kernel.
+    template<typename K>
+    size_t key_upper_bound(const K *keys, size_t n, const K &key) {
+        if constexpr (std::is_same_v<K, int32_t>) {
+            return upper_bound_keys(keys, n, key);
+        } else {
+            return static_cast<size_t>(std::upper_bound(keys, keys + n, key) - keys);
+        }
+    }
+} // namespace db
@@ -1,33 +1,128 @@
 #pragma once
 #include <cstdint>
 #include <cstddef>
+#include <vector>
+#include <db/KeyTraits.hpp>
 #include <db/Tuple.hpp>
 #include <db/types.hpp>   // 这里需要 Page
 
 namespace db {
 
+  // 叶页格式
+  // - LEGACY : | header | 按 key 顺序紧挨存放的元组 ... |
+  // - SLOTTED: | header | K keys[capacity] | uint16 slots[capacity] | 定长元组单元 heap[capacity] |
+  //   keys/slots 按 key 有序，slots[i] 为第 i 条元组所在单元；查找只碰 key 数组，插入只移动 key 与 2 字节的槽
+  // - VARIABLE: | header | K keys[size] | uint16 slots[size] | 空闲 | 变长元组单元（自页尾向前分配）|
+  //   含 VARCHAR 的 schema 专用；slots[i] 为第 i 条元组相对 data 的字节偏移，删除留下的空洞在空间不够时整理掉
+  enum class LeafFormat : uint8_t {
+    LEGACY = 0,
+    SLOTTED = 1,
+    VARIABLE = 2,
+  };
+
   struct LeafPageHeader {
-    size_t   next_leaf;  // 没有则可设为 (size_t)-1
-    uint16_t size;       // 当前元组数
+    size_t     next_leaf;  // 没有则可设为 (size_t)-1
+    uint16_t   size;       // 当前元组数
+    LeafFormat format;     // 位于原先的填充字节中，旧页此处为 0（LEGACY）
+    uint16_t   cell_top;   // 仅 VARIABLE：单元区起点（相对 data）
+    uint16_t   dead;       // 仅 VARIABLE：单元区中已删除元组的字节数
   };
 
-  struct LeafPage {
-    const TupleDesc &td;
-    const size_t     key_index;   // key 字段索引（类型为 int）
-    uint16_t         capacity{};  // 该页最多可容纳的 tuple 数
+  static_assert(sizeof(LeafPageHeader) == 2 * sizeof(size_t), "leaf header layout must not change");
+
+  // K 为 key 类型（见 KeyTraits），key 由 key_fields 指定的字段组成
+  template <typename K>
+  struct BasicLeafPage {
+    const TupleDesc  &td;
+    const KeyFields<K> key_fields;  // 组成 key 的字段索引，类型须与 KeyTraits<K>::types 一致
+    uint16_t         capacity{};    // 该页（按当前格式）最多可容纳的 tuple 数
 
     LeafPageHeader *header{nullptr};
-    uint8_t        *data{nullptr};
+    uint8_t        *data{nullptr};   // header 之后的区域
+
+    // 仅 SLOTTED 格式有效
+    K              *keys{nullptr};
+    uint16_t       *slots{nullptr};
+    uint8_t        *heap{nullptr};
+
+    // 空页按 SLOTTED 解释；非空的 LEGACY 页照旧读取，首次插入时若放得下则原地转换
+    // 含 VARCHAR 的 schema 总是 VARIABLE 格式，此时 capacity 只是（按最短元组算的）条数上限
+    // 字段类型与 K 不符，或变长元组太长、一页放不下 4 条最长元组时抛 std::logic_error
+    BasicLeafPage(Page &page, const TupleDesc &td, const KeyFields<K> &key_fields);
 
-    LeafPage(Page &page, const TupleDesc &td, size_t key_index);
+    // 单字段 key 的便捷形式
+    BasicLeafPage(Page &page, const TupleDesc &td, size_t key_index)
+      requires (KeyTraits<K>::types.size() == 1)
+      : BasicLeafPage(page, td, KeyFields<K>{key_index}) {}
+
+    bool isSlotted() const;
 
     // 按 key 有序插入；若 key 已存在，则覆盖；返回是否“已满需要 split”
+    // 注意：页已满且 key 不存在时不会插入，调用方 split 之后需重新插入
     bool insertTuple(const Tuple &t);
 
+    // 再插入 n 条新 key 后仍不满，即插入不会引发 split
+    // VARIABLE 格式按最长元组估算：之后还放得下一条最长元组才算不满
+    bool hasRoomFor(size_t n) const;
+
+    // 与右邻叶 right 合并后仍不满
+    bool canMerge(const BasicLeafPage &right) const;
+
+    // t 在本页占用的字节数（含 key 与槽）；未使用的字节数
+    size_t cellBytes(const Tuple &t) const;
+    size_t freeBytes() const;
+
+    // 第一个 key >= k 的槽位；都小于 k 时返回 size
+    uint16_t lowerBound(const K &k) const;
+
+    // 第 slot 条（按 key 顺序）元组的 key
+    K keyAt(size_t slot) const;
+
     // 分裂：右半移动到 new_page；返回 new_page 的首 key（分裂键）
-    int split(LeafPage &new_page);
+    // 两半放得下时都写成 SLOTTED 格式
+    K split(BasicLeafPage &new_page);
+
+    // 删除第 slot 条元组，后面的槽位依次前移；越界时抛 std::out_of_range
+    void deleteTuple(size_t slot);
+
+    // 把右邻叶 right 的全部元组并入本页并接管其 next_leaf；right 清空
+    // 调用方保证两页合计放得下本页
+    void merge(BasicLeafPage &right);
+
+    // 与右邻叶 right 平分元组；返回 right 的新首 key（父结点中的新分隔键）
+    K redistribute(BasicLeafPage &right);
 
     Tuple getTuple(size_t slot) const;
+
+    // 不反序列化，直接返回指向页内字节的视图
+    TupleView getView(size_t slot) const;
+
+  private:
+    size_t area{};   // header 之后的字节数
+    KeyFields<K> key_offsets{};   // 各 key 字段在元组内的字节偏移
+    bool variable{};              // schema 含 VARCHAR，页为 VARIABLE 格式
+
+    void layout(LeafFormat format);
+    uint16_t slottedCapacity() const;
+    uint8_t *tupleAt(size_t slot) const;
+    void upgrade();
+    // 按 key 顺序把全部元组紧挨着追加到 out；starts 依次记下各元组的起点，末尾总是 out 的总长
+    size_t copyRows(std::vector<uint8_t> &out, std::vector<size_t> &starts) const;
+    // 能放下 n 条时用 SLOTTED，否则用 LEGACY；变长 schema 总是 VARIABLE
+    LeafFormat formatFor(size_t n) const;
+    // 用按 key 排好的第 [first, last) 条元组（rows 中从 starts[i] 起）重写本页
+    void rebuild(const uint8_t *rows, const std::vector<size_t> &starts, size_t first, size_t last,
+                 LeafFormat format);
+    // 在 starts 描述的 [0, n) 条元组中选一个分界，使两边字节数接近（定长时即 n / 2）
+    size_t middle(const std::vector<size_t> &starts, size_t n) const;
+
+    // 仅 VARIABLE
+    size_t maxCell() const;
+    size_t cellTop() const;
+    size_t usedBytes() const;
+    void compact();
   };
 
+  using LeafPage = BasicLeafPage<int32_t>;
+
 } // namespace db
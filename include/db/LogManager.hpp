@@ -0,0 +1,148 @@
+#pragma once
+
+#include <db/types.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace db {
+    /// Log sequence number: an offset in the log file, which starts empty whenever a LogManager is created.
+    using lsn_t = uint64_t;
+
+    /// An LSN that no unit has.
+    constexpr lsn_t NO_LSN = ~lsn_t{0};
+
+    /// A page that has changes in the log that may not be on disk yet, as recorded by a checkpoint.
+    struct DirtyPage {
+        std::string file;
+        size_t page;
+        lsn_t rec_lsn;   ///< No unit of the page that starts before this LSN needs to be replayed.
+    };
+
+    /**
+     * @brief The changes a recovery has to apply, read back by LogManager::read().
+     * @details `changes` are the byte ranges of the complete units in log order, after the units the last checkpoint
+     * proves to be on disk have been dropped; the ranges of one page must be applied in this order.
+     */
+    struct RedoLog {
+        struct Change {
+            uint32_t file;     ///< Index into `files`.
+            uint64_t page;
+            uint32_t offset;   ///< Byte offset in the page.
+            uint32_t length;
+            const uint8_t *bytes;   ///< Points into `log`.
+        };
+
+        std::vector<std::string> files;
+        std::vector<Change> changes;
+        size_t units{0};             ///< Complete units read, including the ones whose changes were dropped.
+        lsn_t start{0};              ///< Where reading started: the checkpoint's redo point, or 0.
+        std::vector<uint8_t> log;    ///< The log from `start` on.
+    };
+
+/**
+ * @brief Append-only write-ahead log of page changes, with group commit.
+ * @details The log is a sequence of units, each `[u32 length][u32 crc32][records]`. A unit holds the records of one
+ * atomic change: one page, or every page of a multi-page operation (see LogGroup). A record names a page by file
+ * name and page number and carries either the full page image or the byte ranges that changed since the page was
+ * last logged; replaying the records of a page in order therefore rebuilds it from whatever state it has on disk,
+ * including a torn write, as long as the first record since the page was last written is a full image.
+ * Appends go to an in-memory buffer. flush() writes and `fdatasync`s the buffer; threads that ask for a flush while
+ * one is in progress wait for it and are then served together by the next one, so concurrent commits share fsyncs.
+ * checkpoint() appends a unit with the dirty-page table: for each page whose changes may not be on disk, the LSN
+ * from which its units must be replayed. Its position goes to `<path>.ckpt`, so recovery starts at the oldest of those
+ * LSNs instead of the start of the log, skips units of pages the table does not list, and the file space before that
+ * point is given back with `FALLOC_FL_PUNCH_HOLE` (the file keeps its size; offsets stay LSNs).
+ * @note Recovery stops at the first unit that is incomplete or fails its checksum, i.e. at the torn tail of a crash.
+ */
+    class LogManager {
+        int fd{-1};
+        std::string path;
+
+        mutable std::mutex mtx;
+        std::condition_variable flushed_cv;
+        std::vector<uint8_t> buffer;   // 已追加、尚未写出的单元
+        lsn_t appended{0};
+        lsn_t flushed{0};
+        bool flushing{false};
+        size_t syncs{0};
+        lsn_t discarded{0};            // 文件中此前的空间已经打洞释放
+
+    public:
+        /// Bytes in front of the records of a unit.
+        static constexpr size_t UNIT_HEADER = 2 * sizeof(uint32_t);
+
+        /**
+         * @brief Open the log at `path`, discarding any previous content.
+         * @details Recover a log left by a crash with read() before opening it. The checkpoint file of a previous log
+         * is removed once the log is empty.
+         * @throws std::runtime_error if the file cannot be opened or truncated.
+         */
+        explicit LogManager(const std::string &path);
+
+        /**
+         * @brief Flushes the log and closes it.
+         */
+        ~LogManager();
+
+        LogManager(const LogManager &) = delete;
+
+        LogManager &operator=(const LogManager &) = delete;
+
+        /**
+         * @brief Append a unit of records (see encode()).
+         * @return The LSN of the end of the unit.
+         */
+        lsn_t append(std::span<const uint8_t> records);
+
+        /**
+         * @brief Make the log durable up to `lsn`.
+         * @details Returns at once if it already is; otherwise either writes and syncs everything appended so far or
+         * waits for the flush in progress to do so.
+         * @throws std::runtime_error if `pwrite` or `fdatasync` fails.
+         */
+        void flush(lsn_t lsn);
+
+        /// The LSN of the end of the log.
+        lsn_t appendedLsn() const;
+
+        /// The LSN up to which the log is durable.
+        lsn_t flushedLsn() const;
+
+        /// The number of `fdatasync` calls so far.
+        size_t syncCount() const;
+
+        /**
+         * @brief Record a fuzzy checkpoint.
+         * @details Appends a unit with `begin` and the dirty-page table, flushes the log, and atomically replaces
+         * `<path>.ckpt` with the position of the unit. Recovery then replays every unit from `begin` on, and before
+         * that only the units of listed pages from their `rec_lsn` on; the space before the oldest of these is
+         * punched out of the file.
+         * @param begin The end of the log before the table was collected: a page that is not listed must have every
+         * change from a unit before `begin` on disk, synced.
+         * @return The LSN recovery will start from.
+         * @throws std::runtime_error if the log or the checkpoint file cannot be written.
+         */
+        lsn_t checkpoint(lsn_t begin, const std::vector<DirtyPage> &dirty);
+
+        /**
+         * @brief Append a page record to `records`.
+         * @param before The page as last logged, or nullptr; the record is a full image without it or when the diff
+         * would not be much smaller.
+         */
+        static void encode(std::vector<uint8_t> &records, const std::string &file, size_t page, const Page &after,
+                           const Page *before);
+
+        /**
+         * @brief Read the changes recovery has to apply from the log at `path`.
+         * @details Starts at the redo point of the checkpoint in `<path>.ckpt`, if there is a valid one, and stops at
+         * the first incomplete unit. Every unit is decoded completely before any of its changes is returned.
+         * @return The changes; empty if the file does not exist.
+         * @throws std::runtime_error if the file exists but cannot be read.
+         */
+        static RedoLog read(const std::string &path);
+    };
+} // namespace db
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <db/BTreeFile.hpp>
+#include <db/DbFile.hpp>
+#include <db/Predicate.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace db {
+    class HeapFile;
+
+    /// Rows an operator produces per batch.
+    constexpr size_t DEFAULT_BATCH_SIZE = 1024;
+
+    /// Build-side rows a HashJoin keeps in memory before it partitions both inputs to disk.
+    constexpr size_t DEFAULT_JOIN_MEMORY_ROWS = 1 << 20;
+
+    /// The values of one column of a batch: INT as int32_t, DOUBLE as double, CHAR and VARCHAR as std::string.
+    using ColumnVector = std::variant<std::vector<int32_t>, std::vector<double>, std::vector<std::string>>;
+
+/**
+ * @brief A batch of rows stored column by column.
+ * @details Column i holds the values of field i of the producing operator's schema, all columns have the same
+ * length. Operators work on whole columns in tight loops, so numeric work is auto-vectorized.
+ */
+    struct ColumnBatch {
+        std::vector<ColumnVector> columns;
+
+        /// Number of rows.
+        size_t size() const;
+
+        /// Reset to empty columns of the types of `td`, keeping their capacity.
+        void reset(const TupleDesc &td);
+
+        /// Materialize row `i`.
+        Tuple row(size_t i) const;
+    };
+
+/**
+ * @brief A pull-based vectorized operator.
+ * @details Operators form a tree; the root is drained by calling next() until it returns false.
+ */
+    class Operator {
+    public:
+        virtual ~Operator() = default;
+
+        /// The schema of the batches produced.
+        virtual const TupleDesc &schema() const = 0;
+
+        /**
+         * @brief Produce the next batch.
+         * @param batch Overwritten with up to DEFAULT_BATCH_SIZE rows; never empty when true is returned.
+         * @return false once the operator is exhausted.
+         */
+        virtual bool next(ColumnBatch &batch) = 0;
+    };
+
+/**
+ * @brief Reads a DbFile and transposes its tuples into column batches.
+ * @details Tuples are read a page at a time with DbFile::scanPage, or with DbFile::scanPageWhere when a predicate is
+ * given, so rows that do not match it are never deserialized.
+ */
+    class Scan : public Operator {
+        const DbFile &file;
+        Iterator it;
+        std::optional<Predicate> pred;
+        std::vector<Tuple> rows;
+
+    public:
+        /**
+         * @param file The file to scan; it must not be modified while the scan runs.
+         * @param pred An optional predicate pushed down into the pages.
+         * @throws std::logic_error if the predicate does not apply to the file's schema.
+         */
+        explicit Scan(const DbFile &file, std::optional<Predicate> pred = std::nullopt);
+
+        const TupleDesc &schema() const override;
+
+        bool next(ColumnBatch &batch) override;
+    };
+
+/**
+ * @brief Keeps the rows of its input that satisfy a predicate.
+ * @details The predicate is evaluated over the whole column with Predicate::evaluate, and each column is then
+ * compacted with the resulting selection.
+ */
+    class Filter : public Operator {
+        std::unique_ptr<Operator> child;
+        Predicate pred;
+        std::vector<uint64_t> mask;
+        std::vector<uint32_t> selection;
+
+    public:
+        /**
+         * @throws std::logic_error if the predicate does not apply to the child's schema.
+         */
+        Filter(std::unique_ptr<Operator> child, const Predicate &pred);
+
+        const TupleDesc &schema() const override;
+
+        bool next(ColumnBatch &batch) override;
+    };
+
+/**
+ * @brief Keeps (and reorders) a subset of the columns of its input.
+ * @details Columns are moved, not copied.
+ */
+    class Project : public Operator {
+        std::unique_ptr<Operator> child;
+        std::vector<size_t> fields;
+        TupleDesc td;
+        ColumnBatch input;
+
+    public:
+        /**
+         * @param fields The indices of the child's fields to output, in output order; a field may not repeat.
+         * @throws std::out_of_range if a field is not a field of the child's schema.
+         */
+        Project(std::unique_ptr<Operator> child, std::vector<size_t> fields);
+
+        const TupleDesc &schema() const override;
+
+        bool next(ColumnBatch &batch) override;
+    };
+
+    enum class AggregateFunc {
+        COUNT, SUM, MIN, MAX
+    };
+
+    struct Aggregate {
+        AggregateFunc func;
+        size_t field;
+    };
+
+/**
+ * @brief Groups its input by an INT column and computes aggregates per group.
+ * @details The output schema is the group column merged (TupleDesc::merge) with one column per aggregate, named
+ * like `sum(b)`: COUNT is INT, SUM is DOUBLE, and MIN and MAX have the type of their input. Each input batch is
+ * first mapped to group ids through a hash table, then every aggregate is folded in with one loop over its column.
+ * The groups are emitted in ascending key order once the input is exhausted.
+ */
+    class HashAggregate : public Operator {
+        // COUNT 为计数；SUM 用 double 累加；MIN/MAX 与输入同类型
+        using Accumulator = std::variant<std::vector<int64_t>, std::vector<double>, std::vector<int32_t>>;
+
+        std::unique_ptr<Operator> child;
+        size_t group_field;
+        std::vector<Aggregate> aggregates;
+        TupleDesc td;
+
+        std::unordered_map<int32_t, uint32_t> groups;   // 分组键 -> 组号
+        std::vector<int32_t> keys;                      // 组号 -> 分组键
+        std::vector<Accumulator> acc;
+        std::vector<uint32_t> order;                    // 按键排序的组号
+        size_t emitted{0};
+        bool built{false};
+
+        void build();
+
+    public:
+        /**
+         * @throws std::logic_error if the group field is not INT, an aggregate other than COUNT is over a field that
+         * is not INT or DOUBLE, or two aggregates are the same.
+         * @throws std::out_of_range if a field is not a field of the child's schema.
+         */
+        HashAggregate(std::unique_ptr<Operator> child, size_t group_field, std::vector<Aggregate> aggregates);
+
+        const TupleDesc &schema() const override;
+
+        bool next(ColumnBatch &batch) override;
+    };
+
+/**
+ * @brief Equi-join of two inputs on an INT column, with a hash table over the right (build) input.
+ * @details The output schema is `TupleDesc::merge(left, right)`; each left row is followed by its matches in right
+ * input order. The right input is read into a hash table first; then the left input is streamed through it once,
+ * so the output follows the left input.
+ * If the right input has more than `max_build_rows` rows, both inputs are instead hash-partitioned into
+ * PARTITIONS temporary unbuffered HeapFiles each (`<spill_prefix>.<n>.{l,r}<p>`, removed by the destructor), and
+ * the partitions are joined pair by pair, each with an in-memory table over its right rows; the output then follows
+ * the partitions. Either way every input row is read once (twice when spilled) instead of once per outer row.
+ * @note A right partition is loaded whole; inputs far beyond PARTITIONS times the budget still use memory in
+ * proportion to their size.
+ */
+    class HashJoin : public Operator {
+    public:
+        static constexpr size_t PARTITIONS = 16;
+
+    private:
+        static constexpr uint32_t NONE = static_cast<uint32_t>(-1);
+
+        std::unique_ptr<Operator> left;
+        std::unique_ptr<Operator> right;
+        size_t left_field;
+        size_t right_field;
+        size_t max_build_rows;
+        std::string spill_prefix;
+        TupleDesc td;
+
+        // 哈希表：同 key 的行用 chain 串起来，按输入顺序
+        std::vector<Tuple> build_rows;
+        std::unordered_map<int32_t, uint32_t> heads;
+        std::vector<uint32_t> chain;
+
+        // 溢出到磁盘的分区
+        std::vector<std::unique_ptr<HeapFile>> left_parts;
+        std::vector<std::unique_ptr<HeapFile>> right_parts;
+        std::vector<std::string> files;
+        size_t partition{0};
+
+        // 探测状态：当前左批、其中的行、该行下一个匹配
+        Operator *probe{nullptr};
+        std::unique_ptr<Operator> probe_scan;
+        ColumnBatch probe_batch;
+        size_t probe_row{0};
+        uint32_t match{NONE};
+        bool started{false};
+
+        void start();
+        void buildTable();
+        void openPartitions();
+        bool nextPartition();
+
+    public:
+        /**
+         * @param left The probe input.
+         * @param right The build input; make it the smaller one.
+         * @param left_field The INT join column of the left input.
+         * @param right_field The INT join column of the right input.
+         * @param max_build_rows The number of right rows held in memory before spilling.
+         * @param spill_prefix The path prefix of the partition files.
+         * @throws std::logic_error if a join column is not INT.
+         */
+        HashJoin(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, size_t left_field,
+                 size_t right_field, size_t max_build_rows = DEFAULT_JOIN_MEMORY_ROWS,
+                 std::string spill_prefix = "hashjoin");
+
+        /**
+         * @brief Closes and removes the partition files.
+         */
+        ~HashJoin() override;
+
+        const TupleDesc &schema() const override;
+
+        bool next(ColumnBatch &batch) override;
+    };
+
+/**
+ * @brief Joins each row of its input with the tuple of a BTreeFile that has its INT column as key.
+ * @details One BTreeFile::find per input row (keys are unique in the tree, so there is at most one match); rows
+ * without a match are dropped. The output schema is `TupleDesc::merge(left, index)`. The cost is one descent per
+ * outer row instead of a scan of the inner table.
+ */
+    class IndexJoin : public Operator {
+        std::unique_ptr<Operator> left;
+        size_t left_field;
+        const BTreeFile &index;
+        TupleDesc td;
+        ColumnBatch probe_batch;
+        size_t probe_row{0};
+        bool done{false};
+
+    public:
+        /**
+         * @throws std::logic_error if the join column is not INT.
+         */
+        IndexJoin(std::unique_ptr<Operator> left, size_t left_field, const BTreeFile &index);
+
+        const TupleDesc &schema() const override;
+
+        bool next(ColumnBatch &batch) override;
+    };
+} // namespace db
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <db/types.hpp>
+#include <cstddef>
+#include <cstdint>
+
+namespace db {
+/**
+ * @brief Page compression kernels.
+ * @details An LZ77 block codec in the style of LZ4: a sequence is a token (literal length in the high nibble, match
+ * length - 4 in the low nibble, 15 meaning "more bytes follow, 255 each"), the literals, a 16-bit little-endian match
+ * offset and the extra match length. The last sequence has literals only. Matches are found through a single-entry
+ * hash table, so long runs of zero padding cost a few bytes.
+ */
+
+    /**
+     * @brief Compress a page.
+     * @param page The page to compress.
+     * @param dst The output buffer.
+     * @param cap The size of the output buffer.
+     * @return The compressed size, or 0 if it would exceed `cap`.
+     */
+    size_t compress_page(const Page &page, uint8_t *dst, size_t cap);
+
+    /**
+     * @brief Decompress a page written by compress_page.
+     * @param src The compressed bytes.
+     * @param len The number of compressed bytes.
+     * @param page The page to fill.
+     * @throws std::runtime_error if the input is corrupt or does not decode to exactly one page.
+     */
+    void decompress_page(const uint8_t *src, size_t len, Page &page);
+} // namespace db
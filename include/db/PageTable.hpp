@@ -0,0 +1,118 @@
+#pragma once
+
+#include <db/types.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace db {
+/**
+ * @brief On-disk header of one extent of a compressed DbFile.
+ * @details Every page image is stored as an extent: this header followed by `length` bytes (the compressed page, or
+ * the raw page if `length == DEFAULT_PAGE_SIZE`), padded to `units * PageTable::UNIT` bytes. Extents are laid out
+ * back to back from offset 0, so the data file can be walked without the table.
+ */
+    struct ExtentHeader {
+        uint32_t magic;
+        uint16_t length;
+        uint16_t units;
+        uint64_t page;
+        uint64_t seq;       // 越大越新；同一页有多个 extent 时以最新者为准
+    };
+
+    static_assert(sizeof(ExtentHeader) == 24);
+
+/**
+ * @brief Page translation table of a compressed DbFile.
+ * @details Maps page ids to the extent that holds the page's latest image, and keeps free lists of extents by size.
+ * The table is saved to a side file next to the data file (`<data file>.ptt`) and can always be rebuilt by walking
+ * the data file, since each extent header names its page and carries a sequence number.
+ * @note Not thread-safe; DbFile serializes access.
+ */
+    class PageTable {
+        static constexpr uint64_t MAGIC = 0x50545431;   // "PTT1"
+
+    public:
+        /// Allocation granularity of extents, in bytes.
+        static constexpr size_t UNIT = 512;
+
+        static constexpr uint32_t EXTENT_MAGIC = 0x45585431;   // "EXT1"
+
+        /// Largest extent: a page stored raw.
+        static constexpr uint32_t MAX_UNITS = (sizeof(ExtentHeader) + DEFAULT_PAGE_SIZE + UNIT - 1) / UNIT;
+
+        struct Extent {
+            uint64_t offset{0};
+            uint32_t length{0};     // 0: 页从未写过
+            uint32_t units{0};
+        };
+
+    private:
+        std::string path;
+        std::vector<Extent> extents;
+        std::vector<std::vector<uint64_t>> free_extents;   // 下标为 units
+        uint64_t file_end{0};
+        uint64_t next_seq{1};
+        bool loaded{false};
+        bool dirty{false};
+
+        void release(const Extent &e);
+
+    public:
+        /**
+         * @brief Open the table stored at `path`.
+         * @details A missing or unreadable side file yields an empty table that does not cover any data file.
+         */
+        explicit PageTable(std::string path);
+
+        /**
+         * @brief Saves the table if it changed.
+         */
+        ~PageTable();
+
+        PageTable(const PageTable &) = delete;
+
+        PageTable &operator=(const PageTable &) = delete;
+
+        /**
+         * @brief Whether the loaded table describes a data file of `file_size` bytes.
+         */
+        bool covers(uint64_t file_size) const;
+
+        /**
+         * @brief Rebuild the table by walking the extents of the data file.
+         * @details For each page the extent with the highest sequence number wins; the others become free. The walk
+         * stops at the first invalid header (e.g. a torn append), which is treated as the end of the file.
+         * @param fd The data file.
+         * @param file_size The size of the data file in bytes.
+         * @throws std::runtime_error if the data file cannot be read.
+         */
+        void rebuild(int fd, uint64_t file_size);
+
+        /**
+         * @brief Number of pages the table covers (highest written page + 1).
+         */
+        size_t size() const;
+
+        /**
+         * @brief The extent holding page `page`; `length` is 0 if the page was never written.
+         */
+        Extent find(size_t page) const;
+
+        /**
+         * @brief Choose where to write a new image of `length` bytes for page `page`.
+         * @details The page's current extent is reused if it is large enough. Otherwise the smallest free extent that
+         * fits is taken, or the file is extended, and the old extent is freed. The table is updated immediately.
+         * @param seq Set to the sequence number to write in the extent header.
+         * @return The extent to write to.
+         */
+        Extent place(size_t page, uint32_t length, uint64_t &seq);
+
+        /**
+         * @brief Write the table to its side file (via a temporary file and rename).
+         * @throws std::runtime_error if the file cannot be written.
+         */
+        void save();
+    };
+} // namespace db
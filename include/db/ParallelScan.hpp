@@ -0,0 +1,115 @@
+#pragma once
+
+#include <db/DbFile.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace db {
+    /// Morsels each thread of a ParallelScan gets on average; more morsels balance better, fewer cost less to split.
+    constexpr size_t MORSELS_PER_THREAD = 8;
+
+/**
+ * @brief Morsel-driven parallel scan over a pool of worker threads.
+ * @details A scan splits the file with DbFile::split into morsels (page runs of a HeapFile, leaf ranges of a
+ * BTreeFile) and reads each morsel page by page with scanPage. The morsels are dealt out to the workers in
+ * contiguous blocks; a worker that runs out steals the upper half of the block of the next worker that still has
+ * morsels, so uneven morsels do not leave threads idle. Results are kept per morsel and merged in file order, so
+ * they do not depend on the scheduling.
+ * @note A scan reads through the BufferPool (or the file) from several threads at once; the file must not be
+ * modified while it runs. Only one scan runs on a ParallelScan at a time.
+ */
+    class ParallelScan {
+        // 一个工作线程当前负责的连续 morsel 区间 [lo, hi)；主人从 lo 取，窃取者拿走上半段
+        struct Range {
+            std::mutex mtx;
+            size_t lo{0};
+            size_t hi{0};
+        };
+
+        std::vector<std::thread> workers;
+        std::unique_ptr<Range[]> ranges;
+
+        std::mutex mtx;
+        std::condition_variable work_cv;
+        std::condition_variable done_cv;
+        const std::function<void(size_t)> *job{nullptr};
+        size_t generation{0};
+        size_t running{0};
+        bool stopping{false};
+        bool failed{false};
+        std::exception_ptr error;
+
+        void work(size_t self);
+        bool take(size_t self, size_t &morsel);
+
+        // 在所有线程上执行 body(0) … body(count - 1)，返回时全部完成；重新抛出第一个异常
+        void run(size_t count, const std::function<void(size_t)> &body);
+
+        // 把 starts 描述的各区间的元组（有 pred 时只取满足它的）交给 fn(区间号, 元组)
+        void scan(const DbFile &file, const std::vector<Iterator> &starts,
+                  const std::function<void(size_t, const Tuple &)> &fn, const Predicate *pred = nullptr);
+
+    public:
+        /**
+         * @param threads The number of worker threads; 0 uses std::thread::hardware_concurrency().
+         */
+        explicit ParallelScan(size_t threads = 0);
+
+        /**
+         * @brief Stops and joins the worker threads.
+         */
+        ~ParallelScan();
+
+        ParallelScan(const ParallelScan &) = delete;
+
+        ParallelScan &operator=(const ParallelScan &) = delete;
+
+        size_t threads() const;
+
+        /**
+         * @brief Call `fn` on every tuple of the file.
+         * @details Calls run concurrently on the worker threads; tuples of one morsel are visited in order by one
+         * thread.
+         * @throws The first exception thrown by `fn` or by the scan; the remaining morsels are skipped.
+         */
+        void forEach(const DbFile &file, const std::function<void(const Tuple &)> &fn);
+
+        /**
+         * @brief The tuples of the file that satisfy `pred`, in the order of a sequential scan.
+         */
+        std::vector<Tuple> filter(const DbFile &file, const std::function<bool(const Tuple &)> &pred);
+
+        /**
+         * @brief The tuples of the file that satisfy `pred`, in the order of a sequential scan.
+         * @details The predicate is pushed down into the pages with DbFile::scanPageWhere, so rows that do not match
+         * are never deserialized.
+         */
+        std::vector<Tuple> filter(const DbFile &file, const Predicate &pred);
+
+        /**
+         * @brief Fold every tuple of the file into a value.
+         * @details Each morsel folds its tuples into its own copy of `init` with `fold(T &, const Tuple &)`; the
+         * partial results are then combined in file order with `merge(T &into, T &&part)`, starting from `init`.
+         * @param init The identity of `merge`, e.g. 0 for a sum.
+         * @return The merged result.
+         */
+        template <typename T, typename Fold, typename Merge>
+        T aggregate(const DbFile &file, T init, Fold fold, Merge merge) {
+            const std::vector<Iterator> starts = file.split(workers.size() * MORSELS_PER_THREAD);
+            std::vector<T> partial(starts.size(), init);
+            scan(file, starts, [&](size_t m, const Tuple &t) { fold(partial[m], t); });
+            T result = std::move(init);
+            for (T &p : partial) {
+                merge(result, std::move(p));
+            }
+            return result;
+        }
+    };
+} // namespace db
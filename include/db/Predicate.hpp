@@ -0,0 +1,43 @@
+#pragma once
+
+#include <db/Tuple.hpp>
+#include <cstddef>
+#include <cstdint>
+
+namespace db {
+    /// Comparison operator of a Predicate.
+    enum class CompareOp : uint8_t {
+        EQ, NE, LT, LE, GT, GE
+    };
+
+/**
+ * @brief A comparison of one INT or DOUBLE field with a constant: `field op value`.
+ * @details Scans with a predicate (DbFile::scanPageWhere) evaluate it on the serialized page bytes, a page at a time
+ * where the field has a fixed stride, so only matching rows are deserialized. DOUBLE comparisons follow IEEE rules:
+ * NaN matches only NE.
+ */
+    struct Predicate {
+        size_t field;
+        CompareOp op;
+        field_t value;   // INT 字段为 int，DOUBLE 字段为 double
+
+        /**
+         * @brief Check that the predicate applies to a schema.
+         * @throws std::logic_error if `field` is not an INT or DOUBLE field of `td`, or `value` has a different type.
+         */
+        void check(const TupleDesc &td) const;
+
+        bool matches(const Tuple &t) const;
+
+        bool matches(const TupleView &v) const;
+
+        /**
+         * @brief Evaluate the predicate on `n` serialized values of the field at `base + i * stride`.
+         * @details Values need not be aligned. The comparisons run with AVX-512 or AVX2 vector compares (gathers for
+         * a stride other than the value size), whichever the translation unit is compiled for; scalar otherwise.
+         * @param mask Receives bit `i % 64` of word `i / 64` set if value i matches; `(n + 63) / 64` words are
+         * overwritten.
+         */
+        void evaluate(const uint8_t *base, size_t stride, size_t n, uint64_t *mask) const;
+    };
+} // namespace db
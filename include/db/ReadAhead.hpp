@@ -0,0 +1,96 @@
+#pragma once
+
+#include <db/types.hpp>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace db {
+    class BufferPool;
+
+    constexpr size_t DEFAULT_READ_AHEAD_PAGES = 32;
+
+    /**
+     * @brief Extracts the id of the next page of a chain (e.g. `LeafPageHeader::next_leaf`) from a page.
+     * @return The next page id, or `static_cast<size_t>(-1)` at the end of the chain.
+     */
+    using NextPageFn = size_t (*)(const Page &);
+
+/**
+ * @brief Adaptive read-ahead for a BufferPool.
+ * @details Cursors report the pages they move onto. For sequential page ids the window of pages loaded ahead of the
+ * cursor starts small and doubles on every confirmed step up to the maximum; a jump resets it. For linked pages
+ * (B-tree leaf chains) the chain is followed ahead of the cursor. All loads run on a background thread and are
+ * admitted with AccessIntent::SCAN, so the cursor finds its next pages cached instead of waiting on each read.
+ * @note Read-ahead is a hint: failures on the background thread are ignored.
+ */
+    class ReadAhead {
+        static constexpr size_t INITIAL_WINDOW = 4;
+
+        struct Stream {
+            size_t last;           // 最近一次访问的页
+            size_t window;         // 下一次预读的页数
+            size_t issued_until;   // 已预读到（不含）的页
+        };
+
+        struct Job {
+            PageId first;
+            size_t count;
+            NextPageFn next;       // nullptr: 连续页 [first.page, first.page + count)
+        };
+
+        BufferPool &pool;
+        const size_t max_window;
+
+        std::mutex mtx;
+        std::condition_variable work_cv;
+        std::condition_variable idle_cv;
+        std::deque<Job> jobs;
+        bool busy{false};
+        bool stopping{false};
+        std::unordered_map<file_id_t, Stream> streams;
+        std::unordered_map<file_id_t, size_t> chain_steps;
+
+        std::thread worker;
+
+        void run();
+        void execute(const Job &job);
+
+    public:
+        /**
+         * @param pool The pool pages are loaded into.
+         * @param max_window The largest number of pages loaded ahead of a cursor.
+         */
+        ReadAhead(BufferPool &pool, size_t max_window);
+
+        /**
+         * @brief Stops the background thread; pending loads are dropped.
+         */
+        ~ReadAhead();
+
+        ReadAhead(const ReadAhead &) = delete;
+
+        ReadAhead &operator=(const ReadAhead &) = delete;
+
+        /**
+         * @brief Report that a sequential cursor moved onto a page.
+         * @param pid The page the cursor is on.
+         * @param num_pages The number of pages in the file; nothing at or past it is loaded.
+         */
+        void onSequential(const PageId &pid, size_t num_pages);
+
+        /**
+         * @brief Report that a cursor moved onto a page of a linked chain.
+         * @param pid The page the cursor is on.
+         * @param next Extracts the next page of the chain.
+         */
+        void onChain(const PageId &pid, NextPageFn next);
+
+        /**
+         * @brief Wait until every queued load has finished.
+         */
+        void drain();
+    };
+} // namespace db
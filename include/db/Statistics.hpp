@@ -0,0 +1,117 @@
+#pragma once
+
+#include <db/DbFile.hpp>
+#include <db/Predicate.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace db {
+    /// Pages collectStats reads from a file by default; smaller files are scanned completely.
+    constexpr size_t DEFAULT_SAMPLE_PAGES = 64;
+
+    /// Buckets of the equi-depth histogram collectStats builds per column by default.
+    constexpr size_t DEFAULT_HISTOGRAM_BUCKETS = 32;
+
+    /// Index bits of a HyperLogLog by default: 4096 registers, about 1.6% standard error.
+    constexpr size_t DEFAULT_HLL_PRECISION = 12;
+
+/**
+ * @brief HyperLogLog sketch estimating the number of distinct 64-bit hashes added to it.
+ * @details The top `precision` bits of a hash pick one of `2^precision` one-byte registers, which keeps the longest
+ * run of leading zero bits seen in the rest. Small counts use linear counting over the empty registers.
+ */
+    class HyperLogLog {
+        size_t precision;
+        std::vector<uint8_t> registers;
+
+    public:
+        /**
+         * @throws std::logic_error if `precision` is not in [4, 18].
+         */
+        explicit HyperLogLog(size_t precision = DEFAULT_HLL_PRECISION);
+
+        void add(uint64_t hash);
+
+        /**
+         * @brief Add every hash added to `other`.
+         * @throws std::logic_error if the precisions differ.
+         */
+        void merge(const HyperLogLog &other);
+
+        uint64_t estimate() const;
+
+        /**
+         * @brief A 64-bit hash of a field value for add(); -0.0 hashes like 0.0.
+         */
+        static uint64_t hash(const field_t &value);
+    };
+
+    /**
+     * @brief What the statistics know about one column.
+     */
+    struct ColumnStats {
+        uint64_t distinct{0};          ///< Estimated number of distinct values in the file.
+        /// Equi-depth histogram: `bounds.size() - 1` buckets, bucket i spans [bounds[i], bounds[i + 1]] and holds the
+        /// same share of the rows as every other. bounds.front() and bounds.back() are the smallest and largest values
+        /// seen; empty if no (non-NaN) value was seen.
+        std::vector<field_t> bounds;
+
+        /**
+         * @brief Estimated fraction of the rows whose value is less than `v`.
+         * @details INT and DOUBLE values are interpolated linearly inside their bucket, strings count as the middle.
+         */
+        double fractionLess(const field_t &v) const;
+
+        /**
+         * @brief Estimated fraction of the rows whose value is at most `v`.
+         */
+        double fractionAtMost(const field_t &v) const;
+
+        /**
+         * @brief Estimated fraction of the rows whose value equals `v`: the histogram's share of `v` (for values that
+         * span bucket bounds), but at least `1 / distinct`; 0 outside [bounds.front(), bounds.back()].
+         */
+        double fractionEqual(const field_t &v) const;
+    };
+
+    /**
+     * @brief Statistics of a file for choosing between access paths, e.g. a full scan and an index lookup.
+     */
+    struct TableStats {
+        uint64_t rows{0};           ///< Number of tuples (exact if the file kept count, else estimated).
+        uint64_t sampled_rows{0};   ///< Tuples the column statistics were built from.
+        bool complete{false};       ///< Whether every page was read (no sampling).
+        bool rows_exact{false};     ///< Whether `rows` was counted rather than estimated.
+        std::vector<ColumnStats> columns;
+
+        /**
+         * @brief Estimated fraction of the rows that satisfy a predicate.
+         * @details A NaN constant matches nothing but NE, as in Predicate.
+         * @throws std::logic_error if the predicate's field has no statistics.
+         */
+        double selectivity(const Predicate &pred) const;
+
+        /**
+         * @brief `selectivity(pred) * rows`.
+         */
+        double estimateRows(const Predicate &pred) const;
+    };
+
+    /**
+     * @brief Collect statistics from a sample of the pages of a file.
+     * @details A file of at most `sample_pages` pages is read completely. A larger one is split (DbFile::split) into
+     * `sample_pages` ranges and the first page of each range is read, so the sample is spread over the whole file and
+     * costs `sample_pages` page reads. Per column the sampled values give an equi-depth histogram of `buckets` buckets
+     * and a HyperLogLog count of distinct values. For a sample, the distinct count is scaled up by how much it grew
+     * between half of the sampled pages and all of them: a count that doubled with the sample (a key) grows with the
+     * rows, one that did not (a few categories) stays.
+     * The row count is DbFile::getRowCount if the file knows it, the number of rows read for a complete scan (both
+     * exact), and the rows per sampled page times the number of pages otherwise.
+     * @note The file is read with scanPage, through the BufferPool for files that use it; concurrent inserts and
+     * deletes make the result approximate, as it is anyway.
+     * @throws std::logic_error if `sample_pages` or `buckets` is 0.
+     */
+    TableStats collectStats(const DbFile &file, size_t sample_pages = DEFAULT_SAMPLE_PAGES,
+                            size_t buckets = DEFAULT_HISTOGRAM_BUCKETS);
+} // namespace db
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace db {
+    class IoScheduler;
+
+    // Task 的 promise 中与结果类型无关的部分：完成后转回等待它的协程（没有则回到调度器），异常留到取结果时抛出
+    struct TaskPromiseBase {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept { return false; }
+
+            template <typename P>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) const noexcept {
+                const std::coroutine_handle<> next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+
+        void rethrow() const {
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+    template <typename T>
+    struct TaskPromise : TaskPromiseBase {
+        std::optional<T> value;
+
+        template <typename U>
+        void return_value(U &&v) {
+            value.emplace(std::forward<U>(v));
+        }
+
+        T take() {
+            rethrow();
+            return std::move(*value);
+        }
+    };
+
+    template <>
+    struct TaskPromise<void> : TaskPromiseBase {
+        void return_void() const noexcept {}
+
+        void take() const { rethrow(); }
+    };
+
+/**
+ * @brief A lazily started coroutine that produces a `T`, for the asynchronous page access API.
+ * @details A Task does nothing until it is awaited (`co_await task` from another coroutine) or handed to an
+ * IoScheduler with spawn(). When it finishes, control passes straight back to the coroutine that awaited it, so chains
+ * of awaits do not grow the stack. An exception thrown in the coroutine is rethrown where its result is taken.
+ * @note A coroutine keeps its parameters alive, but not what they refer to: arguments passed by reference (the
+ * Iterator of HeapFile::scanPageAsync, say) must outlive the Task.
+ */
+    template <typename T = void>
+    class Task {
+    public:
+        struct promise_type : TaskPromise<T> {
+            Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        };
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+        friend class IoScheduler;
+
+        explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    public:
+        Task() = default;
+
+        ~Task() {
+            if (handle) {
+                handle.destroy();
+            }
+        }
+
+        Task(const Task &) = delete;
+
+        Task &operator=(const Task &) = delete;
+
+        Task(Task &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+        Task &operator=(Task &&other) noexcept {
+            if (this != &other) {
+                if (handle) {
+                    handle.destroy();
+                }
+                handle = std::exchange(other.handle, {});
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Whether the coroutine has run to completion (an empty Task counts as done).
+         */
+        bool done() const { return !handle || handle.done(); }
+
+        bool await_ready() const { return done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) const {
+            handle.promise().continuation = awaiting;
+            return handle;
+        }
+
+        T await_resume() const { return handle.promise().take(); }
+    };
+} // namespace db
@@ -1,7 +1,12 @@
 #pragma once
 
 #include <db/types.hpp>
+#include <cstddef>
+#include <initializer_list>
+#include <new>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 #include <variant>
@@ -9,25 +14,136 @@
 
 namespace db {
 
+    class TupleDesc;
+    class TupleView;
+
+    /**
+     * @brief An owning tuple of fields.
+     * @details Up to INLINE_FIELDS fields are stored in a buffer inside the Tuple, so building, copying or
+     * deserializing a narrow tuple does not allocate (a string field still allocates if it is longer than the
+     * std::string small-string buffer). Wider tuples keep their fields in a std::vector.
+     */
     class Tuple {
-        std::vector<field_t> fields_;
+    public:
+        /// Number of fields stored without a heap allocation.
+        static constexpr size_t INLINE_FIELDS = 4;
+
+    private:
+        alignas(field_t) std::byte inline_[INLINE_FIELDS * sizeof(field_t)];
+        size_t count_{0};              // inline_ 中已构造的字段数
+        bool spilled_{false};          // true: 字段全部在 spill_ 中
+        std::vector<field_t> spill_;
+
+        friend class TupleDesc;
+        friend class TupleView;
+
+        Tuple() = default;
+
+        field_t *inline_data() { return std::launder(reinterpret_cast<field_t *>(inline_)); }
+        const field_t *inline_data() const { return std::launder(reinterpret_cast<const field_t *>(inline_)); }
+
+        // 全部字段，连续存放
+        const field_t *fields() const { return spilled_ ? spill_.data() : inline_data(); }
+
+        void reserve(size_t n);
+        void spill();
+        void clear();
+        void copy_from(const Tuple &other);
+        void move_from(Tuple &&other) noexcept;
+
+        // 追加一个字段（供 deserialize 等就地构造）
+        template <typename... Args>
+        void emplace(Args &&...args) {
+            if (!spilled_ && count_ < INLINE_FIELDS) {
+                new (inline_data() + count_) field_t(std::forward<Args>(args)...);
+                ++count_;
+                return;
+            }
+            if (!spilled_) spill();
+            spill_.emplace_back(std::forward<Args>(args)...);
+        }
 
     public:
         // 允许用花括号/向量隐式构造（配合测试用例）
         Tuple(const std::vector<field_t>& fields);
 
+        /// Takes over the fields; a wide tuple keeps the vector's buffer.
+        Tuple(std::vector<field_t>&& fields);
+
+        Tuple(std::initializer_list<field_t> fields);
+
+        Tuple(const Tuple &other);
+
+        Tuple(Tuple &&other) noexcept;
+
+        Tuple &operator=(const Tuple &other);
+
+        Tuple &operator=(Tuple &&other) noexcept;
+
+        ~Tuple();
+
+        // 字符串字段一律报告为 CHAR；TupleDesc::compatible 对 VARCHAR 同样接受
         type_t         field_type(size_t i) const;
         size_t         size() const;
         const field_t& get_field(size_t i) const;
     };
 
+    // ---------------- TupleView ----------------
+    /**
+     * @brief A non-owning, read-only view of a serialized tuple.
+     * @details Fields are decoded on demand straight from the serialized bytes (e.g. inside a page) using the
+     * offsets of the TupleDesc; no Tuple or std::string is allocated.
+     * A columnar view reads row `row` of a block that stores `rows` rows column by column (the PAX heap page
+     * layout): field i is at `data + rows * offset_of(i) + row * <size of field i>`. A row view is the case
+     * `rows == 1, row == 0`.
+     * @note The view is only valid as long as the underlying bytes and TupleDesc are. A view into a BufferPool
+     * frame must not be used after the frame may have been evicted.
+     */
+    class TupleView {
+        const TupleDesc *td_;
+        const uint8_t   *data_;
+        size_t           rows_{1};
+        size_t           row_{0};
+
+        const uint8_t *field_ptr(size_t i) const;
+
+    public:
+        TupleView(const TupleDesc &td, const uint8_t *data);
+
+        /// Columnar view of row `row` in a block of `rows` rows stored column by column.
+        TupleView(const TupleDesc &td, const uint8_t *data, size_t rows, size_t row);
+
+        size_t         size() const;
+        type_t         field_type(size_t i) const;
+        /// Start of the serialized row; for a columnar view, start of the block.
+        const uint8_t *data() const;
+
+        /// Typed access; throws std::logic_error if field i has a different type.
+        int              get_int(size_t i) const;
+        double           get_double(size_t i) const;
+        std::string_view get_char(size_t i) const;
+
+        /// Materialize a single field / the whole tuple.
+        field_t get_field(size_t i) const;
+        Tuple   to_tuple() const;
+    };
+
     // ---------------- TupleDesc ----------------
     class TupleDesc {
     private:
+        // 构造时为每个字段生成一次的编解码步骤：行内偏移、类型及其在 field_t 中的 variant 下标
+        struct FieldCodec {
+            uint32_t offset;
+            type_t   type;
+            uint8_t  index;
+        };
+
         std::vector<type_t>      types_;
         std::vector<std::string> names_;
         std::vector<size_t>      offsets_;
+        std::vector<FieldCodec>  codec_;
         size_t                   length_{0};
+        size_t                   max_length_{0};
         std::unordered_map<std::string, size_t> name2idx_;
 
     public:
@@ -44,22 +160,49 @@ namespace db {
         TupleDesc(const std::vector<type_t>& types,
                   const std::vector<std::string>& names);
 
-        /// A Tuple is compatible if it has the same number of fields and matching types.
+        /// A Tuple is compatible if it has the same number of fields and matching types (a string matches CHAR and VARCHAR).
         bool   compatible(const Tuple& tuple) const;
 
         /// Byte offset of a field from the start of a serialized tuple.
         size_t offset_of(const size_t& index) const;
 
+        /// Type of a field.
+        type_t type_of(size_t index) const;
+
+        /// Serialized byte length of a field; for a VARCHAR, the size of its in-row descriptor (VARCHAR_SIZE).
+        size_t size_of(size_t index) const;
+
         /// Index of a field by name.
         size_t index_of(const std::string& name) const;
 
+        /// Name of a field.
+        const std::string& name_of(size_t index) const;
+
         /// Number of fields.
         size_t size() const;
 
-        /// Total serialized byte length.
+        /// Serialized byte length of the fixed-size part of a row: the whole row when fixed(), else the shortest row.
         size_t length() const;
 
-        /// Serialize/deserialize a Tuple.
+        /// True if no field is VARCHAR, i.e. every serialized row is length() bytes.
+        bool   fixed() const;
+
+        /// Longest serialized row: length() plus VARCHAR_MAX bytes per VARCHAR field.
+        size_t max_length() const;
+
+        /// Serialized byte length of a tuple / of the serialized row at data.
+        size_t length_of(const Tuple& t) const;
+        size_t length_of(const uint8_t* data) const;
+
+        /**
+         * @brief Serialize/deserialize a Tuple.
+         * @details A row is the fixed-size part (fields at offset_of(i)) followed by the bytes of the VARCHAR fields
+         * in field order; serialize writes length_of(t) bytes. VARCHAR descriptors are relative to the start of the
+         * row, so a row can be moved as a whole.
+         * Both run over a table of per-field steps built once by the constructor. Validation compares each field's
+         * variant index with the expected one, and values are then read without further checks.
+         * @throws std::logic_error (serialize) if the tuple is not compatible; nothing is written in that case.
+         */
         void   serialize(uint8_t* data, const Tuple& t) const;
         Tuple  deserialize(const uint8_t* data) const;
 
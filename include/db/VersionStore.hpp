@@ -0,0 +1,98 @@
+#pragma once
+
+#include <db/types.hpp>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace db {
+    /// Timestamp of a write operation; 0 is the state before any recorded write and is visible to everyone.
+    using ts_t = uint64_t;
+
+/**
+ * @brief Old versions of pages, kept for readers of snapshots.
+ * @details Every write operation gets a timestamp from begin() and ends with commit(); a multi-page operation (see
+ * LogGroup) uses one timestamp for all its pages. Before a page is changed the first time by an operation, modified()
+ * records the page as it was, tagged with the timestamp of the operation that produced it, so each page has a chain
+ * of images, newest first, behind its current content.
+ * A View is a snapshot: it sees the operations that had committed when it was opened, and none of those in flight.
+ * lookup() returns the newest image a view sees, or nullptr if it sees the current content. Images are dropped as
+ * soon as no open view and no operation in flight can need them, so without open views nothing is kept.
+ * @note The store is thread-safe; one mutex protects all chains.
+ */
+    class VersionStore {
+    public:
+        /// A snapshot: the operations committed before it was opened.
+        struct View {
+            ts_t high;                   ///< First timestamp not yet handed out when the view was opened.
+            std::vector<ts_t> in_flight; ///< Sorted timestamps of the operations in flight then.
+
+            /// Whether the writes of operation `ts` belong to the snapshot.
+            bool sees(ts_t ts) const;
+        };
+
+    private:
+        struct Chain {
+            ts_t current{0};   // 写出当前内容的操作
+            std::vector<std::pair<ts_t, std::shared_ptr<const Page>>> old;   // (产生该版本的操作, 页)，新的在前
+        };
+
+        mutable std::mutex mtx;
+        ts_t next{1};
+        std::set<ts_t> in_flight;
+        std::list<View> views;
+        std::unordered_map<PageId, Chain> chains;
+        size_t images{0};
+
+        // 有打开的快照或在途操作看不到 ts 写的内容
+        bool needed(ts_t ts) const;
+        void prune(std::unordered_map<PageId, Chain>::iterator it);
+
+    public:
+        /**
+         * @brief Start a write operation.
+         * @return Its timestamp; the operation's writes are invisible to every view until commit().
+         */
+        ts_t begin();
+
+        /**
+         * @brief Record that operation `op` changed a page.
+         * @param before The page before the change; ignored if `op` already changed the page. May be nullptr if the
+         * writer did not provide it, in which case readers that would need it see the current content.
+         */
+        void modified(const PageId &pid, ts_t op, std::shared_ptr<const Page> before);
+
+        /**
+         * @brief End operation `op`, which changed the pages `touched`, and drop the images nobody needs any more.
+         */
+        void commit(ts_t op, const std::vector<PageId> &touched);
+
+        /**
+         * @brief Open a snapshot of the committed state; the view stays valid until close().
+         */
+        const View *open();
+
+        /**
+         * @brief Close a snapshot and drop the images only it needed.
+         */
+        void close(const View *view);
+
+        /**
+         * @brief The image of a page that `view` sees.
+         * @return nullptr if the view sees the current content.
+         * @note To get a consistent answer, hold the page's shared latch while looking it up and reading the current
+         * content: writers record their changes with modified() while they hold the exclusive latch.
+         */
+        std::shared_ptr<const Page> lookup(const PageId &pid, const View &view) const;
+
+        /**
+         * @brief The number of old page images kept.
+         */
+        size_t imageCount() const;
+    };
+} // namespace db
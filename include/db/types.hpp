@@ -6,27 +6,63 @@
 #include <variant>
 #include <cstdint>
 #include <functional>
+#include <limits>
+#include <type_traits>
+
+#ifndef DB_PAGE_SIZE
+#define DB_PAGE_SIZE 4096
+#endif
 
 namespace db {
     constexpr size_t INT_SIZE = sizeof(int);
     constexpr size_t DOUBLE_SIZE = sizeof(double);
     constexpr size_t CHAR_SIZE = 64;
 
+    /// Longest VARCHAR value; longer strings are truncated, like CHAR.
+    constexpr size_t VARCHAR_MAX = CHAR_SIZE;
+
+    /// In-row descriptor of a VARCHAR field: uint16 offset of the bytes from the start of the row, uint16 length.
+    constexpr size_t VARCHAR_SIZE = 2 * sizeof(uint16_t);
+
+    /**
+     * @brief Field types.
+     * @details CHAR is stored as a fixed, zero-padded CHAR_SIZE-byte field. VARCHAR stores only the string's own
+     * bytes after the fixed-size part of the row; both hold std::string values in a Tuple.
+     */
     enum class type_t {
-        INT, CHAR, DOUBLE
+        INT, CHAR, DOUBLE, VARCHAR
     };
 
     using field_t = std::variant<int, double, std::string>;
 
+    /// Dense id assigned to a file name by Database::add.
+    using file_id_t = uint32_t;
+
+    constexpr file_id_t INVALID_FILE_ID = std::numeric_limits<file_id_t>::max();
+
     struct PageId {
-        std::string file;
-        size_t page;
+        file_id_t file{INVALID_FILE_ID};
+        size_t page{0};
 
     public:
         bool operator==(const PageId&) const = default;
     };
 
-    constexpr size_t DEFAULT_PAGE_SIZE = 4096;
+    static_assert(std::is_trivially_copyable_v<PageId>);
+
+    /**
+     * @brief Size of every page, in bytes.
+     * @details Chosen at build time with `-DDB_PAGE_SIZE=<bytes>` (default 4096); e.g. 16 or 32 KiB for NVMe and
+     * analytic scans. HeapPage, LeafPage and IndexPage derive their capacities from it, so larger pages mean more
+     * tuples per page and a larger B-tree fanout.
+     * @note The size is not recorded in files: a file must be read by a build with the page size it was written with.
+     * @note Slotted pages and compressed extents store in-page offsets as uint16_t, which caps the size at 32 KiB.
+     */
+    constexpr size_t DEFAULT_PAGE_SIZE = DB_PAGE_SIZE;
+
+    static_assert(DEFAULT_PAGE_SIZE >= 1024 && DEFAULT_PAGE_SIZE <= 32768 &&
+                  (DEFAULT_PAGE_SIZE & (DEFAULT_PAGE_SIZE - 1)) == 0,
+                  "DB_PAGE_SIZE must be a power of two between 1 KiB and 32 KiB");
 
     using Page = std::array<uint8_t, DEFAULT_PAGE_SIZE>;
 } // namespace db
@@ -34,7 +70,8 @@ namespace db {
 template<>
 struct std::hash<db::PageId> {
     std::size_t operator()(const db::PageId &r) const noexcept {
-        return std::hash<std::string>()(r.file)
-             ^ (std::hash<size_t>()(r.page) << 1);
+        // 页号与文件 id 拼成 64 位后做一次乘法散列
+        const uint64_t k = (static_cast<uint64_t>(r.file) << 40) ^ static_cast<uint64_t>(r.page);
+        return static_cast<std::size_t>((k * 0x9E3779B97F4A7C15ull) ^ (k >> 29));
     }
 };
\ No newline at end of file
@@ -1,189 +1,1118 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstring>
+#include <db/BloomFilter.hpp>
 #include <db/BTreeFile.hpp>
 #include <db/Database.hpp>
+#include <db/ExternalSort.hpp>
 #include <db/IndexPage.hpp>
 #include <db/LeafPage.hpp>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 using namespace db;
 
-BTreeFile::BTreeFile(const std::string &name,
-                     const TupleDesc &td,
-                     size_t key_index)
-    : DbFile(name, td), key_index(key_index) {}
+namespace {
+// 预读沿叶子链前进；0 与 -1 都表示链尾
+size_t next_leaf_of(const Page &page) {
+  const size_t next = reinterpret_cast<const LeafPageHeader *>(page.data())->next_leaf;
+  return next == 0 ? static_cast<size_t>(-1) : next;
+}
 
-void BTreeFile::insertTuple(const Tuple &t) {
-  std::vector<size_t> path;
-  BufferPool &bufferPool = getDatabase().getBufferPool();
-  PageId pid{name, root_id};
+// 过滤器按 key 的字节求哈希；-0.0 与 0.0 相等，须得到同一哈希
+template <typename K>
+uint64_t key_hash(const K &key) {
+  if constexpr (std::is_same_v<K, double>) {
+    const double v = key == 0.0 ? 0.0 : key;
+    return BloomFilter::hash(&v, sizeof(v));
+  } else {
+    return BloomFilter::hash(&key, sizeof(key));
+  }
+}
 
-  Page &root_page = bufferPool.getPage(pid);
-  IndexPage root(root_page);
+// 常驻缓冲池的上层索引页层数（含 root）
+constexpr size_t RESIDENT_LEVELS = 2;
 
-  int k = std::get<int>(t.get_field(key_index));
+// bulkLoad 每次 pwritev 写出的页数
+constexpr size_t BULK_RUN_PAGES = 64;
 
-  if (root.header->size == 0 && root.children[0] == 0) {
-    bufferPool.markDirty(pid);
-    pid.page = numPages++;
-    root.children[0] = pid.page;
-    root.header->index_children = false;
-  } else {
-    while (true) {
-      Page &page = bufferPool.getPage(pid);
-      IndexPage node(page);
+// 删除后结点少于 capacity / MIN_FILL_DIVISOR 时才与相邻结点合并或重分配
+constexpr size_t MIN_FILL_DIVISOR = 4;
+
+bool underfull(size_t size, size_t capacity) {
+  return size < capacity / MIN_FILL_DIVISOR;
+}
+
+// 页满时 LeafPage/IndexPage 的插入会拒绝新 key，所以每页至多装到 capacity - 1
+size_t fill_count(size_t capacity, double fill_factor) {
+  const size_t most = capacity > 1 ? capacity - 1 : 1;
+  return std::clamp<size_t>(static_cast<size_t>(static_cast<double>(capacity) * fill_factor), 1, most);
+}
+
+// 用下一层 [first, last) 的结点填充一个索引页：keys[i-1] 为第 i 个孩子的首 key
+template <typename K>
+void fill_index(BasicIndexPage<K> &node, const std::vector<std::pair<K, size_t>> &level,
+                size_t first, size_t last, bool index_children) {
+  node.header->size = static_cast<uint16_t>(last - first - 1);
+  node.header->index_children = index_children;
+  for (size_t i = first; i < last; ++i) {
+    node.setChild(i - first, level[i].second);
+    if (i > first) {
+      node.keys[i - first - 1] = level[i].first;
+    }
+  }
+}
+
+// 在 it 所在的叶上调用 f(const Page &)。叶一直 pin 在 it.cache 中，同一叶内每步只加共享 latch，
+// 不再经缓冲池查找；快照读须逐次按快照取版本，仍每次 pinPage
+template <typename F>
+decltype(auto) with_leaf(file_id_t file, const Iterator &it, F &&f) {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  if (bufferPool.inSnapshot()) {
+    it.cache.reset();
+    PageGuard guard = bufferPool.pinPage({file, it.page}, AccessIntent::NORMAL, LatchMode::SHARED);
+    return f(*guard);
+  }
+  auto leaf = std::static_pointer_cast<PageGuard>(it.cache);
+  if (!leaf || leaf->getPageId().page != it.page) {
+    leaf = std::make_shared<PageGuard>(bufferPool.pinPage({file, it.page}));
+    it.cache = leaf;
+  }
+  const auto latch = leaf->readLatch();
+  return f(**leaf);
+}
+} // namespace
 
-      auto pos = std::lower_bound(
-          node.keys,
-          node.keys + node.header->size,
-          k);
-      size_t slot = static_cast<size_t>(pos - node.keys);
+// 按页号开放寻址的帧表，只增不删：槽位的帧先写好再以 release 发布页号，读者不加锁
+struct db::UpperLevels {
+  static constexpr size_t SLOTS = 64;                 // 2 的幂；至多装 SLOTS / 2 页
+  static constexpr size_t EMPTY = static_cast<size_t>(-1);
 
-      size_t current_id = pid.page;
-      size_t child_id   = node.children[slot];
+  const uint64_t epoch;                               // 建表时缓冲池的 resident epoch
+  std::array<std::atomic<size_t>, SLOTS> pages;
+  std::array<Page *, SLOTS> frames{};
+  size_t count{0};                                    // 以下两项在 upper_mtx 内修改
+  std::atomic<bool> full{false};                      // 表或缓冲池的常驻额度已满，不再尝试加入
 
-      if (!node.header->index_children) {
-        pid.page = child_id;
-        break;
+  explicit UpperLevels(uint64_t epoch) : epoch(epoch) {
+    for (auto &page : pages) {
+      page.store(EMPTY, std::memory_order_relaxed);
+    }
+  }
+
+  static size_t home(size_t page) { return (page * 0x9E3779B97F4A7C15ULL) >> 58; }
+
+  Page *find(size_t page) const {
+    for (size_t i = home(page), n = 0; n < SLOTS; i = (i + 1) % SLOTS, ++n) {
+      const size_t p = pages[i].load(std::memory_order_acquire);
+      if (p == page) {
+        return frames[i];
+      }
+      if (p == EMPTY) {
+        return nullptr;
       }
+    }
+    return nullptr;
+  }
+
+  void insert(size_t page, Page *frame) {
+    size_t i = home(page);
+    while (pages[i].load(std::memory_order_relaxed) != EMPTY) {
+      i = (i + 1) % SLOTS;
+    }
+    frames[i] = frame;
+    pages[i].store(page, std::memory_order_release);
+    if (++count == SLOTS / 2) {
+      full.store(true, std::memory_order_relaxed);
+    }
+  }
+};
+
+template <typename K>
+BasicBTreeFile<K>::BasicBTreeFile(const std::string &name,
+                                  const TupleDesc &td,
+                                  const KeyFields<K> &key_fields,
+                                  PageCompression compression,
+                                  FileAccess access)
+    : DbFile(name, td, compression, access), key_fields(key_fields) {
+  for (size_t i = 0; i < key_fields.size(); ++i) {
+    if (td.type_of(key_fields[i]) != KeyTraits<K>::types[i]) {
+      throw std::logic_error("BTreeFile: key field type does not match the key type");
+    }
+  }
+  // 第 0 页固定为根索引页；新文件里它尚未写回，但已占用页号
+  if (numPages == 0) {
+    numPages = 1;
+  }
+}
 
-      if (current_id != root_id) {
-        path.push_back(current_id);
+template <typename K>
+BasicBTreeFile<K>::~BasicBTreeFile() = default;
+
+template <typename K>
+size_t BasicBTreeFile<K>::choose_child_slot(const IndexPage &ip, const K &key) {
+  // 分裂键是右半的首 key：等于分隔键的 key 属于右侧孩子
+  return key_upper_bound(ip.keys, ip.header->size, key);
+}
+
+// 读路径：自 root 起逐层加共享 latch，先锁住孩子再放开父结点
+// 返回叶页号（空树为 0），leaf 持有该叶的共享 latch
+// 读者与乐观插入每次都经过 root 及其下一层：这些页常驻缓冲池，帧记在 upper 表中，
+// 再次下降时直接对帧加共享 latch，省去缓冲池的分片锁、哈希查找与 LRU 维护
+template <typename K>
+PageGuard BasicBTreeFile<K>::pin_node(size_t page_id, bool upper_level) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  // 快照读须按快照取版本，不走常驻帧
+  if (!upper_level || bufferPool.inSnapshot()) {
+    return bufferPool.pinPage({file_id, page_id}, AccessIntent::NORMAL, LatchMode::SHARED);
+  }
+  const uint64_t epoch = bufferPool.getResidentEpoch();
+  UpperLevels *table = upper.load(std::memory_order_acquire);
+  if (table != nullptr && table->epoch == epoch) {
+    if (Page *frame = table->find(page_id)) {
+      return bufferPool.latchResident({file_id, page_id}, frame);
+    }
+    if (table->full.load(std::memory_order_relaxed)) {
+      return bufferPool.pinPage({file_id, page_id}, AccessIntent::NORMAL, LatchMode::SHARED);
+    }
+  }
+
+  Page *frame;
+  {
+    // 加 latch 前先放开 upper_mtx，等 latch 时不挡住其它线程登记常驻页
+    std::lock_guard lock(upper_mtx);
+    table = upper.load(std::memory_order_relaxed);
+    if (table == nullptr || table->epoch != epoch) {
+      upper_tables.push_back(std::make_unique<UpperLevels>(epoch));
+      table = upper_tables.back().get();
+      upper.store(table, std::memory_order_release);
+    }
+    frame = table->find(page_id);
+    if (frame == nullptr && !table->full.load(std::memory_order_relaxed)) {
+      frame = bufferPool.pinResident({file_id, page_id});
+      if (frame == nullptr) {
+        table->full.store(true, std::memory_order_relaxed);
+      } else {
+        table->insert(page_id, frame);
       }
+    }
+  }
+  if (frame == nullptr) {
+    return bufferPool.pinPage({file_id, page_id}, AccessIntent::NORMAL, LatchMode::SHARED);
+  }
+  return bufferPool.latchResident({file_id, page_id}, frame);
+}
 
-      pid.page = child_id;
+template <typename K>
+size_t BasicBTreeFile<K>::descend_shared(const K &key, PageGuard &leaf, std::optional<size_t> *missing) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  const auto absent = [&](size_t page) {
+    if (missing != nullptr && !bufferPool.isCached({file_id, page})) {
+      *missing = page;
+      return true;
     }
+    return false;
+  };
+  if (absent(root_id)) {
+    return 0;
   }
+  PageGuard guard = pin_node(root_id, true);
+  for (size_t depth = 1;; ++depth) {
+    IndexPage node(*guard);
+    if (node.header->size == 0 && node.child(0) == 0) {
+      return 0;
+    }
+    const size_t child = node.child(choose_child_slot(node, key));
+    if (absent(child)) {
+      return 0;
+    }
+    if (!node.header->index_children) {
+      leaf = bufferPool.pinPage({file_id, child}, AccessIntent::NORMAL, LatchMode::SHARED);
+      return child;
+    }
+    guard = pin_node(child, depth < RESIDENT_LEVELS);
+  }
+}
 
-  Page &page = bufferPool.getPage(pid);
-  bufferPool.markDirty(pid);
-  LeafPage leaf(page, td, key_index);
+template <typename K>
+size_t BasicBTreeFile<K>::allocate_empty_page() {
+  std::lock_guard lock(alloc_mtx);
+  return numPages++;
+}
 
+template <typename K>
+void BasicBTreeFile<K>::insertTuple(const Tuple &t) {
+  if (isReadOnly()) {
+    throw std::logic_error("BTreeFile::insertTuple: file is read-only");
+  }
+  const K k = KeyTraits<K>::of(t, key_fields);
+  if (!insert_optimistic(t, k)) {
+    insert_pessimistic(t, k);
+  }
+  note_key(k);
+}
+
+// 乐观插入：索引页只加共享 latch，只有叶加排他 latch，同一子树外的读写互不阻塞
+// 叶插入后会满（需要分裂）或树为空时什么也不改，返回 false
+template <typename K>
+bool BasicBTreeFile<K>::insert_optimistic(const Tuple &t, const K &k) {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  PageGuard guard = pin_node(root_id, true);
+  for (size_t depth = 1;; ++depth) {
+    IndexPage node(*guard);
+    if (node.header->size == 0 && node.child(0) == 0) {
+      return false;
+    }
+    const PageId child{file_id, node.child(choose_child_slot(node, k))};
+    if (node.header->index_children) {
+      guard = pin_node(child.page, depth < RESIDENT_LEVELS);
+      continue;
+    }
+    PageGuard leaf_guard = bufferPool.pinPage(child, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+    guard.release();
+    LeafPage leaf(*leaf_guard, td, key_fields);
+    if (!leaf.hasRoomFor(1)) {
+      return false;
+    }
+    leaf_guard.markDirty();
+    const uint16_t before = leaf.header->size;
+    (void)leaf.insertTuple(t);
+    noteRows(leaf.header->size - before);   // 覆盖已有 key 时行数不变
+    return true;
+  }
+}
+
+template <typename K>
+void BasicBTreeFile<K>::insertTuples(std::span<const Tuple> tuples) {
+  if (isReadOnly()) {
+    throw std::logic_error("BTreeFile::insertTuples: file is read-only");
+  }
+  std::vector<std::pair<K, const Tuple *>> rows;
+  rows.reserve(tuples.size());
+  for (const Tuple &t : tuples) {
+    rows.emplace_back(KeyTraits<K>::of(t, key_fields), &t);
+  }
+  std::stable_sort(rows.begin(), rows.end(),
+                   [](const auto &a, const auto &b) { return a.first < b.first; });
+
+  for (size_t i = 0; i < rows.size();) {
+    const size_t done = insert_run(rows, i);
+    if (done == 0) {
+      insert_pessimistic(*rows[i].second, rows[i].first);
+      ++i;
+    }
+    i += done;
+  }
+  for (const auto &row : rows) {
+    note_key(row.first);
+  }
+}
+
+// 与乐观插入相同的下降；沿途记下叶 key 区间的上界（父结点中该孩子右侧的分隔键）
+// 叶已满或树为空时什么也不改，返回 0
+template <typename K>
+size_t BasicBTreeFile<K>::insert_run(const std::vector<std::pair<K, const Tuple *>> &rows, size_t first) {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  const K &k = rows[first].first;
+  std::optional<K> upper;
+  PageGuard guard = pin_node(root_id, true);
+  for (size_t depth = 1;; ++depth) {
+    IndexPage node(*guard);
+    if (node.header->size == 0 && node.child(0) == 0) {
+      return 0;
+    }
+    const size_t slot = choose_child_slot(node, k);
+    if (slot < node.header->size) {
+      upper = node.keys[slot];
+    }
+    const PageId child{file_id, node.child(slot)};
+    if (node.header->index_children) {
+      guard = pin_node(child.page, depth < RESIDENT_LEVELS);
+      continue;
+    }
+    PageGuard leaf_guard = bufferPool.pinPage(child, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+    guard.release();
+    LeafPage leaf(*leaf_guard, td, key_fields);
+    const uint16_t before = leaf.header->size;
+    size_t i = first;
+    for (; i < rows.size() && (!upper || rows[i].first < *upper) && leaf.hasRoomFor(1); ++i) {
+      (void)leaf.insertTuple(*rows[i].second);
+    }
+    if (i != first) {
+      leaf_guard.markDirty();
+      noteRows(leaf.header->size - before);
+    }
+    return i - first;
+  }
+}
+
+// 悲观插入（latch crabbing）：自上而下加排他 latch；孩子插入后不会满时放开它的全部祖先，
+// 因此 held 中只剩分裂可能波及的结点，其上方的第一个结点插入后一定不会再分裂
+template <typename K>
+void BasicBTreeFile<K>::insert_pessimistic(const Tuple &t, const K &k) {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  // 分裂改动的各页在日志中是一个整体；须先于 guard 构造，guard 全部释放后才结束
+  LogGroup group(bufferPool);
+  std::vector<PageGuard> held;
+  held.push_back(bufferPool.pinPage({file_id, root_id}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE));
+
+  size_t leaf_id;
+  {
+    IndexPage root(*held.front());
+    if (root.header->size == 0 && root.child(0) == 0) {
+      held.front().markDirty();
+      leaf_id = allocate_empty_page();
+      root.setChild(0, leaf_id);
+      root.header->index_children = false;
+    } else {
+      while (true) {
+        IndexPage node(*held.back());
+        const size_t child = node.child(choose_child_slot(node, k));
+        if (!node.header->index_children) {
+          leaf_id = child;
+          break;
+        }
+        PageGuard next = bufferPool.pinPage({file_id, child}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+        IndexPage child_page(*next);
+        if (child_page.header->size + 1 < child_page.capacity) {
+          held.clear();
+        }
+        held.push_back(std::move(next));
+      }
+    }
+  }
+
+  PageGuard leaf_guard = bufferPool.pinPage({file_id, leaf_id}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+  leaf_guard.markDirty();
+  LeafPage leaf(*leaf_guard, td, key_fields);
+  if (leaf.hasRoomFor(1)) {
+    held.clear();
+  }
+
+  const uint16_t before = leaf.header->size;
   if (!leaf.insertTuple(t)) {
+    noteRows(leaf.header->size - before);
     return;
   }
 
-  pid.page = numPages++;
-  Page &new_leaf_page = bufferPool.getPage(pid);
-  bufferPool.markDirty(pid);
-  LeafPage new_leaf(new_leaf_page, td, key_index);
+  size_t new_child = allocate_empty_page();
+  PageGuard new_leaf_guard = bufferPool.pinPage({file_id, new_child}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+  new_leaf_guard.markDirty();
+  LeafPage new_leaf(*new_leaf_guard, td, key_fields);
 
-  int new_key = leaf.split(new_leaf);
-  leaf.header->next_leaf = pid.page;
-  size_t new_child = pid.page;
+  K new_key = leaf.split(new_leaf);
+  leaf.header->next_leaf = new_child;
+  // 原页满时 t 没有插进去；重复插入同一 key 只是覆盖，所以分裂后总是再插一次
+  (void)(k < new_key ? leaf : new_leaf).insertTuple(t);
+  noteRows(leaf.header->size + new_leaf.header->size - before);
 
-  while (!path.empty()) {
-    size_t parent_id = path.back();
-    path.pop_back();
+  leaf_guard.release();
+  new_leaf_guard.release();
 
-    pid.page = parent_id;
-    Page &parent_page = bufferPool.getPage(pid);
-    bufferPool.markDirty(pid);
-    IndexPage parent(parent_page);
+  while (!held.empty()) {
+    PageGuard &parent_guard = held.back();
+    parent_guard.markDirty();
+    IndexPage parent(*parent_guard);
 
     if (!parent.insert(new_key, new_child)) {
       return;
     }
+    if (parent_guard.getPageId().page == root_id) {
+      break;
+    }
 
-    pid.page = numPages++;
-    Page &new_internal_page = bufferPool.getPage(pid);
-    bufferPool.markDirty(pid);
-    IndexPage new_internal(new_internal_page);
+    const size_t id = allocate_empty_page();
+    PageGuard new_internal_guard = bufferPool.pinPage({file_id, id}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+    new_internal_guard.markDirty();
+    IndexPage new_internal(*new_internal_guard);
 
     new_key = parent.split(new_internal);
-    new_child = pid.page;
+    new_child = id;
+    held.pop_back();
   }
-
-  pid.page = root_id;
-  bufferPool.markDirty(pid);
-  if (!root.insert(new_key, new_child)) {
+  if (held.empty()) {
     return;
   }
 
-  pid.page = numPages++;
-  Page &new_child1 = bufferPool.getPage(pid);
-  bufferPool.markDirty(pid);
-  size_t child1 = pid.page;
+  // root 已满：内容搬到新页 child1 后分裂出 child2，root 只保留一个分隔键（页号 0 不变）
+  Page &root_page = *held.front();
+  IndexPage root(root_page);
 
-  new_child1 = root_page;
-  IndexPage child1_page(new_child1);
+  const size_t child1 = allocate_empty_page();
+  PageGuard child1_guard = bufferPool.pinPage({file_id, child1}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+  child1_guard.markDirty();
+  *child1_guard = root_page;
+  IndexPage child1_page(*child1_guard);
 
-  pid.page = numPages++;
-  Page &new_child2 = bufferPool.getPage(pid);
-  bufferPool.markDirty(pid);
-  size_t child2 = pid.page;
-  IndexPage child2_page(new_child2);
+  const size_t child2 = allocate_empty_page();
+  PageGuard child2_guard = bufferPool.pinPage({file_id, child2}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+  child2_guard.markDirty();
+  IndexPage child2_page(*child2_guard);
 
-  int key_split = child1_page.split(child2_page);
+  const K key_split = child1_page.split(child2_page);
 
   root.header->size = 1;
   root.header->index_children = true;
   root.keys[0] = key_split;
-  root.children[0] = child1;
-  root.children[1] = child2;
+  root.setChild(0, child1);
+  root.setChild(1, child2);
+}
+
+template <typename K>
+void BasicBTreeFile<K>::write_run(std::vector<Page> &run, size_t first_id) const {
+  if (run.empty()) {
+    return;
+  }
+  std::vector<const Page *> pages;
+  pages.reserve(run.size());
+  for (const Page &page : run) {
+    pages.push_back(&page);
+  }
+  writePages(pages, first_id);
+  run.clear();
+}
+
+template <typename K>
+void BasicBTreeFile<K>::bulkLoad(const TupleSource &next, double fill_factor) {
+  if (isReadOnly()) {
+    throw std::logic_error("BTreeFile::bulkLoad: file is read-only");
+  }
+  if (!(fill_factor > 0.0 && fill_factor <= 1.0)) {
+    throw std::logic_error("BTreeFile::bulkLoad: fill factor must be in (0, 1]");
+  }
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  // root 的排他 latch 在整个装载期间挡住其它读写
+  PageGuard root_guard = bufferPool.pinPage({file_id, root_id}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+  IndexPage root(*root_guard);
+  if (numPages > 1 || root.header->size != 0 || root.child(0) != 0) {
+    throw std::logic_error("BTreeFile::bulkLoad: tree is not empty");
+  }
+
+  Page probe{};
+  const LeafPage probe_leaf(probe, td, key_fields);
+  const size_t leaf_fill = fill_count(probe_leaf.capacity, fill_factor);
+  // 变长元组还要按字节限制每叶的装载量
+  const size_t leaf_bytes = td.fixed() ? static_cast<size_t>(-1)
+                                       : static_cast<size_t>(static_cast<double>(probe_leaf.freeBytes()) * fill_factor);
+  const size_t index_capacity = IndexPage(probe).capacity;
+  const size_t fanout = fill_count(index_capacity, fill_factor) + 1;
+  // 当前层的结点：(首 key, 页号)，从左到右
+  std::vector<std::pair<K, size_t>> level;
+  std::vector<Page> run;
+  run.reserve(BULK_RUN_PAGES);
+  size_t run_first = numPages;
+
+  auto add_page = [&]() -> std::pair<Page &, size_t> {
+    if (run.size() == BULK_RUN_PAGES) {
+      write_run(run, run_first);
+      run_first = numPages;
+    }
+    run.emplace_back();
+    run.back().fill(0);
+    return {run.back(), numPages++};
+  };
+
+  // ---------- 叶子层：按顺序装满到 leaf_fill，并串起 next_leaf ----------
+  std::vector<Tuple> rows;
+  rows.reserve(leaf_fill);
+  size_t rows_bytes = 0;
+  auto emit_leaf = [&](bool last) {
+    auto [page, id] = add_page();
+    LeafPage leaf(page, td, key_fields);
+    for (const Tuple &row : rows) {
+      (void)leaf.insertTuple(row);   // 按序追加，leaf_fill < capacity 且字节数不超过一页，都放得下
+    }
+    leaf.header->next_leaf = last ? static_cast<size_t>(-1) : id + 1;
+    level.emplace_back(KeyTraits<K>::of(rows.front(), key_fields), id);
+    noteRows(static_cast<int64_t>(rows.size()));
+    rows.clear();
+    rows_bytes = 0;
+  };
+
+  K last_key{};
+  while (std::optional<Tuple> t = next()) {
+    if (!td.compatible(*t)) {
+      throw std::logic_error("BTreeFile::bulkLoad: tuple not compatible with schema");
+    }
+    const K k = KeyTraits<K>::of(*t, key_fields);
+    note_key(k);
+    if (!rows.empty() || !level.empty()) {
+      if (k < last_key) {
+        throw std::logic_error("BTreeFile::bulkLoad: keys are not in ascending order");
+      }
+      if (k == last_key) {
+        rows_bytes += probe_leaf.cellBytes(*t) - probe_leaf.cellBytes(rows.back());
+        rows.back() = std::move(*t);   // 同 key 覆盖，与 insertTuple 一致
+        continue;
+      }
+    }
+    // 只有确认后面还有新 key 时才写出当前叶，这样最后一叶能标记链尾
+    const size_t bytes = probe_leaf.cellBytes(*t);
+    if (rows.size() == leaf_fill || (!rows.empty() && rows_bytes + bytes > leaf_bytes)) {
+      emit_leaf(false);
+    }
+    rows_bytes += bytes;
+    rows.push_back(std::move(*t));
+    last_key = k;
+  }
+  if (rows.empty()) {
+    return;
+  }
+  emit_leaf(true);
+
+  // ---------- 索引层：自底向上，直到剩余结点放得进 root ----------
+  bool index_children = false;
+  while (level.size() > index_capacity) {
+    const size_t nodes = (level.size() + fanout - 1) / fanout;
+    std::vector<std::pair<K, size_t>> upper;
+    upper.reserve(nodes);
+    size_t first = 0;
+    for (size_t n = 0; n < nodes; ++n) {
+      // 孩子在各结点间平均分配，避免最后一个结点只剩一个孩子
+      const size_t last = level.size() * (n + 1) / nodes;
+      auto [page, id] = add_page();
+      IndexPage node(page);
+      fill_index(node, level, first, last, index_children);
+      upper.emplace_back(level[first].first, id);
+      first = last;
+    }
+    level = std::move(upper);
+    index_children = true;
+  }
+  write_run(run, run_first);
+  // 新页绕过缓冲池直接写入、不记日志：先落盘，再记录指向它们的 root
+  if (bufferPool.isLogEnabled()) {
+    sync();
+  }
+
+  root_guard.markDirty();
+  fill_index(root, level, 0, level.size(), index_children);
+}
+
+template <typename K>
+void BasicBTreeFile<K>::bulkLoad(const DbFile &source, double fill_factor) {
+  ExternalSort sorted(source, [this](const Tuple &a, const Tuple &b) {
+    return KeyTraits<K>::of(a, key_fields) < KeyTraits<K>::of(b, key_fields);
+  });
+  bulkLoad([&sorted] { return sorted.next(); }, fill_factor);
+}
+
+template <typename K>
+void BasicBTreeFile<K>::deleteTuple(const Iterator &it) {
+  if (isReadOnly()) {
+    throw std::logic_error("BTreeFile::deleteTuple: file is read-only");
+  }
+  if (it.page == root_id || it.page >= getNumPages()) {
+    throw std::out_of_range("BTreeFile::deleteTuple: page out of range");
+  }
+  K key;
+  {
+    PageGuard guard = getDatabase().getBufferPool().pinPage({file_id, it.page}, AccessIntent::NORMAL,
+                                                            LatchMode::SHARED);
+    LeafPage leaf(*guard, td, key_fields);
+    if (it.slot >= leaf.header->size) {
+      throw std::out_of_range("BTreeFile::deleteTuple: slot out of range");
+    }
+    key = leaf.keyAt(it.slot);
+  }
+  (void)erase(key);
+}
+
+// 按 key 删除（latch crabbing）：删去一个 key 后仍不会不足的结点放开其全部祖先；
+// root 还要至少留下一个 key，否则可能被收缩
+template <typename K>
+bool BasicBTreeFile<K>::erase(const K &key) {
+  if (isReadOnly()) {
+    throw std::logic_error("BTreeFile::erase: file is read-only");
+  }
+  if (!may_contain(key)) {
+    return false;
+  }
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  auto safe = [](size_t size, size_t capacity) {
+    return size > std::max<size_t>(capacity / MIN_FILL_DIVISOR, 1);
+  };
+
+  LogGroup group(bufferPool);   // 合并或重分配改动的各页在日志中是一个整体
+  std::vector<PageGuard> held;
+  held.push_back(bufferPool.pinPage({file_id, root_id}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE));
+  std::vector<size_t> slots;   // held[i] 中通往下一层的孩子槽位
+  size_t leaf_id;
+  while (true) {
+    IndexPage node(*held.back());
+    if (node.header->size == 0 && node.child(0) == 0) {
+      return false;
+    }
+    const size_t slot = choose_child_slot(node, key);
+    const size_t child = node.child(slot);
+    slots.push_back(slot);
+    if (!node.header->index_children) {
+      leaf_id = child;
+      break;
+    }
+    PageGuard next = bufferPool.pinPage({file_id, child}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+    IndexPage child_page(*next);
+    if (safe(child_page.header->size, child_page.capacity)) {
+      held.clear();
+      slots.clear();
+    }
+    held.push_back(std::move(next));
+  }
+
+  PageGuard leaf_guard = bufferPool.pinPage({file_id, leaf_id}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+  {
+    LeafPage leaf(*leaf_guard, td, key_fields);
+    const uint16_t pos = leaf.lowerBound(key);
+    if (pos == leaf.header->size || !(leaf.keyAt(pos) == key)) {
+      return false;   // 已被并发删除
+    }
+    leaf_guard.markDirty();
+    leaf.deleteTuple(pos);
+    noteRows(-1);
+    if (!underfull(leaf.header->size, leaf.capacity)) {
+      return true;
+    }
+  }
+
+  // 叶不足下限：与同父的相邻叶合并或重分配；父结点仍持有排他 latch
+  PageGuard &parent_guard = held.back();
+  IndexPage parent(*parent_guard);
+  const size_t slot = slots.back();
+  if (parent.header->size == 0) {
+    return true;   // 唯一的叶，没有相邻叶可合并
+  }
+
+  // 与右邻合并；已是最后一个孩子时与左邻合并。叶 latch 总是先左后右，与沿叶链前进的读者同序
+  const size_t left_slot = slot < parent.header->size ? slot : slot - 1;
+  PageGuard left_guard;
+  PageGuard right_guard;
+  if (left_slot == slot) {
+    left_guard = std::move(leaf_guard);
+    right_guard = bufferPool.pinPage({file_id, parent.child(slot + 1)}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+  } else {
+    leaf_guard.release();
+    left_guard = bufferPool.pinPage({file_id, parent.child(left_slot)}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+    right_guard = bufferPool.pinPage({file_id, parent.child(slot)}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+  }
+  left_guard.markDirty();
+  right_guard.markDirty();
+  parent_guard.markDirty();
+  LeafPage left(*left_guard, td, key_fields);
+  LeafPage right(*right_guard, td, key_fields);
+
+  if (!left.canMerge(right)) {
+    parent.keys[left_slot] = left.redistribute(right);
+    return true;
+  }
+  left.merge(right);
+  parent.remove(left_slot);
+  left_guard.release();
+  right_guard.release();
+
+  merge_index_levels(held, slots);
+  collapse_root(held);
+  return true;
 }
 
-void BTreeFile::deleteTuple(const Iterator &it) {
+// held 为自上而下持有排他 latch 的索引页，slots 为各页通往下一层的槽位；
+// 自下而上把不足的索引页与相邻页合并，放不进一页或已不再不足时停止
+template <typename K>
+void BasicBTreeFile<K>::merge_index_levels(std::vector<PageGuard> &held, const std::vector<size_t> &slots) {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  for (size_t i = held.size() - 1; i > 0; --i) {
+    IndexPage node(*held[i]);
+    if (!underfull(node.header->size, node.capacity)) {
+      return;
+    }
+    IndexPage up(*held[i - 1]);
+    const size_t slot = slots[i - 1];
+    if (up.header->size == 0) {
+      return;
+    }
+    // 索引页只有自上而下的访问，兄弟页的加锁顺序无关紧要
+    const bool node_is_left = slot < up.header->size;
+    const size_t left_slot = node_is_left ? slot : slot - 1;
+    PageGuard sibling_guard = bufferPool.pinPage({file_id, up.child(node_is_left ? slot + 1 : left_slot)},
+                                                 AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+    IndexPage sibling(*sibling_guard);
+    IndexPage &left = node_is_left ? node : sibling;
+    IndexPage &right = node_is_left ? sibling : node;
+    // 索引页只合并不重分配：放不进一页时保持原样
+    if (left.header->size + right.header->size + 1 >= left.capacity) {
+      return;
+    }
+    held[i].markDirty();
+    sibling_guard.markDirty();
+    held[i - 1].markDirty();
+    left.merge(right, up.keys[left_slot]);
+    up.remove(left_slot);
+  }
 }
 
-Tuple BTreeFile::getTuple(const Iterator &it) const {
+// root 只剩一个孩子且孩子是索引页时，把孩子的内容提升进 root，树高减一
+template <typename K>
+void BasicBTreeFile<K>::collapse_root(std::vector<PageGuard> &held) {
+  if (held.empty() || held.front().getPageId().page != root_id) {
+    return;   // root 的 latch 早已放开，说明它删后仍至少有一个 key
+  }
+  // root 的孩子可能就在 held 中；有 root 的排他 latch 挡着，先放开下层再重新加锁
+  held.erase(held.begin() + 1, held.end());
   BufferPool &bufferPool = getDatabase().getBufferPool();
-  PageId pid{name, it.page};
-  Page &page = bufferPool.getPage(pid);
-  LeafPage leaf(page, td, key_index);
-  return leaf.getTuple(it.slot);
+  PageGuard &root_guard = held.front();
+  IndexPage root(*root_guard);
+  while (root.header->size == 0 && root.header->index_children) {
+    PageGuard child_guard = bufferPool.pinPage({file_id, root.child(0)}, AccessIntent::NORMAL,
+                                               LatchMode::EXCLUSIVE);
+    root_guard.markDirty();
+    *root_guard = *child_guard;
+    root = IndexPage(*root_guard);
+  }
+}
+
+template <typename K>
+Tuple BasicBTreeFile<K>::getTuple(const Iterator &it) const {
+  return with_leaf(file_id, it, [&](Page &page) { return LeafPage(page, td, key_fields).getTuple(it.slot); });
+}
+
+template <typename K>
+TupleView BasicBTreeFile<K>::getView(const Iterator &it) const {
+  return with_leaf(file_id, it, [&](Page &page) { return LeafPage(page, td, key_fields).getView(it.slot); });
 }
 
-void BTreeFile::next(Iterator &it) const {
+template <typename K>
+void BasicBTreeFile<K>::next(Iterator &it) const {
   if (it.page == 0 && it.slot == 0) {
     return;
   }
 
+  // 叶内前进只改槽位；走到叶尾时返回后继叶页号
+  const std::optional<size_t> next_leaf = with_leaf(file_id, it, [&](Page &page) -> std::optional<size_t> {
+    LeafPage leaf(page, td, key_fields);
+    if (it.slot + 1 < leaf.header->size) {
+      return std::nullopt;
+    }
+    return leaf.header->next_leaf;
+  });
+  if (!next_leaf) {
+    it.slot++;
+    return;
+  }
+
+  // 离开本叶时放开它的 pin，后继叶在下次访问时再 pin
+  it.cache.reset();
+  it.slot = 0;
+  if (*next_leaf == static_cast<size_t>(-1)) {
+    it.page = 0;
+  } else {
+    it.page = *next_leaf;
+    if (it.page != 0) {
+      getDatabase().getBufferPool().readAheadChain({file_id, it.page}, next_leaf_of);
+    }
+  }
+}
+
+template <typename K>
+Iterator BasicBTreeFile<K>::begin() const {
   BufferPool &bufferPool = getDatabase().getBufferPool();
-  PageId pid{name, it.page};
-  Page &page = bufferPool.getPage(pid);
-  LeafPage leaf(page, td, key_index);
+  PageGuard guard = pin_node(root_id, true);
+  for (size_t depth = 1;; ++depth) {
+    IndexPage node(*guard);
+    const size_t child = node.child(0);
+    if (child == 0) {
+      return end();
+    }
+    if (!node.header->index_children) {
+      guard = bufferPool.pinPage({file_id, child}, AccessIntent::NORMAL, LatchMode::SHARED);
+      return first_in_chain(guard);
+    }
+    guard = pin_node(child, depth < RESIDENT_LEVELS);
+  }
+}
 
-  if (it.slot + 1 < leaf.header->size) {
-    it.slot++;
+// 从持有共享 latch 的叶起沿叶子链找第一个非空叶的首条（删除可能留下空叶）；
+// 先锁住后继再放开当前叶，与删除时先左后右的加锁顺序一致
+template <typename K>
+Iterator BasicBTreeFile<K>::first_in_chain(PageGuard &guard) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  while (true) {
+    LeafPage leaf(*guard, td, key_fields);
+    if (leaf.header->size > 0) {
+      return {*this, guard.getPageId().page, 0};
+    }
+    const size_t next = leaf.header->next_leaf;
+    if (next == 0 || next == static_cast<size_t>(-1)) {
+      return end();
+    }
+    guard = bufferPool.pinPage({file_id, next}, AccessIntent::NORMAL, LatchMode::SHARED);
+  }
+}
+
+template <typename K>
+size_t BasicBTreeFile<K>::scanPage(Iterator &it, std::vector<Tuple> &out, size_t limit) const {
+  if ((it.page == 0 && it.slot == 0) || limit == 0) {
+    return 0;
+  }
+
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  PageGuard guard = bufferPool.pinPage({file_id, it.page}, AccessIntent::SCAN, LatchMode::SHARED);
+  LeafPage leaf(*guard, td, key_fields);
+
+  const size_t n = leaf.header->size;
+  size_t count = 0;
+  size_t slot = it.slot;
+  for (; slot < n && count < limit; ++slot, ++count) {
+    out.push_back(leaf.getTuple(slot));
+  }
+
+  if (slot < n) {
+    it.slot = slot;
+  } else if (leaf.header->next_leaf == static_cast<size_t>(-1)) {
+    it.page = 0;
+    it.slot = 0;
+    it.cache.reset();
   } else {
-    if (leaf.header->next_leaf == static_cast<size_t>(-1)) {
-      it.page = 0;
-      it.slot = 0;
-    } else {
-      it.page = leaf.header->next_leaf;
-      it.slot = 0;
+    it.page = leaf.header->next_leaf;
+    it.slot = 0;
+    it.cache.reset();
+    if (it.page != 0) {
+      bufferPool.readAheadChain({file_id, it.page}, next_leaf_of);
     }
   }
+  return count;
 }
 
-Iterator BTreeFile::begin() const {
+template <typename K>
+size_t BasicBTreeFile<K>::scanPageWhere(Iterator &it, std::vector<Tuple> &out, size_t limit,
+                                        const Predicate &pred) const {
+  if ((it.page == 0 && it.slot == 0) || limit == 0) {
+    return 0;
+  }
+  pred.check(td);
+
   BufferPool &bufferPool = getDatabase().getBufferPool();
-  PageId pid{name, root_id};
+  PageGuard guard = bufferPool.pinPage({file_id, it.page}, AccessIntent::SCAN, LatchMode::SHARED);
+  LeafPage leaf(*guard, td, key_fields);
 
-  Page &root_page = bufferPool.getPage(pid);
-  IndexPage root(root_page);
+  const size_t n = leaf.header->size;
+  const size_t first = std::min(it.slot, n);
+  const size_t last = first + std::min(limit, n - first);
+
+  // key 字段在 SLOTTED 叶中是稠密数组，整段一次求值；其余情况逐条读页内字节
+  uint64_t mask[DEFAULT_PAGE_SIZE / 64 + 1];
+  bool dense = false;
+  if constexpr (std::is_same_v<K, int32_t> || std::is_same_v<K, double>) {
+    if (leaf.isSlotted() && pred.field == key_fields[0]) {
+      pred.evaluate(reinterpret_cast<const uint8_t *>(leaf.keys + first), sizeof(K), last - first, mask);
+      dense = true;
+    }
+  }
+  for (size_t slot = first; slot < last; ++slot) {
+    const size_t bit = slot - first;
+    if (dense ? (mask[bit / 64] >> (bit % 64)) & 1 : pred.matches(leaf.getView(slot))) {
+      out.push_back(leaf.getTuple(slot));
+    }
+  }
+
+  if (last < n) {
+    it.slot = last;
+  } else if (leaf.header->next_leaf == static_cast<size_t>(-1)) {
+    it.page = 0;
+    it.slot = 0;
+    it.cache.reset();
+  } else {
+    it.page = leaf.header->next_leaf;
+    it.slot = 0;
+    it.cache.reset();
+    if (it.page != 0) {
+      bufferPool.readAheadChain({file_id, it.page}, next_leaf_of);
+    }
+  }
+  return last - first;
+}
 
-  if (root.children[0] == 0) {
+template <typename K>
+Iterator BasicBTreeFile<K>::lowerBound(const K &key) const {
+  PageGuard guard;
+  const size_t leaf_id = descend_shared(key, guard);
+  if (leaf_id == 0) {
     return end();
   }
 
+  LeafPage leaf(*guard, td, key_fields);
+  const size_t slot = leaf.lowerBound(key);
+  if (slot < leaf.header->size) {
+    return {*this, leaf_id, slot};
+  }
+  // 叶内没有 >= key 的元组：答案是后继叶的首条
+  const size_t next = leaf.header->next_leaf;
+  if (next == 0 || next == static_cast<size_t>(-1)) {
+    return end();
+  }
+  guard = getDatabase().getBufferPool().pinPage({file_id, next}, AccessIntent::NORMAL, LatchMode::SHARED);
+  return first_in_chain(guard);
+}
+
+// key 只可能在下降到的那个叶中，不必沿叶子链前进
+template <typename K>
+Iterator BasicBTreeFile<K>::find(const K &key) const {
+  if (!may_contain(key)) {
+    return end();
+  }
+  PageGuard guard;
+  const size_t leaf_id = descend_shared(key, guard);
+  return find_in_leaf(guard, leaf_id, key);
+}
+
+template <typename K>
+Iterator BasicBTreeFile<K>::find_in_leaf(const PageGuard &leaf_guard, size_t leaf_id, const K &key) const {
+  if (leaf_id == 0) {
+    return end();
+  }
+  LeafPage leaf(*leaf_guard, td, key_fields);
+  const size_t slot = leaf.lowerBound(key);
+  if (slot < leaf.header->size && leaf.keyAt(slot) == key) {
+    return {*this, leaf_id, slot};
+  }
+  return end();
+}
+
+// 缺页时放开全部 latch 再等，等来的页一直 pin 着，重新下降时不会又被换出；
+// 没有调度器时 co_await 直接同步读，下降也就不必在缺页处停下
+template <typename K>
+Task<Iterator> BasicBTreeFile<K>::findAsync(K key) const {
+  if (!may_contain(key)) {
+    co_return end();
+  }
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  PageGuard loaded;
   while (true) {
-    Page &page = bufferPool.getPage(pid);
-    IndexPage node(page);
+    std::optional<size_t> missing;
+    {
+      PageGuard guard;
+      const size_t leaf_id = descend_shared(key, guard, IoScheduler::current() != nullptr ? &missing : nullptr);
+      if (!missing) {
+        co_return find_in_leaf(guard, leaf_id, key);
+      }
+    }
+    loaded = co_await bufferPool.getPageAsync({file_id, *missing});
+  }
+}
 
-    size_t child = node.children[0];
+template <typename K>
+std::pair<Iterator, Iterator> BasicBTreeFile<K>::range(const K &lo, const K &hi) const {
+  Iterator first = lowerBound(lo);
+  if (!(lo < hi)) {
+    return {first, first};
+  }
+  return {first, lowerBound(hi)};
+}
 
-    if (!node.header->index_children) {
-      pid.page = child;
+// 自 root 逐层展开到子树够多或到达叶层；每个区间从所选子树最左叶（跳过空叶）的首条开始
+template <typename K>
+std::vector<Iterator> BasicBTreeFile<K>::split(size_t parts) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  parts = std::max<size_t>(parts, 1);
+  std::vector<size_t> level{root_id};
+  std::vector<size_t> subtrees;
+  bool leaves = false;   // subtrees 是否为叶
+  while (true) {
+    subtrees.clear();
+    for (const size_t id : level) {
+      PageGuard guard = bufferPool.pinPage({file_id, id}, AccessIntent::NORMAL, LatchMode::SHARED);
+      IndexPage node(*guard);
+      if (node.header->size == 0 && node.child(0) == 0) {
+        return {};
+      }
+      for (size_t s = 0; s <= node.header->size; ++s) {
+        subtrees.push_back(node.child(s));
+      }
+      leaves = !node.header->index_children;
+    }
+    if (leaves || subtrees.size() >= parts) {
       break;
     }
-
-    pid.page = child;
+    level.swap(subtrees);
   }
 
-  return {*this, pid.page, 0};
+  std::vector<Iterator> starts;
+  const size_t chosen = std::min(parts, subtrees.size());
+  for (size_t i = 0; i < chosen; ++i) {
+    size_t id = subtrees[i * subtrees.size() / chosen];
+    for (bool leaf = leaves; !leaf;) {
+      PageGuard guard = bufferPool.pinPage({file_id, id}, AccessIntent::NORMAL, LatchMode::SHARED);
+      IndexPage node(*guard);
+      leaf = !node.header->index_children;
+      id = node.child(0);
+    }
+    PageGuard guard = bufferPool.pinPage({file_id, id}, AccessIntent::NORMAL, LatchMode::SHARED);
+    Iterator it = first_in_chain(guard);
+    if (it == end()) {
+      break;
+    }
+    if (starts.empty() || it != starts.back()) {
+      starts.push_back(it);
+    }
+  }
+  return starts;
 }
 
-Iterator BTreeFile::end() const {
+template <typename K>
+Iterator BasicBTreeFile<K>::end() const {
   return {*this, 0, 0};
 }
+
+// 先让插入记入新过滤器，再扫描已有的 key，扫描完才用它回答查找。插入在写叶之后才记 key：
+// 若它读到的过滤器还是旧的，写叶就早于此处换上新过滤器，扫描一定能看到这条 key
+template <typename K>
+void BasicBTreeFile<K>::enableKeyFilter(size_t expected_keys, size_t bits_per_key) {
+  if (bits_per_key == 0) {
+    throw std::logic_error("BTreeFile::enableKeyFilter: bits per key must be positive");
+  }
+  std::lock_guard lock(filter_mtx);
+  filter_ready.store(false);
+  key_filters.push_back(std::make_unique<BloomFilter>(expected_keys, bits_per_key));
+  BloomFilter &filter = *key_filters.back();
+  key_filter.store(&filter);
+  for (Iterator it = begin(), e = end(); it != e; next(it)) {
+    it.slot = with_leaf(file_id, it, [&](Page &page) {
+      LeafPage leaf(page, td, key_fields);
+      for (size_t slot = it.slot; slot < leaf.header->size; ++slot) {
+        filter.add(key_hash(leaf.keyAt(slot)));
+      }
+      return std::max<size_t>(leaf.header->size, 1) - 1;   // next() 由叶尾走到后继叶
+    });
+  }
+  filter_ready.store(true);
+}
+
+template <typename K>
+void BasicBTreeFile<K>::disableKeyFilter() {
+  std::lock_guard lock(filter_mtx);
+  filter_ready.store(false);
+  key_filter.store(nullptr);
+}
+
+template <typename K>
+const BloomFilter *BasicBTreeFile<K>::getKeyFilter() const {
+  return filter_ready.load() ? key_filter.load() : nullptr;
+}
+
+template <typename K>
+void BasicBTreeFile<K>::note_key(const K &key) {
+  if (BloomFilter *filter = key_filter.load()) {
+    filter->add(key_hash(key));
+  }
+}
+
+template <typename K>
+bool BasicBTreeFile<K>::may_contain(const K &key) const {
+  const BloomFilter *filter = getKeyFilter();
+  return filter == nullptr || filter->mayContain(key_hash(key));
+}
+
+template class db::BasicBTreeFile<int32_t>;
+template class db::BasicBTreeFile<double>;
+template class db::BasicBTreeFile<CharKey>;
+template class db::BasicBTreeFile<IntPairKey>;
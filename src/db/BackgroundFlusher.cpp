@@ -0,0 +1,54 @@
+#include <db/BackgroundFlusher.hpp>
+#include <db/BufferPool.hpp>
+#include <algorithm>
+#include <exception>
+
+using namespace db;
+
+BackgroundFlusher::BackgroundFlusher(BufferPool &pool, size_t clean_frames, std::chrono::milliseconds interval)
+    : pool(pool), clean_frames(std::max<size_t>(1, clean_frames)), interval(interval) {
+    worker = std::thread([this] { run(); });
+}
+
+BackgroundFlusher::~BackgroundFlusher() {
+    {
+        std::lock_guard lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    worker.join();
+}
+
+size_t BackgroundFlusher::getCleanFrames() const { return clean_frames; }
+
+std::chrono::milliseconds BackgroundFlusher::getInterval() const { return interval; }
+
+void BackgroundFlusher::wake() {
+    {
+        std::lock_guard lock(mtx);
+        pending = true;
+    }
+    cv.notify_one();
+}
+
+void BackgroundFlusher::run() {
+    std::unique_lock lock(mtx);
+    while (true) {
+        cv.wait_for(lock, interval, [this] { return stopping || pending; });
+        if (stopping) {
+            return;
+        }
+        pending = false;
+        lock.unlock();
+
+        for (size_t s = 0; s < pool.getNumShards(); ++s) {
+            try {
+                pool.cleanShard(s, clean_frames);
+            } catch (const std::exception &) {
+                // 写失败时页仍是脏的，下一轮或淘汰时再写
+            }
+        }
+
+        lock.lock();
+    }
+}
@@ -0,0 +1,56 @@
+#include <db/BloomFilter.hpp>
+#include <algorithm>
+#include <cstring>
+
+using namespace db;
+
+namespace {
+// 每个字一个奇数盐，把哈希的高 32 位映射成字内的位（Parquet 的 split-block 方案）
+constexpr uint32_t SALT[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                              0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+} // namespace
+
+BloomFilter::BloomFilter(size_t keys, size_t bits_per_key)
+    : blocks(std::max<size_t>(1, (keys * bits_per_key + 255) / 256)) {
+    words = std::make_unique<std::atomic<uint32_t>[]>(blocks * WORDS_PER_BLOCK);
+}
+
+void BloomFilter::add(uint64_t hash) {
+    std::atomic<uint32_t> *block = &words[((hash & 0xffffffffULL) * blocks >> 32) * WORDS_PER_BLOCK];
+    const auto key = static_cast<uint32_t>(hash >> 32);
+    for (size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+        block[i].fetch_or(1U << ((key * SALT[i]) >> 27), std::memory_order_relaxed);
+    }
+}
+
+bool BloomFilter::mayContain(uint64_t hash) const {
+    const std::atomic<uint32_t> *block = &words[((hash & 0xffffffffULL) * blocks >> 32) * WORDS_PER_BLOCK];
+    const auto key = static_cast<uint32_t>(hash >> 32);
+    for (size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+        if ((block[i].load(std::memory_order_relaxed) & (1U << ((key * SALT[i]) >> 27))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 每 8 字节一轮乘加混合，尾部补 0；key 最长 64 字节，不必更快的算法
+uint64_t BloomFilter::hash(const void *data, size_t n) {
+    const auto *p = static_cast<const uint8_t *>(data);
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ n;
+    for (size_t i = 0; i < n; i += sizeof(uint64_t)) {
+        uint64_t w = 0;
+        std::memcpy(&w, p + i, std::min(sizeof(uint64_t), n - i));
+        h = mix(h ^ w) + 0x9E3779B97F4A7C15ULL;
+    }
+    return mix(h);
+}
@@ -1,134 +1,1362 @@
 #include <db/BufferPool.hpp>
 #include <db/Database.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <new>
 #include <numeric>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <thread>
 #include <vector>
 
 using namespace db;
 
-BufferPool::BufferPool()
-    : pid_to_pos(),
-      available(DEFAULT_NUM_PAGES)
+namespace {
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// 所有帧放在一块连续内存里；足够大时按 2 MiB 对齐，方便内核用透明大页映射
+Page *allocate_frames(size_t n) {
+    size_t bytes = n * sizeof(Page);
+    const size_t align = bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : DEFAULT_PAGE_SIZE;
+    bytes = (bytes + align - 1) / align * align;
+    void *mem = std::aligned_alloc(align, bytes);
+    if (mem == nullptr) {
+        throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (align == HUGE_PAGE_SIZE) {
+        (void)madvise(mem, bytes, MADV_HUGEPAGE);
+    }
+#endif
+    return static_cast<Page *>(mem);
+}
+
+// 每个线程的日志状态：置脏后待记录的页，以及 LogGroup 内已记录、待整体追加的改动
+struct ThreadLog {
+    size_t depth{0};
+    std::vector<std::pair<PageId, size_t>> pending;
+    std::vector<uint8_t> records;
+    std::vector<std::pair<PageId, size_t>> held;
+};
+
+thread_local ThreadLog thread_log;
+
+// 每个线程的多版本状态：当前写操作的时间戳及其改过的页，以及本线程持有的快照
+struct ThreadVersions {
+    size_t depth{0};
+    ts_t op{0};
+    std::vector<PageId> touched;
+    const VersionStore::View *snapshot{nullptr};
+    std::vector<std::shared_ptr<const Page>> retained;   // getPage 交出去的旧版本，快照结束前保活
+};
+
+thread_local ThreadVersions thread_versions;
+
+// 把 n 个帧尽量平均地分给 shards 个分片：返回第 s 个分片的 [first, count)
+std::pair<size_t, size_t> shard_range(size_t n, size_t shards, size_t s) {
+    const size_t base = n / shards;
+    const size_t extra = n % shards;
+    const size_t first = s * base + std::min(s, extra);
+    return {first, base + (s < extra ? 1 : 0)};
+}
+} // namespace
+
+void BufferPool::FrameDeleter::operator()(Page *frames) const { std::free(frames); }
+
+BufferPool::BufferPool(size_t num_pages, ReplacementPolicy policy, size_t num_shards)
+    : capacity(num_pages),
+      policy(policy)
 {
-    std::iota(available.rbegin(), available.rend(), 0);
+    if (num_pages == 0) {
+        throw std::logic_error("BufferPool: number of pages must be positive");
+    }
+    if (num_shards == 0 || num_shards > num_pages) {
+        throw std::logic_error("BufferPool: number of shards must be in [1, number of pages]");
+    }
+    pages.reset(allocate_frames(num_pages));
+    pos_to_pid.resize(num_pages);
+    pin_count.assign(num_pages, 0);
+    ref_bit.assign(num_pages, 0);
+    latches = std::make_unique<std::shared_mutex[]>(num_pages);
+    allocateLogState(num_pages);
+    before.resize(num_pages);
+    for (size_t s = 0; s < num_shards; ++s) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+    layoutShards(num_pages);
+}
+
+void BufferPool::allocateLogState(size_t num_pages) {
+    page_lsn = std::make_unique<std::atomic<lsn_t>[]>(num_pages);
+    need_image = std::make_unique<std::atomic<uint8_t>[]>(num_pages);
+    rec_lsn = std::make_unique<std::atomic<lsn_t>[]>(num_pages);
+    for (size_t pos = 0; pos < num_pages; ++pos) {
+        need_image[pos] = 1;
+        rec_lsn[pos] = NO_LSN;
+    }
+    logged.clear();
+    logged.resize(num_pages);
+    hold.assign(num_pages, 0);
+}
+
+void BufferPool::layoutShards(size_t num_pages) {
+    for (size_t s = 0; s < shards.size(); ++s) {
+        Shard &shard = *shards[s];
+        std::tie(shard.first, shard.count) = shard_range(num_pages, shards.size(), s);
+        shard.pid_to_pos.clear();
+        shard.dirty.clear();
+        shard.lru_list.clear();
+        shard.pos_to_lru.clear();
+        shard.scan_ring.clear();
+        shard.clock_hand = 0;
+        shard.available.resize(shard.count);
+        std::iota(shard.available.rbegin(), shard.available.rend(), shard.first);
+    }
+}
+
+size_t BufferPool::getNumPages() const { return capacity; }
+
+size_t BufferPool::getNumShards() const { return shards.size(); }
+
+BufferPoolStats BufferPool::getStats() const {
+    BufferPoolStats stats;
+    for (const auto &shard : shards) {
+        std::lock_guard lock(shard->mtx);
+        stats.hits += shard->hits;
+        stats.misses += shard->misses;
+        stats.prefetched += shard->prefetched;
+        stats.evictions += shard->evictions;
+    }
+    stats.flushes = flushes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool BufferPool::inSnapshot() const { return versions && thread_versions.snapshot; }
+
+ReplacementPolicy BufferPool::getPolicy() const { return policy; }
+
+BufferPool::Shard &BufferPool::shardOf(const PageId &pid) const {
+    if (shards.size() == 1) {
+        return *shards.front();
+    }
+    return *shards[std::hash<PageId>()(pid) % shards.size()];
+}
+
+void BufferPool::touch(Shard &shard, size_t pos) {
+    if (policy == ReplacementPolicy::CLOCK) {
+        ref_bit[pos] = 1;
+        return;
+    }
+    auto lit = shard.pos_to_lru.find(pos);
+    if (lit != shard.pos_to_lru.end()) {
+        shard.lru_list.splice(shard.lru_list.begin(), shard.lru_list, lit->second);
+        lit->second = shard.lru_list.begin();
+    }
+}
+
+// 新调入的页：CLOCK 下引用位为 0，只被访问一次的页（如顺序扫描）会先于热页被淘汰
+// SCAN 调入的页在 LRU 下放在队尾，并记入扫描环
+void BufferPool::admit(Shard &shard, size_t pos, AccessIntent intent) {
+    if (intent == AccessIntent::SCAN) {
+        shard.scan_ring.push_back(pos);
+    }
+    if (policy == ReplacementPolicy::CLOCK) {
+        ref_bit[pos] = 0;
+        return;
+    }
+    if (intent == AccessIntent::SCAN) {
+        shard.lru_list.push_back(pos);
+        shard.pos_to_lru[pos] = std::prev(shard.lru_list.end());
+    } else {
+        shard.lru_list.push_front(pos);
+        shard.pos_to_lru[pos] = shard.lru_list.begin();
+    }
+}
+
+size_t BufferPool::scanRingLimit(const Shard &shard) const {
+    return std::max<size_t>(1, std::min(scan_ring_pages, shard.count / 4));
+}
+
+// 扫描环已满时，取出最老的未 pin 帧供本次 SCAN 调入复用
+bool BufferPool::takeFromScanRing(Shard &shard, size_t &pos) {
+    if (shard.scan_ring.size() < scanRingLimit(shard)) {
+        return false;
+    }
+    for (auto it = shard.scan_ring.begin(); it != shard.scan_ring.end(); ++it) {
+        if (pin_count[*it] == 0 && hold[*it] == 0) {
+            pos = *it;
+            shard.scan_ring.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+void BufferPool::leaveScanRing(Shard &shard, size_t pos) {
+    auto it = std::find(shard.scan_ring.begin(), shard.scan_ring.end(), pos);
+    if (it != shard.scan_ring.end()) {
+        shard.scan_ring.erase(it);
+    }
+}
+
+size_t BufferPool::chooseVictim(Shard &shard) {
+    if (policy == ReplacementPolicy::CLOCK) {
+        // 最多转两圈：第一圈清引用位，第二圈必能找到未 pin 的帧
+        for (size_t step = 0; step < 2 * shard.count; ++step) {
+            const size_t pos = shard.first + shard.clock_hand;
+            shard.clock_hand = (shard.clock_hand + 1) % shard.count;
+            // 跳过被 pin 或改动未记日志的帧，以及正在被 prefetch 预留、尚未装入的帧
+            if (pin_count[pos] > 0 || hold[pos] > 0 || pos_to_pid[pos].file == INVALID_FILE_ID) {
+                continue;
+            }
+            if (ref_bit[pos]) {
+                ref_bit[pos] = 0;
+                continue;
+            }
+            return pos;
+        }
+        throw std::runtime_error("BufferPool::getPage: all pages are pinned");
+    }
+
+    // 从 LRU 尾部开始，跳过被 pin 住或改动未记日志的帧
+    auto victim = shard.lru_list.rbegin();
+    while (victim != shard.lru_list.rend() && (pin_count[*victim] > 0 || hold[*victim] > 0)) {
+        ++victim;
+    }
+    if (victim == shard.lru_list.rend()) {
+        throw std::runtime_error("BufferPool::getPage: all pages are pinned");
+    }
+    return *victim;
+}
+
+// 常驻帧，按“最近使用”从新到旧排列（CLOCK 下引用位为 1 的在前）
+std::vector<size_t> BufferPool::residentByRecency(const Shard &shard) const {
+    std::vector<size_t> out;
+    if (policy == ReplacementPolicy::LRU) {
+        out.assign(shard.lru_list.begin(), shard.lru_list.end());
+        return out;
+    }
+    for (int referenced = 1; referenced >= 0; --referenced) {
+        for (size_t pos = shard.first; pos < shard.first + shard.count; ++pos) {
+            if (pos_to_pid[pos].file != INVALID_FILE_ID && ref_bit[pos] == referenced) {
+                out.push_back(pos);
+            }
+        }
+    }
+    return out;
+}
+
+// 后台写回线程会 pin 帧，重排帧期间先停掉，完成后按原参数重启
+void BufferPool::resize(size_t num_pages) {
+    releaseResident();
+    if (!flusher) {
+        resizeFrames(num_pages);
+        return;
+    }
+    const size_t clean_frames = flusher->getCleanFrames();
+    const std::chrono::milliseconds interval = flusher->getInterval();
+    flusher.reset();
+    try {
+        resizeFrames(num_pages);
+    } catch (...) {
+        enableBackgroundFlush(clean_frames, interval);
+        throw;
+    }
+    enableBackgroundFlush(clean_frames, interval);
+}
+
+void BufferPool::resizeFrames(size_t num_pages) {
+    if (num_pages == 0 || num_pages < shards.size()) {
+        throw std::logic_error("BufferPool::resize: number of pages must be at least the number of shards");
+    }
+
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (auto &shard : shards) {
+        locks.emplace_back(shard->mtx);
+    }
+    if (std::any_of(pin_count.begin(), pin_count.end(), [](size_t c) { return c > 0; }) ||
+        std::any_of(hold.begin(), hold.end(), [](uint32_t h) { return h > 0; })) {
+        throw std::logic_error("BufferPool::resize: pages are pinned");
+    }
+
+    if (wal) {
+        wal->flush(wal->appendedLsn());
+    }
+    std::unique_ptr<Page[], FrameDeleter> new_pages(allocate_frames(num_pages));
+    std::vector<PageId> new_pos_to_pid(num_pages);
+    std::vector<uint8_t> new_ref_bit(num_pages, 0);
+    std::vector<lsn_t> new_rec_lsn(num_pages, NO_LSN);
+
+    for (size_t s = 0; s < shards.size(); ++s) {
+        Shard &shard = *shards[s];
+        const auto [first, count] = shard_range(num_pages, shards.size(), s);
+
+        // 按最近使用顺序保留页，其余的页先落盘再丢弃
+        std::vector<size_t> keep;
+        for (size_t pos : residentByRecency(shard)) {
+            if (keep.size() < count) {
+                keep.push_back(pos);
+            } else {
+                flushLocked(shard, pos_to_pid[pos]);
+            }
+        }
+
+        std::unordered_set<size_t> new_dirty;
+        shard.pid_to_pos.clear();
+        shard.lru_list.clear();
+        shard.pos_to_lru.clear();
+        for (size_t i = 0; i < keep.size(); ++i) {
+            const size_t old_pos = keep[i];
+            const size_t pos = first + i;
+            new_pages[pos] = pages[old_pos];
+            new_pos_to_pid[pos] = pos_to_pid[old_pos];
+            shard.pid_to_pos[new_pos_to_pid[pos]] = pos;
+            new_ref_bit[pos] = ref_bit[old_pos];
+            new_rec_lsn[pos] = rec_lsn[old_pos];
+            if (policy == ReplacementPolicy::LRU) {
+                shard.lru_list.push_back(pos);
+                shard.pos_to_lru[pos] = std::prev(shard.lru_list.end());
+            }
+            if (shard.dirty.contains(old_pos)) {
+                new_dirty.insert(pos);
+            }
+        }
+
+        shard.first = first;
+        shard.count = count;
+        shard.dirty = std::move(new_dirty);
+        shard.clock_hand = 0;
+        shard.scan_ring.clear();
+        shard.available.resize(count - keep.size());
+        std::iota(shard.available.rbegin(), shard.available.rend(), first + keep.size());
+    }
+
+    pages = std::move(new_pages);
+    pos_to_pid = std::move(new_pos_to_pid);
+    ref_bit = std::move(new_ref_bit);
+    pin_count.assign(num_pages, 0);
+    latches = std::make_unique<std::shared_mutex[]>(num_pages);
+    // 日志已在上面整个落盘，保留下来的帧 LSN 归零即可；下一条记录从整页开始。恢复 LSN 仍要保留
+    allocateLogState(num_pages);
+    for (size_t pos = 0; pos < num_pages; ++pos) {
+        rec_lsn[pos] = new_rec_lsn[pos];
+    }
+    before.assign(num_pages, nullptr);
+    capacity = num_pages;
 }
 
 BufferPool::~BufferPool() {
-    std::vector<PageId> to_flush;
-    to_flush.reserve(dirty.size());
-    for (size_t pos : dirty) {
-        const PageId &pid = pos_to_pid[pos];
-        if (!pid.file.empty()) {
-            to_flush.push_back(pid);
+    read_ahead.reset();
+    flusher.reset();
+    for (auto &shard : shards) {
+        std::lock_guard lock(shard->mtx);
+        std::vector<size_t> to_flush;
+        to_flush.reserve(shard->dirty.size());
+        for (size_t pos : shard->dirty) {
+            if (pos_to_pid[pos].file != INVALID_FILE_ID) {
+                to_flush.push_back(pos);
+            }
+        }
+        flushBatchLocked(*shard, to_flush);
+    }
+}
+
+// 改动尚未记日志的帧跳过，保持为脏
+void BufferPool::flushBatchLocked(Shard &shard, std::vector<size_t> &positions) {
+    std::erase_if(positions, [this](size_t pos) { return hold[pos] > 0; });
+    for (size_t pos : positions) {
+        shard.dirty.erase(pos);
+    }
+    writeSorted(positions);
+}
+
+// 调用方保证这些帧在写出期间不会被淘汰（持有分片锁或已 pin 住）
+void BufferPool::writeSorted(std::vector<size_t> &positions) {
+    if (positions.empty()) {
+        return;
+    }
+    logBeforeWrite(positions);
+    std::sort(positions.begin(), positions.end(), [this](size_t a, size_t b) {
+        const PageId &x = pos_to_pid[a];
+        const PageId &y = pos_to_pid[b];
+        return x.file != y.file ? x.file < y.file : x.page < y.page;
+    });
+
+    std::exception_ptr error;
+    std::vector<IoRequest> singles;
+    for (size_t i = 0; i < positions.size();) {
+        const PageId first = pos_to_pid[positions[i]];
+        size_t j = i + 1;
+        while (j < positions.size() && pos_to_pid[positions[j]].file == first.file &&
+               pos_to_pid[positions[j]].page == first.page + (j - i)) {
+            ++j;
+        }
+        const DbFile &file = getDatabase().get(first.file);
+        if (j - i == 1) {
+            singles.push_back({IoOp::WRITE, &file, first.page, &pages[positions[i]]});
+        } else {
+            std::vector<const Page *> run;
+            run.reserve(j - i);
+            for (size_t k = i; k < j; ++k) {
+                run.push_back(&pages[positions[k]]);
+            }
+            try {
+                file.writePages(run, first.page);
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
         }
+        i = j;
     }
-    for (const auto &pid : to_flush) {
-        flushPage(pid);
+    try {
+        io.run(singles);
+    } catch (...) {
+        if (!error) error = std::current_exception();
     }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    noteWritten(positions);
+}
+
+// 最先会被淘汰的 n 个未 pin 帧：扫描环在前，然后是 LRU 队尾 / CLOCK 指针之后引用位为 0 的帧
+std::vector<size_t> BufferPool::coldestUnpinned(const Shard &shard, size_t n) const {
+    std::vector<size_t> out;
+    auto take = [&](size_t pos) {
+        if (out.size() < n && pin_count[pos] == 0 && hold[pos] == 0 && pos_to_pid[pos].file != INVALID_FILE_ID &&
+            std::find(out.begin(), out.end(), pos) == out.end()) {
+            out.push_back(pos);
+        }
+    };
+    for (size_t pos : shard.scan_ring) {
+        take(pos);
+    }
+    if (policy == ReplacementPolicy::LRU) {
+        for (auto it = shard.lru_list.rbegin(); it != shard.lru_list.rend() && out.size() < n; ++it) {
+            take(*it);
+        }
+        return out;
+    }
+    for (uint8_t referenced = 0; referenced <= 1; ++referenced) {
+        for (size_t step = 0; step < shard.count && out.size() < n; ++step) {
+            const size_t pos = shard.first + (shard.clock_hand + step) % shard.count;
+            if (ref_bit[pos] == referenced) {
+                take(pos);
+            }
+        }
+    }
+    return out;
 }
 
-Page &BufferPool::getPage(const PageId &pid) {
-    if (contains(pid)) {
-        auto it = pid_to_pos.find(pid);
-        size_t pos = it->second;
-        auto lit = pos_to_lru.find(pos);
-        if (lit != pos_to_lru.end()) {
-            lru_list.splice(lru_list.begin(), lru_list, lit->second);
-            lit->second = lru_list.begin();
+// 选中的脏帧先 pin 住并清脏位，锁外写出：写出期间帧不会被淘汰。
+// 写出期间被别的线程 pin 住修改的页可能写出半新半旧的内容，但修改方会重新置脏，下一轮再写。
+// 开启日志时不能写出未记录的改动，所以写出期间持有帧的共享 latch，拿不到就留到下一轮
+void BufferPool::cleanShard(size_t s, size_t target) {
+    std::lock_guard writeback(writeback_mtx);
+    Shard &shard = *shards[s];
+    std::vector<size_t> todo;
+    {
+        std::lock_guard lock(shard.mtx);
+        const size_t limit = std::min(target, std::max<size_t>(1, shard.count / 4));
+        if (shard.available.size() >= limit) {
+            return;
+        }
+        for (size_t pos : coldestUnpinned(shard, limit - shard.available.size())) {
+            if (shard.dirty.erase(pos) != 0) {
+                ++pin_count[pos];
+                todo.push_back(pos);
+            }
+        }
+    }
+    if (todo.empty()) {
+        return;
+    }
+
+    std::vector<size_t> latched;
+    std::vector<size_t> skipped;
+    if (wal) {
+        for (size_t pos : todo) {
+            (latches[pos].try_lock_shared() ? latched : skipped).push_back(pos);
+        }
+        todo = latched;
+    }
+    std::exception_ptr error;
+    try {
+        writeSorted(todo);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    for (size_t pos : latched) {
+        latches[pos].unlock_shared();
+    }
+
+    std::lock_guard lock(shard.mtx);
+    for (size_t pos : skipped) {
+        --pin_count[pos];
+        shard.dirty.insert(pos);
+    }
+    for (size_t pos : todo) {
+        --pin_count[pos];
+        if (error) {
+            shard.dirty.insert(pos);
         }
-        return pages[pos];
     }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
 
-    if (available.empty()) {
-        size_t pos = lru_list.back();
+// 取得一个空闲帧（必要时淘汰一页），帧已从 available 中移出
+size_t BufferPool::reserveFrameLocked(Shard &shard, AccessIntent intent) {
+    size_t ring_pos;
+    const bool recycle = intent == AccessIntent::SCAN && takeFromScanRing(shard, ring_pos);
+    if (recycle || shard.available.empty()) {
+        size_t pos = recycle ? ring_pos : chooseVictim(shard);
         PageId old_pid = pos_to_pid[pos];
-        if (!old_pid.file.empty()) {
-            if (isDirty(old_pid)) {
-                flushPage(old_pid);
+        if (old_pid.file != INVALID_FILE_ID) {
+            if (flusher && shard.dirty.contains(pos)) {
+                flusher->wake();   // 后台写回没跟上，缺页只好自己写
             }
-            discardPage(old_pid);
+            flushLocked(shard, old_pid);
+            discardLocked(shard, old_pid);
+            ++shard.evictions;
         }
     }
 
-    size_t pos = available.back();
-    available.pop_back();
+    size_t pos = shard.available.back();
+    shard.available.pop_back();
+    return pos;
+}
+
+size_t BufferPool::fetchLocked(Shard &shard, const PageId &pid, AccessIntent intent) {
+    auto it = shard.pid_to_pos.find(pid);
+    if (it != shard.pid_to_pos.end()) {
+        ++shard.hits;
+        if (intent == AccessIntent::NORMAL) {
+            // 被正常访问的扫描页转为普通页
+            if (!shard.scan_ring.empty()) {
+                leaveScanRing(shard, it->second);
+            }
+            touch(shard, it->second);
+        }
+        return it->second;
+    }
 
-    Page &page = pages[pos];
-    getDatabase().get(pid.file).readPage(page, pid.page);
+    ++shard.misses;
+    const size_t pos = reserveFrameLocked(shard, intent);
+    try {
+        getDatabase().get(pid.file).readPage(pages[pos], pid.page);
+    } catch (...) {
+        shard.available.push_back(pos);
+        throw;
+    }
 
-    pid_to_pos[pid] = pos;
+    shard.pid_to_pos[pid] = pos;
     pos_to_pid[pos] = pid;
 
-    lru_list.push_front(pos);
-    pos_to_lru[pos] = lru_list.begin();
+    admit(shard, pos, intent);
 
-    return page;
+    return pos;
 }
 
-void BufferPool::markDirty(const PageId &pid) {
-    auto it = pid_to_pos.find(pid);
-    if (it == pid_to_pos.end()) {
+void BufferPool::prefetch(const std::vector<PageId> &pids, AccessIntent intent) {
+    std::vector<std::vector<PageId>> by_shard(shards.size());
+    for (const PageId &pid : pids) {
+        by_shard[shards.size() == 1 ? 0 : std::hash<PageId>()(pid) % shards.size()].push_back(pid);
+    }
+
+    for (size_t s = 0; s < shards.size(); ++s) {
+        if (by_shard[s].empty()) {
+            continue;
+        }
+        Shard &shard = *shards[s];
+        std::lock_guard lock(shard.mtx);
+
+        const size_t limit = std::max<size_t>(1, shard.count / 2);
+        std::vector<PageId> todo;
+        std::vector<IoRequest> batch;
+        for (const PageId &pid : by_shard[s]) {
+            if (batch.size() >= limit) {
+                break;
+            }
+            if (shard.pid_to_pos.contains(pid) || std::find(todo.begin(), todo.end(), pid) != todo.end() ||
+                mapped(pid) != nullptr) {
+                continue;
+            }
+            size_t pos;
+            try {
+                pos = reserveFrameLocked(shard, intent);
+            } catch (const std::runtime_error &) {
+                break;   // 其余帧都被 pin 住了，能读多少读多少
+            }
+            todo.push_back(pid);
+            batch.push_back({IoOp::READ, &getDatabase().get(pid.file), pid.page, &pages[pos]});
+        }
+
+        try {
+            io.run(batch);
+        } catch (...) {
+            for (const IoRequest &req : batch) {
+                shard.available.push_back(static_cast<size_t>(req.buf - pages.get()));
+            }
+            throw;
+        }
+
+        for (size_t i = 0; i < todo.size(); ++i) {
+            const size_t pos = static_cast<size_t>(batch[i].buf - pages.get());
+            shard.pid_to_pos[todo[i]] = pos;
+            pos_to_pid[pos] = todo[i];
+            admit(shard, pos, intent);
+        }
+        shard.prefetched += todo.size();
+    }
+}
+
+void BufferPool::enableReadAhead(size_t max_window) {
+    read_ahead.reset();
+    size_t smallest = capacity;
+    for (const auto &shard : shards) {
+        smallest = std::min(smallest, shard->count);
+    }
+    scan_ring_pages = std::max(DEFAULT_SCAN_RING_PAGES, 2 * max_window);
+    const size_t ring = std::max<size_t>(1, std::min(scan_ring_pages, smallest / 4));
+    read_ahead = std::make_unique<ReadAhead>(*this, std::max<size_t>(1, std::min(max_window, ring / 2)));
+}
+
+void BufferPool::enableBackgroundFlush(size_t clean_frames, std::chrono::milliseconds interval) {
+    flusher.reset();
+    flusher = std::make_unique<BackgroundFlusher>(*this, clean_frames, interval);
+}
+
+void BufferPool::disableBackgroundFlush() { flusher.reset(); }
+
+void BufferPool::disableReadAhead() {
+    read_ahead.reset();
+    scan_ring_pages = DEFAULT_SCAN_RING_PAGES;
+}
+
+// 映射的文件交给内核预读：顺序游标每到一个窗口的起点提示一次，链式游标提示下一页
+void BufferPool::readAhead(const PageId &pid, size_t num_pages) {
+    if (mapped(pid) != nullptr) {
+        if (pid.page % DEFAULT_READ_AHEAD_PAGES == 0) {
+            getDatabase().get(pid.file).adviseWillNeed(pid.page, DEFAULT_READ_AHEAD_PAGES);
+        }
         return;
     }
-    size_t pos = it->second;
-    dirty.insert(pos);
+    if (read_ahead) {
+        read_ahead->onSequential(pid, num_pages);
+    }
+}
+
+void BufferPool::readAheadChain(const PageId &pid, NextPageFn next) {
+    if (const Page *page = mapped(pid)) {
+        const size_t next_page = next(*page);
+        if (next_page != static_cast<size_t>(-1)) {
+            getDatabase().get(pid.file).adviseWillNeed(next_page, 1);
+        }
+        return;
+    }
+    if (read_ahead) {
+        read_ahead->onChain(pid, next);
+    }
+}
+
+void BufferPool::drainReadAhead() {
+    if (read_ahead) {
+        read_ahead->drain();
+    }
+}
+
+bool BufferPool::usesIoUring() const { return io.usesIoUring(); }
+
+Page *BufferPool::mapped(const PageId &pid) {
+    const DbFile *file = getDatabase().find(pid.file);
+    return file == nullptr ? nullptr : const_cast<Page *>(file->mappedPage(pid.page));
+}
+
+Page &BufferPool::getPage(const PageId &pid, AccessIntent intent) {
+    if (Page *page = mapped(pid)) {
+        return *page;
+    }
+    if (versions && thread_versions.snapshot) {
+        PageGuard guard = pinPage(pid, intent);
+        if (guard.version) {
+            thread_versions.retained.push_back(guard.version);
+        }
+        return *guard;
+    }
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    return pages[fetchLocked(shard, pid, intent)];
+}
+
+size_t BufferPool::acquire(const PageId &pid, AccessIntent intent) {
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    const size_t pos = fetchLocked(shard, pid, intent);
+    ++pin_count[pos];
+    return pos;
+}
+
+PageGuard BufferPool::pinPage(const PageId &pid, AccessIntent intent, LatchMode latch) {
+    if (Page *page = mapped(pid)) {
+        if (latch == LatchMode::EXCLUSIVE) {
+            throw std::logic_error("BufferPool::pinPage: page of a read-only file cannot be latched exclusively");
+        }
+        return {pid, page};
+    }
+    // 快照读：先拿共享 latch 再查版本链，写者在排他 latch 下登记改动，两者不会错开
+    if (versions && thread_versions.snapshot && latch != LatchMode::EXCLUSIVE) {
+        PageGuard guard(*this, pid, intent, LatchMode::SHARED);
+        if (auto image = versions->lookup(pid, *thread_versions.snapshot)) {
+            return {pid, std::move(image)};
+        }
+        return guard;
+    }
+    return {*this, pid, intent, latch};
+}
+
+Page *BufferPool::pinResident(const PageId &pid) {
+    if (Page *page = mapped(pid)) {
+        return page;
+    }
+    std::lock_guard lock(resident_mtx);
+    if (resident.size() >= capacity / RESIDENT_FRACTION) {
+        return nullptr;
+    }
+    const size_t pos = acquire(pid, AccessIntent::NORMAL);
+    resident.push_back(pid);
+    return &pages[pos];
+}
+
+void BufferPool::releaseResident(file_id_t file) {
+    std::lock_guard lock(resident_mtx);
+    const auto released = std::partition(resident.begin(), resident.end(), [&](const PageId &pid) {
+        return file != INVALID_FILE_ID && pid.file != file;
+    });
+    if (released == resident.end()) {
+        return;
+    }
+    for (auto it = released; it != resident.end(); ++it) {
+        unpin(*it);
+    }
+    resident.erase(released, resident.end());
+    resident_epoch.fetch_add(1, std::memory_order_acq_rel);
+}
+
+PageGuard BufferPool::latchResident(const PageId &pid, Page *frame) {
+    const Page *first = pages.get();
+    if (std::less<>()(frame, first) || !std::less<>()(frame, first + capacity)) {
+        return {pid, frame};   // 只读映射中的页
+    }
+    PageGuard guard;
+    guard.pool = this;
+    guard.pid = pid;
+    guard.page = frame;
+    guard.pos = static_cast<size_t>(frame - first);
+    guard.pinned = false;
+    latches[guard.pos].lock_shared();
+    guard.latch = LatchMode::SHARED;
+    return guard;
+}
+
+void BufferPool::pin(const PageId &pid) {
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    auto it = shard.pid_to_pos.find(pid);
+    if (it == shard.pid_to_pos.end()) {
+        throw std::logic_error("BufferPool::pin: page not in buffer pool");
+    }
+    ++pin_count[it->second];
+}
+
+void BufferPool::unpin(const PageId &pid) {
+    // 本线程推迟的记录要在放掉 pin 之前记下，否则帧一直被 hold 住、不能写回
+    if (wal) {
+        const auto &pending = thread_log.pending;
+        auto p = std::find_if(pending.begin(), pending.end(), [&](const auto &e) { return e.first == pid; });
+        if (p != pending.end()) {
+            logFrame(p->second, pid);
+        }
+    }
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    auto it = shard.pid_to_pos.find(pid);
+    if (it == shard.pid_to_pos.end()) {
+        return;
+    }
+    size_t &count = pin_count[it->second];
+    if (count > 0) {
+        --count;
+    }
+}
+
+bool BufferPool::isPinned(const PageId &pid) const {
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    auto it = shard.pid_to_pos.find(pid);
+    return it != shard.pid_to_pos.end() && pin_count[it->second] > 0;
+}
+
+void BufferPool::markDirty(const PageId &pid) {
+    setDirty(pid, false);
+}
+
+// 开启日志时，defer 的调用方（PageGuard::markDirty）在本线程 pin 着该页、改动尚未完成，记录推迟到它的 guard
+// 释放（或 unpin）时；其余调用方的改动已经完成，立即记录
+void BufferPool::setDirty(const PageId &pid, bool defer) {
+    Shard &shard = shardOf(pid);
+    size_t pos;
+    {
+        std::lock_guard lock(shard.mtx);
+        auto it = shard.pid_to_pos.find(pid);
+        if (it == shard.pid_to_pos.end()) {
+            return;
+        }
+        pos = it->second;
+        shard.dirty.insert(pos);
+        if (versions) {
+            noteModified(pos, pid);
+        }
+        if (!wal) {
+            return;
+        }
+        // 此后追加的记录都不早于当前日志尾
+        if (rec_lsn[pos] == NO_LSN) {
+            rec_lsn[pos] = wal->appendedLsn();
+        }
+        // 本线程已推迟的记录会在 guard 释放时记下之后的全部改动
+        auto &pending = thread_log.pending;
+        if (std::find(pending.begin(), pending.end(), std::pair{pid, pos}) != pending.end()) {
+            return;
+        }
+        ++hold[pos];
+        if (defer && pin_count[pos] > 0) {
+            pending.emplace_back(pid, pos);
+            return;
+        }
+    }
+    logFrame(pos, pid);
 }
 
 bool BufferPool::isDirty(const PageId &pid) const {
-    auto it = pid_to_pos.find(pid);
-    if (it == pid_to_pos.end()) {
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    auto it = shard.pid_to_pos.find(pid);
+    if (it == shard.pid_to_pos.end()) {
         return false;
     }
     size_t pos = it->second;
-    return dirty.contains(pos);
+    return shard.dirty.contains(pos);
+}
+
+PageFetch BufferPool::getPageAsync(const PageId &pid, AccessIntent intent, LatchMode latch) {
+    return {*this, pid, intent, latch};
+}
+
+bool BufferPool::isCached(const PageId &pid) const { return mapped(pid) != nullptr || contains(pid); }
+
+// 没有调度器时同步读；挂起期间页可能又被换出，醒来时 pinPage 照常补读
+bool PageFetch::await_ready() const { return IoScheduler::current() == nullptr || pool.isCached(pid); }
+
+void PageFetch::await_suspend(std::coroutine_handle<> handle) const {
+    IoScheduler::current()->wait(pid, intent, handle);
 }
 
+PageGuard PageFetch::await_resume() const { return pool.pinPage(pid, intent, latch); }
+
 bool BufferPool::contains(const PageId &pid) const {
-    return pid_to_pos.contains(pid);
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    return shard.pid_to_pos.contains(pid);
 }
 
-void BufferPool::discardPage(const PageId &pid) {
-    auto it = pid_to_pos.find(pid);
-    if (it == pid_to_pos.end()) {
+void BufferPool::discardLocked(Shard &shard, const PageId &pid) {
+    auto it = shard.pid_to_pos.find(pid);
+    if (it == shard.pid_to_pos.end()) {
         return;
     }
     size_t pos = it->second;
-    pid_to_pos.erase(it);
+    if (pin_count[pos] > 0) {
+        throw std::logic_error("BufferPool::discardPage: page is pinned");
+    }
+    if (hold[pos] > 0) {
+        throw std::logic_error("BufferPool::discardPage: change of the page is not logged yet");
+    }
+    shard.pid_to_pos.erase(it);
 
     pos_to_pid[pos] = PageId{};
 
-    auto lit = pos_to_lru.find(pos);
-    if (lit != pos_to_lru.end()) {
-        lru_list.erase(lit->second);
-        pos_to_lru.erase(lit);
+    auto lit = shard.pos_to_lru.find(pos);
+    if (lit != shard.pos_to_lru.end()) {
+        shard.lru_list.erase(lit->second);
+        shard.pos_to_lru.erase(lit);
     }
 
-    dirty.erase(pos);
-    available.push_back(pos);
+    if (!shard.scan_ring.empty()) {
+        leaveScanRing(shard, pos);
+    }
+    ref_bit[pos] = 0;
+    shard.dirty.erase(pos);
+    page_lsn[pos] = 0;
+    need_image[pos] = 1;
+    rec_lsn[pos] = NO_LSN;
+    logged[pos].reset();
+    before[pos].reset();
+    shard.available.push_back(pos);
 }
 
-void BufferPool::flushPage(const PageId &pid) {
-    auto it = pid_to_pos.find(pid);
-    if (it == pid_to_pos.end()) {
+void BufferPool::discardPage(const PageId &pid) {
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    discardLocked(shard, pid);
+}
+
+void BufferPool::flushLocked(Shard &shard, const PageId &pid) {
+    auto it = shard.pid_to_pos.find(pid);
+    if (it == shard.pid_to_pos.end()) {
         return;
     }
     size_t pos = it->second;
-    if (dirty.erase(pos) == 0) {
+    if (hold[pos] > 0 || shard.dirty.erase(pos) == 0) {
         return;
     }
+    logBeforeWrite({pos});
     const Page &page = pages[pos];
     getDatabase().get(pid.file).writePage(page, pid.page);
+    noteWritten({pos});
+}
+
+void BufferPool::flushPage(const PageId &pid) {
+    std::lock_guard writeback(writeback_mtx);
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    flushLocked(shard, pid);
+}
+
+void BufferPool::flushFile(file_id_t file) {
+    std::lock_guard writeback(writeback_mtx);
+    for (auto &shard : shards) {
+        std::lock_guard lock(shard->mtx);
+        std::vector<size_t> to_flush;
+        to_flush.reserve(shard->dirty.size());
+        for (size_t pos : shard->dirty) {
+            if (pos_to_pid[pos].file == file) {
+                to_flush.push_back(pos);
+            }
+        }
+        flushBatchLocked(*shard, to_flush);
+    }
 }
 
 void BufferPool::flushFile(const std::string &file) {
-    std::vector<PageId> to_flush;
-    to_flush.reserve(dirty.size());
-    for (size_t pos : dirty) {
-        const PageId &pid = pos_to_pid[pos];
-        if (pid.file == file) {
-            to_flush.push_back(pid);
+    flushFile(getDatabase().get(file).getFileId());
+}
+
+PageGuard::PageGuard(BufferPool &pool, const PageId &pid, AccessIntent intent, LatchMode latch)
+    : pool(&pool), pid(pid), latch(latch) {
+    if (latch == LatchMode::EXCLUSIVE && pool.versions && thread_versions.snapshot) {
+        throw std::logic_error("PageGuard: a Snapshot is read-only");
+    }
+    pos = pool.acquire(pid, intent);
+    page = &pool.pages[pos];
+    // 帧 latch 在分片锁之外获取，等待内容锁时不会阻塞同分片的其它查找
+    if (latch == LatchMode::SHARED) {
+        pool.latches[pos].lock_shared();
+    } else if (latch == LatchMode::EXCLUSIVE) {
+        pool.latches[pos].lock();
+        if (pool.versions) {
+            pool.captureBefore(pos);
         }
     }
-    for (const auto &pid : to_flush) {
-        flushPage(pid);
+}
+
+PageGuard::~PageGuard() { release(); }
+
+PageGuard::PageGuard(PageGuard &&other) noexcept
+    : pool(other.pool), pid(other.pid), page(other.page), pos(other.pos), latch(other.latch), pinned(other.pinned),
+      version(std::move(other.version)) {
+    other.pool = nullptr;
+    other.page = nullptr;
+    other.latch = LatchMode::NONE;
+}
+
+PageGuard &PageGuard::operator=(PageGuard &&other) noexcept {
+    if (this != &other) {
+        release();
+        pool = other.pool;
+        pid = other.pid;
+        page = other.page;
+        pos = other.pos;
+        latch = other.latch;
+        pinned = other.pinned;
+        version = std::move(other.version);
+        other.pool = nullptr;
+        other.page = nullptr;
+        other.latch = LatchMode::NONE;
+    }
+    return *this;
+}
+
+std::shared_lock<std::shared_mutex> PageGuard::readLatch() const {
+    if (latch != LatchMode::NONE) {
+        throw std::logic_error("PageGuard::readLatch: the guard already holds a latch");
+    }
+    if (pool == nullptr) {
+        return {};
     }
+    return std::shared_lock(pool->latches[pos]);
+}
+
+void PageGuard::markDirty() const {
+    if (pool != nullptr) {
+        pool->setDirty(pid, true);
+    }
+}
+
+void PageGuard::release() {
+    if (pool != nullptr) {
+        if (pool->wal) {
+            pool->logIfPending(pos, pid);
+        }
+        if (latch == LatchMode::SHARED) {
+            pool->latches[pos].unlock_shared();
+        } else if (latch == LatchMode::EXCLUSIVE) {
+            pool->latches[pos].unlock();
+        }
+        if (pinned) {
+            pool->unpin(pid);
+        }
+        pool = nullptr;
+        latch = LatchMode::NONE;
+        pinned = true;
+    }
+    page = nullptr;
+    version.reset();
+}
+
+// ---------------- 预写日志 ----------------
+
+// 调用方持有该帧的 pin（或帧已被 hold 住），帧内容此刻不会被写回或挪走
+void BufferPool::logFrame(size_t pos, const PageId &pid) {
+    ThreadLog &tl = thread_log;
+    std::erase(tl.pending, std::pair{pid, pos});
+
+    std::vector<uint8_t> single;
+    std::vector<uint8_t> &records = tl.depth > 0 ? tl.records : single;
+    std::unique_ptr<Page> &before = logged[pos];
+    const bool image = need_image[pos].exchange(0) != 0 || !before;
+    LogManager::encode(records, getDatabase().get(pid.file).getName(), pid.page, pages[pos],
+                       image ? nullptr : before.get());
+    if (!before) {
+        before = std::make_unique<Page>();
+    }
+    *before = pages[pos];
+
+    if (tl.depth == 0) {
+        unhold(pos, pid, wal->append(single));
+        return;
+    }
+    // 组内同一帧只保留一次 hold
+    if (std::find(tl.held.begin(), tl.held.end(), std::pair{pid, pos}) != tl.held.end()) {
+        Shard &shard = shardOf(pid);
+        std::lock_guard lock(shard.mtx);
+        --hold[pos];
+    } else {
+        tl.held.emplace_back(pid, pos);
+    }
+}
+
+void BufferPool::logIfPending(size_t pos, const PageId &pid) {
+    const auto &pending = thread_log.pending;
+    if (std::find(pending.begin(), pending.end(), std::pair{pid, pos}) != pending.end()) {
+        logFrame(pos, pid);
+    }
+}
+
+void BufferPool::unhold(size_t pos, const PageId &pid, lsn_t lsn) {
+    page_lsn[pos] = std::max(page_lsn[pos].load(), lsn);
+    Shard &shard = shardOf(pid);
+    std::lock_guard lock(shard.mtx);
+    --hold[pos];
 }
+
+void BufferPool::beginGroup() {
+    if (versions) {
+        ++thread_versions.depth;
+    }
+    if (wal) {
+        ++thread_log.depth;
+    }
+}
+
+void BufferPool::endGroup() {
+    ThreadVersions &tv = thread_versions;
+    if (tv.depth > 0 && --tv.depth == 0 && tv.op != 0) {
+        commitVersions();
+    }
+    ThreadLog &tl = thread_log;
+    if (tl.depth == 0 || --tl.depth > 0) {
+        return;
+    }
+    // 组内直接置脏、仍被 pin 着的页也算在本组里
+    ++tl.depth;
+    while (!tl.pending.empty()) {
+        const auto [pid, pos] = tl.pending.back();
+        logFrame(pos, pid);
+    }
+    --tl.depth;
+    const lsn_t lsn = tl.records.empty() ? 0 : wal->append(tl.records);
+    for (const auto &[pid, pos] : tl.held) {
+        unhold(pos, pid, lsn);
+    }
+    tl.records.clear();
+    tl.held.clear();
+}
+
+void BufferPool::logBeforeWrite(const std::vector<size_t> &positions) {
+    if (!wal) {
+        return;
+    }
+    lsn_t lsn = 0;
+    for (size_t pos : positions) {
+        lsn = std::max(lsn, page_lsn[pos].load());
+    }
+    wal->flush(lsn);
+}
+
+void BufferPool::noteWritten(const std::vector<size_t> &positions) {
+    flushes.fetch_add(positions.size(), std::memory_order_relaxed);
+    if (!wal) {
+        return;
+    }
+    std::lock_guard lock(unsynced_mtx);
+    for (size_t pos : positions) {
+        need_image[pos] = 1;
+        rec_lsn[pos] = NO_LSN;
+        unsynced.insert(pos_to_pid[pos].file);
+    }
+}
+
+// 重放：改动按页散列分给各线程，线程内各页先读进内存、按日志顺序应用，最后整页写回；全部结束后同步
+void BufferPool::enableLog(const std::string &path, size_t redo_threads) {
+    disableLog();
+    releaseResident();
+    for (size_t pos = 0; pos < capacity; ++pos) {
+        page_lsn[pos] = 0;   // 新日志的 LSN 从 0 开始
+        rec_lsn[pos] = NO_LSN;
+    }
+    const RedoLog log = LogManager::read(path);
+
+    std::vector<DbFile *> files(log.files.size(), nullptr);
+    for (size_t i = 0; i < files.size(); ++i) {
+        try {
+            DbFile &file = getDatabase().get(log.files[i]);
+            if (!file.isReadOnly()) {
+                files[i] = &file;
+            }
+        } catch (const std::logic_error &) {
+            // 文件已不在库中：跳过它的记录
+        }
+    }
+
+    if (redo_threads == 0) {
+        redo_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    redo_threads = std::max<size_t>(1, std::min(redo_threads, log.changes.size()));
+    std::vector<std::vector<const RedoLog::Change *>> parts(redo_threads);
+    for (const RedoLog::Change &c : log.changes) {
+        if (files[c.file] != nullptr) {
+            const PageId pid{files[c.file]->getFileId(), c.page};
+            parts[std::hash<PageId>{}(pid) % redo_threads].push_back(&c);
+        }
+    }
+
+    // 各线程只碰自己分到的页，互不相干；文件页数在汇总后统一更新
+    std::vector<std::unordered_map<file_id_t, size_t>> extents(redo_threads);
+    std::vector<std::exception_ptr> errors(redo_threads);
+    auto redo = [&](size_t t) {
+        try {
+            std::unordered_map<PageId, Page> pages_of;
+            for (const RedoLog::Change *c : parts[t]) {
+                DbFile &file = *files[c->file];
+                const PageId pid{file.getFileId(), c->page};
+                auto [it, fresh] = pages_of.try_emplace(pid);
+                if (fresh) {
+                    file.readPage(it->second, pid.page);
+                }
+                std::memcpy(it->second.data() + c->offset, c->bytes, c->length);
+            }
+            for (const auto &[pid, page] : pages_of) {
+                discardPage(pid);
+                getDatabase().get(pid.file).writePage(page, pid.page);
+                size_t &extent = extents[t][pid.file];
+                extent = std::max(extent, pid.page + 1);
+            }
+        } catch (...) {
+            errors[t] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < redo_threads; ++t) {
+        workers.emplace_back(redo, t);
+    }
+    redo(0);
+    for (std::thread &w : workers) {
+        w.join();
+    }
+    for (const std::exception_ptr &e : errors) {
+        if (e) std::rethrow_exception(e);
+    }
+
+    std::unordered_map<file_id_t, size_t> touched;
+    for (const auto &part : extents) {
+        for (const auto &[id, extent] : part) {
+            touched[id] = std::max(touched[id], extent);
+        }
+    }
+    for (const auto &[id, extent] : touched) {
+        DbFile &file = getDatabase().get(id);
+        file.numPages.store(std::max(file.numPages.load(), extent), std::memory_order_release);
+        file.sync();
+    }
+    wal = std::make_unique<LogManager>(path);
+}
+
+void BufferPool::disableLog() { wal.reset(); }
+
+bool BufferPool::isLogEnabled() const { return wal != nullptr; }
+
+LogManager *BufferPool::getLog() const { return wal.get(); }
+
+void BufferPool::commit() {
+    if (wal) {
+        wal->flush(wal->appendedLsn());
+    }
+}
+
+// 先取脏页表再交换待同步的文件：取表之后才写回的页仍在表里，取表之前写回的页由这次同步落盘
+void BufferPool::checkpoint(bool write_pages) {
+    if (!wal) {
+        throw std::logic_error("BufferPool::checkpoint: log is not enabled");
+    }
+    std::lock_guard writeback(writeback_mtx);
+    if (write_pages) {
+        for (auto &shard : shards) {
+            std::lock_guard lock(shard->mtx);
+            std::vector<size_t> to_flush(shard->dirty.begin(), shard->dirty.end());
+            flushBatchLocked(*shard, to_flush);
+        }
+    }
+
+    const lsn_t begin = wal->appendedLsn();
+    std::vector<std::pair<PageId, lsn_t>> table;
+    for (auto &shard : shards) {
+        std::lock_guard lock(shard->mtx);
+        for (size_t pos = shard->first; pos < shard->first + shard->count; ++pos) {
+            const lsn_t rec = rec_lsn[pos];
+            if (rec != NO_LSN) {
+                table.emplace_back(pos_to_pid[pos], rec);
+            }
+        }
+    }
+    std::unordered_set<file_id_t> files;
+    {
+        std::lock_guard lock(unsynced_mtx);
+        files.swap(unsynced);
+    }
+    for (file_id_t id : files) {
+        if (const DbFile *file = getDatabase().find(id)) {
+            file->sync();
+        }
+    }
+
+    std::vector<DirtyPage> dirty;
+    dirty.reserve(table.size());
+    for (const auto &[pid, rec] : table) {
+        if (const DbFile *file = getDatabase().find(pid.file)) {
+            dirty.push_back({file->getName(), pid.page, rec});
+        }
+    }
+    wal->checkpoint(begin, dirty);
+}
+
+LogGroup::LogGroup(BufferPool &pool) : pool(pool) { pool.beginGroup(); }
+
+LogGroup::~LogGroup() { pool.endGroup(); }
+
+// ---------------- 多版本 ----------------
+
+// 调用方持有帧的排他 latch；帧内容自上次拷贝后没改过（改动都经过 markDirty，会交走副本）就不必再拷
+void BufferPool::captureBefore(size_t pos) {
+    if (!before[pos]) {
+        before[pos] = std::make_shared<const Page>(pages[pos]);
+    }
+}
+
+// 调用方持有分片锁；副本交给版本链后帧内容即将不同于它
+void BufferPool::noteModified(size_t pos, const PageId &pid) {
+    ThreadVersions &tv = thread_versions;
+    if (tv.op == 0) {
+        tv.op = versions->begin();
+    }
+    versions->modified(pid, tv.op, std::move(before[pos]));
+    if (std::find(tv.touched.begin(), tv.touched.end(), pid) == tv.touched.end()) {
+        tv.touched.push_back(pid);
+    }
+    if (tv.depth == 0) {
+        commitVersions();
+    }
+}
+
+void BufferPool::commitVersions() {
+    ThreadVersions &tv = thread_versions;
+    versions->commit(tv.op, tv.touched);
+    tv.op = 0;
+    tv.touched.clear();
+}
+
+void BufferPool::openSnapshot() {
+    if (!versions) {
+        throw std::logic_error("Snapshot: versioning is not enabled");
+    }
+    ThreadVersions &tv = thread_versions;
+    if (tv.snapshot != nullptr) {
+        throw std::logic_error("Snapshot: the thread already holds a snapshot");
+    }
+    tv.snapshot = versions->open();
+}
+
+void BufferPool::closeSnapshot() {
+    ThreadVersions &tv = thread_versions;
+    if (versions && tv.snapshot != nullptr) {
+        versions->close(tv.snapshot);
+    }
+    tv.snapshot = nullptr;
+    tv.retained.clear();
+}
+
+void BufferPool::enableVersioning() {
+    if (!versions) {
+        versions = std::make_unique<VersionStore>();
+    }
+}
+
+void BufferPool::disableVersioning() {
+    if (thread_versions.snapshot != nullptr) {
+        throw std::logic_error("BufferPool::disableVersioning: a Snapshot is open");
+    }
+    versions.reset();
+    before.assign(capacity, nullptr);
+}
+
+bool BufferPool::isVersioningEnabled() const { return versions != nullptr; }
+
+VersionStore *BufferPool::getVersions() const { return versions.get(); }
+
+Snapshot::Snapshot(BufferPool &pool) : pool(pool) { pool.openSnapshot(); }
+
+Snapshot::~Snapshot() { pool.closeSnapshot(); }
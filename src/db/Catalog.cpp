@@ -0,0 +1,426 @@
+#include <db/BTreeFile.hpp>
+#include <db/Catalog.hpp>
+#include <db/HashFile.hpp>
+#include <db/HeapFile.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+constexpr uint64_t CATALOG_MAGIC = 0x474F4C4154414344ULL;   // "DCATALOG"
+
+constexpr size_t HEADER = 2 * sizeof(uint64_t);
+
+template <typename T>
+void put_int(std::vector<uint8_t> &out, T v) {
+    const size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &v, sizeof(T));
+}
+
+void put_string(std::vector<uint8_t> &out, const std::string &s) {
+    if (s.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::logic_error("Catalog: name too long: " + s.substr(0, 64));
+    }
+    put_int<uint16_t>(out, static_cast<uint16_t>(s.size()));
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+// 越界或取值不合法说明文件已损坏
+struct Reader {
+    const uint8_t *p;
+    const uint8_t *end;
+
+    void need(size_t n) const {
+        if (static_cast<size_t>(end - p) < n) {
+            throw std::runtime_error("Catalog: corrupt record");
+        }
+    }
+
+    template <typename T>
+    T get() {
+        need(sizeof(T));
+        T v;
+        std::memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+
+    // 枚举按 u8 存放，不超过 last
+    template <typename E>
+    E get_enum(E last) {
+        const auto v = get<uint8_t>();
+        if (v > static_cast<uint8_t>(last)) {
+            throw std::runtime_error("Catalog: corrupt record");
+        }
+        return static_cast<E>(v);
+    }
+
+    std::string_view string() {
+        const size_t n = get<uint16_t>();
+        need(n);
+        const std::string_view s(reinterpret_cast<const char *>(p), n);
+        p += n;
+        return s;
+    }
+
+    field_t field() {
+        switch (get<uint8_t>()) {
+            case 0: return get<int32_t>();
+            case 1: return get<double>();
+            case 2: return std::string(string());
+            default: throw std::runtime_error("Catalog: corrupt record");
+        }
+    }
+
+    TableStats stats() {
+        TableStats s;
+        s.rows = get<uint64_t>();
+        s.sampled_rows = get<uint64_t>();
+        const auto flags = get<uint8_t>();
+        s.complete = (flags & 1) != 0;
+        s.rows_exact = (flags & 2) != 0;
+        s.columns.resize(get<uint16_t>());
+        for (ColumnStats &c : s.columns) {
+            c.distinct = get<uint64_t>();
+            const size_t n = get<uint16_t>();
+            for (size_t i = 0; i < n; ++i) {
+                c.bounds.push_back(field());
+            }
+        }
+        return s;
+    }
+};
+
+// 直方图边界：u8 类型下标，再按类型存 i32、f64 或 (u16 长度, 字节)
+void put_field(std::vector<uint8_t> &out, const field_t &v) {
+    put_int<uint8_t>(out, static_cast<uint8_t>(v.index()));
+    if (const int *i = std::get_if<int>(&v)) {
+        put_int<int32_t>(out, *i);
+    } else if (const double *d = std::get_if<double>(&v)) {
+        put_int<double>(out, *d);
+    } else {
+        put_string(out, std::get<std::string>(v));
+    }
+}
+
+void put_stats(std::vector<uint8_t> &out, const TableStats &stats) {
+    if (stats.columns.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::logic_error("Catalog: too many columns in statistics");
+    }
+    put_int<uint64_t>(out, stats.rows);
+    put_int<uint64_t>(out, stats.sampled_rows);
+    put_int<uint8_t>(out, (stats.complete ? 1 : 0) | (stats.rows_exact ? 2 : 0));
+    put_int<uint16_t>(out, static_cast<uint16_t>(stats.columns.size()));
+    for (const ColumnStats &c : stats.columns) {
+        if (c.bounds.size() > std::numeric_limits<uint16_t>::max()) {
+            throw std::logic_error("Catalog: too many histogram buckets");
+        }
+        put_int<uint64_t>(out, c.distinct);
+        put_int<uint16_t>(out, static_cast<uint16_t>(c.bounds.size()));
+        for (const field_t &v : c.bounds) {
+            put_field(out, v);
+        }
+    }
+}
+
+// 记录：名字，kind/buffered/layout/compression/access 各一字节，u64 页数，
+// u16 字段数及各字段的 (u8 类型, 名字)，u16 key 字段数及各 u32 下标，
+// 然后 u8 是否有统计信息，有则为 u64 行数、u64 抽样行数、u8 标志（完整、行数精确）、u16 列数及各列的
+// (u64 不同值数, u16 边界数, 边界)。没有统计信息这部分的旧记录到 key 下标为止
+void encode(std::vector<uint8_t> &out, const CatalogEntry &e) {
+    if (e.types.size() != e.field_names.size() || e.types.size() > std::numeric_limits<uint16_t>::max() ||
+        e.key_fields.size() > std::numeric_limits<uint16_t>::max()) {
+        throw std::logic_error("Catalog: invalid schema for " + e.name);
+    }
+    put_string(out, e.name);
+    put_int<uint8_t>(out, static_cast<uint8_t>(e.kind));
+    put_int<uint8_t>(out, e.buffered ? 1 : 0);
+    put_int<uint8_t>(out, static_cast<uint8_t>(e.layout));
+    put_int<uint8_t>(out, static_cast<uint8_t>(e.compression));
+    put_int<uint8_t>(out, static_cast<uint8_t>(e.access));
+    put_int<uint64_t>(out, e.num_pages);
+    put_int<uint16_t>(out, static_cast<uint16_t>(e.types.size()));
+    for (size_t i = 0; i < e.types.size(); ++i) {
+        put_int<uint8_t>(out, static_cast<uint8_t>(e.types[i]));
+        put_string(out, e.field_names[i]);
+    }
+    put_int<uint16_t>(out, static_cast<uint16_t>(e.key_fields.size()));
+    for (const size_t f : e.key_fields) {
+        put_int<uint32_t>(out, static_cast<uint32_t>(f));
+    }
+    put_int<uint8_t>(out, e.stats ? 1 : 0);
+    if (e.stats) {
+        put_stats(out, *e.stats);
+    }
+}
+
+CatalogEntry decode(Reader r) {
+    CatalogEntry e;
+    e.name = r.string();
+    e.kind = r.get_enum(FileKind::HASH);
+    e.buffered = r.get<uint8_t>() != 0;
+    e.layout = r.get_enum(PageLayout::PAX);
+    e.compression = r.get_enum(PageCompression::LZ);
+    e.access = r.get_enum(FileAccess::MMAP_READ_ONLY);
+    e.num_pages = r.get<uint64_t>();
+    const size_t fields = r.get<uint16_t>();
+    for (size_t i = 0; i < fields; ++i) {
+        e.types.push_back(r.get_enum(type_t::VARCHAR));
+        e.field_names.emplace_back(r.string());
+    }
+    const size_t keys = r.get<uint16_t>();
+    for (size_t i = 0; i < keys; ++i) {
+        e.key_fields.push_back(r.get<uint32_t>());
+    }
+    if (r.p != r.end && r.get<uint8_t>() != 0) {
+        e.stats = r.stats();
+    }
+    return e;
+}
+
+template <typename K>
+std::unique_ptr<DbFile> open_btree(const CatalogEntry &e) {
+    KeyFields<K> fields;
+    std::copy(e.key_fields.begin(), e.key_fields.end(), fields.begin());
+    return std::make_unique<BasicBTreeFile<K>>(e.name, e.tupleDesc(), fields, e.compression, e.access);
+}
+
+void write_all(int fd, const uint8_t *data, size_t n, const std::string &path) {
+    size_t done = 0;
+    while (done < n) {
+        const ssize_t w = pwrite(fd, data + done, n - done, static_cast<off_t>(done));
+        if (w == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Catalog: pwrite failed for " + path + ": " + std::strerror(errno));
+        }
+        done += static_cast<size_t>(w);
+    }
+}
+} // namespace
+
+TupleDesc CatalogEntry::tupleDesc() const { return {types, field_names}; }
+
+std::unique_ptr<DbFile> CatalogEntry::open() const {
+    if (kind == FileKind::HEAP) {
+        return std::make_unique<HeapFile>(name, tupleDesc(), buffered, layout, compression, access);
+    }
+    for (const size_t f : key_fields) {
+        if (f >= types.size()) {
+            throw std::logic_error("CatalogEntry::open: key field out of range for " + name);
+        }
+    }
+    if (kind == FileKind::HASH) {
+        if (key_fields.size() != 1) {
+            throw std::logic_error("CatalogEntry::open: a hash file needs exactly one key field: " + name);
+        }
+        return std::make_unique<HashFile>(name, tupleDesc(), key_fields[0], compression, access);
+    }
+    if (key_fields.size() == 1) {
+        switch (types[key_fields[0]]) {
+            case type_t::INT: return open_btree<int32_t>(*this);
+            case type_t::DOUBLE: return open_btree<double>(*this);
+            case type_t::CHAR: return open_btree<CharKey>(*this);
+            case type_t::VARCHAR: break;
+        }
+    } else if (key_fields.size() == 2 && types[key_fields[0]] == type_t::INT && types[key_fields[1]] == type_t::INT) {
+        return open_btree<IntPairKey>(*this);
+    }
+    throw std::logic_error("CatalogEntry::open: no B-tree key type for the key fields of " + name);
+}
+
+Catalog::Catalog(const std::string &path) : path(path) { mapFile(); }
+
+Catalog::~Catalog() { unmapFile(); }
+
+// 只校验文件头和偏移表的长度；记录在读到时才检查
+void Catalog::mapFile() {
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw std::runtime_error("Catalog: cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == -1) {
+        const int err = errno;
+        unmapFile();
+        throw std::runtime_error("Catalog: fstat failed for " + path + ": " + std::strerror(err));
+    }
+    map_size = static_cast<size_t>(st.st_size);
+    if (map_size < HEADER) {
+        unmapFile();
+        throw std::runtime_error("Catalog: " + path + " is not a catalog");
+    }
+    void *m = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        const int err = errno;
+        unmapFile();
+        throw std::runtime_error("Catalog: mmap failed for " + path + ": " + std::strerror(err));
+    }
+    map = static_cast<const uint8_t *>(m);
+    uint64_t magic;
+    uint64_t n;
+    std::memcpy(&magic, map, sizeof(magic));
+    std::memcpy(&n, map + sizeof(magic), sizeof(n));
+    if (magic != CATALOG_MAGIC || n > (map_size - HEADER) / sizeof(uint64_t)) {
+        unmapFile();
+        throw std::runtime_error("Catalog: " + path + " is not a catalog");
+    }
+    count = static_cast<size_t>(n);
+}
+
+void Catalog::unmapFile() {
+    if (map != nullptr) {
+        munmap(const_cast<uint8_t *>(map), map_size);
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    fd = -1;
+    map = nullptr;
+    map_size = 0;
+    count = 0;
+}
+
+std::string_view Catalog::nameAt(size_t i) const {
+    uint64_t offset;
+    std::memcpy(&offset, map + HEADER + i * sizeof(uint64_t), sizeof(offset));
+    if (offset > map_size) {
+        throw std::runtime_error("Catalog: corrupt record");
+    }
+    return Reader{map + offset, map + map_size}.string();
+}
+
+CatalogEntry Catalog::entryAt(size_t i) const {
+    uint64_t offset;
+    std::memcpy(&offset, map + HEADER + i * sizeof(uint64_t), sizeof(offset));
+    if (offset > map_size) {
+        throw std::runtime_error("Catalog: corrupt record");
+    }
+    // 记录到下一条记录（或文件尾）为止，旧格式的记录据此知道后面没有统计信息
+    uint64_t next = map_size;
+    if (i + 1 < count) {
+        std::memcpy(&next, map + HEADER + (i + 1) * sizeof(uint64_t), sizeof(next));
+    }
+    if (next < offset || next > map_size) {
+        throw std::runtime_error("Catalog: corrupt record");
+    }
+    return decode(Reader{map + offset, map + next});
+}
+
+std::optional<size_t> Catalog::search(std::string_view name) const {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        const std::string_view s = nameAt(mid);
+        if (s == name) {
+            return mid;
+        }
+        if (s < name) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<CatalogEntry> Catalog::find(const std::string &name) const {
+    if (auto it = changes.find(name); it != changes.end()) {
+        return it->second;
+    }
+    if (auto i = search(name)) {
+        return entryAt(*i);
+    }
+    return std::nullopt;
+}
+
+void Catalog::put(const CatalogEntry &entry) { changes.insert_or_assign(entry.name, entry); }
+
+void Catalog::erase(const std::string &name) { changes.insert_or_assign(name, std::nullopt); }
+
+size_t Catalog::size() const {
+    size_t n = count;
+    for (const auto &[name, entry] : changes) {
+        const bool saved = search(name).has_value();
+        if (entry && !saved) {
+            ++n;
+        } else if (!entry && saved) {
+            --n;
+        }
+    }
+    return n;
+}
+
+// 文件里的条目与改动都按名字有序，归并一遍即得新的有序目录
+void Catalog::save() {
+    std::vector<uint8_t> records;
+    std::vector<uint64_t> offsets;
+    const auto emit = [&](const CatalogEntry &e) {
+        offsets.push_back(records.size());
+        encode(records, e);
+    };
+    auto it = changes.begin();
+    for (size_t i = 0; i < count; ++i) {
+        const std::string_view name = nameAt(i);
+        for (; it != changes.end() && std::string_view(it->first) < name; ++it) {
+            if (it->second) emit(*it->second);
+        }
+        if (it != changes.end() && it->first == name) {
+            if (it->second) emit(*it->second);
+            ++it;
+            continue;
+        }
+        emit(entryAt(i));
+    }
+    for (; it != changes.end(); ++it) {
+        if (it->second) emit(*it->second);
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(HEADER + offsets.size() * sizeof(uint64_t) + records.size());
+    put_int<uint64_t>(out, CATALOG_MAGIC);
+    put_int<uint64_t>(out, offsets.size());
+    const uint64_t base = HEADER + offsets.size() * sizeof(uint64_t);
+    for (const uint64_t off : offsets) {
+        put_int<uint64_t>(out, base + off);
+    }
+    out.insert(out.end(), records.begin(), records.end());
+
+    // 写临时文件、同步后改名，崩溃时要么是旧目录要么是新的
+    const std::string tmp = path + ".tmp";
+    const int out_fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd == -1) {
+        throw std::runtime_error("Catalog: cannot open " + tmp + ": " + std::strerror(errno));
+    }
+    try {
+        write_all(out_fd, out.data(), out.size(), tmp);
+        if (fdatasync(out_fd) == -1) {
+            throw std::runtime_error("Catalog: fdatasync failed for " + tmp + ": " + std::strerror(errno));
+        }
+    } catch (...) {
+        close(out_fd);
+        unlink(tmp.c_str());
+        throw;
+    }
+    close(out_fd);
+    if (rename(tmp.c_str(), path.c_str()) == -1) {
+        const int err = errno;
+        unlink(tmp.c_str());
+        throw std::runtime_error("Catalog: cannot write " + path + ": " + std::strerror(err));
+    }
+    unmapFile();
+    changes.clear();
+    mapFile();
+}
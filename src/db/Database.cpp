@@ -1,7 +1,34 @@
 #include <db/Database.hpp>
+#include <stdexcept>
 
 using namespace db;
 
+namespace {
+// 用打开的文件更新目录项：页数，以及文件记着的行数；返回是否有变化
+bool refresh(CatalogEntry &entry, const DbFile &file) {
+    bool changed = entry.num_pages != file.getNumPages();
+    entry.num_pages = file.getNumPages();
+    if (const auto rows = file.getRowCount()) {
+        if (!entry.stats) {
+            entry.stats.emplace();
+        }
+        changed |= !entry.stats->rows_exact || entry.stats->rows != *rows;
+        entry.stats->rows = *rows;
+        entry.stats->rows_exact = true;
+    }
+    return changed;
+}
+
+// 目录里记下的精确行数交给新打开的文件继续维护
+std::unique_ptr<DbFile> open_entry(const CatalogEntry &entry) {
+    std::unique_ptr<DbFile> file = entry.open();
+    if (entry.stats && entry.stats->rows_exact && !file->getRowCount()) {
+        file->setRowCount(entry.stats->rows);
+    }
+    return file;
+}
+} // namespace
+
 BufferPool &Database::getBufferPool() { return bufferPool; }
 
 Database &db::getDatabase() {
@@ -10,27 +37,196 @@ Database &db::getDatabase() {
 }
 
 void Database::add(std::unique_ptr<DbFile> file) {
-    const std::string &name = file->getName();
-
-    if (files.contains(name)) {
+    const std::string name = file->getName();
+    // remove 要落盘，不能在持锁时调用
+    while (true) {
+        {
+            std::unique_lock lock(mtx);
+            if (!files.contains(name)) {
+                registerLocked(std::move(file));
+                return;
+            }
+        }
         remove(name);
     }
+}
 
+std::atomic<DbFile *> &Database::slotLocked(file_id_t id) const {
+    return files_by_id[id / ID_SEGMENT_SIZE].load(std::memory_order_relaxed)[id % ID_SEGMENT_SIZE];
+}
+
+DbFile &Database::registerLocked(std::unique_ptr<DbFile> file) const {
+    const std::string &name = file->getName();
+    auto it = file_ids.find(name);
+    if (it == file_ids.end()) {
+        const size_t id = file_ids.size();
+        if (id / ID_SEGMENT_SIZE >= ID_SEGMENTS) {
+            throw std::length_error("Database: out of file ids");
+        }
+        // 新段先清零再发布，无锁的读者看到段指针时槽位已经是 nullptr
+        if (id % ID_SEGMENT_SIZE == 0) {
+            id_segments.push_back(std::make_unique<std::atomic<DbFile *>[]>(ID_SEGMENT_SIZE));
+            files_by_id[id / ID_SEGMENT_SIZE].store(id_segments.back().get(), std::memory_order_release);
+        }
+        it = file_ids.emplace(name, static_cast<file_id_t>(id)).first;
+    }
+    file->file_id = it->second;
+    slotLocked(it->second).store(file.get(), std::memory_order_release);
+
+    DbFile &ref = *file;
     files[name] = std::move(file);
+    return ref;
 }
 
 
 std::unique_ptr<DbFile> Database::remove(const std::string &name) {
     // TODO pa0
-    auto nh = files.extract(name);
-    if (nh.empty()) {
+    file_id_t id;
+    {
+        std::shared_lock lock(mtx);
+        auto it = files.find(name);
+        if (it == files.end()) {
+            throw std::logic_error("File does not exist");
+        }
+        id = it->second->getFileId();
+    }
+    // 先落盘再摘除，flushPage 需要通过 id 找到文件；落盘时不持锁，缓冲池持分片锁时也会查文件
+    Database::getBufferPool().drainReadAhead();
+    Database::getBufferPool().releaseResident(id);
+    Database::getBufferPool().flushFile(id);
+    std::unique_lock lock(mtx);
+    auto it = files.find(name);
+    if (it == files.end()) {
         throw std::logic_error("File does not exist");
     }
-    Database::getBufferPool().flushFile(nh.key());
+    slotLocked(id).store(nullptr, std::memory_order_release);
+    auto nh = files.extract(it);
     return std::move(nh.mapped());
 }
 
 DbFile &Database::get(const std::string &name) const {
     // TODO pa0
-    return *files.at(name);
+    {
+        std::shared_lock lock(mtx);
+        if (auto it = files.find(name); it != files.end()) {
+            return *it->second;
+        }
+        if (catalog == nullptr) {
+            return *files.at(name);
+        }
+    }
+    // 目录里有的文件第一次被访问时才打开
+    std::unique_lock lock(mtx);
+    if (auto it = files.find(name); it != files.end()) {
+        return *it->second;
+    }
+    const std::optional<CatalogEntry> entry = catalog->find(name);
+    if (!entry) {
+        return *files.at(name);
+    }
+    return registerLocked(open_entry(*entry));
+}
+
+DbFile &Database::get(file_id_t id) const {
+    DbFile *file = find(id);
+    if (file == nullptr) {
+        throw std::out_of_range("Database::get: file id not registered");
+    }
+    return *file;
+}
+
+DbFile *Database::find(file_id_t id) const noexcept {
+    if (id / ID_SEGMENT_SIZE >= ID_SEGMENTS) {
+        return nullptr;
+    }
+    const std::atomic<DbFile *> *segment = files_by_id[id / ID_SEGMENT_SIZE].load(std::memory_order_acquire);
+    return segment != nullptr ? segment[id % ID_SEGMENT_SIZE].load(std::memory_order_acquire) : nullptr;
+}
+
+void Database::openCatalog(const std::string &path) {
+    auto opened = std::make_unique<Catalog>(path);
+    std::unique_lock lock(mtx);
+    catalog = std::move(opened);
+}
+
+DbFile &Database::create(const CatalogEntry &entry) {
+    bool registered;
+    {
+        std::shared_lock lock(mtx);
+        if (catalog == nullptr) {
+            throw std::logic_error("Database::create: no catalog is open");
+        }
+        registered = files.contains(entry.name);
+    }
+    // 先写回并摘除同名的旧文件，新打开的文件才能从磁盘看到正确的页数
+    if (registered) {
+        remove(entry.name);
+    }
+    std::unique_ptr<DbFile> file = open_entry(entry);
+    DbFile &ref = *file;
+    add(std::move(file));
+    std::unique_lock lock(mtx);
+    catalog->put(entry);
+    return ref;
+}
+
+std::optional<CatalogEntry> Database::describe(const std::string &name) const {
+    std::shared_lock lock(mtx);
+    if (catalog == nullptr) {
+        return std::nullopt;
+    }
+    std::optional<CatalogEntry> entry = catalog->find(name);
+    if (entry) {
+        if (auto it = files.find(name); it != files.end()) {
+            (void)refresh(*entry, *it->second);
+        }
+    }
+    return entry;
+}
+
+std::unique_ptr<DbFile> Database::drop(const std::string &name) {
+    {
+        std::unique_lock lock(mtx);
+        if (catalog == nullptr) {
+            throw std::logic_error("Database::drop: no catalog is open");
+        }
+        if (!catalog->find(name)) {
+            throw std::logic_error("Database::drop: " + name + " is not in the catalog");
+        }
+        catalog->erase(name);
+        if (!files.contains(name)) {
+            return nullptr;
+        }
+    }
+    return remove(name);
+}
+
+void Database::saveCatalog() {
+    std::unique_lock lock(mtx);
+    if (catalog == nullptr) {
+        throw std::logic_error("Database::saveCatalog: no catalog is open");
+    }
+    // 只有打开过的文件页数、行数可能变了
+    for (const auto &[name, file] : files) {
+        if (std::optional<CatalogEntry> entry = catalog->find(name); entry && refresh(*entry, *file)) {
+            catalog->put(*entry);
+        }
+    }
+    catalog->save();
+}
+
+TableStats Database::analyze(const std::string &name, size_t sample_pages, size_t buckets) {
+    DbFile &file = get(name);
+    TableStats stats = collectStats(file, sample_pages, buckets);
+    if (stats.rows_exact && !file.getRowCount()) {
+        file.setRowCount(stats.rows);
+    }
+    std::unique_lock lock(mtx);
+    if (catalog != nullptr) {
+        if (std::optional<CatalogEntry> entry = catalog->find(name)) {
+            entry->stats = stats;
+            catalog->put(*entry);
+        }
+    }
+    return stats;
 }
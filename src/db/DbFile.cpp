@@ -1,51 +1,392 @@
 #include <db/DbFile.hpp>
+#include <db/PageCodec.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
 #include <stdexcept>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 using namespace db;
 
 const TupleDesc &DbFile::getTupleDesc() const { return td; }
 
-DbFile::DbFile(const std::string &name, const TupleDesc &td) : name(name), td(td) {
-    // TODO pa1: open file and initialize numPages
-    // Hint: use open, fstat
+DbFile::DbFile(const std::string &name, const TupleDesc &td, PageCompression compression, FileAccess access)
+    : read_only(access == FileAccess::MMAP_READ_ONLY), name(name), td(td) {
+    if (read_only && compression != PageCompression::NONE) {
+        throw std::logic_error("DbFile: compressed files cannot be mapped");
+    }
+    fd = read_only ? open(name.c_str(), O_RDONLY) : open(name.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("DbFile: cannot open " + name + ": " + std::strerror(errno));
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == -1) {
+        const int err = errno;
+        close(fd);
+        throw std::runtime_error("DbFile: fstat failed for " + name + ": " + std::strerror(err));
+    }
+    numPages = static_cast<size_t>(st.st_size) / DEFAULT_PAGE_SIZE;
+    // 只映射完整的页；空文件没有映射
+    if (read_only && numPages > 0) {
+        void *m = mmap(nullptr, numPages * DEFAULT_PAGE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+        if (m == MAP_FAILED) {
+            const int err = errno;
+            close(fd);
+            throw std::runtime_error("DbFile: mmap failed for " + name + ": " + std::strerror(err));
+        }
+        map = static_cast<const uint8_t *>(m);
+        mapped_pages = numPages;
+    }
+    if (compression == PageCompression::LZ) {
+        try {
+            ptt = std::make_unique<PageTable>(name + ".ptt");
+            if (!ptt->covers(static_cast<uint64_t>(st.st_size))) {
+                ptt->rebuild(fd, static_cast<uint64_t>(st.st_size));
+            }
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        numPages = ptt->size();
+    }
+    if (numPages == 0) {
+        row_base = 0;
+    }
 }
 
 DbFile::~DbFile() {
-    // TODO pa1: close file
-    // Hind: use close
+    if (map != nullptr) {
+        munmap(const_cast<uint8_t *>(map), mapped_pages * DEFAULT_PAGE_SIZE);
+    }
+    if (fd != -1) {
+        close(fd);
+    }
 }
 
 const std::string &DbFile::getName() const { return name; }
 
+file_id_t DbFile::getFileId() const { return file_id; }
+
+bool DbFile::isCompressed() const { return ptt != nullptr; }
+
+bool DbFile::isReadOnly() const { return read_only; }
+
+const Page *DbFile::mappedPage(size_t id) const {
+    if (id >= mapped_pages) {
+        return nullptr;
+    }
+    return reinterpret_cast<const Page *>(map + id * DEFAULT_PAGE_SIZE);
+}
+
+void DbFile::adviseSequential() const {
+    if (map != nullptr) {
+        (void)madvise(const_cast<uint8_t *>(map), mapped_pages * DEFAULT_PAGE_SIZE, MADV_SEQUENTIAL);
+    }
+}
+
+void DbFile::adviseWillNeed(size_t first, size_t count) const {
+    if (first >= mapped_pages || count == 0) {
+        return;
+    }
+    count = std::min(count, mapped_pages - first);
+    (void)madvise(const_cast<uint8_t *>(map + first * DEFAULT_PAGE_SIZE), count * DEFAULT_PAGE_SIZE, MADV_WILLNEED);
+}
+
+namespace {
+uint64_t ns_since(std::chrono::steady_clock::time_point t) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count());
+}
+} // namespace
+
+void DbFile::noteRead(size_t id, std::chrono::steady_clock::time_point start) const {
+    const uint64_t latency = ns_since(std::chrono::steady_clock::now()) - ns_since(start);
+    io_stats.reads.fetch_add(1, std::memory_order_relaxed);
+    io_stats.read_latency.record(latency);
+    reads.record(id, 1);
+    if (IoTrace &trace = getIoTrace(); trace.enabled()) {
+        trace.record({IoOp::READ, file_id, id, ns_since(start), latency});
+    }
+}
+
+void DbFile::noteWrite(size_t first_id, size_t count, std::chrono::steady_clock::time_point start) const {
+    const uint64_t latency = ns_since(std::chrono::steady_clock::now()) - ns_since(start);
+    io_stats.writes.fetch_add(count, std::memory_order_relaxed);
+    io_stats.write_latency.record(latency);
+    writes.record(first_id, count);
+    if (IoTrace &trace = getIoTrace(); trace.enabled()) {
+        for (size_t i = 0; i < count; ++i) {
+            trace.record({IoOp::WRITE, file_id, first_id + i, ns_since(start), latency});
+        }
+    }
+}
+
+void DbFile::setIoHistoryLimit(size_t limit) {
+    reads.setLimit(limit);
+    writes.setLimit(limit);
+}
+
+const FileIoStats &DbFile::getIoStats() const { return io_stats; }
+
+// 读到文件末尾之后的部分补 0：尚未写回的新页读出来就是空页
 void DbFile::readPage(Page &page, const size_t id) const {
-    reads.push_back(id);
-    // TODO pa1: read page
-    // Hint: use pread
+    const auto start = std::chrono::steady_clock::now();
+    if (ptt) {
+        readCompressed(page, id);
+        noteRead(id, start);
+        return;
+    }
+    if (read_only) {
+        if (const Page *mapped = mappedPage(id)) {
+            page = *mapped;
+        } else {
+            page.fill(0);
+        }
+        noteRead(id, start);
+        return;
+    }
+    const off_t offset = static_cast<off_t>(id * DEFAULT_PAGE_SIZE);
+    size_t done = 0;
+    while (done < page.size()) {
+        const ssize_t n = pread(fd, page.data() + done, page.size() - done, offset + static_cast<off_t>(done));
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("DbFile::readPage: pread failed for " + name + ": " + std::strerror(errno));
+        }
+        if (n == 0) {
+            std::memset(page.data() + done, 0, page.size() - done);
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    noteRead(id, start);
 }
 
 void DbFile::writePage(const Page &page, const size_t id) const {
-    writes.push_back(id);
-    // TODO pa1: write page
-    // Hint: use pwrite
+    if (read_only) {
+        throw std::logic_error("DbFile::writePage: " + name + " is read-only");
+    }
+    const auto start = std::chrono::steady_clock::now();
+    if (ptt) {
+        writeCompressed(page, id);
+        noteWrite(id, 1, start);
+        return;
+    }
+    const off_t offset = static_cast<off_t>(id * DEFAULT_PAGE_SIZE);
+    size_t done = 0;
+    while (done < page.size()) {
+        const ssize_t n = pwrite(fd, page.data() + done, page.size() - done, offset + static_cast<off_t>(done));
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("DbFile::writePage: pwrite failed for " + name + ": " + std::strerror(errno));
+        }
+        done += static_cast<size_t>(n);
+    }
+    noteWrite(id, 1, start);
+}
+
+void DbFile::sync() const {
+    if (read_only) {
+        return;
+    }
+    if (fdatasync(fd) == -1) {
+        throw std::runtime_error("DbFile::sync: fdatasync failed for " + name + ": " + std::strerror(errno));
+    }
+}
+
+// 相邻页一次 pwritev 写出；短写时从中断处继续
+void DbFile::writePages(const std::vector<const Page *> &pages, const size_t first_id) const {
+    if (read_only) {
+        throw std::logic_error("DbFile::writePages: " + name + " is read-only");
+    }
+    if (ptt) {
+        for (size_t i = 0; i < pages.size(); ++i) {
+            writePage(*pages[i], first_id + i);
+        }
+        return;
+    }
+    std::vector<iovec> iov;
+    iov.reserve(pages.size());
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < pages.size(); ++i) {
+        iov.push_back({const_cast<uint8_t *>(pages[i]->data()), pages[i]->size()});
+    }
+    off_t offset = static_cast<off_t>(first_id * DEFAULT_PAGE_SIZE);
+    size_t idx = 0;
+    while (idx < iov.size()) {
+        const int cnt = static_cast<int>(std::min<size_t>(iov.size() - idx, IOV_MAX));
+        const ssize_t n = pwritev(fd, &iov[idx], cnt, offset);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("DbFile::writePages: pwritev failed for " + name + ": " + std::strerror(errno));
+        }
+        offset += n;
+        size_t left = static_cast<size_t>(n);
+        while (idx < iov.size() && left >= iov[idx].iov_len) {
+            left -= iov[idx].iov_len;
+            ++idx;
+        }
+        if (left > 0) {
+            iov[idx].iov_base = static_cast<uint8_t *>(iov[idx].iov_base) + left;
+            iov[idx].iov_len -= left;
+        }
+    }
+    noteWrite(first_id, pages.size(), start);
+}
+
+// 一次 pread 读出 extent 头和负载；从未写过的页为空页
+void DbFile::readCompressed(Page &page, const size_t id) const {
+    PageTable::Extent e;
+    {
+        std::lock_guard lock(ptt_mtx);
+        e = ptt->find(id);
+    }
+    if (e.length == 0) {
+        page.fill(0);
+        return;
+    }
+    uint8_t buf[sizeof(ExtentHeader) + DEFAULT_PAGE_SIZE];
+    const size_t len = sizeof(ExtentHeader) + e.length;
+    size_t done = 0;
+    while (done < len) {
+        const ssize_t n = pread(fd, buf + done, len - done, static_cast<off_t>(e.offset + done));
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("DbFile::readPage: pread failed for " + name + ": " + std::strerror(errno));
+        }
+        if (n == 0) {
+            throw std::runtime_error("DbFile::readPage: extent past end of " + name);
+        }
+        done += static_cast<size_t>(n);
+    }
+    ExtentHeader h;
+    std::memcpy(&h, buf, sizeof(h));
+    if (h.magic != PageTable::EXTENT_MAGIC || h.page != id || h.length != e.length) {
+        throw std::runtime_error("DbFile::readPage: bad extent header in " + name);
+    }
+    if (e.length == DEFAULT_PAGE_SIZE) {
+        std::memcpy(page.data(), buf + sizeof(ExtentHeader), DEFAULT_PAGE_SIZE);
+    } else {
+        decompress_page(buf + sizeof(ExtentHeader), e.length, page);
+    }
 }
 
-const std::vector<size_t> &DbFile::getReads() const { return reads; }
+// 压缩不到一页以内的页原样存放；整个 extent（头、负载、补 0）一次 pwrite 写出，文件长度始终与页表一致
+void DbFile::writeCompressed(const Page &page, const size_t id) const {
+    uint8_t buf[PageTable::MAX_UNITS * PageTable::UNIT];
+    size_t len = compress_page(page, buf + sizeof(ExtentHeader), DEFAULT_PAGE_SIZE - 1);
+    if (len == 0) {
+        std::memcpy(buf + sizeof(ExtentHeader), page.data(), DEFAULT_PAGE_SIZE);
+        len = DEFAULT_PAGE_SIZE;
+    }
+    ExtentHeader h{PageTable::EXTENT_MAGIC, static_cast<uint16_t>(len), 0, id, 0};
+    PageTable::Extent e;
+    {
+        std::lock_guard lock(ptt_mtx);
+        e = ptt->place(id, static_cast<uint32_t>(len), h.seq);
+    }
+    h.units = static_cast<uint16_t>(e.units);
+    std::memcpy(buf, &h, sizeof(h));
+    len += sizeof(ExtentHeader);
+    std::memset(buf + len, 0, e.units * PageTable::UNIT - len);
+    len = e.units * PageTable::UNIT;
+    size_t done = 0;
+    while (done < len) {
+        const ssize_t n = pwrite(fd, buf + done, len - done, static_cast<off_t>(e.offset + done));
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("DbFile::writePage: pwrite failed for " + name + ": " + std::strerror(errno));
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+std::vector<size_t> DbFile::getReads() const { return reads.ids(); }
 
-const std::vector<size_t> &DbFile::getWrites() const { return writes; }
+std::vector<size_t> DbFile::getWrites() const { return writes.ids(); }
 
 void DbFile::insertTuple(const Tuple &t) { throw std::runtime_error("Not implemented"); }
 
+void DbFile::insertTuples(std::span<const Tuple> tuples) {
+    for (const Tuple &t : tuples) {
+        insertTuple(t);
+    }
+}
+
 void DbFile::deleteTuple(const Iterator &it) { throw std::runtime_error("Not implemented"); }
 
 Tuple DbFile::getTuple(const Iterator &it) const { throw std::runtime_error("Not implemented"); }
 
+TupleView DbFile::getView(const Iterator &) const { throw std::runtime_error("Not implemented"); }
+
 void DbFile::next(Iterator &it) const { throw std::runtime_error("Not implemented"); }
 
 Iterator DbFile::begin() const { throw std::runtime_error("Not implemented"); }
 
 Iterator DbFile::end() const { throw std::runtime_error("Not implemented"); }
 
-size_t DbFile::getNumPages() const { return numPages; }
+size_t DbFile::scanPage(Iterator &it, std::vector<Tuple> &out, size_t limit) const {
+    const Iterator e = end();
+    const size_t page = it.page;
+    size_t count = 0;
+    while (count < limit && it != e && it.page == page) {
+        out.push_back(getTuple(it));
+        next(it);
+        ++count;
+    }
+    return count;
+}
+
+size_t DbFile::scanPageWhere(Iterator &it, std::vector<Tuple> &out, size_t limit, const Predicate &pred) const {
+    pred.check(td);
+    std::vector<Tuple> rows;
+    const size_t count = scanPage(it, rows, limit);
+    for (Tuple &t : rows) {
+        if (pred.matches(t)) {
+            out.push_back(std::move(t));
+        }
+    }
+    return count;
+}
+
+size_t DbFile::nextBatch(Iterator &it, std::vector<Tuple> &out, size_t limit) const {
+    size_t count = 0;
+    while (count < limit) {
+        const size_t got = scanPage(it, out, limit - count);
+        if (got == 0) {
+            break;
+        }
+        count += got;
+    }
+    return count;
+}
+
+std::vector<Iterator> DbFile::split(size_t /*parts*/) const {
+    std::vector<Iterator> starts;
+    Iterator it = begin();
+    if (it != end()) {
+        starts.push_back(it);
+    }
+    return starts;
+}
+
+size_t DbFile::getNumPages() const { return numPages.load(std::memory_order_acquire); }
+
+void DbFile::noteRows(int64_t delta) { row_delta.fetch_add(delta, std::memory_order_relaxed); }
+
+std::optional<uint64_t> DbFile::getRowCount() const {
+    const int64_t base = row_base.load(std::memory_order_relaxed);
+    if (base < 0) {
+        return std::nullopt;
+    }
+    return static_cast<uint64_t>(std::max<int64_t>(base + row_delta.load(std::memory_order_relaxed), 0));
+}
+
+// 之前记下的增减已包含在 rows 中
+void DbFile::setRowCount(uint64_t rows) {
+    row_base.store(static_cast<int64_t>(rows) - row_delta.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
@@ -0,0 +1,213 @@
+#include <db/Database.hpp>
+#include <db/ExternalSort.hpp>
+#include <db/HeapFile.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <limits>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+std::atomic<uint64_t> sort_seq{0};
+
+// 归并输出每攒够这么多字节写一次
+constexpr size_t WRITE_CHUNK_BYTES = ExternalSort::READ_CHUNK_PAGES * DEFAULT_PAGE_SIZE;
+
+// 一个 run 的读游标：一次读入 READ_CHUNK_PAGES 页
+class RunCursor {
+    const DbFile &file;
+    Iterator it;
+    std::vector<Tuple> buf;
+    size_t pos{0};
+
+    void fill() {
+        buf.clear();
+        pos = 0;
+        const Iterator end = file.end();
+        for (size_t p = 0; p < ExternalSort::READ_CHUNK_PAGES && it != end; ++p) {
+            file.scanPage(it, buf, std::numeric_limits<size_t>::max());
+        }
+    }
+
+public:
+    explicit RunCursor(const DbFile &file) : file(file), it(file.begin()) { fill(); }
+
+    bool done() const { return pos == buf.size(); }
+
+    Tuple &top() { return buf[pos]; }
+
+    void advance() {
+        if (++pos == buf.size()) fill();
+    }
+};
+} // namespace
+
+/**
+ * 败者树：tree[0] 为当前最小的游标，tree[1..k) 记下各内部结点比赛的败者。
+ * 取走最小值后只需沿该游标到根的路径重赛一次，每个元组 log2(k) 次比较。
+ */
+class ExternalSort::Merger {
+    std::vector<RunCursor> inputs;
+    std::vector<size_t> tree;
+    const Less &less;
+
+    // a 是否排在 b 前面；下标 k 是建树用的哨兵（最小），读完的游标最大；相等时下标小的在前，保证稳定
+    bool beats(size_t a, size_t b) {
+        const size_t k = inputs.size();
+        if (a == k || b == k) return a == k;
+        if (inputs[a].done() || inputs[b].done()) return !inputs[a].done();
+        if (less(inputs[a].top(), inputs[b].top())) return true;
+        if (less(inputs[b].top(), inputs[a].top())) return false;
+        return a < b;
+    }
+
+    void replay(size_t leaf) {
+        size_t winner = leaf;
+        for (size_t t = (leaf + inputs.size()) / 2; t > 0; t /= 2) {
+            if (beats(tree[t], winner)) std::swap(tree[t], winner);
+        }
+        tree[0] = winner;
+    }
+
+public:
+    Merger(const std::vector<const DbFile *> &files, const Less &less) : less(less) {
+        inputs.reserve(files.size());
+        for (const DbFile *f : files) {
+            inputs.emplace_back(*f);
+        }
+        tree.assign(inputs.size(), inputs.size());
+        for (size_t i = inputs.size(); i-- > 0;) {
+            replay(i);
+        }
+    }
+
+    bool empty() const { return inputs[tree[0]].done(); }
+
+    Tuple pop() {
+        const size_t w = tree[0];
+        Tuple t = std::move(inputs[w].top());
+        inputs[w].advance();
+        replay(w);
+        return t;
+    }
+};
+
+ExternalSort::ExternalSort(const DbFile &source, Less less, size_t memory_pages)
+    : td(source.getTupleDesc()), less(std::move(less)),
+      budget(std::max<size_t>(memory_pages, 1) * DEFAULT_PAGE_SIZE),
+      fan_in(std::max<size_t>(2, memory_pages / READ_CHUNK_PAGES)),
+      prefix(source.getName() + ".sort." + std::to_string(getpid()) + "." + std::to_string(sort_seq++) + ".") {
+    // 第一趟：按内存预算切成 run，各自稳定排序后写出
+    size_t bytes = 0;
+    const Iterator end = source.end();
+    for (Iterator it = source.begin(); it != end;) {
+        const size_t first = memory.size();
+        source.scanPage(it, memory, std::numeric_limits<size_t>::max());
+        for (size_t i = first; i < memory.size(); ++i) {
+            bytes += td.length_of(memory[i]);
+        }
+        if (bytes >= budget) {
+            writeRun();
+            bytes = 0;
+        }
+    }
+    if (run_files.empty()) {
+        std::stable_sort(memory.begin(), memory.end(), this->less);
+        return;
+    }
+    if (!memory.empty()) {
+        writeRun();
+    }
+    initial_runs = run_files.size();
+
+    // 路数超过 fan_in 时逐趟把相邻的 run 归并成更长的 run；按原顺序分组，保持稳定
+    while (run_files.size() > fan_in) {
+        std::vector<std::string> merged;
+        for (size_t first = 0; first < run_files.size(); first += fan_in) {
+            const size_t count = std::min(fan_in, run_files.size() - first);
+            merged.push_back(count == 1 ? run_files[first] : mergeRuns(first, count));
+        }
+        run_files = std::move(merged);
+    }
+
+    std::vector<const DbFile *> files;
+    for (const std::string &name : run_files) {
+        files.push_back(&getDatabase().get(name));
+    }
+    merger = std::make_unique<Merger>(files, this->less);
+}
+
+ExternalSort::~ExternalSort() {
+    merger.reset();
+    for (const std::string &name : run_files) {
+        dropRun(name);
+    }
+}
+
+std::string ExternalSort::newRun() {
+    const std::string name = prefix + std::to_string(created++);
+    std::remove(name.c_str());
+    std::remove((name + ".fsm").c_str());
+    getDatabase().add(std::make_unique<HeapFile>(name, td));
+    return name;
+}
+
+void ExternalSort::dropRun(const std::string &name) {
+    getDatabase().remove(name).reset();   // 析构时写出 .fsm，随后一并删除
+    std::remove(name.c_str());
+    std::remove((name + ".fsm").c_str());
+}
+
+void ExternalSort::writeRun() {
+    std::stable_sort(memory.begin(), memory.end(), less);
+    const std::string name = newRun();
+    run_files.push_back(name);
+    getDatabase().get(name).insertTuples(memory);
+    memory.clear();
+}
+
+// 归并 run_files[first, first + count) 到一个新 run，并删除输入
+std::string ExternalSort::mergeRuns(size_t first, size_t count) {
+    const std::string out_name = newRun();
+    DbFile &out = getDatabase().get(out_name);
+    {
+        std::vector<const DbFile *> files;
+        for (size_t i = first; i < first + count; ++i) {
+            files.push_back(&getDatabase().get(run_files[i]));
+        }
+        Merger m(files, less);
+        std::vector<Tuple> staged;
+        size_t bytes = 0;
+        while (!m.empty()) {
+            staged.push_back(m.pop());
+            bytes += td.length_of(staged.back());
+            if (bytes >= WRITE_CHUNK_BYTES) {
+                out.insertTuples(staged);
+                staged.clear();
+                bytes = 0;
+            }
+        }
+        out.insertTuples(staged);
+    }
+    for (size_t i = first; i < first + count; ++i) {
+        dropRun(run_files[i]);
+    }
+    return out_name;
+}
+
+std::optional<Tuple> ExternalSort::next() {
+    if (merger == nullptr) {
+        if (memory_pos == memory.size()) return std::nullopt;
+        return std::move(memory[memory_pos++]);
+    }
+    if (merger->empty()) return std::nullopt;
+    return merger->pop();
+}
+
+size_t ExternalSort::runs() const { return initial_runs; }
+
+ExternalSort::Less ExternalSort::byField(size_t field) {
+    return [field](const Tuple &a, const Tuple &b) { return a.get_field(field) < b.get_field(field); };
+}
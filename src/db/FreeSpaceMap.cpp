@@ -0,0 +1,126 @@
+#include <db/FreeSpaceMap.hpp>
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+constexpr size_t WORD_BITS = 64;
+
+// 完整读/写 n 字节；EINTR 重试
+bool read_all(int fd, void *buf, size_t n) {
+    auto *p = static_cast<uint8_t *>(buf);
+    while (n > 0) {
+        const ssize_t r = read(fd, p, n);
+        if (r == -1 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+bool write_all(int fd, const void *buf, size_t n) {
+    const auto *p = static_cast<const uint8_t *>(buf);
+    while (n > 0) {
+        const ssize_t w = write(fd, p, n);
+        if (w == -1 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+} // namespace
+
+// 文件格式：| MAGIC | 页数 | words[(页数 + 63) / 64] |，均为 uint64_t
+FreeSpaceMap::FreeSpaceMap(std::string path) : path(std::move(path)) {
+    const int fd = open(this->path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    uint64_t head[2];
+    if (read_all(fd, head, sizeof(head)) && head[0] == MAGIC) {
+        std::vector<uint64_t> loaded((head[1] + WORD_BITS - 1) / WORD_BITS);
+        if (read_all(fd, loaded.data(), loaded.size() * sizeof(uint64_t))) {
+            words = std::move(loaded);
+            pages = head[1];
+        }
+    }
+    close(fd);
+}
+
+FreeSpaceMap::~FreeSpaceMap() {
+    // 析构中不抛异常：保存失败只会让下次打开时重建
+    try {
+        if (dirty) save();
+    } catch (const std::exception &) {
+    }
+}
+
+size_t FreeSpaceMap::size() const { return pages; }
+
+void FreeSpaceMap::resize(size_t num_pages) {
+    if (num_pages == pages) {
+        return;
+    }
+    words.resize((num_pages + WORD_BITS - 1) / WORD_BITS, 0);
+    // 截短时清掉最后一个字中越界的位
+    if (num_pages < pages && num_pages % WORD_BITS != 0) {
+        words.back() &= (uint64_t{1} << (num_pages % WORD_BITS)) - 1;
+    }
+    pages = num_pages;
+    cursor = std::min(cursor, words.size());
+    dirty = true;
+}
+
+void FreeSpaceMap::set(size_t page, bool has_room) {
+    if (page >= pages) {
+        resize(page + 1);
+    }
+    uint64_t &word = words[page / WORD_BITS];
+    const uint64_t bit = uint64_t{1} << (page % WORD_BITS);
+    const uint64_t old = word;
+    if (has_room) {
+        word |= bit;
+        cursor = std::min(cursor, page / WORD_BITS);
+    } else {
+        word &= ~bit;
+    }
+    dirty |= word != old;
+}
+
+size_t FreeSpaceMap::find() {
+    for (; cursor < words.size(); ++cursor) {
+        if (words[cursor] != 0) {
+            return cursor * WORD_BITS + static_cast<size_t>(std::countr_zero(words[cursor]));
+        }
+    }
+    return npos;
+}
+
+void FreeSpaceMap::save() {
+    const std::string tmp = path + ".tmp";
+    const int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("FreeSpaceMap: cannot open " + tmp + ": " + std::strerror(errno));
+    }
+    const uint64_t head[2] = {MAGIC, pages};
+    const bool ok = write_all(fd, head, sizeof(head)) &&
+                    write_all(fd, words.data(), words.size() * sizeof(uint64_t));
+    int err = errno;
+    close(fd);
+    if (ok && rename(tmp.c_str(), path.c_str()) == 0) {
+        dirty = false;
+        return;
+    }
+    if (ok) err = errno;
+    unlink(tmp.c_str());
+    throw std::runtime_error("FreeSpaceMap: cannot write " + path + ": " + std::strerror(err));
+}
@@ -0,0 +1,648 @@
+#include <db/BloomFilter.hpp>
+#include <db/Database.hpp>
+#include <db/HashFile.hpp>
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+using namespace db;
+
+namespace {
+// 每页首字节记页的种类；从未写过的页读出为 FREE
+enum class HashPageKind : uint8_t {
+    FREE = 0, HEADER = 1, DIRECTORY = 2, BUCKET = 3
+};
+
+// 第 0 页：文件头，其后是各目录页的页号（size_t）
+struct HashFileHeader {
+    HashPageKind kind;
+    uint8_t global_depth;
+    uint16_t unused;
+    uint32_t dir_pages;
+};
+
+// 目录页：头部之后是目录项（桶首页的页号，size_t），第 i 页存第 [i * DIR_ENTRIES, (i + 1) * DIR_ENTRIES) 项
+struct DirectoryHeader {
+    HashPageKind kind;
+    uint8_t unused[7];
+};
+
+// 桶页：| header | Slot slots[count] | 空闲 | 行（自页尾向前分配）|
+// 溢出页格式相同，由 overflow 串成链；local_depth 只在链的首页上有意义
+struct BucketHeader {
+    HashPageKind kind;
+    uint8_t local_depth;
+    uint16_t count;
+    uint16_t cell_top;   // 行区起点
+    uint16_t dead;       // 行区中已删除行的字节数
+    size_t overflow;     // 下一溢出页；0 表示链尾
+};
+
+// hash 只存低 32 位：目录至多按低 MAX_DEPTH 位索引，分裂用到的位都在其中
+struct Slot {
+    uint32_t hash;
+    uint16_t offset;
+    uint16_t length;
+};
+
+static_assert(sizeof(HashFileHeader) == 8 && sizeof(DirectoryHeader) == 8 && sizeof(BucketHeader) == 16);
+
+constexpr size_t DIR_ENTRIES = (DEFAULT_PAGE_SIZE - sizeof(DirectoryHeader)) / sizeof(size_t);
+constexpr size_t MAX_DIR_PAGES = (DEFAULT_PAGE_SIZE - sizeof(HashFileHeader)) / sizeof(size_t);
+
+// 文件头列得下的目录页装得下 2^MAX_DEPTH 项
+constexpr size_t max_depth() {
+    size_t depth = 0;
+    while ((size_t{2} << depth) <= DIR_ENTRIES * MAX_DIR_PAGES) {
+        ++depth;
+    }
+    return depth;
+}
+
+constexpr size_t MAX_DEPTH = max_depth();
+
+static_assert(MAX_DEPTH < 32, "slot hashes keep 32 bits");
+
+// 新文件：第 0 页为文件头，第 1 页为第一个目录页，第 2 页为第一个桶
+constexpr size_t HEADER_PAGE = 0;
+constexpr size_t FIRST_DIR_PAGE = 1;
+constexpr size_t FIRST_BUCKET = 2;
+
+HashPageKind kind_of(const Page &page) { return static_cast<HashPageKind>(page[0]); }
+
+HashFileHeader *file_header(Page &page) { return reinterpret_cast<HashFileHeader *>(page.data()); }
+
+size_t *dir_page_ids(Page &page) { return reinterpret_cast<size_t *>(page.data() + sizeof(HashFileHeader)); }
+
+size_t *dir_entries(Page &page) { return reinterpret_cast<size_t *>(page.data() + sizeof(DirectoryHeader)); }
+
+struct BucketPage {
+    Page &page;
+    BucketHeader *header;
+    Slot *slots;
+
+    explicit BucketPage(Page &page)
+        : page(page), header(reinterpret_cast<BucketHeader *>(page.data())),
+          slots(reinterpret_cast<Slot *>(page.data() + sizeof(BucketHeader))) {}
+
+    static BucketPage init(Page &page, size_t local_depth) {
+        page.fill(0);
+        BucketPage b(page);
+        b.header->kind = HashPageKind::BUCKET;
+        b.header->local_depth = static_cast<uint8_t>(local_depth);
+        b.header->cell_top = static_cast<uint16_t>(DEFAULT_PAGE_SIZE);
+        return b;
+    }
+
+    size_t freeBytes() const { return header->cell_top - sizeof(BucketHeader) - header->count * sizeof(Slot); }
+
+    // 整理行区后放得下一行 len 字节的元组
+    bool fits(size_t len) const { return freeBytes() + header->dead >= len + sizeof(Slot); }
+
+    const uint8_t *row(size_t slot) const { return page.data() + slots[slot].offset; }
+
+    void insert(uint32_t hash, const uint8_t *data, size_t len) {
+        if (freeBytes() < len + sizeof(Slot)) {
+            compact();
+        }
+        header->cell_top = static_cast<uint16_t>(header->cell_top - len);
+        std::memcpy(page.data() + header->cell_top, data, len);
+        slots[header->count++] = {hash, header->cell_top, static_cast<uint16_t>(len)};
+    }
+
+    void remove(size_t slot) {
+        header->dead = static_cast<uint16_t>(header->dead + slots[slot].length);
+        std::memmove(slots + slot, slots + slot + 1, (header->count - slot - 1) * sizeof(Slot));
+        --header->count;
+    }
+
+    // 把仍在用的行紧挨着搬到页尾，回收删除留下的空洞
+    void compact() {
+        Page copy = page;
+        size_t top = DEFAULT_PAGE_SIZE;
+        for (size_t i = 0; i < header->count; ++i) {
+            top -= slots[i].length;
+            std::memcpy(page.data() + top, copy.data() + slots[i].offset, slots[i].length);
+            slots[i].offset = static_cast<uint16_t>(top);
+        }
+        header->cell_top = static_cast<uint16_t>(top);
+        header->dead = 0;
+    }
+};
+
+// 把 key 化成页里存放的形式：CHAR 截到 CHAR_SIZE 且止于 '\0'，VARCHAR 截到 VARCHAR_MAX，
+// 这样查找的 key 与从页里读出的 key 字节相同、哈希相同
+field_t stored_key(type_t type, const field_t &key) {
+    const bool ok = type == type_t::INT      ? std::holds_alternative<int>(key)
+                    : type == type_t::DOUBLE ? std::holds_alternative<double>(key)
+                                             : std::holds_alternative<std::string>(key);
+    if (!ok) {
+        throw std::logic_error("HashFile: key type does not match the key field");
+    }
+    if (type == type_t::CHAR) {
+        const std::string &s = std::get<std::string>(key);
+        return s.substr(0, std::min(s.find('\0'), CHAR_SIZE));
+    }
+    if (type == type_t::VARCHAR) {
+        return std::get<std::string>(key).substr(0, VARCHAR_MAX);
+    }
+    return key;
+}
+
+// -0.0 与 0.0 相等，须得到同一哈希
+uint64_t key_hash(const field_t &key) {
+    if (const int *v = std::get_if<int>(&key)) {
+        return BloomFilter::hash(v, sizeof(*v));
+    }
+    if (const double *v = std::get_if<double>(&key)) {
+        const double d = *v == 0.0 ? 0.0 : *v;
+        return BloomFilter::hash(&d, sizeof(d));
+    }
+    const std::string &s = std::get<std::string>(key);
+    return BloomFilter::hash(s.data(), s.size());
+}
+
+bool key_matches(const TupleView &view, size_t field, const field_t &key) {
+    if (const int *v = std::get_if<int>(&key)) {
+        return view.get_int(field) == *v;
+    }
+    if (const double *v = std::get_if<double>(&key)) {
+        return view.get_double(field) == *v;
+    }
+    return view.get_char(field) == std::get<std::string>(key);
+}
+
+// 先比 hash，相同时才读 key 字段
+std::optional<size_t> find_slot(const BucketPage &bucket, const TupleDesc &td, size_t field, uint64_t hash,
+                                const field_t &key) {
+    for (size_t slot = 0; slot < bucket.header->count; ++slot) {
+        if (bucket.slots[slot].hash == static_cast<uint32_t>(hash) &&
+            key_matches(TupleView(td, bucket.row(slot)), field, key)) {
+            return slot;
+        }
+    }
+    return std::nullopt;
+}
+
+// 持着首页 head 的 latch 依次访问链中各页，溢出页同一时刻只 pin 一页；f 返回 true 时停下并返回 true
+template <typename F>
+bool for_each_page(file_id_t file, PageGuard &head, LatchMode latch, F &&f) {
+    if (f(head)) {
+        return true;
+    }
+    BufferPool &bufferPool = getDatabase().getBufferPool();
+    PageGuard guard;
+    for (size_t id = BucketPage(*head).header->overflow; id != 0; id = BucketPage(*guard).header->overflow) {
+        guard = bufferPool.pinPage({file, id}, AccessIntent::NORMAL, latch);
+        if (f(guard)) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+HashFile::HashFile(const std::string &name, const TupleDesc &td, size_t key_index, PageCompression compression,
+                   FileAccess access)
+    : DbFile(name, td, compression, access), key_index(key_index) {
+    if (key_index >= td.size()) {
+        throw std::logic_error("HashFile: key index out of range");
+    }
+    if (sizeof(BucketHeader) + sizeof(Slot) + td.max_length() > DEFAULT_PAGE_SIZE) {
+        throw std::logic_error("HashFile: rows do not fit in a bucket page");
+    }
+    // 新文件的文件头、第一个目录页与第一个桶在第一次使用时才写入，但已占用页号
+    if (numPages == 0 && !isReadOnly()) {
+        numPages = FIRST_BUCKET + 1;
+    }
+}
+
+size_t HashFile::getKeyIndex() const { return key_index; }
+
+size_t HashFile::getGlobalDepth() const {
+    const auto lock = lock_directory();
+    return global_depth;
+}
+
+std::shared_lock<std::shared_mutex> HashFile::lock_directory() const {
+    std::shared_lock lock(dir_mtx);
+    if (!loaded) {
+        lock.unlock();
+        {
+            std::unique_lock exclusive(dir_mtx);
+            if (!loaded) {
+                load_directory();
+            }
+        }
+        lock.lock();
+    }
+    return lock;
+}
+
+void HashFile::load_directory() const {
+    if (getNumPages() == 0) {
+        loaded = true;   // 从未写过的只读文件：没有桶
+        return;
+    }
+    BufferPool &bufferPool = getDatabase().getBufferPool();
+    LogGroup group(bufferPool);   // 新文件的三页在日志中是一个整体
+    PageGuard header_guard = bufferPool.pinPage({file_id, HEADER_PAGE}, AccessIntent::NORMAL,
+                                                isReadOnly() ? LatchMode::SHARED : LatchMode::EXCLUSIVE);
+    if (kind_of(*header_guard) == HashPageKind::FREE) {
+        if (isReadOnly()) {
+            loaded = true;
+            return;
+        }
+        PageGuard dir_guard = bufferPool.pinPage({file_id, FIRST_DIR_PAGE}, AccessIntent::NORMAL,
+                                                 LatchMode::EXCLUSIVE);
+        PageGuard bucket_guard = bufferPool.pinPage({file_id, FIRST_BUCKET}, AccessIntent::NORMAL,
+                                                    LatchMode::EXCLUSIVE);
+        header_guard.markDirty();
+        dir_guard.markDirty();
+        bucket_guard.markDirty();
+        header_guard->fill(0);
+        file_header(*header_guard)->kind = HashPageKind::HEADER;
+        file_header(*header_guard)->dir_pages = 1;
+        dir_page_ids(*header_guard)[0] = FIRST_DIR_PAGE;
+        dir_guard->fill(0);
+        (*dir_guard)[0] = static_cast<uint8_t>(HashPageKind::DIRECTORY);
+        dir_entries(*dir_guard)[0] = FIRST_BUCKET;
+        BucketPage::init(*bucket_guard, 0);
+    } else if (kind_of(*header_guard) != HashPageKind::HEADER) {
+        throw std::runtime_error("HashFile: " + name + " is not a hash file");
+    }
+
+    const HashFileHeader *header = file_header(*header_guard);
+    global_depth = header->global_depth;
+    dir_pages.assign(dir_page_ids(*header_guard), dir_page_ids(*header_guard) + header->dir_pages);
+    header_guard.release();
+    directory.resize(size_t{1} << global_depth);
+    for (size_t p = 0; p < dir_pages.size(); ++p) {
+        PageGuard guard = bufferPool.pinPage({file_id, dir_pages[p]}, AccessIntent::NORMAL, LatchMode::SHARED);
+        const size_t first = p * DIR_ENTRIES;
+        const size_t n = std::min(DIR_ENTRIES, directory.size() - first);
+        std::copy_n(dir_entries(*guard), n, directory.begin() + static_cast<std::ptrdiff_t>(first));
+    }
+    loaded = true;
+}
+
+size_t HashFile::bucket_of(uint64_t hash) const {
+    return directory.empty() ? 0 : directory[hash & (directory.size() - 1)];
+}
+
+size_t HashFile::snapshot_bucket_of(uint64_t hash) const {
+    BufferPool &bufferPool = getDatabase().getBufferPool();
+    size_t dir_page;
+    size_t entry;
+    {
+        PageGuard guard = bufferPool.pinPage({file_id, HEADER_PAGE}, AccessIntent::NORMAL, LatchMode::SHARED);
+        if (kind_of(*guard) != HashPageKind::HEADER) {
+            return 0;
+        }
+        entry = hash & ((size_t{1} << file_header(*guard)->global_depth) - 1);
+        dir_page = dir_page_ids(*guard)[entry / DIR_ENTRIES];
+    }
+    PageGuard guard = bufferPool.pinPage({file_id, dir_page}, AccessIntent::NORMAL, LatchMode::SHARED);
+    return dir_entries(*guard)[entry % DIR_ENTRIES];
+}
+
+PageGuard HashFile::pin_bucket(size_t page, LatchMode latch) const {
+    return getDatabase().getBufferPool().pinPage({file_id, page}, AccessIntent::NORMAL, latch);
+}
+
+void HashFile::insertTuple(const Tuple &t) {
+    if (isReadOnly()) {
+        throw std::logic_error("HashFile::insertTuple: file is read-only");
+    }
+    Page row;
+    td.serialize(row.data(), t);
+    const size_t len = td.length_of(t);
+    const field_t key = stored_key(td.type_of(key_index), t.get_field(key_index));
+    const uint64_t hash = key_hash(key);
+    if (!insert_fast(row.data(), len, hash, key)) {
+        insert_slow(row.data(), len, hash, key);
+    }
+}
+
+// 只改一页：覆盖时旧行所在页放得下新行，或 key 不在链中而链中有页放得下它
+bool HashFile::insert_fast(const uint8_t *row, size_t len, uint64_t hash, const field_t &key) {
+    const auto lock = lock_directory();
+    PageGuard head = pin_bucket(bucket_of(hash), LatchMode::EXCLUSIVE);
+    size_t room = 0;
+    std::optional<bool> replaced;
+    for_each_page(file_id, head, LatchMode::EXCLUSIVE, [&](PageGuard &guard) {
+        BucketPage bucket(*guard);
+        if (const auto slot = find_slot(bucket, td, key_index, hash, key)) {
+            // 新行沿用旧行的槽，旧行的字节整理后可再用
+            replaced = bucket.freeBytes() + bucket.header->dead + bucket.slots[*slot].length >= len;
+            if (*replaced) {
+                guard.markDirty();
+                bucket.remove(*slot);
+                bucket.insert(static_cast<uint32_t>(hash), row, len);
+            }
+            return true;
+        }
+        if (room == 0 && bucket.fits(len)) {
+            room = guard.getPageId().page;
+        }
+        return false;
+    });
+    if (replaced || room == 0) {
+        return replaced.value_or(false);
+    }
+    PageGuard other;
+    PageGuard &guard = room == head.getPageId().page ? head : (other = pin_bucket(room, LatchMode::EXCLUSIVE));
+    guard.markDirty();
+    BucketPage(*guard).insert(static_cast<uint32_t>(hash), row, len);
+    noteRows(1);
+    return true;
+}
+
+// 持目录排他锁：需要时分裂桶（可能连续几次），到最大深度后在链尾加溢出页
+void HashFile::insert_slow(const uint8_t *row, size_t len, uint64_t hash, const field_t &key) {
+    BufferPool &bufferPool = getDatabase().getBufferPool();
+    LogGroup group(bufferPool);   // 分裂改动的桶页、目录页与文件头在日志中是一个整体
+    std::unique_lock lock(dir_mtx);
+    while (true) {
+        PageGuard head = pin_bucket(bucket_of(hash), LatchMode::EXCLUSIVE);
+        size_t room = 0;
+        size_t last = 0;
+        for_each_page(file_id, head, LatchMode::EXCLUSIVE, [&](PageGuard &guard) {
+            BucketPage bucket(*guard);
+            if (const auto slot = find_slot(bucket, td, key_index, hash, key)) {
+                guard.markDirty();
+                bucket.remove(*slot);
+                noteRows(-1);   // 下面总会插回一行
+            }
+            if (room == 0 && bucket.fits(len)) {
+                room = guard.getPageId().page;
+            }
+            last = guard.getPageId().page;
+            return false;
+        });
+        const size_t head_id = head.getPageId().page;
+        if (room != 0) {
+            PageGuard other;
+            PageGuard &guard = room == head_id ? head : (other = pin_bucket(room, LatchMode::EXCLUSIVE));
+            guard.markDirty();
+            BucketPage(*guard).insert(static_cast<uint32_t>(hash), row, len);
+            noteRows(1);
+            return;
+        }
+        const size_t local_depth = BucketPage(*head).header->local_depth;
+        if (local_depth < MAX_DEPTH && last == head_id) {
+            split_bucket(head, hash);
+            continue;
+        }
+        const size_t id = numPages++;
+        PageGuard other;
+        PageGuard &tail = last == head_id ? head : (other = pin_bucket(last, LatchMode::EXCLUSIVE));
+        tail.markDirty();
+        BucketPage(*tail).header->overflow = id;
+        PageGuard guard = pin_bucket(id, LatchMode::EXCLUSIVE);
+        guard.markDirty();
+        BucketPage::init(*guard, local_depth).insert(static_cast<uint32_t>(hash), row, len);
+        noteRows(1);
+        return;
+    }
+}
+
+// head 为 hash 所在桶的首页（没有溢出页）：哈希第 local_depth 位为 1 的行移到新桶，
+// 目录中原指向它、且该位为 1 的项改指新桶
+void HashFile::split_bucket(PageGuard &head, uint64_t hash) {
+    BufferPool &bufferPool = getDatabase().getBufferPool();
+    BucketPage bucket(*head);
+    const size_t depth = bucket.header->local_depth;
+    if (depth == global_depth) {
+        double_directory();
+    }
+
+    const size_t id = numPages++;
+    PageGuard guard = bufferPool.pinPage({file_id, id}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+    guard.markDirty();
+    head.markDirty();
+    BucketPage sibling = BucketPage::init(*guard, depth + 1);
+    bucket.header->local_depth = static_cast<uint8_t>(depth + 1);
+    for (size_t slot = 0; slot < bucket.header->count;) {
+        if ((bucket.slots[slot].hash >> depth) & 1) {
+            sibling.insert(bucket.slots[slot].hash, bucket.row(slot), bucket.slots[slot].length);
+            bucket.remove(slot);
+        } else {
+            ++slot;
+        }
+    }
+
+    const size_t first = (hash & ((size_t{1} << depth) - 1)) | (size_t{1} << depth);
+    const size_t step = size_t{2} << depth;
+    for (size_t i = first; i < directory.size(); i += step) {
+        directory[i] = id;
+    }
+    store_directory(first, directory.size(), step);
+}
+
+// 新的一半是旧目录的拷贝：只写新的一半，需要时分配新目录页
+void HashFile::double_directory() {
+    const size_t n = directory.size();
+    directory.resize(2 * n);
+    std::copy_n(directory.begin(), n, directory.begin() + static_cast<std::ptrdiff_t>(n));
+    ++global_depth;
+    while (dir_pages.size() * DIR_ENTRIES < directory.size()) {
+        dir_pages.push_back(numPages++);
+    }
+    store_directory(n, 2 * n, 1);
+    store_header();
+}
+
+void HashFile::store_header() const {
+    PageGuard guard = getDatabase().getBufferPool().pinPage({file_id, HEADER_PAGE}, AccessIntent::NORMAL,
+                                                            LatchMode::EXCLUSIVE);
+    guard.markDirty();
+    file_header(*guard)->global_depth = static_cast<uint8_t>(global_depth);
+    file_header(*guard)->dir_pages = static_cast<uint32_t>(dir_pages.size());
+    std::copy(dir_pages.begin(), dir_pages.end(), dir_page_ids(*guard));
+}
+
+// 写目录项 first, first + step, ... (< last)，每个目录页只 pin 一次
+void HashFile::store_directory(size_t first, size_t last, size_t step) const {
+    BufferPool &bufferPool = getDatabase().getBufferPool();
+    PageGuard guard;
+    size_t current = dir_pages.size();
+    for (size_t i = first; i < last; i += step) {
+        const size_t p = i / DIR_ENTRIES;
+        if (p != current) {
+            guard = bufferPool.pinPage({file_id, dir_pages[p]}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+            guard.markDirty();
+            (*guard)[0] = static_cast<uint8_t>(HashPageKind::DIRECTORY);
+            current = p;
+        }
+        dir_entries(*guard)[i % DIR_ENTRIES] = directory[i];
+    }
+}
+
+void HashFile::deleteTuple(const Iterator &it) {
+    if (isReadOnly()) {
+        throw std::logic_error("HashFile::deleteTuple: file is read-only");
+    }
+    if (it.page == 0 || it.page >= getNumPages()) {
+        throw std::out_of_range("HashFile::deleteTuple: page out of range");
+    }
+    field_t key;
+    {
+        PageGuard guard = getDatabase().getBufferPool().pinPage({file_id, it.page}, AccessIntent::NORMAL,
+                                                                LatchMode::SHARED);
+        const BucketPage bucket(*guard);
+        if (kind_of(*guard) != HashPageKind::BUCKET || it.slot >= bucket.header->count) {
+            throw std::out_of_range("HashFile::deleteTuple: slot out of range");
+        }
+        key = TupleView(td, bucket.row(it.slot)).get_field(key_index);
+    }
+    (void)erase(key);
+}
+
+bool HashFile::erase(const field_t &key) {
+    if (isReadOnly()) {
+        throw std::logic_error("HashFile::erase: file is read-only");
+    }
+    const field_t k = stored_key(td.type_of(key_index), key);
+    const uint64_t hash = key_hash(k);
+    const auto lock = lock_directory();
+    PageGuard head = pin_bucket(bucket_of(hash), LatchMode::EXCLUSIVE);
+    return for_each_page(file_id, head, LatchMode::EXCLUSIVE, [&](PageGuard &guard) {
+        BucketPage bucket(*guard);
+        const auto slot = find_slot(bucket, td, key_index, hash, k);
+        if (slot) {
+            guard.markDirty();
+            bucket.remove(*slot);
+            noteRows(-1);
+        }
+        return slot.has_value();
+    });
+}
+
+Iterator HashFile::find(const field_t &key) const {
+    const field_t k = stored_key(td.type_of(key_index), key);
+    const uint64_t hash = key_hash(k);
+    size_t head_id;
+    std::shared_lock<std::shared_mutex> lock;
+    if (getDatabase().getBufferPool().inSnapshot()) {
+        head_id = snapshot_bucket_of(hash);
+    } else {
+        lock = lock_directory();
+        head_id = bucket_of(hash);
+    }
+    if (head_id == 0) {
+        return end();
+    }
+    // 锁住首页后即可放开目录：分裂要先拿到首页的排他 latch
+    PageGuard head = pin_bucket(head_id, LatchMode::SHARED);
+    lock = {};
+    size_t page = 0;
+    size_t slot = 0;
+    for_each_page(file_id, head, LatchMode::SHARED, [&](PageGuard &guard) {
+        const auto found = find_slot(BucketPage(*guard), td, key_index, hash, k);
+        if (found) {
+            page = guard.getPageId().page;
+            slot = *found;
+        }
+        return found.has_value();
+    });
+    return page == 0 ? end() : Iterator(*this, page, slot);
+}
+
+Tuple HashFile::getTuple(const Iterator &it) const { return getView(it).to_tuple(); }
+
+TupleView HashFile::getView(const Iterator &it) const {
+    if (it.page == 0 || it.page >= getNumPages()) {
+        throw std::out_of_range("HashFile::getView: page out of range");
+    }
+    PageGuard guard = getDatabase().getBufferPool().pinPage({file_id, it.page}, AccessIntent::NORMAL,
+                                                            LatchMode::SHARED);
+    const BucketPage bucket(*guard);
+    if (kind_of(*guard) != HashPageKind::BUCKET || it.slot >= bucket.header->count) {
+        throw std::out_of_range("HashFile::getView: slot out of range");
+    }
+    return {td, bucket.row(it.slot)};
+}
+
+void HashFile::seek_page(Iterator &it, size_t p) const {
+    BufferPool &bufferPool = getDatabase().getBufferPool();
+    const size_t n = getNumPages();
+    for (; p < n; ++p) {
+        if (!isReadOnly()) {
+            bufferPool.readAhead({file_id, p}, n);
+        }
+        PageGuard guard = bufferPool.pinPage({file_id, p}, AccessIntent::SCAN, LatchMode::SHARED);
+        if (kind_of(*guard) == HashPageKind::BUCKET && BucketPage(*guard).header->count > 0) {
+            it.page = p;
+            it.slot = 0;
+            return;
+        }
+    }
+    it.page = 0;
+    it.slot = 0;
+}
+
+void HashFile::next(Iterator &it) const {
+    if (it.page == 0) {
+        return;
+    }
+    size_t count;
+    {
+        PageGuard guard = getDatabase().getBufferPool().pinPage({file_id, it.page}, AccessIntent::SCAN,
+                                                                LatchMode::SHARED);
+        count = kind_of(*guard) == HashPageKind::BUCKET ? BucketPage(*guard).header->count : 0;
+    }
+    if (it.slot + 1 < count) {
+        it.slot++;
+    } else {
+        seek_page(it, it.page + 1);
+    }
+}
+
+Iterator HashFile::begin() const {
+    Iterator it(*this, 0, 0);
+    seek_page(it, HEADER_PAGE + 1);
+    return it;
+}
+
+Iterator HashFile::end() const { return {*this, 0, 0}; }
+
+size_t HashFile::scanPage(Iterator &it, std::vector<Tuple> &out, size_t limit) const {
+    if (it.page == 0 || limit == 0) {
+        return 0;
+    }
+    size_t count = 0;
+    bool done;
+    {
+        PageGuard guard = getDatabase().getBufferPool().pinPage({file_id, it.page}, AccessIntent::SCAN,
+                                                                LatchMode::SHARED);
+        const BucketPage bucket(*guard);
+        const size_t n = kind_of(*guard) == HashPageKind::BUCKET ? bucket.header->count : 0;
+        for (; it.slot < n && count < limit; ++it.slot, ++count) {
+            out.push_back(td.deserialize(bucket.row(it.slot)));
+        }
+        done = it.slot >= n;
+    }
+    if (done) {
+        seek_page(it, it.page + 1);
+    }
+    return count;
+}
+
+std::vector<Iterator> HashFile::split(size_t parts) const {
+    const size_t n = getNumPages();
+    parts = std::clamp<size_t>(parts, 1, std::max<size_t>(n, 1));
+    std::vector<Iterator> starts;
+    for (size_t i = 0; i < parts; ++i) {
+        Iterator it(*this, 0, 0);
+        seek_page(it, std::max<size_t>(i * n / parts, HEADER_PAGE + 1));
+        if (it == end()) {
+            break;
+        }
+        if (starts.empty() || it != starts.back()) {
+            starts.push_back(it);
+        }
+    }
+    return starts;
+}
@@ -1,49 +1,192 @@
 #include <db/Database.hpp>
 #include <db/HeapFile.hpp>
 #include <db/HeapPage.hpp>
+#include <algorithm>
 #include <stdexcept>
 
 using namespace db;
 
-HeapFile::HeapFile(const std::string &name, const TupleDesc &td) : DbFile(name, td) {}
+namespace {
+// 非 buffered 模式下 insertTuples 一次 writePages 写出的新页数上限
+constexpr size_t WRITE_RUN_PAGES = 64;
+} // namespace
 
-// 插入到“最后一页的第一个空槽”。若最后一页满了，则新建一页写入。
+HeapFile::HeapFile(const std::string &name, const TupleDesc &td, bool buffered, PageLayout layout,
+                   PageCompression compression, FileAccess access)
+    : DbFile(name, td, compression, access), buffered(buffered), layout(layout), fsm(name + ".fsm") {
+    if (layout == PageLayout::PAX && !getTupleDesc().fixed()) {
+        throw std::logic_error("HeapFile: PAX layout needs fixed-length fields");
+    }
+    // 只读文件不插入，也不改写空闲空间映射
+    if (isReadOnly()) {
+        return;
+    }
+    // 映射比文件长说明文件被截断或重建过；没覆盖到的页直接读盘补齐（此时尚未注册到 Database）
+    const size_t n = getNumPages();
+    const size_t covered = std::min(fsm.size(), n);
+    fsm.resize(covered);
+    Page page{};
+    for (size_t p = covered; p < n; ++p) {
+        readPage(page, p);
+        fsm.set(p, HeapPage(page, getTupleDesc(), layout).hasFreeSlot());
+    }
+}
+
+bool HeapFile::isBuffered() const { return buffered; }
+
+PageLayout HeapFile::getLayout() const { return layout; }
+
+// 只读映射的页直接返回；buffered 模式下返回 BufferPool 中的帧（由 guard pin 住）；否则读入调用方提供的 scratch
+Page &HeapFile::fetchPage(size_t id, Page &scratch, PageGuard &guard, AccessIntent intent, LatchMode latch) const {
+    if (const Page *mapped = mappedPage(id)) {
+        return const_cast<Page &>(*mapped);
+    }
+    if (buffered) {
+        guard = getDatabase().getBufferPool().pinPage({file_id, id}, intent, latch);
+        return *guard;
+    }
+    readPage(scratch, id);
+    return scratch;
+}
+
+// buffered 模式下只标记脏页，由 BufferPool 负责落盘；否则立即写回
+void HeapFile::storePage(const Page &page, size_t id) const {
+    if (buffered) {
+        getDatabase().getBufferPool().markDirty({file_id, id});
+        return;
+    }
+    writePage(page, id);
+}
+
+// 插入到空闲空间映射给出的最低页；映射只是提示，页实际已满时清掉它的位再找
 void HeapFile::insertTuple(const Tuple &t) {
+    if (isReadOnly()) {
+        throw std::logic_error("HeapFile::insertTuple: file is read-only");
+    }
     if (!getTupleDesc().compatible(t)) {
         throw std::logic_error("HeapFile::insertTuple: tuple not compatible with schema");
     }
 
     const TupleDesc &td = getTupleDesc();
+    std::lock_guard lock(write_mtx);
     const size_t n = getNumPages();
 
-    if (n > 0) {
-        // 试图写入最后一页
-        Page page{};
-        readPage(page, n - 1);
-        HeapPage hp(page, td);
+    Page scratch{};
+    PageGuard guard;
+    for (size_t p = fsm.find(); p != FreeSpaceMap::npos && p < n; p = fsm.find()) {
+        Page &page = fetchPage(p, scratch, guard, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+        HeapPage hp(page, td, layout);
         if (hp.insertTuple(t)) {
-            writePage(page, n - 1);
+            storePage(page, p);
+            fsm.set(p, hp.hasFreeSlot());
+            noteRows(1);
             return;
         }
+        fsm.set(p, false);
     }
 
-    // 最后一页不存在或已满 -> 新建空页并写入
-    Page new_page{};                // 全 0 即空页
-    HeapPage hp_new(new_page, td);
+    // 没有页有空位 -> 新建空页并写入
+    if (buffered) {
+        guard = getDatabase().getBufferPool().pinPage({file_id, n}, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+    }
+    Page &new_page = buffered ? *guard : scratch;
+    new_page.fill(0);               // 全 0 即空页
+    HeapPage hp_new(new_page, td, layout);
     (void)hp_new.insertTuple(t);    // 首条一定能插入
-    writePage(new_page, n);         // 追加为第 n 页（0-based）
+    storePage(new_page, n);         // 追加为第 n 页（0-based）
+    numPages.store(n + 1, std::memory_order_release);
+    fsm.set(n, hp_new.hasFreeSlot());
+    noteRows(1);
+}
+
+// 先校验整批；之后每页只取一次、写一次：先填有空位的页，再依次追加新页
+void HeapFile::insertTuples(std::span<const Tuple> tuples) {
+    if (isReadOnly()) {
+        throw std::logic_error("HeapFile::insertTuples: file is read-only");
+    }
+    const TupleDesc &td = getTupleDesc();
+    for (const Tuple &t : tuples) {
+        if (!td.compatible(t)) {
+            throw std::logic_error("HeapFile::insertTuples: tuple not compatible with schema");
+        }
+    }
+
+    std::lock_guard lock(write_mtx);
+    size_t i = 0;
+    Page scratch{};
+    PageGuard guard;
+    // 非 buffered 模式下，文件末尾的新页攒成一段后用一次 writePages 顺序写出；
+    // 新页写好后才发布到 numPages，快照扫描不会读到还没写出的页
+    std::vector<Page> pending;
+    size_t pending_first = 0;
+    size_t pages = getNumPages();
+    const auto flush = [&] {
+        std::vector<const Page *> run;
+        run.reserve(pending.size());
+        for (const Page &pg : pending) run.push_back(&pg);
+        writePages(run, pending_first);
+        numPages.store(pending_first + pending.size(), std::memory_order_release);
+        pending.clear();
+    };
+    while (i < tuples.size()) {
+        size_t p = fsm.find();
+        const bool fresh = p == FreeSpaceMap::npos || p >= pages;
+        Page *page;
+        if (fresh) {
+            p = pages;
+            if (buffered) {
+                guard = getDatabase().getBufferPool().pinPage({file_id, p}, AccessIntent::NORMAL,
+                                                              LatchMode::EXCLUSIVE);
+                page = &*guard;
+            } else {
+                if (pending.size() == WRITE_RUN_PAGES) flush();
+                if (pending.empty()) {
+                    pending.reserve(WRITE_RUN_PAGES);
+                    pending_first = p;
+                }
+                page = &pending.emplace_back();
+            }
+            page->fill(0);
+        } else {
+            if (!pending.empty()) flush();
+            page = &fetchPage(p, scratch, guard, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+        }
+
+        HeapPage hp(*page, td, layout);
+        const size_t first = i;
+        while (i < tuples.size() && hp.insertTuple(tuples[i])) {
+            ++i;
+        }
+        if (i != first && (buffered || !fresh)) {
+            storePage(*page, p);
+        }
+        if (fresh) {
+            ++pages;
+            if (buffered) {
+                numPages.store(pages, std::memory_order_release);
+            }
+        }
+        fsm.set(p, hp.hasFreeSlot());
+    }
+    if (!pending.empty()) flush();
+    noteRows(static_cast<int64_t>(tuples.size()));
 }
 
 // 根据迭代器定位并删除槽位（页在范围内由 HeapPage 自行做槽位校验）
 void HeapFile::deleteTuple(const Iterator &it) {
+    if (isReadOnly()) throw std::logic_error("HeapFile::deleteTuple: file is read-only");
+    std::lock_guard lock(write_mtx);
     const size_t n = getNumPages();
     if (it.page >= n) throw std::out_of_range("HeapFile::deleteTuple: page out of range");
 
-    Page page{};
-    readPage(page, it.page);
-    HeapPage hp(page, getTupleDesc());
+    Page scratch{};
+    PageGuard guard;
+    Page &page = fetchPage(it.page, scratch, guard, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+    HeapPage hp(page, getTupleDesc(), layout);
     hp.deleteTuple(it.slot);
-    writePage(page, it.page);
+    storePage(page, it.page);
+    fsm.set(it.page, true);
+    noteRows(-1);
 }
 
 // 读取迭代器指定位置的元组
@@ -51,12 +194,49 @@ Tuple HeapFile::getTuple(const Iterator &it) const {
     const size_t n = getNumPages();
     if (it.page >= n) throw std::out_of_range("HeapFile::getTuple: page out of range");
 
-    Page page{};
-    readPage(page, it.page);
-    const HeapPage hp(page, getTupleDesc());
+    Page scratch{};
+    PageGuard guard;
+    Page &page = fetchPage(it.page, scratch, guard, AccessIntent::SCAN);
+    const HeapPage hp(page, getTupleDesc(), layout);
     return hp.getTuple(it.slot);
 }
 
+// 视图指向 BufferPool 中的帧或只读映射，因此只在 buffered 或映射模式下可用
+TupleView HeapFile::getView(const Iterator &it) const {
+    if (!buffered && !isReadOnly()) throw std::logic_error("HeapFile::getView: file is not buffered");
+    if (it.page >= getNumPages()) throw std::out_of_range("HeapFile::getView: page out of range");
+
+    const Page *mapped = mappedPage(it.page);
+    Page &page = mapped != nullptr ? const_cast<Page &>(*mapped)
+                                   : getDatabase().getBufferPool().getPage({file_id, it.page}, AccessIntent::SCAN);
+    const HeapPage hp(page, getTupleDesc(), layout);
+    return hp.getView(it.slot);
+}
+
+void HeapFile::seekPage(Iterator &it, size_t p) const {
+    const size_t n = getNumPages();
+    Page scratch{};
+    PageGuard guard;
+    for (; p < n; ++p) {
+        if (isReadOnly()) {
+            // 映射由内核预读：每到一个窗口起点提示一次
+            if (p % DEFAULT_READ_AHEAD_PAGES == 0) adviseWillNeed(p, DEFAULT_READ_AHEAD_PAGES);
+        } else if (buffered) {
+            getDatabase().getBufferPool().readAhead({file_id, p}, n);
+        }
+        Page &page = fetchPage(p, scratch, guard, AccessIntent::SCAN);
+        HeapPage hp(page, getTupleDesc(), layout);
+        size_t b = hp.begin();
+        if (b != hp.end()) {
+            it.page = p;
+            it.slot = b;
+            return;
+        }
+    }
+    it.page = n;
+    it.slot = 0;
+}
+
 // 将迭代器推进到下一个已占用槽；若到末尾，设为 end() 哨兵
 void HeapFile::next(Iterator &it) const {
     const size_t n = getNumPages();
@@ -67,9 +247,10 @@ void HeapFile::next(Iterator &it) const {
     }
 
     // 当前页内尝试下一个
-    Page page{};
-    readPage(page, it.page);
-    HeapPage hp(page, getTupleDesc());
+    Page scratch{};
+    PageGuard guard;
+    Page &page = fetchPage(it.page, scratch, guard, AccessIntent::SCAN);
+    HeapPage hp(page, getTupleDesc(), layout);
 
     size_t s = it.slot;
     hp.next(s);
@@ -79,34 +260,134 @@ void HeapFile::next(Iterator &it) const {
     }
 
     // 跨页寻找下一非空页
+    seekPage(it, it.page + 1);
+}
+
+Iterator HeapFile::begin() const {
+    adviseSequential();
+    Iterator it(*this, 0, 0);
+    seekPage(it, 0);
+    return it;
+}
+
+// 一次取页，按位图顺序读出本页的元组
+size_t HeapFile::scanPage(Iterator &it, std::vector<Tuple> &out, size_t limit) const {
+    if (it.page >= getNumPages() || limit == 0) {
+        return 0;
+    }
+
+    Page scratch{};
+    PageGuard guard;
+    Page &page = fetchPage(it.page, scratch, guard, AccessIntent::SCAN);
+    HeapPage hp(page, getTupleDesc(), layout);
+
+    size_t count = 0;
+    size_t s = it.slot;
+    for (; s != hp.end() && count < limit; hp.next(s), ++count) {
+        out.push_back(hp.getTuple(s));
+    }
+
+    if (s != hp.end()) {
+        it.slot = s;
+    } else {
+        seekPage(it, it.page + 1);
+    }
+    return count;
+}
+
+// 与 scanPage、seekPage 相同，只是每页都先 co_await；等待时不持 latch
+Task<size_t> HeapFile::scanPageAsync(Iterator &it, std::vector<Tuple> &out, size_t limit) const {
+    if (!buffered) {
+        co_return scanPage(it, out, limit);
+    }
+    const size_t n = getNumPages();
+    if (it.page >= n || limit == 0) {
+        co_return 0;
+    }
+    BufferPool &bufferPool = getDatabase().getBufferPool();
+    size_t count = 0;
+    {
+        const PageGuard guard = co_await bufferPool.getPageAsync({file_id, it.page}, AccessIntent::SCAN);
+        HeapPage hp(*guard, getTupleDesc(), layout);
+        size_t s = it.slot;
+        for (; s != hp.end() && count < limit; hp.next(s), ++count) {
+            out.push_back(hp.getTuple(s));
+        }
+        if (s != hp.end()) {
+            it.slot = s;
+            co_return count;
+        }
+    }
     for (size_t p = it.page + 1; p < n; ++p) {
-        Page pg{};
-        readPage(pg, p);
-        HeapPage hpg(pg, getTupleDesc());
-        size_t b = hpg.begin();
-        if (b != hpg.end()) {
+        bufferPool.readAhead({file_id, p}, n);
+        const PageGuard guard = co_await bufferPool.getPageAsync({file_id, p}, AccessIntent::SCAN);
+        HeapPage hp(*guard, getTupleDesc(), layout);
+        if (hp.begin() != hp.end()) {
             it.page = p;
-            it.slot = b;
-            return;
+            it.slot = hp.begin();
+            co_return count;
         }
     }
-
     it.page = n;
     it.slot = 0;
+    co_return count;
 }
 
-Iterator HeapFile::begin() const {
+// 定长 schema 先对整页该列求值得到位图，只反序列化命中的占用槽；变长页逐槽在视图上求值
+size_t HeapFile::scanPageWhere(Iterator &it, std::vector<Tuple> &out, size_t limit, const Predicate &pred) const {
+    if (it.page >= getNumPages() || limit == 0) {
+        return 0;
+    }
+    const TupleDesc &td = getTupleDesc();
+    pred.check(td);
+
+    Page scratch{};
+    PageGuard guard;
+    Page &page = fetchPage(it.page, scratch, guard, AccessIntent::SCAN);
+    HeapPage hp(page, td, layout);
+
+    // 每槽至少占 1 字节，槽数不超过页大小
+    uint64_t mask[DEFAULT_PAGE_SIZE / 64 + 1];
+    const size_t first = it.slot;
+    const bool columnar = td.fixed();
+    if (columnar) {
+        const HeapPage::Column col = hp.column(pred.field);
+        pred.evaluate(col.data + first * col.stride, col.stride, hp.end() - first, mask);
+    }
+
+    size_t count = 0;
+    size_t s = first;
+    for (; s != hp.end() && count < limit; hp.next(s), ++count) {
+        const size_t bit = s - first;
+        if (columnar ? (mask[bit / 64] >> (bit % 64)) & 1 : pred.matches(hp.getView(s))) {
+            out.push_back(hp.getTuple(s));
+        }
+    }
+
+    if (s != hp.end()) {
+        it.slot = s;
+    } else {
+        seekPage(it, it.page + 1);
+    }
+    return count;
+}
+
+// 按页号均分；相邻两段落到同一起点（中间全是空页）时合并
+std::vector<Iterator> HeapFile::split(size_t parts) const {
     const size_t n = getNumPages();
-    for (size_t p = 0; p < n; ++p) {
-        Page page{};
-        readPage(page, p);
-        HeapPage hp(page, getTupleDesc());
-        size_t b = hp.begin();
-        if (b != hp.end()) {
-            return Iterator(*this, p, b);
+    parts = std::clamp<size_t>(parts, 1, std::max<size_t>(n, 1));
+    std::vector<Iterator> starts;
+    for (size_t i = 0; i < parts; ++i) {
+        Iterator it(*this, 0, 0);
+        seekPage(it, i * n / parts);
+        if (it.page >= n) {
+            break;
+        }
+        if (starts.empty() || it != starts.back()) {
+            starts.push_back(it);
         }
     }
-    return Iterator(*this, n, 0);
+    return starts;
 }
 
 Iterator HeapFile::end() const {
@@ -1,15 +1,73 @@
 #include <db/Database.hpp>
 #include <db/HeapPage.hpp>
+#include <algorithm>
+#include <bit>
 #include <cstring>
 
 using namespace db;
 
+namespace {
+// 头区是 MSB-first 的位图：按大端读 8 字节，第 i 个槽即第 i 个最高位；不足 8 字节时补 0
+inline uint64_t load_bits(const uint8_t *p, size_t n) {
+    uint64_t w = 0;
+    if (n >= 8) {
+        std::memcpy(&w, p, 8);
+    } else {
+        uint8_t buf[8] = {};
+        std::memcpy(buf, p, n);
+        std::memcpy(&w, buf, 8);
+    }
+    if constexpr (std::endian::native == std::endian::little) {
+        w = __builtin_bswap64(w);
+    }
+    return w;
+}
+
+// 变长页：| uint16 目录项数 | uint16 单元区起点 | 目录 {uint16 偏移, uint16 长度}[项数] | 空闲 | 单元（自页尾向前分配）|
+// 长度为 0 的目录项为空槽；槽号即目录下标，删除和整理都不改变其它元组的槽号
+constexpr size_t DIR_HEADER = 2 * sizeof(uint16_t);
+constexpr size_t DIR_ENTRY  = 2 * sizeof(uint16_t);
+
+inline uint16_t load_u16(const uint8_t *p) {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void store_u16(uint8_t *p, size_t v) {
+    const auto u = static_cast<uint16_t>(v);
+    std::memcpy(p, &u, sizeof(u));
+}
+} // namespace
+
+
+HeapPage::HeapPage(Page &page, const TupleDesc &td, PageLayout layout)
+    : td(td), layout(layout), variable(!td.fixed()) {
+    if (variable) {
+        if (layout == PageLayout::PAX) {
+            throw std::logic_error("HeapPage: PAX layout needs fixed-length fields");
+        }
+        if (DIR_HEADER + DIR_ENTRY + td.max_length() > DEFAULT_PAGE_SIZE) {
+            throw std::logic_error("HeapPage: row does not fit in a page");
+        }
+        header = page.data();
+        data = nullptr;
+        capacity = load_u16(header);
+        // 全 0 的新页：单元区为空，起点即页尾
+        cell_top = capacity == 0 ? DEFAULT_PAGE_SIZE : load_u16(header + sizeof(uint16_t));
+        for (size_t i = 0; i < capacity; ++i) {
+            if (const size_t len = entryLen(i); len != 0) {
+                ++live;
+                used += len;
+            }
+        }
+        return;
+    }
 
-HeapPage::HeapPage(Page &page, const TupleDesc &td) : td(td) {
     const size_t P = DEFAULT_PAGE_SIZE;
     const size_t T = td.length();
 
-    // 关键：考虑到每条记录需要 1 个头位(bit)
+    // 关键：考虑到每条记录需要 1 个头位(bit)；PAX 只是重排数据区，容量相同
     capacity = (8 * P) / (8 * T + 1);
 
     // 头区字节数
@@ -18,65 +76,209 @@ HeapPage::HeapPage(Page &page, const TupleDesc &td) : td(td) {
     // 直接在页缓冲里定位头区和数据区（无额外分配）
     header = page.data();                  // 前 headerBytes 字节是头
     data   = page.data() + headerBytes;    // 后面紧跟数据
+
+    // 一次数 64 个头位；最后一个字节中超出 capacity 的位不计
+    for (size_t b = 0; b < headerBytes; b += 8) {
+        live += static_cast<size_t>(std::popcount(load_bits(header + b, std::min<size_t>(8, headerBytes - b))));
+    }
+    if (const size_t rest = capacity % 8; rest != 0) {
+        live -= static_cast<size_t>(std::popcount(static_cast<uint8_t>(header[headerBytes - 1] & (0xFFu >> rest))));
+    }
 }
 
+size_t HeapPage::entryOff(size_t slot) const {
+    return load_u16(header + DIR_HEADER + slot * DIR_ENTRY);
+}
 
-size_t HeapPage::begin() const {
+size_t HeapPage::entryLen(size_t slot) const {
+    return load_u16(header + DIR_HEADER + slot * DIR_ENTRY + sizeof(uint16_t));
+}
+
+void HeapPage::setEntry(size_t slot, size_t off, size_t len) {
+    store_u16(header + DIR_HEADER + slot * DIR_ENTRY, off);
+    store_u16(header + DIR_HEADER + slot * DIR_ENTRY + sizeof(uint16_t), len);
+}
+
+// 目录与单元之间的连续空闲字节
+size_t HeapPage::gap() const {
+    return cell_top - DIR_HEADER - capacity * DIR_ENTRY;
+}
+
+// 把存活的单元按槽号顺序重新紧排到页尾，删除留下的空洞并入中间的空闲区
+void HeapPage::compact() {
+    Page cells;
+    size_t top = DEFAULT_PAGE_SIZE;
     for (size_t i = 0; i < capacity; ++i) {
-        const size_t  byte = i >> 3;
-        const uint8_t mask = static_cast<uint8_t>(0x80u >> (i & 7)); // MSB-first
-        if (header[byte] & mask) return i;
+        if (const size_t len = entryLen(i); len != 0) {
+            top -= len;
+            std::memcpy(cells.data() + top, header + entryOff(i), len);
+            setEntry(i, top, len);
+        }
+    }
+    std::memcpy(header + top, cells.data() + top, DEFAULT_PAGE_SIZE - top);
+    cell_top = top;
+    store_u16(header + sizeof(uint16_t), cell_top);
+}
+
+const uint8_t *HeapPage::rowAt(size_t slot) const {
+    return variable ? header + entryOff(slot) : data + slot * td.length();
+}
+
+// 第一个 >= from 且占用状态为 occupied 的槽；没有则为 capacity
+size_t HeapPage::find(size_t from, bool occupied) const {
+    if (variable) {
+        for (size_t i = from; i < capacity; ++i) {
+            if ((entryLen(i) != 0) == occupied) return i;
+        }
+        return capacity;
+    }
+    const size_t headerBytes = (capacity + 7) / 8;
+    size_t skip = from & 7;   // 首字中要跳过的高位数
+    for (size_t b = from >> 3; b < headerBytes; b += 8, skip = 0) {
+        uint64_t w = load_bits(header + b, std::min<size_t>(8, headerBytes - b));
+        if (!occupied) w = ~w;   // 补出来的 0 字节取反后落在 capacity 之后，由 min 截掉
+        w &= ~uint64_t{0} >> skip;
+        if (w != 0) {
+            return std::min(capacity, b * 8 + static_cast<size_t>(std::countl_zero(w)));
+        }
     }
     return capacity;
 }
 
+uint8_t *HeapPage::field_ptr(size_t slot, size_t field) const {
+    if (layout == PageLayout::ROW) {
+        return data + slot * td.length() + td.offset_of(field);
+    }
+    return data + capacity * td.offset_of(field) + slot * td.size_of(field);
+}
+
+size_t HeapPage::begin() const {
+    return live == 0 ? capacity : find(0, true);
+}
+
 size_t HeapPage::end() const {
     return capacity;
 }
 
+size_t HeapPage::size() const {
+    return live;
+}
+
 bool HeapPage::insertTuple(const Tuple &t) {
-    for (size_t i = 0; i < capacity; ++i) {
-        const size_t  byte = i >> 3;
-        const uint8_t mask = static_cast<uint8_t>(0x80u >> (i & 7));
-        if ((header[byte] & mask) == 0) {              // 空位
-            td.serialize(data + i * td.length(), t);   // 写入
-            header[byte] |= mask;                      // 置位
-            return true;
+    if (variable) {
+        const size_t len = td.length_of(t);
+        const size_t i = find(free_hint, false);
+        const size_t need = len + (i == capacity ? DIR_ENTRY : 0);   // 没有空目录项时要追加一项
+        if (DEFAULT_PAGE_SIZE - DIR_HEADER - capacity * DIR_ENTRY - used < need) return false;
+        if (gap() < need) compact();
+        if (i == capacity) {
+            ++capacity;
+            store_u16(header, capacity);
         }
+        cell_top -= len;
+        store_u16(header + sizeof(uint16_t), cell_top);
+        td.serialize(header + cell_top, t);
+        setEntry(i, cell_top, len);
+        ++live;
+        used += len;
+        free_hint = i + 1;
+        return true;
     }
-    return false; // 满页
+    if (live == capacity) return false; // 满页
+    const size_t i = find(free_hint, false);
+    if (i == capacity) return false;
+    if (layout == PageLayout::ROW) {
+        td.serialize(data + i * td.length(), t);               // 写入
+    } else {
+        // 先按行序列化，再把各字段分散到各自的 minipage
+        uint8_t row[DEFAULT_PAGE_SIZE];
+        td.serialize(row, t);
+        for (size_t f = 0; f < td.size(); ++f) {
+            std::memcpy(field_ptr(i, f), row + td.offset_of(f), td.size_of(f));
+        }
+    }
+    header[i >> 3] |= static_cast<uint8_t>(0x80u >> (i & 7));  // 置位
+    ++live;
+    free_hint = i + 1;
+    return true;
 }
 
 void HeapPage::deleteTuple(size_t slot) {
     if (slot >= capacity) throw std::out_of_range("slot OOB");
+    if (variable) {
+        const size_t len = entryLen(slot);
+        if (len == 0) throw std::logic_error("slot empty");
+        const size_t off = entryOff(slot);
+        std::memset(header + off, 0, len);
+        if (off == cell_top) {
+            cell_top += len;   // 最靠前的单元直接还给空闲区，其余的留到 compact
+        }
+        setEntry(slot, 0, 0);
+        // 末尾的空目录项一并收回
+        while (capacity > 0 && entryLen(capacity - 1) == 0) --capacity;
+        if (capacity == 0) cell_top = DEFAULT_PAGE_SIZE;
+        store_u16(header, capacity);
+        store_u16(header + sizeof(uint16_t), cell_top);
+        --live;
+        used -= len;
+        free_hint = std::min(free_hint, slot);
+        return;
+    }
     const size_t  byte = slot >> 3;
     const uint8_t mask = static_cast<uint8_t>(0x80u >> (slot & 7));
     if ((header[byte] & mask) == 0) throw std::logic_error("slot empty");
-    std::memset(data + slot * td.length(), 0, td.length());
+    if (layout == PageLayout::ROW) {
+        std::memset(data + slot * td.length(), 0, td.length());
+    } else {
+        for (size_t f = 0; f < td.size(); ++f) {
+            std::memset(field_ptr(slot, f), 0, td.size_of(f));
+        }
+    }
     header[byte] &= ~mask;
+    --live;
+    free_hint = std::min(free_hint, slot);
 }
 
 Tuple HeapPage::getTuple(size_t slot) const {
     if (slot >= capacity) throw std::out_of_range("slot OOB");
-    const size_t  byte = slot >> 3;
-    const uint8_t mask = static_cast<uint8_t>(0x80u >> (slot & 7));
-    if ((header[byte] & mask) == 0) throw std::logic_error("slot empty");
-    return td.deserialize(data + slot * td.length());
+    if (empty(slot)) throw std::logic_error("slot empty");
+    if (layout == PageLayout::ROW) {
+        return td.deserialize(rowAt(slot));
+    }
+    return TupleView(td, data, capacity, slot).to_tuple();
+}
+
+TupleView HeapPage::getView(size_t slot) const {
+    if (slot >= capacity) throw std::out_of_range("slot OOB");
+    if (empty(slot)) throw std::logic_error("slot empty");
+    if (layout == PageLayout::ROW) {
+        return {td, rowAt(slot)};
+    }
+    return {td, data, capacity, slot};
+}
+
+HeapPage::Column HeapPage::column(size_t field) const {
+    if (field >= td.size()) throw std::out_of_range("HeapPage::column: field out of range");
+    if (variable) throw std::logic_error("HeapPage::column: rows have variable length");
+    return {field_ptr(0, field), layout == PageLayout::ROW ? td.length() : td.size_of(field)};
+}
+
+bool HeapPage::hasFreeSlot() const {
+    if (variable) {
+        // 保守：放得下最长的行（含一个新目录项）才算有空位，这样 true 时插入一定成功
+        return DEFAULT_PAGE_SIZE - DIR_HEADER - capacity * DIR_ENTRY - used >= td.max_length() + DIR_ENTRY;
+    }
+    return live < capacity;
 }
 
 bool HeapPage::empty(size_t slot) const {
     if (slot >= capacity) return true;
+    if (variable) return entryLen(slot) == 0;
     const size_t  byte = slot >> 3;
     const uint8_t mask = static_cast<uint8_t>(0x80u >> (slot & 7));
     return (header[byte] & mask) == 0;
 }
 
 void HeapPage::next(size_t &slot) const {
-    if (slot >= capacity) { slot = capacity; return; }
-    for (size_t i = slot + 1; i < capacity; ++i) {
-        const size_t  byte = i >> 3;
-        const uint8_t mask = static_cast<uint8_t>(0x80u >> (i & 7));
-        if (header[byte] & mask) { slot = i; return; }
-    }
-    slot = capacity;
+    slot = slot >= capacity ? capacity : find(slot + 1, true);
 }
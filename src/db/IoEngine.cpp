@@ -0,0 +1,227 @@
+#include <db/DbFile.hpp>
+#include <db/IoEngine.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define DB_HAVE_IO_URING 1
+#endif
+
+using namespace db;
+
+IoEngine::IoEngine(unsigned queue_depth) {
+    if (queue_depth == 0) {
+        throw std::logic_error("IoEngine: queue depth must be positive");
+    }
+    if (!setupRing(queue_depth)) {
+        ring_fd = -1;
+    }
+}
+
+IoEngine::~IoEngine() {
+    if (sqes != nullptr) munmap(sqes, sqes_size);
+    if (cq_ring != nullptr && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+    if (sq_ring != nullptr) munmap(sq_ring, sq_ring_size);
+    if (ring_fd != -1) close(ring_fd);
+}
+
+bool IoEngine::usesIoUring() const { return ring_fd != -1; }
+
+bool IoEngine::setupRing(unsigned queue_depth) {
+#ifdef DB_HAVE_IO_URING
+    io_uring_params p{};
+    const int fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &p));
+    if (fd < 0) {
+        return false;
+    }
+    ring_fd = fd;
+
+    sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    void *sq = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        close(fd);
+        ring_fd = -1;
+        return false;
+    }
+    sq_ring = sq;
+
+    if (single_mmap) {
+        cq_ring = sq_ring;
+    } else {
+        void *cq = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                        IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            munmap(sq_ring, sq_ring_size);
+            sq_ring = nullptr;
+            close(fd);
+            ring_fd = -1;
+            return false;
+        }
+        cq_ring = cq;
+    }
+
+    sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    void *s = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (s == MAP_FAILED) {
+        if (cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        munmap(sq_ring, sq_ring_size);
+        sq_ring = cq_ring = nullptr;
+        close(fd);
+        ring_fd = -1;
+        return false;
+    }
+    sqes = s;
+
+    auto *sqb = static_cast<uint8_t *>(sq_ring);
+    auto *cqb = static_cast<uint8_t *>(cq_ring);
+    sq_head  = reinterpret_cast<unsigned *>(sqb + p.sq_off.head);
+    sq_tail  = reinterpret_cast<unsigned *>(sqb + p.sq_off.tail);
+    sq_mask  = reinterpret_cast<unsigned *>(sqb + p.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned *>(sqb + p.sq_off.array);
+    cq_head  = reinterpret_cast<unsigned *>(cqb + p.cq_off.head);
+    cq_tail  = reinterpret_cast<unsigned *>(cqb + p.cq_off.tail);
+    cq_mask  = reinterpret_cast<unsigned *>(cqb + p.cq_off.ring_mask);
+    cqes     = cqb + p.cq_off.cqes;
+    entries  = p.sq_entries;
+    return true;
+#else
+    (void)queue_depth;
+    return false;
+#endif
+}
+
+void IoEngine::runSync(const IoRequest &req) {
+    if (req.op == IoOp::READ) {
+        req.file->readPage(*req.buf, req.page);
+    } else {
+        req.file->writePage(*req.buf, req.page);
+    }
+}
+
+void IoEngine::runRing(std::vector<IoRequest> &batch, size_t first, size_t count) {
+#ifdef DB_HAVE_IO_URING
+    auto *sqe_array = static_cast<io_uring_sqe *>(sqes);
+    auto *cqe_array = static_cast<io_uring_cqe *>(cqes);
+
+    // 延迟从整批提交时算起
+    const auto start = std::chrono::steady_clock::now();
+    // 本引擎是唯一的生产者（持有 mtx），tail 可以直接读
+    unsigned tail = *sq_tail;
+    const unsigned mask = *sq_mask;
+    for (size_t i = 0; i < count; ++i) {
+        const IoRequest &req = batch[first + i];
+        const unsigned idx = tail & mask;
+        io_uring_sqe *sqe = &sqe_array[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = req.op == IoOp::READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = req.file->fd;
+        sqe->addr = reinterpret_cast<uint64_t>(req.buf->data());
+        sqe->len = static_cast<uint32_t>(DEFAULT_PAGE_SIZE);
+        sqe->off = static_cast<uint64_t>(req.page) * DEFAULT_PAGE_SIZE;
+        sqe->user_data = first + i;
+        sq_array[idx] = idx;
+        ++tail;
+    }
+    __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+    std::exception_ptr error;
+    unsigned to_submit = static_cast<unsigned>(count);
+    size_t completed = 0;
+    while (completed < count) {
+        const int r = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                               static_cast<unsigned>(count - completed),
+                                               IORING_ENTER_GETEVENTS, nullptr, 0));
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("IoEngine: io_uring_enter failed: ") + std::strerror(errno));
+        }
+        to_submit -= std::min(to_submit, static_cast<unsigned>(r));
+
+        unsigned head = *cq_head;
+        const unsigned ctail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != ctail; ++head, ++completed) {
+            const io_uring_cqe &cqe = cqe_array[head & *cq_mask];
+            const IoRequest &req = batch[cqe.user_data];
+            if (cqe.res == static_cast<int>(DEFAULT_PAGE_SIZE)) {
+                if (req.op == IoOp::READ) {
+                    req.file->noteRead(req.page, start);
+                } else {
+                    req.file->noteWrite(req.page, 1, start);
+                }
+                continue;
+            }
+            // 短读（文件末尾）、短写或内核不支持该操作：退回同步路径重做整页
+            try {
+                runSync(req);
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+#else
+    (void)batch;
+    (void)first;
+    (void)count;
+#endif
+}
+
+void IoEngine::run(std::vector<IoRequest> &batch) {
+    std::lock_guard lock(mtx);
+    if (ring_fd == -1) {
+        std::exception_ptr error;
+        for (const IoRequest &req : batch) {
+            try {
+                runSync(req);
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return;
+    }
+    // 压缩文件的页不在固定偏移处，只能走同步路径
+    std::exception_ptr error;
+    std::vector<IoRequest> raw;
+    raw.reserve(batch.size());
+    for (const IoRequest &req : batch) {
+        if (!req.file->isCompressed()) {
+            raw.push_back(req);
+            continue;
+        }
+        try {
+            runSync(req);
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    for (size_t first = 0; first < raw.size(); first += entries) {
+        try {
+            runRing(raw, first, std::min<size_t>(entries, raw.size() - first));
+        } catch (...) {
+            if (!error) error = std::current_exception();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,80 @@
+#include <db/BufferPool.hpp>
+#include <db/IoScheduler.hpp>
+#include <stdexcept>
+
+using namespace db;
+
+namespace {
+thread_local IoScheduler *active = nullptr;
+} // namespace
+
+IoScheduler::IoScheduler(BufferPool &pool) : pool(pool) {}
+
+void IoScheduler::spawn(Task<> task) {
+    if (task.done()) {
+        return;
+    }
+    ready.push_back(task.handle);
+    tasks.push_back(std::move(task));
+}
+
+IoScheduler *IoScheduler::current() { return active; }
+
+void IoScheduler::wait(const PageId &pid, AccessIntent intent, std::coroutine_handle<> handle) {
+    waiting.push_back({pid, intent, handle});
+}
+
+// 按访问意图分两批预取；预取失败（I/O 错误、帧都被 pin 住）不在这里处理，
+// 等待者醒来后 pinPage 自己同步读，错误从那里抛给协程
+void IoScheduler::loadWaiting() {
+    std::vector<PageId> normal;
+    std::vector<PageId> scan;
+    for (const Waiter &w : waiting) {
+        (w.intent == AccessIntent::SCAN ? scan : normal).push_back(w.pid);
+    }
+    try {
+        if (!normal.empty()) {
+            pool.prefetch(normal, AccessIntent::NORMAL);
+        }
+        if (!scan.empty()) {
+            pool.prefetch(scan, AccessIntent::SCAN);
+        }
+    } catch (const std::runtime_error &) {
+    }
+    ++rounds;
+    loads += waiting.size();
+    for (const Waiter &w : waiting) {
+        ready.push_back(w.handle);
+    }
+    waiting.clear();
+}
+
+void IoScheduler::run() {
+    if (active != nullptr) {
+        throw std::logic_error("IoScheduler::run: a scheduler is already running on this thread");
+    }
+    // 协程的异常留在各自的 Task 里；能从这里抛出的只有预取本身的误用错误
+    active = this;
+    try {
+        while (!ready.empty() || !waiting.empty()) {
+            while (!ready.empty()) {
+                const std::coroutine_handle<> h = ready.front();
+                ready.pop_front();
+                h.resume();
+            }
+            if (!waiting.empty()) {
+                loadWaiting();
+            }
+        }
+    } catch (...) {
+        active = nullptr;
+        throw;
+    }
+    active = nullptr;
+
+    std::vector<Task<>> finished = std::move(tasks);
+    tasks.clear();
+    for (Task<> &task : finished) {
+        task.await_resume();
+    }
+}
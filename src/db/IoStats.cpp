@@ -0,0 +1,141 @@
+#include <db/IoStats.hpp>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+using namespace db;
+
+void LatencyHistogram::record(uint64_t ns) {
+    const size_t b = ns < 2 ? 0 : std::min<size_t>(std::bit_width(ns) - 1, BUCKETS - 1);
+    buckets[b].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t n = 0;
+    for (const auto &b : buckets) {
+        n += b.load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+uint64_t LatencyHistogram::bucket(size_t i) const { return buckets.at(i).load(std::memory_order_relaxed); }
+
+// 先读出各桶，在这一份上求分位，避免并发记录让累计数对不上
+uint64_t LatencyHistogram::percentile(double q) const {
+    std::array<uint64_t, BUCKETS> counts;
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const double target = std::clamp(q, 0.0, 1.0) * static_cast<double>(total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (counts[i] != 0 && static_cast<double>(seen) >= target) {
+            return i + 1 == BUCKETS ? UINT64_MAX : (uint64_t{1} << (i + 1)) - 1;
+        }
+    }
+    return UINT64_MAX;
+}
+
+PageHistory::Ring::Ring(size_t capacity) : capacity(capacity), ids(std::make_unique<std::atomic<size_t>[]>(capacity)) {}
+
+PageHistory::PageHistory(size_t limit) : limit(limit) {}
+
+PageHistory::Ring *PageHistory::allocate() {
+    std::lock_guard lock(mtx);
+    Ring *r = ring.load(std::memory_order_acquire);
+    const size_t n = limit.load(std::memory_order_relaxed);
+    if (r == nullptr && n != 0) {
+        rings.push_back(std::make_unique<Ring>(n));
+        r = rings.back().get();
+        ring.store(r, std::memory_order_release);
+    }
+    return r;
+}
+
+void PageHistory::record(size_t first_id, size_t count) {
+    Ring *r = ring.load(std::memory_order_acquire);
+    if (r == nullptr && (limit.load(std::memory_order_relaxed) == 0 || (r = allocate()) == nullptr)) {
+        return;
+    }
+    const uint64_t at = r->recorded.fetch_add(count, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        r->ids[(at + i) % r->capacity].store(first_id + i, std::memory_order_relaxed);
+    }
+}
+
+std::vector<size_t> PageHistory::ids() const {
+    std::vector<size_t> out;
+    const Ring *r = ring.load(std::memory_order_acquire);
+    if (r == nullptr) {
+        return out;
+    }
+    const uint64_t recorded = r->recorded.load(std::memory_order_relaxed);
+    const uint64_t n = std::min<uint64_t>(recorded, r->capacity);
+    out.reserve(n);
+    for (uint64_t i = recorded - n; i < recorded; ++i) {
+        out.push_back(r->ids[i % r->capacity].load(std::memory_order_relaxed));
+    }
+    return out;
+}
+
+void PageHistory::setLimit(size_t n) {
+    std::lock_guard lock(mtx);
+    const std::vector<size_t> kept = ids();
+    limit.store(n, std::memory_order_relaxed);
+    if (n == 0) {
+        ring.store(nullptr, std::memory_order_release);
+        return;
+    }
+    auto fresh = std::make_unique<Ring>(n);
+    const size_t keep = std::min(kept.size(), n);
+    for (size_t i = 0; i < keep; ++i) {
+        fresh->ids[i].store(kept[kept.size() - keep + i], std::memory_order_relaxed);
+    }
+    fresh->recorded.store(keep, std::memory_order_relaxed);
+    rings.push_back(std::move(fresh));
+    ring.store(rings.back().get(), std::memory_order_release);
+}
+
+void IoTrace::enable(size_t capacity) {
+    if (capacity == 0) {
+        throw std::logic_error("IoTrace::enable: capacity must be positive");
+    }
+    std::lock_guard lock(mtx);
+    ring.assign(capacity, IoTraceEvent{});
+    recorded = 0;
+    on.store(true, std::memory_order_relaxed);
+}
+
+void IoTrace::disable() { on.store(false, std::memory_order_relaxed); }
+
+void IoTrace::record(const IoTraceEvent &event) {
+    std::lock_guard lock(mtx);
+    if (ring.empty()) {
+        return;
+    }
+    ring[recorded % ring.size()] = event;
+    ++recorded;
+}
+
+std::vector<IoTraceEvent> IoTrace::events() const {
+    std::lock_guard lock(mtx);
+    std::vector<IoTraceEvent> out;
+    const size_t n = std::min(recorded, ring.size());
+    out.reserve(n);
+    for (size_t i = recorded - n; i < recorded; ++i) {
+        out.push_back(ring[i % ring.size()]);
+    }
+    return out;
+}
+
+// 不析构：Database 单例析构时还会写回脏页并记录
+IoTrace &db::getIoTrace() {
+    static IoTrace *const instance = new IoTrace();
+    return *instance;
+}
@@ -0,0 +1,126 @@
+#include <db/KeySearch.hpp>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+using namespace db;
+
+namespace {
+// 二分收缩到不超过 WINDOW 个 key 后，改用向量比较一次数完
+constexpr size_t WINDOW = 32;
+
+inline int32_t load_key(const uint8_t *p) {
+    int32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// keys[0, n) 中小于 key 的个数
+size_t count_less(const int32_t *keys, size_t n, int32_t key) {
+    size_t count = 0;
+    size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512i k = _mm512_set1_epi32(key);
+    for (; i + 16 <= n; i += 16) {
+        count += std::popcount(static_cast<unsigned>(_mm512_cmplt_epi32_mask(_mm512_loadu_si512(keys + i), k)));
+    }
+    if (i < n) {
+        // 带掩码的加载不会越过数组末尾
+        const __mmask16 m = static_cast<__mmask16>((1u << (n - i)) - 1);
+        const __m512i v = _mm512_maskz_loadu_epi32(m, keys + i);
+        count += std::popcount(static_cast<unsigned>(_mm512_mask_cmplt_epi32_mask(m, v, k)));
+        i = n;
+    }
+#elif defined(__AVX2__)
+    const __m256i k = _mm256_set1_epi32(key);
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+        const __m256i lt = _mm256_cmpgt_epi32(k, v);
+        count += std::popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(lt))));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const int32x4_t k = vdupq_n_s32(key);
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 4 <= n; i += 4) {
+        // 比较结果每个命中通道为全 1（即 -1），减去它等于计数加一
+        acc = vsubq_u32(acc, vcltq_s32(vld1q_s32(keys + i), k));
+    }
+    count += vaddvq_u32(acc);
+#endif
+    for (; i < n; ++i) {
+        count += keys[i] < key;
+    }
+    return count;
+}
+
+// base + i * stride 处的 n 个 key 中小于 key 的个数
+size_t count_less_strided(const uint8_t *base, size_t stride, size_t n, int32_t key) {
+    size_t count = 0;
+    size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512i k = _mm512_set1_epi32(key);
+    const __m512i offsets = _mm512_mullo_epi32(
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+        _mm512_set1_epi32(static_cast<int>(stride)));
+    for (; i + 16 <= n; i += 16) {
+        const __m512i v = _mm512_i32gather_epi32(offsets, base + i * stride, 1);
+        count += std::popcount(static_cast<unsigned>(_mm512_cmplt_epi32_mask(v, k)));
+    }
+#elif defined(__AVX2__)
+    const __m256i k = _mm256_set1_epi32(key);
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                               _mm256_set1_epi32(static_cast<int>(stride)));
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int *>(base + i * stride), offsets, 1);
+        const __m256i lt = _mm256_cmpgt_epi32(k, v);
+        count += std::popcount(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(lt))));
+    }
+#endif
+    for (; i < n; ++i) {
+        count += load_key(base + i * stride) < key;
+    }
+    return count;
+}
+} // namespace
+
+size_t db::lower_bound_keys(const int32_t *keys, size_t n, int32_t key) {
+    size_t lo = 0;
+    size_t hi = n;
+    while (hi - lo > WINDOW) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (keys[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    // [lo, hi) 之前的 key 都 < key，之后的都 >= key
+    return lo + count_less(keys + lo, hi - lo, key);
+}
+
+size_t db::upper_bound_keys(const int32_t *keys, size_t n, int32_t key) {
+    if (key == std::numeric_limits<int32_t>::max()) {
+        return n;
+    }
+    return lower_bound_keys(keys, n, key + 1);
+}
+
+size_t db::lower_bound_strided(const uint8_t *base, size_t stride, size_t n, int32_t key) {
+    size_t lo = 0;
+    size_t hi = n;
+    while (hi - lo > WINDOW) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (load_key(base + mid * stride) < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo + count_less_strided(base + lo * stride, stride, hi - lo, key);
+}
@@ -1,55 +1,260 @@
+#include <db/KeySearch.hpp>
 #include <db/LeafPage.hpp>
 #include <db/types.hpp>
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
+#include <type_traits>
+#include <vector>
 using namespace db;
 
 
-namespace {
-// 读取指定槽位的 key（仅用于二分/比较）
-inline int key_at(const TupleDesc& td, size_t key_index,
-                  const uint8_t* base, size_t tbytes, size_t slot) {
-  const uint8_t* p = base + slot * tbytes;
-  Tuple tmp = td.deserialize(p);
-  return std::get<int>(tmp.get_field(key_index));
-}
-} // namespace
-
-LeafPage::LeafPage(Page &page, const TupleDesc &td_, size_t key_idx)
-  : td(td_), key_index(key_idx)
+template <typename K>
+BasicLeafPage<K>::BasicLeafPage(Page &page, const TupleDesc &td_, const KeyFields<K> &fields)
+  : td(td_), key_fields(fields)
 {
-  // 页布局：| LeafPageHeader | tuple bytes ... |
+  for (size_t i = 0; i < key_fields.size(); ++i) {
+    if (td.type_of(key_fields[i]) != KeyTraits<K>::types[i]) {
+      throw std::logic_error("LeafPage: key field type does not match the key type");
+    }
+    key_offsets[i] = td.offset_of(key_fields[i]);
+  }
+
   header = reinterpret_cast<LeafPageHeader*>(page.data());
   data   = reinterpret_cast<uint8_t*>(page.data()) + sizeof(LeafPageHeader);
+  area   = page.size() - sizeof(LeafPageHeader);
 
-  const size_t bytes_for_tuples =
-      page.size() - static_cast<uint32_t>(sizeof(LeafPageHeader));
-  const size_t tbytes = td.length();
-  capacity = static_cast<uint16_t>(bytes_for_tuples / tbytes);
+  variable = !td.fixed();
+  if (variable) {
+    // 分裂按字节对半，每半都要还能放下一条最长元组
+    if (4 * maxCell() > area) {
+      throw std::logic_error("LeafPage: rows are too long for a variable-length leaf");
+    }
+    layout(LeafFormat::VARIABLE);
+    if (header->size > capacity) header->size = 0;
+    return;
+  }
+
+  // 在读路径上不改页：空页的格式字节留到第一次插入时再写
+  layout(header->size == 0 || header->format == LeafFormat::SLOTTED ? LeafFormat::SLOTTED : LeafFormat::LEGACY);
 
   // 防御：若未格式化/异常，置零
   if (header->size > capacity) header->size = 0;
 }
 
-bool LeafPage::insertTuple(const Tuple &t) {
+template <typename K>
+void BasicLeafPage<K>::layout(LeafFormat format) {
+  if (format == LeafFormat::VARIABLE) {
+    // slots 紧跟在 size 个 key 之后，size 变化后须重新定位
+    capacity = static_cast<uint16_t>(area / (sizeof(K) + sizeof(uint16_t) + td.length()));
+    keys  = reinterpret_cast<K*>(data);
+    slots = reinterpret_cast<uint16_t*>(data + header->size * sizeof(K));
+    heap  = data;
+  } else if (format == LeafFormat::SLOTTED) {
+    capacity = slottedCapacity();
+    keys  = reinterpret_cast<K*>(data);
+    slots = reinterpret_cast<uint16_t*>(data + capacity * sizeof(K));
+    heap  = data + capacity * (sizeof(K) + sizeof(uint16_t));
+  } else {
+    capacity = static_cast<uint16_t>(area / td.length());
+    keys  = nullptr;
+    slots = nullptr;
+    heap  = nullptr;
+  }
+}
+
+template <typename K>
+uint16_t BasicLeafPage<K>::slottedCapacity() const {
+  return static_cast<uint16_t>(area / (sizeof(K) + sizeof(uint16_t) + td.length()));
+}
+
+template <typename K>
+bool BasicLeafPage<K>::isSlotted() const { return keys != nullptr; }
+
+template <typename K>
+size_t BasicLeafPage<K>::maxCell() const {
+  return sizeof(K) + sizeof(uint16_t) + td.max_length();
+}
+
+// 空页的 cell_top/dead 可能是旧值（如 merge 清空的右页），按空单元区算
+template <typename K>
+size_t BasicLeafPage<K>::cellTop() const {
+  return header->size == 0 ? area : header->cell_top;
+}
+
+template <typename K>
+size_t BasicLeafPage<K>::usedBytes() const {
+  return header->size == 0 ? 0 : area - header->cell_top - header->dead;
+}
+
+template <typename K>
+size_t BasicLeafPage<K>::cellBytes(const Tuple &t) const {
+  return sizeof(K) + sizeof(uint16_t) + (variable ? td.length_of(t) : td.length());
+}
+
+template <typename K>
+size_t BasicLeafPage<K>::freeBytes() const {
+  if (variable) {
+    return area - header->size * (sizeof(K) + sizeof(uint16_t)) - usedBytes();
+  }
+  return (capacity - header->size) * (isSlotted() ? sizeof(K) + sizeof(uint16_t) + td.length() : td.length());
+}
+
+template <typename K>
+uint8_t *BasicLeafPage<K>::tupleAt(size_t slot) const {
+  if (variable) {
+    return data + slots[slot];
+  }
+  const size_t tbytes = td.length();
+  return isSlotted() ? heap + slots[slot] * tbytes : data + slot * tbytes;
+}
+
+template <typename K>
+K BasicLeafPage<K>::keyAt(size_t slot) const {
+  if (isSlotted()) {
+    return keys[slot];
+  }
+  return KeyTraits<K>::read(data + slot * td.length(), key_offsets);
+}
+
+template <typename K>
+bool BasicLeafPage<K>::hasRoomFor(size_t n) const {
+  if (variable) {
+    return freeBytes() >= (n + 1) * maxCell();
+  }
+  // 旧格式页放得下时插入前会先转为 SLOTTED，按转换后的容量算
+  const size_t cap = !isSlotted() && header->size < slottedCapacity() ? slottedCapacity() : capacity;
+  return header->size + n < cap;
+}
+
+template <typename K>
+uint16_t BasicLeafPage<K>::lowerBound(const K &k) const {
+  if (isSlotted()) {
+    return static_cast<uint16_t>(key_lower_bound(keys, header->size, k));
+  }
+  if constexpr (std::is_same_v<K, int32_t>) {
+    // 旧格式：key 字段在每条元组内的偏移固定，按步长直接比较 int
+    return static_cast<uint16_t>(lower_bound_strided(data + key_offsets[0], td.length(), header->size, k));
+  } else {
+    uint16_t lo = 0;
+    uint16_t hi = header->size;
+    while (lo < hi) {
+      const uint16_t mid = static_cast<uint16_t>(lo + (hi - lo) / 2);
+      if (keyAt(mid) < k) {
+        lo = static_cast<uint16_t>(mid + 1);
+      } else {
+        hi = mid;
+      }
+    }
+    return lo;
+  }
+}
+
+template <typename K>
+void BasicLeafPage<K>::rebuild(const uint8_t *rows, const std::vector<size_t> &starts, size_t first, size_t last,
+                               LeafFormat format) {
+  const size_t tbytes = td.length();
+  const size_t n = last - first;
+  if (format == LeafFormat::VARIABLE) {
+    header->size = static_cast<uint16_t>(n);
+    layout(format);
+    size_t top = area;
+    for (size_t i = 0; i < n; ++i) {
+      const uint8_t *row = rows + starts[first + i];
+      const size_t len = starts[first + i + 1] - starts[first + i];
+      top -= len;
+      std::memcpy(data + top, row, len);
+      keys[i]  = KeyTraits<K>::read(row, key_offsets);
+      slots[i] = static_cast<uint16_t>(top);
+    }
+    header->cell_top = static_cast<uint16_t>(top);
+    header->dead = 0;
+    header->format = format;
+    return;
+  }
+  layout(format);
+  if (format == LeafFormat::SLOTTED) {
+    for (size_t i = 0; i < n; ++i) {
+      const uint8_t *row = rows + (first + i) * tbytes;
+      keys[i]  = KeyTraits<K>::read(row, key_offsets);
+      slots[i] = static_cast<uint16_t>(i);
+      std::memcpy(heap + i * tbytes, row, tbytes);
+    }
+  } else {
+    std::memcpy(data, rows + first * tbytes, n * tbytes);
+  }
+  header->size = static_cast<uint16_t>(n);
+  header->format = format;
+}
+
+// 旧格式页原地转为 SLOTTED：元组先拷出，再按新布局写回
+template <typename K>
+void BasicLeafPage<K>::upgrade() {
+  std::vector<uint8_t> rows;
+  std::vector<size_t> starts;
+  const size_t n = copyRows(rows, starts);
+  rebuild(rows.data(), starts, 0, n, LeafFormat::SLOTTED);
+}
+
+// VARIABLE：把存活元组重新紧排到页尾，删除留下的空洞并入中间的空闲区
+template <typename K>
+void BasicLeafPage<K>::compact() {
+  std::vector<uint8_t> rows;
+  std::vector<size_t> starts;
+  const size_t n = copyRows(rows, starts);
+  rebuild(rows.data(), starts, 0, n, LeafFormat::VARIABLE);
+}
+
+template <typename K>
+bool BasicLeafPage<K>::insertTuple(const Tuple &t) {
+  const K k = KeyTraits<K>::of(t, key_fields);
+
+  if (variable) {
+    const size_t len  = td.length_of(t);
+    const size_t cell = sizeof(K) + sizeof(uint16_t) + len;
+    const uint16_t pos = lowerBound(k);
+    if (pos < header->size && keyAt(pos) == k) {
+      // 覆盖：新旧长度可能不同，放得下才删掉旧元组再按新 key 插入
+      if (freeBytes() + sizeof(K) + sizeof(uint16_t) + td.length_of(tupleAt(pos)) < cell) {
+        return true;
+      }
+      deleteTuple(pos);
+    } else if (freeBytes() < cell) {
+      return true;    // 页满且无空间插新 tuple
+    }
+    if (cellTop() - header->size * (sizeof(K) + sizeof(uint16_t)) < cell) {
+      compact();
+    }
+    const uint16_t n   = header->size;
+    const size_t   top = cellTop() - len;
+    // slots 整体后移一个 key 的宽度，再在 pos 处给 key 与槽各腾一格
+    std::memmove(data + (n + 1) * sizeof(K), data + n * sizeof(K), n * sizeof(uint16_t));
+    header->size = static_cast<uint16_t>(n + 1);
+    layout(LeafFormat::VARIABLE);
+    std::memmove(&keys[pos + 1], &keys[pos], (n - pos) * sizeof(K));
+    std::memmove(&slots[pos + 1], &slots[pos], (n - pos) * sizeof(uint16_t));
+    td.serialize(data + top, t);
+    keys[pos]  = k;
+    slots[pos] = static_cast<uint16_t>(top);
+    if (n == 0) header->dead = 0;
+    header->cell_top = static_cast<uint16_t>(top);
+    header->format = LeafFormat::VARIABLE;
+    return !hasRoomFor(0);
+  }
+
+  if (!isSlotted() && header->size < slottedCapacity()) {
+    upgrade();
+  }
+
   const size_t   tbytes = td.length();
   const uint16_t n      = header->size;
-  const int      k      = std::get<int>(t.get_field(key_index));
 
   // 二分找插入位（第一个 >= k）
-  uint16_t lo = 0, hi = n;
-  while (lo < hi) {
-    const uint16_t mid = static_cast<uint16_t>((lo + hi) >> 1);
-    if (key_at(td, key_index, data, tbytes, mid) < k)
-      lo = mid + 1;
-    else
-      hi = mid;
-  }
-  const uint16_t pos = lo;
+  const uint16_t pos = lowerBound(k);
 
   // 1. 如果 key 已存在：允许更新（即使 n == capacity）
-  if (pos < n && key_at(td, key_index, data, tbytes, pos) == k) {
-    td.serialize(data + pos * tbytes, t);   // 覆盖 "apple" → "orange"
+  if (pos < n && keyAt(pos) == k) {
+    td.serialize(tupleAt(pos), t);          // 覆盖 "apple" → "orange"
     return (n == capacity);                 // 页是否已满，按测试语义返回 true/false
   }
 
@@ -59,42 +264,176 @@ bool LeafPage::insertTuple(const Tuple &t) {
     return true;    // 页满且无空间插新 tuple
   }
 
-  // 3. 有空间插新 key：右移 [pos..n-1]，腾位置插入
-  const size_t move_bytes = static_cast<size_t>(n - pos) * tbytes;
-  if (move_bytes) {
-    std::memmove(data + (pos + 1) * tbytes, data + pos * tbytes, move_bytes);
+  // 3. 有空间插新 key
+  if (isSlotted()) {
+    // 只移动 key 与槽；已用单元恰为 [0, n)，新元组放进第 n 个单元
+    std::memmove(&keys[pos + 1], &keys[pos], (n - pos) * sizeof(K));
+    std::memmove(&slots[pos + 1], &slots[pos], (n - pos) * sizeof(uint16_t));
+    keys[pos]  = k;
+    slots[pos] = n;
+    td.serialize(heap + n * tbytes, t);
+    header->format = LeafFormat::SLOTTED;
+  } else {
+    // 旧格式且放不下新布局：右移 [pos..n-1]，腾位置插入
+    const size_t move_bytes = static_cast<size_t>(n - pos) * tbytes;
+    if (move_bytes) {
+      std::memmove(data + (pos + 1) * tbytes, data + pos * tbytes, move_bytes);
+    }
+    td.serialize(data + pos * tbytes, t);
   }
-
-  td.serialize(data + pos * tbytes, t);
   header->size = static_cast<uint16_t>(n + 1);
 
   return (header->size == capacity);
 }
 
 
-int LeafPage::split(LeafPage &new_page) {
+template <typename K>
+K BasicLeafPage<K>::split(BasicLeafPage &new_page) {
   const uint16_t n = header->size;
   if (n == 0) throw std::logic_error("split on empty leaf page");
 
-  const size_t tbytes = td.length();
-  const uint16_t mid  = static_cast<uint16_t>(n / 2);
-  const uint16_t right_cnt = static_cast<uint16_t>(n - mid);
+  // 按 key 顺序拷出全部元组，再分别重写两页
+  std::vector<uint8_t> rows;
+  std::vector<size_t> starts;
+  copyRows(rows, starts);
+  const size_t mid = middle(starts, n);
 
   // 分裂键：新页第一条（原 mid 槽位）
-  const int split_key = key_at(td, key_index, data, tbytes, mid);
+  const K split_key = keyAt(mid);
 
-  // 右半复制到新页；左半截断
-  std::memcpy(new_page.data, data + mid * tbytes, static_cast<size_t>(right_cnt) * tbytes);
-  new_page.header->size = right_cnt;
+  const LeafFormat format = formatFor(std::max<size_t>(mid, n - mid));
+  new_page.rebuild(rows.data(), starts, mid, n, format);
   new_page.header->next_leaf = header->next_leaf;
-
-  header->size = mid;
+  rebuild(rows.data(), starts, 0, mid, format);
 
   return split_key;
 }
 
-Tuple LeafPage::getTuple(size_t slot) const {
+template <typename K>
+size_t BasicLeafPage<K>::copyRows(std::vector<uint8_t> &out, std::vector<size_t> &starts) const {
+  if (starts.empty()) starts.push_back(out.size());
+  for (size_t i = 0; i < header->size; ++i) {
+    const uint8_t *row = tupleAt(i);
+    out.insert(out.end(), row, row + (variable ? td.length_of(row) : td.length()));
+    starts.push_back(out.size());
+  }
+  return header->size;
+}
+
+template <typename K>
+size_t BasicLeafPage<K>::middle(const std::vector<size_t> &starts, size_t n) const {
+  if (!variable || n < 2) {
+    return n / 2;
+  }
+  const size_t half = (starts[n] - starts[0]) / 2;
+  const size_t mid = static_cast<size_t>(std::lower_bound(starts.begin(), starts.begin() + n, starts[0] + half) -
+                                         starts.begin());
+  return std::clamp<size_t>(mid, 1, n - 1);
+}
+
+template <typename K>
+LeafFormat BasicLeafPage<K>::formatFor(size_t n) const {
+  if (variable) return LeafFormat::VARIABLE;
+  return n <= slottedCapacity() ? LeafFormat::SLOTTED : LeafFormat::LEGACY;
+}
+
+template <typename K>
+void BasicLeafPage<K>::deleteTuple(size_t slot) {
   if (slot >= header->size) throw std::out_of_range("leaf slot out of range");
-  const size_t tbytes = td.length();
-  return td.deserialize(data + slot * tbytes);
+
+  const size_t   tbytes = td.length();
+  const uint16_t n      = header->size;
+  if (variable) {
+    const size_t off = slots[slot];
+    const size_t len = td.length_of(data + off);
+    if (off == header->cell_top) {
+      header->cell_top = static_cast<uint16_t>(off + len);   // 最靠前的单元直接还给空闲区
+    } else {
+      header->dead = static_cast<uint16_t>(header->dead + len);
+    }
+    std::memmove(&keys[slot], &keys[slot + 1], (n - slot - 1) * sizeof(K));
+    std::memmove(&slots[slot], &slots[slot + 1], (n - slot - 1) * sizeof(uint16_t));
+    // slots 整体前移一个 key 的宽度
+    std::memmove(data + (n - 1) * sizeof(K), slots, (n - 1) * sizeof(uint16_t));
+    header->size = static_cast<uint16_t>(n - 1);
+    layout(LeafFormat::VARIABLE);
+    return;
+  }
+  if (isSlotted()) {
+    // 把最后一个单元搬进空出的单元，使已用单元仍恰为 [0, n-1)
+    const uint16_t cell = slots[slot];
+    const uint16_t last = static_cast<uint16_t>(n - 1);
+    if (cell != last) {
+      std::memcpy(heap + cell * tbytes, heap + last * tbytes, tbytes);
+      for (uint16_t i = 0; i < n; ++i) {
+        if (slots[i] == last) {
+          slots[i] = cell;
+          break;
+        }
+      }
+    }
+    std::memmove(&keys[slot], &keys[slot + 1], (n - slot - 1) * sizeof(K));
+    std::memmove(&slots[slot], &slots[slot + 1], (n - slot - 1) * sizeof(uint16_t));
+  } else {
+    std::memmove(data + slot * tbytes, data + (slot + 1) * tbytes, (n - slot - 1) * tbytes);
+  }
+  header->size = static_cast<uint16_t>(n - 1);
 }
+
+template <typename K>
+bool BasicLeafPage<K>::canMerge(const BasicLeafPage &right) const {
+  if (variable) {
+    const size_t entries = (header->size + right.header->size) * (sizeof(K) + sizeof(uint16_t));
+    return entries + usedBytes() + right.usedBytes() + maxCell() <= area;
+  }
+  return header->size + right.header->size < std::min(capacity, right.capacity);
+}
+
+template <typename K>
+void BasicLeafPage<K>::merge(BasicLeafPage &right) {
+  const size_t n = header->size + right.header->size;
+  const bool fits = variable ? freeBytes() >= area - right.freeBytes() : n <= capacity;
+  if (!fits) throw std::logic_error("merged leaf page would overflow");
+
+  std::vector<uint8_t> rows;
+  std::vector<size_t> starts;
+  copyRows(rows, starts);
+  right.copyRows(rows, starts);
+  rebuild(rows.data(), starts, 0, n, formatFor(n));
+  header->next_leaf = right.header->next_leaf;
+  right.header->size = 0;
+}
+
+template <typename K>
+K BasicLeafPage<K>::redistribute(BasicLeafPage &right) {
+  const size_t n = header->size + right.header->size;
+
+  // 两页合计可能超过一页，先按 key 顺序拷到堆上
+  std::vector<uint8_t> rows;
+  std::vector<size_t> starts;
+  copyRows(rows, starts);
+  right.copyRows(rows, starts);
+
+  const size_t mid = middle(starts, n);
+  const LeafFormat format = formatFor(std::max(mid, n - mid));
+  right.rebuild(rows.data(), starts, mid, n, format);
+  rebuild(rows.data(), starts, 0, mid, format);
+  return right.keyAt(0);
+}
+
+template <typename K>
+Tuple BasicLeafPage<K>::getTuple(size_t slot) const {
+  if (slot >= header->size) throw std::out_of_range("leaf slot out of range");
+  return td.deserialize(tupleAt(slot));
+}
+
+template <typename K>
+TupleView BasicLeafPage<K>::getView(size_t slot) const {
+  if (slot >= header->size) throw std::out_of_range("leaf slot out of range");
+  return {td, tupleAt(slot)};
+}
+
+template struct db::BasicLeafPage<int32_t>;
+template struct db::BasicLeafPage<double>;
+template struct db::BasicLeafPage<CharKey>;
+template struct db::BasicLeafPage<IntPairKey>;
@@ -0,0 +1,461 @@
+#include <db/LogManager.hpp>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+enum RecordKind : uint8_t { FULL = 0, DIFF = 1, CHECKPOINT = 2 };
+
+constexpr size_t UNIT_HEADER = LogManager::UNIT_HEADER;
+
+constexpr uint64_t CKPT_MAGIC = 0x544E494F504B4843ULL;   // "CHKPOINT"
+
+// 打洞按文件系统块对齐
+constexpr lsn_t HOLE_ALIGN = 4096;
+
+// 相隔不超过这么多个相同字节的两段修改合并为一段，省下一个段头
+constexpr size_t MERGE_GAP = 8;
+
+constexpr std::array<uint32_t, 256> crc_table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        t[i] = c;
+    }
+    return t;
+}();
+
+uint32_t crc32(const uint8_t *p, size_t n) {
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; ++i) {
+        c = crc_table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+template <typename T>
+void put(std::vector<uint8_t> &out, T v) {
+    const size_t at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &v, sizeof(T));
+}
+
+// 解码时越界说明单元已损坏（校验和碰巧通过），按日志尾部处理
+struct Malformed {};
+
+struct Reader {
+    const uint8_t *p;
+    const uint8_t *end;
+
+    template <typename T>
+    T get() {
+        T v;
+        take(&v, sizeof(T));
+        return v;
+    }
+
+    void need(size_t n) const {
+        if (static_cast<size_t>(end - p) < n) throw Malformed{};
+    }
+
+    void take(void *dst, size_t n) {
+        need(n);
+        std::memcpy(dst, p, n);
+        p += n;
+    }
+};
+
+void write_all(int fd, const uint8_t *data, size_t n, off_t offset, const std::string &path) {
+    size_t done = 0;
+    while (done < n) {
+        const ssize_t w = pwrite(fd, data + done, n - done, offset + static_cast<off_t>(done));
+        if (w == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("LogManager: pwrite failed for " + path + ": " + std::strerror(errno));
+        }
+        done += static_cast<size_t>(w);
+    }
+}
+
+// 从 offset 读到文件尾
+std::vector<uint8_t> read_from(int fd, off_t offset, const std::string &path) {
+    std::vector<uint8_t> out;
+    uint8_t chunk[1 << 16];
+    while (true) {
+        const ssize_t n = pread(fd, chunk, sizeof(chunk), offset);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("LogManager: read failed for " + path + ": " + std::strerror(errno));
+        }
+        if (n == 0) return out;
+        out.insert(out.end(), chunk, chunk + n);
+        offset += n;
+    }
+}
+
+std::string checkpoint_path(const std::string &path) { return path + ".ckpt"; }
+
+// 检查点文件：u64 魔数，u64 检查点单元的 LSN，u32 前两项的 crc32
+std::optional<lsn_t> read_checkpoint_lsn(const std::string &path) {
+    const int fd = open(checkpoint_path(path).c_str(), O_RDONLY);
+    if (fd == -1) {
+        return std::nullopt;
+    }
+    uint8_t buf[2 * sizeof(uint64_t) + sizeof(uint32_t)];
+    const ssize_t n = pread(fd, buf, sizeof(buf), 0);
+    close(fd);
+    uint64_t magic;
+    lsn_t lsn;
+    uint32_t crc;
+    std::memcpy(&magic, buf, sizeof(magic));
+    std::memcpy(&lsn, buf + sizeof(magic), sizeof(lsn));
+    std::memcpy(&crc, buf + 2 * sizeof(uint64_t), sizeof(crc));
+    if (n != static_cast<ssize_t>(sizeof(buf)) || magic != CKPT_MAGIC || crc32(buf, 2 * sizeof(uint64_t)) != crc) {
+        return std::nullopt;
+    }
+    return lsn;
+}
+
+// 写临时文件、同步后改名，崩溃时要么是旧检查点要么是新的
+void write_checkpoint_lsn(const std::string &path, lsn_t lsn) {
+    const std::string target = checkpoint_path(path);
+    const std::string tmp = target + ".tmp";
+    uint8_t buf[2 * sizeof(uint64_t) + sizeof(uint32_t)];
+    std::memcpy(buf, &CKPT_MAGIC, sizeof(CKPT_MAGIC));
+    std::memcpy(buf + sizeof(CKPT_MAGIC), &lsn, sizeof(lsn));
+    const uint32_t crc = crc32(buf, 2 * sizeof(uint64_t));
+    std::memcpy(buf + 2 * sizeof(uint64_t), &crc, sizeof(crc));
+
+    const int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("LogManager: cannot open " + tmp + ": " + std::strerror(errno));
+    }
+    try {
+        write_all(fd, buf, sizeof(buf), 0, tmp);
+        if (fdatasync(fd) == -1) {
+            throw std::runtime_error("LogManager: fdatasync failed for " + tmp + ": " + std::strerror(errno));
+        }
+    } catch (...) {
+        close(fd);
+        unlink(tmp.c_str());
+        throw;
+    }
+    close(fd);
+    if (rename(tmp.c_str(), target.c_str()) == -1) {
+        const int err = errno;
+        unlink(tmp.c_str());
+        throw std::runtime_error("LogManager: cannot write " + target + ": " + std::strerror(err));
+    }
+}
+
+// 解码一个单元的全部记录；keep 决定某页的改动是否要返回
+template <typename Keep>
+void decode_unit(const uint8_t *records, size_t length, RedoLog &out,
+                 std::unordered_map<std::string, uint32_t> &file_index, const Keep &keep) {
+    Reader r{records, records + length};
+    while (r.p != r.end) {
+        const auto kind = r.get<uint8_t>();
+        if (kind == CHECKPOINT) {
+            r.get<lsn_t>();
+            const auto count = r.get<uint32_t>();
+            for (uint32_t i = 0; i < count; ++i) {
+                const auto name_length = r.get<uint16_t>();
+                r.need(name_length);
+                r.p += name_length;
+                r.get<uint64_t>();
+                r.get<lsn_t>();
+            }
+            continue;
+        }
+        if (kind != FULL && kind != DIFF) throw Malformed{};
+        std::string file(r.get<uint16_t>(), '\0');
+        r.take(file.data(), file.size());
+        const auto page = r.get<uint64_t>();
+        const bool wanted = keep(file, page);
+        uint32_t index = 0;
+        if (wanted) {
+            auto [it, inserted] = file_index.try_emplace(file, static_cast<uint32_t>(out.files.size()));
+            if (inserted) out.files.push_back(file);
+            index = it->second;
+        }
+        if (kind == FULL) {
+            r.need(DEFAULT_PAGE_SIZE);
+            if (wanted) out.changes.push_back({index, page, 0, static_cast<uint32_t>(DEFAULT_PAGE_SIZE), r.p});
+            r.p += DEFAULT_PAGE_SIZE;
+            continue;
+        }
+        const auto count = r.get<uint16_t>();
+        for (uint16_t c = 0; c < count; ++c) {
+            const auto offset = r.get<uint16_t>();
+            const auto len = r.get<uint16_t>();
+            if (offset + len > DEFAULT_PAGE_SIZE) throw Malformed{};
+            r.need(len);
+            if (wanted) out.changes.push_back({index, page, offset, len, r.p});
+            r.p += len;
+        }
+    }
+}
+} // namespace
+
+// 先清空日志再删检查点文件：中间崩溃时检查点指向空日志，恢复时无事可做
+LogManager::LogManager(const std::string &path) : path(path) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("LogManager: cannot open " + path + ": " + std::strerror(errno));
+    }
+    if (fdatasync(fd) == -1 || (unlink(checkpoint_path(path).c_str()) == -1 && errno != ENOENT)) {
+        const int err = errno;
+        close(fd);
+        throw std::runtime_error("LogManager: cannot reset " + path + ": " + std::strerror(err));
+    }
+}
+
+LogManager::~LogManager() {
+    try {
+        flush(appendedLsn());
+    } catch (...) {
+        // 析构时写不出去也只能放弃：尚未落盘的页同样不会写出
+    }
+    close(fd);
+}
+
+lsn_t LogManager::append(std::span<const uint8_t> records) {
+    std::lock_guard lock(mtx);
+    put(buffer, static_cast<uint32_t>(records.size()));
+    put(buffer, crc32(records.data(), records.size()));
+    buffer.insert(buffer.end(), records.begin(), records.end());
+    appended += UNIT_HEADER + records.size();
+    return appended;
+}
+
+// 组提交：同一时刻只有一个线程写盘；其余线程等它结束，再由其中一个把期间追加的单元一起写出
+void LogManager::flush(lsn_t lsn) {
+    std::unique_lock lock(mtx);
+    lsn = std::min(lsn, appended);
+    while (flushed < lsn) {
+        if (flushing) {
+            flushed_cv.wait(lock);
+            continue;
+        }
+        flushing = true;
+        std::vector<uint8_t> out;
+        out.swap(buffer);
+        const lsn_t target = appended;
+        const off_t offset = static_cast<off_t>(target - out.size());
+        lock.unlock();
+        try {
+            write_all(fd, out.data(), out.size(), offset, path);
+            if (fdatasync(fd) == -1) {
+                throw std::runtime_error("LogManager: fdatasync failed for " + path + ": " + std::strerror(errno));
+            }
+        } catch (...) {
+            // 把没写成的部分放回缓冲区前面，下次重试
+            lock.lock();
+            out.insert(out.end(), buffer.begin(), buffer.end());
+            buffer.swap(out);
+            flushing = false;
+            flushed_cv.notify_all();
+            throw;
+        }
+        lock.lock();
+        flushed = target;
+        ++syncs;
+        flushing = false;
+        flushed_cv.notify_all();
+    }
+}
+
+lsn_t LogManager::appendedLsn() const {
+    std::lock_guard lock(mtx);
+    return appended;
+}
+
+lsn_t LogManager::flushedLsn() const {
+    std::lock_guard lock(mtx);
+    return flushed;
+}
+
+size_t LogManager::syncCount() const {
+    std::lock_guard lock(mtx);
+    return syncs;
+}
+
+// 检查点单元：u8 类型，u64 begin，u32 页数，各页（u16 文件名长度，文件名，u64 页号，u64 rec_lsn）
+lsn_t LogManager::checkpoint(lsn_t begin, const std::vector<DirtyPage> &dirty) {
+    std::vector<uint8_t> records;
+    put(records, static_cast<uint8_t>(CHECKPOINT));
+    put(records, begin);
+    put(records, static_cast<uint32_t>(dirty.size()));
+    lsn_t redo = begin;
+    for (const DirtyPage &d : dirty) {
+        put(records, static_cast<uint16_t>(d.file.size()));
+        records.insert(records.end(), d.file.begin(), d.file.end());
+        put(records, static_cast<uint64_t>(d.page));
+        put(records, d.rec_lsn);
+        redo = std::min(redo, d.rec_lsn);
+    }
+    const lsn_t end = append(records);
+    flush(end);
+    write_checkpoint_lsn(path, end - UNIT_HEADER - records.size());
+
+    // 检查点文件已经指向新单元，redo 点之前的日志再也不会读到
+    const lsn_t hole = redo / HOLE_ALIGN * HOLE_ALIGN;
+    std::lock_guard lock(mtx);
+    if (hole > discarded) {
+        // 文件系统不支持打洞时只是不释放空间
+        if (fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(discarded),
+                      static_cast<off_t>(hole - discarded)) == 0) {
+            discarded = hole;
+        }
+    }
+    return redo;
+}
+
+// 记录：u8 类型，u16 文件名长度，文件名，u64 页号；FULL 接整页，DIFF 接 u16 段数和各段（u16 偏移，u16 长度，字节）
+void LogManager::encode(std::vector<uint8_t> &records, const std::string &file, size_t page, const Page &after,
+                        const Page *before) {
+    const size_t start = records.size();
+    put(records, static_cast<uint8_t>(before ? DIFF : FULL));
+    put(records, static_cast<uint16_t>(file.size()));
+    records.insert(records.end(), file.begin(), file.end());
+    put(records, static_cast<uint64_t>(page));
+    const size_t body = records.size();
+
+    if (before != nullptr) {
+        const size_t count_at = records.size();
+        put(records, uint16_t{0});
+        uint16_t count = 0;
+        size_t i = 0;
+        while (i < after.size() && records.size() - body < after.size() / 2) {
+            if (after[i] == (*before)[i]) {
+                ++i;
+                continue;
+            }
+            const size_t first = i;
+            size_t last = i + 1;   // 段尾（不含）
+            for (size_t j = i + 1; j < after.size() && j - last <= MERGE_GAP; ++j) {
+                if (after[j] != (*before)[j]) last = j + 1;
+            }
+            put(records, static_cast<uint16_t>(first));
+            put(records, static_cast<uint16_t>(last - first));
+            records.insert(records.end(), after.begin() + static_cast<std::ptrdiff_t>(first),
+                           after.begin() + static_cast<std::ptrdiff_t>(last));
+            ++count;
+            i = last;
+        }
+        if (i == after.size()) {
+            std::memcpy(records.data() + count_at, &count, sizeof(count));
+            return;
+        }
+        // 改动太多：不如整页
+        records.resize(body);
+        records[start] = FULL;
+    }
+    records.insert(records.end(), after.begin(), after.end());
+}
+
+// 检查点之前的单元只对表中的页、且从它的 rec_lsn 起才需要重放；begin 之后的单元全部重放
+RedoLog LogManager::read(const std::string &path) {
+    RedoLog out;
+    const int in = open(path.c_str(), O_RDONLY);
+    if (in == -1) {
+        if (errno == ENOENT) return out;
+        throw std::runtime_error("LogManager: cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat st{};
+    lsn_t begin = 0;
+    std::unordered_map<std::string, std::unordered_map<uint64_t, lsn_t>> dirty;
+    try {
+        if (const auto at = read_checkpoint_lsn(path)) {
+            // 检查点单元读不出来说明日志在检查点之后被重新清空了
+            uint8_t header[UNIT_HEADER];
+            uint32_t length = 0;
+            uint32_t crc = 0;
+            std::vector<uint8_t> unit;
+            if (fstat(in, &st) == 0 && *at + UNIT_HEADER <= static_cast<lsn_t>(st.st_size) &&
+                pread(in, header, UNIT_HEADER, static_cast<off_t>(*at)) == static_cast<ssize_t>(UNIT_HEADER)) {
+                std::memcpy(&length, header, sizeof(length));
+                std::memcpy(&crc, header + sizeof(length), sizeof(crc));
+                if (*at + UNIT_HEADER + length <= static_cast<lsn_t>(st.st_size)) {
+                    unit.resize(length);
+                }
+            }
+            if (unit.empty() ||
+                pread(in, unit.data(), length, static_cast<off_t>(*at + UNIT_HEADER)) != static_cast<ssize_t>(length) ||
+                crc32(unit.data(), length) != crc || unit[0] != CHECKPOINT) {
+                close(in);
+                return out;
+            }
+            Reader r{unit.data() + 1, unit.data() + unit.size()};
+            begin = r.get<lsn_t>();
+            out.start = begin;
+            const auto count = r.get<uint32_t>();
+            for (uint32_t i = 0; i < count; ++i) {
+                std::string file(r.get<uint16_t>(), '\0');
+                r.take(file.data(), file.size());
+                const auto page = r.get<uint64_t>();
+                const auto rec = r.get<lsn_t>();
+                dirty[file][page] = rec;
+                out.start = std::min(out.start, rec);
+            }
+        }
+        out.log = read_from(in, static_cast<off_t>(out.start), path);
+    } catch (const Malformed &) {
+        close(in);
+        return out;
+    } catch (...) {
+        close(in);
+        throw;
+    }
+    close(in);
+
+    std::unordered_map<std::string, uint32_t> file_index;
+    const std::vector<uint8_t> &log = out.log;
+    size_t at = 0;
+    while (log.size() - at >= UNIT_HEADER) {
+        uint32_t length;
+        uint32_t crc;
+        std::memcpy(&length, log.data() + at, sizeof(length));
+        std::memcpy(&crc, log.data() + at + sizeof(length), sizeof(crc));
+        const uint8_t *records = log.data() + at + UNIT_HEADER;
+        if (log.size() - at - UNIT_HEADER < length || crc32(records, length) != crc) {
+            break;
+        }
+        const lsn_t unit_lsn = out.start + at;
+        auto keep = [&](const std::string &file, uint64_t page) {
+            if (unit_lsn >= begin) return true;
+            auto fit = dirty.find(file);
+            if (fit == dirty.end()) return false;
+            auto pit = fit->second.find(page);
+            return pit != fit->second.end() && unit_lsn >= pit->second;
+        };
+        // 先整个解码再交出：半个单元都不能落到页上
+        const size_t files_before = out.files.size();
+        const size_t changes_before = out.changes.size();
+        try {
+            decode_unit(records, length, out, file_index, keep);
+        } catch (const Malformed &) {
+            for (size_t i = files_before; i < out.files.size(); ++i) {
+                file_index.erase(out.files[i]);
+            }
+            out.files.resize(files_before);
+            out.changes.resize(changes_before);
+            break;
+        }
+        ++out.units;
+        at += UNIT_HEADER + length;
+    }
+    return out;
+}
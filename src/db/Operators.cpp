@@ -0,0 +1,562 @@
+#include <db/HeapFile.hpp>
+#include <db/Operators.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+// 列向量的下标与 ColumnVector 的候选类型一一对应
+size_t column_index(type_t type) {
+    switch (type) {
+    case type_t::INT: return 0;
+    case type_t::DOUBLE: return 1;
+    case type_t::CHAR:
+    case type_t::VARCHAR: return 2;
+    }
+    return 2;
+}
+
+// Tuple 中 INT 字段以 int 存放，列中为 int32_t
+template <typename T>
+using field_of = std::conditional_t<std::is_same_v<T, int32_t>, int, T>;
+
+const char *func_name(AggregateFunc func) {
+    switch (func) {
+    case AggregateFunc::COUNT: return "count";
+    case AggregateFunc::SUM: return "sum";
+    case AggregateFunc::MIN: return "min";
+    case AggregateFunc::MAX: return "max";
+    }
+    return "";
+}
+
+template <typename T>
+void fold_min(std::vector<T> &acc, const std::vector<uint32_t> &gid, const std::vector<T> &col) {
+    for (size_t i = 0; i < col.size(); ++i) {
+        acc[gid[i]] = std::min(acc[gid[i]], col[i]);
+    }
+}
+
+template <typename T>
+void fold_max(std::vector<T> &acc, const std::vector<uint32_t> &gid, const std::vector<T> &col) {
+    for (size_t i = 0; i < col.size(); ++i) {
+        acc[gid[i]] = std::max(acc[gid[i]], col[i]);
+    }
+}
+
+static_assert((HashJoin::PARTITIONS & (HashJoin::PARTITIONS - 1)) == 0, "PARTITIONS must be a power of two");
+
+// 乘法散列取高位：连续的 key 也能均匀落到各分区
+size_t partition_of(int32_t key) {
+    return ((static_cast<uint32_t>(key) * 0x9E3779B1u) >> 16) & (HashJoin::PARTITIONS - 1);
+}
+
+std::atomic<uint64_t> spill_seq{0};
+
+// 分区文件的暂存：每个分区攒满一批再整批写入，每页只写一次
+void stage(std::vector<std::vector<Tuple>> &staged, std::vector<std::unique_ptr<HeapFile>> &parts, size_t p,
+           Tuple t) {
+    staged[p].push_back(std::move(t));
+    if (staged[p].size() >= DEFAULT_BATCH_SIZE) {
+        parts[p]->insertTuples(staged[p]);
+        staged[p].clear();
+    }
+}
+
+void flush(std::vector<std::vector<Tuple>> &staged, std::vector<std::unique_ptr<HeapFile>> &parts) {
+    for (size_t p = 0; p < parts.size(); ++p) {
+        parts[p]->insertTuples(staged[p]);
+        staged[p].clear();
+    }
+}
+
+// 输出一行：左批第 i 行的各列，接着右元组的各字段
+void append_row(ColumnBatch &out, const ColumnBatch &left, size_t i, const Tuple &right) {
+    const size_t n = left.columns.size();
+    for (size_t c = 0; c < n; ++c) {
+        std::visit([&](auto &dst) {
+            using V = std::decay_t<decltype(dst)>;
+            dst.push_back(std::get<V>(left.columns[c])[i]);
+        }, out.columns[c]);
+    }
+    for (size_t c = 0; c < right.size(); ++c) {
+        std::visit([&](auto &dst) {
+            using T = typename std::decay_t<decltype(dst)>::value_type;
+            dst.push_back(std::get<field_of<T>>(right.get_field(c)));
+        }, out.columns[n + c]);
+    }
+}
+} // namespace
+
+// ---------------- ColumnBatch ----------------
+
+size_t ColumnBatch::size() const {
+    if (columns.empty()) {
+        return 0;
+    }
+    return std::visit([](const auto &col) { return col.size(); }, columns.front());
+}
+
+void ColumnBatch::reset(const TupleDesc &td) {
+    columns.resize(td.size());
+    for (size_t i = 0; i < td.size(); ++i) {
+        switch (column_index(td.type_of(i))) {
+        case 0:
+            if (columns[i].index() != 0) columns[i].emplace<0>();
+            break;
+        case 1:
+            if (columns[i].index() != 1) columns[i].emplace<1>();
+            break;
+        default:
+            if (columns[i].index() != 2) columns[i].emplace<2>();
+            break;
+        }
+        std::visit([](auto &col) { col.clear(); }, columns[i]);
+    }
+}
+
+Tuple ColumnBatch::row(size_t i) const {
+    std::vector<field_t> fields;
+    fields.reserve(columns.size());
+    for (const ColumnVector &column : columns) {
+        std::visit([&](const auto &col) {
+            using T = typename std::decay_t<decltype(col)>::value_type;
+            fields.emplace_back(static_cast<field_of<T>>(col.at(i)));
+        }, column);
+    }
+    return Tuple(std::move(fields));
+}
+
+// ---------------- Scan ----------------
+
+Scan::Scan(const DbFile &file, std::optional<Predicate> pred) : file(file), it(file.begin()), pred(std::move(pred)) {
+    if (this->pred) {
+        this->pred->check(file.getTupleDesc());
+    }
+}
+
+const TupleDesc &Scan::schema() const { return file.getTupleDesc(); }
+
+// 一次读若干页凑满一批，再按列转置
+bool Scan::next(ColumnBatch &batch) {
+    batch.reset(schema());
+    rows.clear();
+    const Iterator end = file.end();
+    while (rows.size() < DEFAULT_BATCH_SIZE && it != end) {
+        const size_t remaining = DEFAULT_BATCH_SIZE - rows.size();
+        if (pred) {
+            file.scanPageWhere(it, rows, remaining, *pred);
+        } else {
+            file.scanPage(it, rows, remaining);
+        }
+    }
+    for (size_t c = 0; c < batch.columns.size(); ++c) {
+        std::visit([&](auto &col) {
+            using T = typename std::decay_t<decltype(col)>::value_type;
+            col.reserve(rows.size());
+            for (const Tuple &t : rows) {
+                col.push_back(std::get<field_of<T>>(t.get_field(c)));
+            }
+        }, batch.columns[c]);
+    }
+    return !rows.empty();
+}
+
+// ---------------- Filter ----------------
+
+Filter::Filter(std::unique_ptr<Operator> child, const Predicate &pred) : child(std::move(child)), pred(pred) {
+    pred.check(this->child->schema());
+}
+
+const TupleDesc &Filter::schema() const { return child->schema(); }
+
+// 先对整列求值得到位图，再无分支地生成选择向量，最后逐列压紧
+bool Filter::next(ColumnBatch &batch) {
+    while (child->next(batch)) {
+        const size_t n = batch.size();
+        mask.resize((n + 63) / 64);
+        std::visit([&](const auto &col) {
+            using T = typename std::decay_t<decltype(col)>::value_type;
+            if constexpr (std::is_arithmetic_v<T>) {
+                pred.evaluate(reinterpret_cast<const uint8_t *>(col.data()), sizeof(T), n, mask.data());
+            }
+        }, batch.columns[pred.field]);
+
+        selection.resize(n);
+        size_t kept = 0;
+        for (size_t i = 0; i < n; ++i) {
+            selection[kept] = static_cast<uint32_t>(i);
+            kept += (mask[i / 64] >> (i % 64)) & 1;
+        }
+        if (kept == 0) {
+            continue;
+        }
+        if (kept < n) {
+            for (ColumnVector &column : batch.columns) {
+                std::visit([&](auto &col) {
+                    // selection[j] >= j，原地前移即可；跳过自赋值
+                    for (size_t j = 0; j < kept; ++j) {
+                        if (selection[j] != j) col[j] = std::move(col[selection[j]]);
+                    }
+                    col.resize(kept);
+                }, column);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// ---------------- Project ----------------
+
+Project::Project(std::unique_ptr<Operator> child, std::vector<size_t> fields)
+    : child(std::move(child)), fields(std::move(fields)) {
+    const TupleDesc &in = this->child->schema();
+    std::vector<type_t> types;
+    std::vector<std::string> names;
+    for (const size_t f : this->fields) {
+        types.push_back(in.type_of(f));
+        names.push_back(in.name_of(f));
+    }
+    td = TupleDesc(types, names);
+}
+
+const TupleDesc &Project::schema() const { return td; }
+
+bool Project::next(ColumnBatch &batch) {
+    if (!child->next(input)) {
+        return false;
+    }
+    batch.columns.resize(fields.size());
+    for (size_t j = 0; j < fields.size(); ++j) {
+        batch.columns[j] = std::move(input.columns[fields[j]]);
+    }
+    return true;
+}
+
+// ---------------- HashAggregate ----------------
+
+HashAggregate::HashAggregate(std::unique_ptr<Operator> child, size_t group_field, std::vector<Aggregate> aggregates)
+    : child(std::move(child)), group_field(group_field), aggregates(std::move(aggregates)) {
+    const TupleDesc &in = this->child->schema();
+    if (in.type_of(group_field) != type_t::INT) {
+        throw std::logic_error("HashAggregate: group field must be INT");
+    }
+    std::vector<type_t> types;
+    std::vector<std::string> names;
+    for (const Aggregate &a : this->aggregates) {
+        const type_t type = in.type_of(a.field);
+        const bool numeric = type == type_t::INT || type == type_t::DOUBLE;
+        if (a.func != AggregateFunc::COUNT && !numeric) {
+            throw std::logic_error("HashAggregate: SUM/MIN/MAX need an INT or DOUBLE field");
+        }
+        names.push_back(std::string(func_name(a.func)) + "(" + in.name_of(a.field) + ")");
+        switch (a.func) {
+        case AggregateFunc::COUNT:
+            types.push_back(type_t::INT);
+            acc.emplace_back(std::in_place_type<std::vector<int64_t>>);
+            break;
+        case AggregateFunc::SUM:
+            types.push_back(type_t::DOUBLE);
+            acc.emplace_back(std::in_place_type<std::vector<double>>);
+            break;
+        case AggregateFunc::MIN:
+        case AggregateFunc::MAX:
+            types.push_back(type);
+            if (type == type_t::INT) {
+                acc.emplace_back(std::in_place_type<std::vector<int32_t>>);
+            } else {
+                acc.emplace_back(std::in_place_type<std::vector<double>>);
+            }
+            break;
+        }
+    }
+    td = TupleDesc::merge(TupleDesc({type_t::INT}, {in.name_of(group_field)}), TupleDesc(types, names));
+}
+
+const TupleDesc &HashAggregate::schema() const { return td; }
+
+// 每批先查哈希表得到组号，再对每个聚合按列做一次紧凑的折叠
+void HashAggregate::build() {
+    ColumnBatch in;
+    std::vector<uint32_t> gid;
+    while (child->next(in)) {
+        const auto &key_col = std::get<std::vector<int32_t>>(in.columns[group_field]);
+        const size_t n = key_col.size();
+        gid.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            const auto [pos, inserted] = groups.try_emplace(key_col[i], static_cast<uint32_t>(keys.size()));
+            if (inserted) {
+                keys.push_back(key_col[i]);
+            }
+            gid[i] = pos->second;
+        }
+
+        for (size_t a = 0; a < aggregates.size(); ++a) {
+            const AggregateFunc func = aggregates[a].func;
+            const ColumnVector &column = in.columns[aggregates[a].field];
+            std::visit([&](auto &values) {
+                using A = typename std::decay_t<decltype(values)>::value_type;
+                A identity{};
+                if (func == AggregateFunc::MIN) {
+                    identity = std::numeric_limits<A>::has_infinity ? std::numeric_limits<A>::infinity()
+                                                                    : std::numeric_limits<A>::max();
+                } else if (func == AggregateFunc::MAX) {
+                    identity = std::numeric_limits<A>::has_infinity ? -std::numeric_limits<A>::infinity()
+                                                                    : std::numeric_limits<A>::lowest();
+                }
+                values.resize(keys.size(), identity);
+
+                if (func == AggregateFunc::COUNT) {
+                    for (size_t i = 0; i < n; ++i) {
+                        ++values[gid[i]];
+                    }
+                    return;
+                }
+                std::visit([&](const auto &col) {
+                    using T = typename std::decay_t<decltype(col)>::value_type;
+                    if constexpr (std::is_arithmetic_v<T>) {
+                        if constexpr (std::is_same_v<A, double> || std::is_same_v<A, T>) {
+                            if (func == AggregateFunc::SUM) {
+                                for (size_t i = 0; i < n; ++i) {
+                                    values[gid[i]] += static_cast<A>(col[i]);
+                                }
+                            }
+                        }
+                        if constexpr (std::is_same_v<A, T>) {
+                            if (func == AggregateFunc::MIN) fold_min(values, gid, col);
+                            if (func == AggregateFunc::MAX) fold_max(values, gid, col);
+                        }
+                    }
+                }, column);
+            }, acc[a]);
+        }
+    }
+
+    order.resize(keys.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](uint32_t x, uint32_t y) { return keys[x] < keys[y]; });
+    built = true;
+}
+
+bool HashAggregate::next(ColumnBatch &batch) {
+    if (!built) {
+        build();
+    }
+    if (emitted >= order.size()) {
+        return false;
+    }
+    batch.reset(td);
+    const size_t m = std::min(DEFAULT_BATCH_SIZE, order.size() - emitted);
+
+    auto &key_out = std::get<std::vector<int32_t>>(batch.columns[0]);
+    for (size_t j = 0; j < m; ++j) {
+        key_out.push_back(keys[order[emitted + j]]);
+    }
+    for (size_t a = 0; a < aggregates.size(); ++a) {
+        std::visit([&](const auto &values) {
+            using A = typename std::decay_t<decltype(values)>::value_type;
+            // 计数输出为 INT 列
+            using Out = std::conditional_t<std::is_same_v<A, int64_t>, int32_t, A>;
+            auto &out = std::get<std::vector<Out>>(batch.columns[1 + a]);
+            for (size_t j = 0; j < m; ++j) {
+                out.push_back(static_cast<Out>(values[order[emitted + j]]));
+            }
+        }, acc[a]);
+    }
+    emitted += m;
+    return true;
+}
+
+// ---------------- HashJoin ----------------
+
+HashJoin::HashJoin(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, size_t left_field,
+                   size_t right_field, size_t max_build_rows, std::string spill_prefix)
+    : left(std::move(left)), right(std::move(right)), left_field(left_field), right_field(right_field),
+      max_build_rows(max_build_rows), spill_prefix(std::move(spill_prefix)) {
+    if (this->left->schema().type_of(left_field) != type_t::INT ||
+        this->right->schema().type_of(right_field) != type_t::INT) {
+        throw std::logic_error("HashJoin: join columns must be INT");
+    }
+    td = TupleDesc::merge(this->left->schema(), this->right->schema());
+}
+
+HashJoin::~HashJoin() {
+    // 先关闭（空闲空间映射在析构时落盘），再删除
+    left_parts.clear();
+    right_parts.clear();
+    for (const std::string &name : files) {
+        std::remove(name.c_str());
+        std::remove((name + ".fsm").c_str());
+    }
+}
+
+const TupleDesc &HashJoin::schema() const { return td; }
+
+// 逆序建链，使同 key 的行按输入顺序被访问
+void HashJoin::buildTable() {
+    heads.clear();
+    chain.assign(build_rows.size(), NONE);
+    for (auto r = static_cast<uint32_t>(build_rows.size()); r-- > 0;) {
+        const int32_t key = std::get<int>(build_rows[r].get_field(right_field));
+        const auto [it, inserted] = heads.try_emplace(key, r);
+        if (!inserted) {
+            chain[r] = it->second;
+            it->second = r;
+        }
+    }
+}
+
+void HashJoin::openPartitions() {
+    const std::string base = spill_prefix + "." + std::to_string(getpid()) + "." + std::to_string(spill_seq++);
+    for (size_t p = 0; p < PARTITIONS; ++p) {
+        for (const char side : {'l', 'r'}) {
+            const std::string name = base + "." + side + std::to_string(p);
+            std::remove(name.c_str());
+            std::remove((name + ".fsm").c_str());
+            files.push_back(name);
+            auto &parts = side == 'l' ? left_parts : right_parts;
+            parts.push_back(std::make_unique<HeapFile>(name, (side == 'l' ? left : right)->schema()));
+        }
+    }
+}
+
+// 读完右输入；超出内存预算时把两侧都按 key 分区写入临时文件
+void HashJoin::start() {
+    started = true;
+    ColumnBatch b;
+    std::vector<std::vector<Tuple>> staged(PARTITIONS);
+    while (right->next(b)) {
+        const auto &keys = std::get<std::vector<int32_t>>(b.columns[right_field]);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (!right_parts.empty()) {
+                stage(staged, right_parts, partition_of(keys[i]), b.row(i));
+                continue;
+            }
+            build_rows.push_back(b.row(i));
+            if (build_rows.size() > max_build_rows) {
+                openPartitions();
+                for (Tuple &t : build_rows) {
+                    const size_t p = partition_of(std::get<int>(t.get_field(right_field)));
+                    stage(staged, right_parts, p, std::move(t));
+                }
+                build_rows.clear();
+            }
+        }
+    }
+
+    if (right_parts.empty()) {
+        buildTable();
+        probe = left.get();
+        return;
+    }
+    flush(staged, right_parts);
+    while (left->next(b)) {
+        const auto &keys = std::get<std::vector<int32_t>>(b.columns[left_field]);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            stage(staged, left_parts, partition_of(keys[i]), b.row(i));
+        }
+    }
+    flush(staged, left_parts);
+}
+
+// 载入下一个非空的右分区建表，并以对应的左分区作为探测输入
+bool HashJoin::nextPartition() {
+    while (partition < right_parts.size()) {
+        const size_t p = partition++;
+        HeapFile &file = *right_parts[p];
+        build_rows.clear();
+        for (Iterator it = file.begin(); it != file.end();) {
+            file.scanPage(it, build_rows, std::numeric_limits<size_t>::max());
+        }
+        if (build_rows.empty()) {
+            continue;
+        }
+        buildTable();
+        probe_scan = std::make_unique<Scan>(*left_parts[p]);
+        probe = probe_scan.get();
+        return true;
+    }
+    return false;
+}
+
+bool HashJoin::next(ColumnBatch &batch) {
+    if (!started) {
+        start();
+    }
+    batch.reset(td);
+    size_t rows = 0;
+    while (rows < DEFAULT_BATCH_SIZE) {
+        if (match != NONE) {
+            append_row(batch, probe_batch, probe_row, build_rows[match]);
+            ++rows;
+            match = chain[match];
+            if (match == NONE) ++probe_row;
+            continue;
+        }
+        if (probe_row < probe_batch.size()) {
+            const int32_t key = std::get<std::vector<int32_t>>(probe_batch.columns[left_field])[probe_row];
+            const auto it = heads.find(key);
+            if (it == heads.end()) {
+                ++probe_row;
+            } else {
+                match = it->second;
+            }
+            continue;
+        }
+        probe_row = 0;
+        if (probe != nullptr && probe->next(probe_batch)) {
+            continue;
+        }
+        // 当前探测输入读完（返回 false 时批的内容不确定）
+        probe = nullptr;
+        probe_batch.columns.clear();
+        if (!nextPartition()) {
+            break;
+        }
+    }
+    return rows > 0;
+}
+
+// ---------------- IndexJoin ----------------
+
+IndexJoin::IndexJoin(std::unique_ptr<Operator> left, size_t left_field, const BTreeFile &index)
+    : left(std::move(left)), left_field(left_field), index(index) {
+    if (this->left->schema().type_of(left_field) != type_t::INT) {
+        throw std::logic_error("IndexJoin: join column must be INT");
+    }
+    td = TupleDesc::merge(this->left->schema(), index.getTupleDesc());
+}
+
+const TupleDesc &IndexJoin::schema() const { return td; }
+
+bool IndexJoin::next(ColumnBatch &batch) {
+    batch.reset(td);
+    size_t rows = 0;
+    const Iterator end = index.end();
+    while (rows < DEFAULT_BATCH_SIZE && !done) {
+        if (probe_row >= probe_batch.size()) {
+            probe_row = 0;
+            if (!left->next(probe_batch)) {
+                probe_batch.columns.clear();
+                done = true;
+            }
+            continue;
+        }
+        const int32_t key = std::get<std::vector<int32_t>>(probe_batch.columns[left_field])[probe_row];
+        const Iterator it = index.find(key);
+        if (it != end) {
+            append_row(batch, probe_batch, probe_row, index.getTuple(it));
+            ++rows;
+        }
+        ++probe_row;
+    }
+    return rows > 0;
+}
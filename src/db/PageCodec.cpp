@@ -0,0 +1,125 @@
+#include <db/PageCodec.hpp>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace db;
+
+namespace {
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 0xFFFF;
+constexpr unsigned HASH_BITS = 12;
+
+uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hash4(uint32_t v) { return (v * 2654435761u) >> (32 - HASH_BITS); }
+
+// 写出 15 之后的长度延伸字节；空间不足返回 false
+bool put_length(uint8_t *&op, const uint8_t *end, size_t len) {
+    for (; len >= 255; len -= 255) {
+        if (op == end) return false;
+        *op++ = 255;
+    }
+    if (op == end) return false;
+    *op++ = static_cast<uint8_t>(len);
+    return true;
+}
+
+// 一个序列：literals 为 [lit, lit + lit_len)，match_len 为 0 表示最后一个只有 literals 的序列
+bool put_sequence(uint8_t *&op, const uint8_t *end, const uint8_t *lit, size_t lit_len, size_t offset,
+                  size_t match_len) {
+    if (op == end) return false;
+    uint8_t &token = *op++;
+    token = static_cast<uint8_t>(std::min<size_t>(lit_len, 15) << 4);
+    if (lit_len >= 15 && !put_length(op, end, lit_len - 15)) return false;
+    if (static_cast<size_t>(end - op) < lit_len) return false;
+    std::memcpy(op, lit, lit_len);
+    op += lit_len;
+    if (match_len == 0) return true;
+
+    if (end - op < 2) return false;
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    const size_t extra = match_len - MIN_MATCH;
+    token |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+    return extra < 15 || put_length(op, end, extra - 15);
+}
+
+size_t get_length(const uint8_t *&ip, const uint8_t *end, size_t len) {
+    if (len != 15) return len;
+    uint8_t b;
+    do {
+        if (ip == end) throw std::runtime_error("decompress_page: truncated length");
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+} // namespace
+
+size_t db::compress_page(const Page &page, uint8_t *dst, size_t cap) {
+    const uint8_t *src = page.data();
+    const size_t n = page.size();
+    uint8_t *op = dst;
+    const uint8_t *end = dst + cap;
+
+    // 保存 位置 + 1，0 表示空
+    uint16_t table[size_t{1} << HASH_BITS] = {};
+    static_assert(DEFAULT_PAGE_SIZE < 0xFFFF);
+
+    size_t anchor = 0;
+    size_t ip = 0;
+    while (ip + MIN_MATCH <= n) {
+        const uint32_t h = hash4(read32(src + ip));
+        const size_t cand = table[h];
+        table[h] = static_cast<uint16_t>(ip + 1);
+        if (cand == 0 || ip - (cand - 1) > MAX_OFFSET || read32(src + cand - 1) != read32(src + ip)) {
+            ++ip;
+            continue;
+        }
+        const size_t m = cand - 1;
+        size_t len = MIN_MATCH;
+        while (ip + len < n && src[m + len] == src[ip + len]) ++len;
+        if (!put_sequence(op, end, src + anchor, ip - anchor, ip - m, len)) return 0;
+        ip += len;
+        anchor = ip;
+    }
+    if (!put_sequence(op, end, src + anchor, n - anchor, 0, 0)) return 0;
+    return static_cast<size_t>(op - dst);
+}
+
+void db::decompress_page(const uint8_t *src, size_t len, Page &page) {
+    const uint8_t *ip = src;
+    const uint8_t *end = src + len;
+    uint8_t *out = page.data();
+    size_t pos = 0;
+    while (true) {
+        if (ip == end) throw std::runtime_error("decompress_page: truncated sequence");
+        const uint8_t token = *ip++;
+        const size_t lit_len = get_length(ip, end, token >> 4);
+        if (static_cast<size_t>(end - ip) < lit_len || page.size() - pos < lit_len) {
+            throw std::runtime_error("decompress_page: literals out of bounds");
+        }
+        std::memcpy(out + pos, ip, lit_len);
+        ip += lit_len;
+        pos += lit_len;
+        if (ip == end) break;
+
+        if (end - ip < 2) throw std::runtime_error("decompress_page: truncated offset");
+        const size_t offset = ip[0] | (size_t{ip[1]} << 8);
+        ip += 2;
+        const size_t match_len = get_length(ip, end, token & 15) + MIN_MATCH;
+        if (offset == 0 || offset > pos || page.size() - pos < match_len) {
+            throw std::runtime_error("decompress_page: match out of bounds");
+        }
+        // 逐字节复制：offset 小于长度时源与目标重叠（例如 0 的长串 offset 为 1）
+        for (size_t i = 0; i < match_len; ++i, ++pos) {
+            out[pos] = out[pos - offset];
+        }
+    }
+    if (pos != page.size()) throw std::runtime_error("decompress_page: wrong page size");
+}
@@ -0,0 +1,180 @@
+#include <db/PageTable.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+// 完整读/写 n 字节；EINTR 重试
+bool read_all(int fd, void *buf, size_t n) {
+    auto *p = static_cast<uint8_t *>(buf);
+    while (n > 0) {
+        const ssize_t r = read(fd, p, n);
+        if (r == -1 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+bool write_all(int fd, const void *buf, size_t n) {
+    const auto *p = static_cast<const uint8_t *>(buf);
+    while (n > 0) {
+        const ssize_t w = write(fd, p, n);
+        if (w == -1 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+struct FreeEntry {
+    uint64_t offset;
+    uint64_t units;
+};
+} // namespace
+
+// 文件格式：| MAGIC | file_end | next_seq | 页数 | 空闲数 | Extent[页数] | FreeEntry[空闲数] |
+PageTable::PageTable(std::string path) : path(std::move(path)), free_extents(MAX_UNITS + 1) {
+    const int fd = open(this->path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    uint64_t head[5];
+    if (read_all(fd, head, sizeof(head)) && head[0] == MAGIC) {
+        std::vector<Extent> table(head[3]);
+        std::vector<FreeEntry> free(head[4]);
+        if (read_all(fd, table.data(), table.size() * sizeof(Extent)) &&
+            read_all(fd, free.data(), free.size() * sizeof(FreeEntry))) {
+            extents = std::move(table);
+            for (const FreeEntry &f : free) {
+                if (f.units >= 1 && f.units <= MAX_UNITS) free_extents[f.units].push_back(f.offset);
+            }
+            file_end = head[1];
+            next_seq = head[2];
+            loaded = true;
+        }
+    }
+    close(fd);
+    // 原地覆写会改变 extent 的长度而不改变文件大小：打开期间删掉旧表，崩溃后下次打开必然重建
+    unlink(this->path.c_str());
+    dirty = true;
+}
+
+PageTable::~PageTable() {
+    // 析构中不抛异常：保存失败只会让下次打开时重建
+    try {
+        if (dirty) save();
+    } catch (const std::exception &) {
+    }
+}
+
+bool PageTable::covers(uint64_t file_size) const { return loaded && file_end == file_size; }
+
+void PageTable::rebuild(int fd, uint64_t file_size) {
+    extents.clear();
+    for (auto &list : free_extents) list.clear();
+    std::vector<uint64_t> seqs;     // 每页当前胜出 extent 的序号
+    next_seq = 1;
+
+    uint64_t off = 0;
+    while (off + sizeof(ExtentHeader) <= file_size) {
+        ExtentHeader h{};
+        const ssize_t n = pread(fd, &h, sizeof(h), static_cast<off_t>(off));
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("PageTable: pread failed for " + path + ": " + std::strerror(errno));
+        }
+        if (static_cast<size_t>(n) != sizeof(h) || h.magic != EXTENT_MAGIC || h.units == 0 ||
+            h.units > MAX_UNITS || h.length == 0 || h.length > DEFAULT_PAGE_SIZE || h.page >= file_size / UNIT ||
+            sizeof(ExtentHeader) + h.length > h.units * UNIT || off + h.units * UNIT > file_size) {
+            break;
+        }
+        const Extent e{off, h.length, h.units};
+        if (h.page >= extents.size()) {
+            extents.resize(h.page + 1);
+            seqs.resize(h.page + 1, 0);
+        }
+        if (h.seq > seqs[h.page]) {
+            if (extents[h.page].length != 0) release(extents[h.page]);
+            extents[h.page] = e;
+            seqs[h.page] = h.seq;
+        } else {
+            release(e);
+        }
+        next_seq = std::max(next_seq, h.seq + 1);
+        off += h.units * UNIT;
+    }
+    file_end = off;
+    loaded = true;
+    dirty = true;
+}
+
+size_t PageTable::size() const { return extents.size(); }
+
+PageTable::Extent PageTable::find(size_t page) const {
+    return page < extents.size() ? extents[page] : Extent{};
+}
+
+void PageTable::release(const Extent &e) { free_extents[e.units].push_back(e.offset); }
+
+PageTable::Extent PageTable::place(size_t page, uint32_t length, uint64_t &seq) {
+    if (page >= extents.size()) {
+        extents.resize(page + 1);
+    }
+    const auto units = static_cast<uint32_t>((sizeof(ExtentHeader) + length + UNIT - 1) / UNIT);
+    Extent &cur = extents[page];
+    seq = next_seq++;
+    dirty = true;
+    if (cur.length != 0 && cur.units >= units) {
+        cur.length = length;
+        return cur;
+    }
+
+    Extent next{0, length, units};
+    uint32_t u = units;
+    while (u <= MAX_UNITS && free_extents[u].empty()) ++u;
+    if (u <= MAX_UNITS) {
+        next.offset = free_extents[u].back();
+        next.units = u;
+        free_extents[u].pop_back();
+    } else {
+        next.offset = file_end;
+        file_end += units * UNIT;
+    }
+    if (cur.length != 0) release(cur);
+    cur = next;
+    return cur;
+}
+
+void PageTable::save() {
+    const std::string tmp = path + ".tmp";
+    const int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("PageTable: cannot open " + tmp + ": " + std::strerror(errno));
+    }
+    std::vector<FreeEntry> free;
+    for (uint32_t u = 1; u <= MAX_UNITS; ++u) {
+        for (const uint64_t off : free_extents[u]) free.push_back({off, u});
+    }
+    const uint64_t head[5] = {MAGIC, file_end, next_seq, extents.size(), free.size()};
+    const bool ok = write_all(fd, head, sizeof(head)) &&
+                    write_all(fd, extents.data(), extents.size() * sizeof(Extent)) &&
+                    write_all(fd, free.data(), free.size() * sizeof(FreeEntry));
+    int err = errno;
+    close(fd);
+    if (ok && rename(tmp.c_str(), path.c_str()) == 0) {
+        dirty = false;
+        return;
+    }
+    if (ok) err = errno;
+    unlink(tmp.c_str());
+    throw std::runtime_error("PageTable: cannot write " + path + ": " + std::strerror(err));
+}
@@ -0,0 +1,180 @@
+#include <db/ParallelScan.hpp>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+using namespace db;
+
+ParallelScan::ParallelScan(size_t threads) {
+    if (threads == 0) {
+        threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    ranges = std::make_unique<Range[]>(threads);
+    workers.reserve(threads);
+    for (size_t w = 0; w < threads; ++w) {
+        workers.emplace_back([this, w] { work(w); });
+    }
+}
+
+ParallelScan::~ParallelScan() {
+    {
+        std::lock_guard lock(mtx);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (std::thread &t : workers) {
+        t.join();
+    }
+}
+
+size_t ParallelScan::threads() const { return workers.size(); }
+
+void ParallelScan::work(size_t self) {
+    size_t seen = 0;
+    std::unique_lock lock(mtx);
+    while (true) {
+        work_cv.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        const std::function<void(size_t)> &body = *job;
+        lock.unlock();
+
+        size_t morsel;
+        while (take(self, morsel)) {
+            try {
+                body(morsel);
+            } catch (...) {
+                std::lock_guard guard(mtx);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+        }
+
+        lock.lock();
+        if (--running == 0) {
+            done_cv.notify_all();
+        }
+    }
+}
+
+// 先取自己区间的下一个；空了就从其他线程的区间拿走上半段（只剩一个就整个拿走）
+bool ParallelScan::take(size_t self, size_t &morsel) {
+    {
+        std::lock_guard lock(mtx);
+        if (failed) return false;
+    }
+    {
+        Range &own = ranges[self];
+        std::lock_guard lock(own.mtx);
+        if (own.lo < own.hi) {
+            morsel = own.lo++;
+            return true;
+        }
+    }
+    const size_t n = workers.size();
+    for (size_t k = 1; k < n; ++k) {
+        Range &victim = ranges[(self + k) % n];
+        size_t lo;
+        size_t hi;
+        {
+            std::lock_guard lock(victim.mtx);
+            if (victim.lo >= victim.hi) continue;
+            lo = victim.lo + (victim.hi - victim.lo) / 2;
+            hi = victim.hi;
+            victim.hi = lo;
+        }
+        morsel = lo;
+        if (lo + 1 < hi) {
+            Range &own = ranges[self];
+            std::lock_guard lock(own.mtx);
+            own.lo = lo + 1;
+            own.hi = hi;
+        }
+        return true;
+    }
+    return false;
+}
+
+void ParallelScan::run(size_t count, const std::function<void(size_t)> &body) {
+    if (count == 0) {
+        return;
+    }
+    // 按线程切成连续块，相邻 morsel 尽量由同一线程读
+    const size_t n = workers.size();
+    for (size_t w = 0; w < n; ++w) {
+        std::lock_guard lock(ranges[w].mtx);
+        ranges[w].lo = w * count / n;
+        ranges[w].hi = (w + 1) * count / n;
+    }
+
+    std::unique_lock lock(mtx);
+    job = &body;
+    failed = false;
+    error = nullptr;
+    running = n;
+    ++generation;
+    work_cv.notify_all();
+    done_cv.wait(lock, [this] { return running == 0; });
+    job = nullptr;
+    if (error) {
+        std::rethrow_exception(std::exchange(error, nullptr));
+    }
+}
+
+void ParallelScan::scan(const DbFile &file, const std::vector<Iterator> &starts,
+                        const std::function<void(size_t, const Tuple &)> &fn, const Predicate *pred) {
+    const Iterator end = file.end();
+    run(starts.size(), [&](size_t m) {
+        Iterator it = starts[m];
+        const Iterator &stop = m + 1 < starts.size() ? starts[m + 1] : end;
+        std::vector<Tuple> batch;
+        // 区间起点都是页首，scanPage 每次读完一页后恰好停在下一区间的起点上
+        while (it != stop && it != end) {
+            batch.clear();
+            if (pred != nullptr) {
+                file.scanPageWhere(it, batch, std::numeric_limits<size_t>::max(), *pred);
+            } else {
+                file.scanPage(it, batch, std::numeric_limits<size_t>::max());
+            }
+            for (const Tuple &t : batch) {
+                fn(m, t);
+            }
+        }
+    });
+}
+
+void ParallelScan::forEach(const DbFile &file, const std::function<void(const Tuple &)> &fn) {
+    scan(file, file.split(workers.size() * MORSELS_PER_THREAD), [&](size_t, const Tuple &t) { fn(t); });
+}
+
+namespace {
+std::vector<Tuple> concat(std::vector<std::vector<Tuple>> &parts) {
+    std::vector<Tuple> out;
+    size_t total = 0;
+    for (const auto &p : parts) total += p.size();
+    out.reserve(total);
+    for (auto &p : parts) {
+        std::move(p.begin(), p.end(), std::back_inserter(out));
+    }
+    return out;
+}
+} // namespace
+
+std::vector<Tuple> ParallelScan::filter(const DbFile &file, const std::function<bool(const Tuple &)> &pred) {
+    const std::vector<Iterator> starts = file.split(workers.size() * MORSELS_PER_THREAD);
+    std::vector<std::vector<Tuple>> parts(starts.size());
+    scan(file, starts, [&](size_t m, const Tuple &t) {
+        if (pred(t)) parts[m].push_back(t);
+    });
+    return concat(parts);
+}
+
+std::vector<Tuple> ParallelScan::filter(const DbFile &file, const Predicate &pred) {
+    pred.check(file.getTupleDesc());
+    const std::vector<Iterator> starts = file.split(workers.size() * MORSELS_PER_THREAD);
+    std::vector<std::vector<Tuple>> parts(starts.size());
+    scan(file, starts, [&](size_t m, const Tuple &t) { parts[m].push_back(t); }, &pred);
+    return concat(parts);
+}
@@ -0,0 +1,205 @@
+#include <db/Predicate.hpp>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace db;
+
+namespace {
+template <typename T>
+inline T load(const uint8_t *p) {
+    T v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// 向量一次产出 4/8/16 位，起点都是其整数倍，不会跨越 64 位字
+inline void set_bits(uint64_t *mask, size_t i, uint64_t bits) { mask[i / 64] |= bits << (i % 64); }
+
+template <typename T, typename Cmp>
+void scalar(const uint8_t *base, size_t stride, size_t from, size_t n, T key, Cmp cmp, uint64_t *mask) {
+    for (size_t i = from; i < n; ++i) {
+        set_bits(mask, i, cmp(load<T>(base + i * stride), key));
+    }
+}
+
+// 处理 [from, n)；前面的部分已由向量代码处理
+template <typename T>
+void scalar(const uint8_t *base, size_t stride, size_t from, size_t n, T key, CompareOp op, uint64_t *mask) {
+    switch (op) {
+    case CompareOp::EQ: return scalar(base, stride, from, n, key, std::equal_to<T>{}, mask);
+    case CompareOp::NE: return scalar(base, stride, from, n, key, std::not_equal_to<T>{}, mask);
+    case CompareOp::LT: return scalar(base, stride, from, n, key, std::less<T>{}, mask);
+    case CompareOp::LE: return scalar(base, stride, from, n, key, std::less_equal<T>{}, mask);
+    case CompareOp::GT: return scalar(base, stride, from, n, key, std::greater<T>{}, mask);
+    case CompareOp::GE: return scalar(base, stride, from, n, key, std::greater_equal<T>{}, mask);
+    }
+}
+
+// gather 一律用带掩码的形式：非掩码形式以未定义值作源，GCC 会误报未初始化
+#if defined(__AVX512F__)
+// 比较谓词须为编译期常量；返回已处理的个数
+template <int Cmp>
+size_t vector_int(const uint8_t *base, size_t stride, size_t n, int32_t key, uint64_t *mask) {
+    const __m512i k = _mm512_set1_epi32(key);
+    const __m512i offsets = _mm512_mullo_epi32(
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+        _mm512_set1_epi32(static_cast<int>(stride)));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const uint8_t *p = base + i * stride;
+        const __m512i v = stride == sizeof(int32_t)
+                              ? _mm512_loadu_si512(p)
+                              : _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF, offsets, p, 1);
+        set_bits(mask, i, _mm512_cmp_epi32_mask(v, k, Cmp));
+    }
+    return i;
+}
+
+template <int Cmp>
+size_t vector_double(const uint8_t *base, size_t stride, size_t n, double key, uint64_t *mask) {
+    const __m512d k = _mm512_set1_pd(key);
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                               _mm256_set1_epi32(static_cast<int>(stride)));
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint8_t *p = base + i * stride;
+        const __m512d v = stride == sizeof(double)
+                              ? _mm512_loadu_pd(p)
+                              : _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, offsets, p, 1);
+        set_bits(mask, i, _mm512_cmp_pd_mask(v, k, Cmp));
+    }
+    return i;
+}
+
+size_t vector_int(const uint8_t *base, size_t stride, size_t n, int32_t key, CompareOp op, uint64_t *mask) {
+    switch (op) {
+    case CompareOp::EQ: return vector_int<_MM_CMPINT_EQ>(base, stride, n, key, mask);
+    case CompareOp::NE: return vector_int<_MM_CMPINT_NE>(base, stride, n, key, mask);
+    case CompareOp::LT: return vector_int<_MM_CMPINT_LT>(base, stride, n, key, mask);
+    case CompareOp::LE: return vector_int<_MM_CMPINT_LE>(base, stride, n, key, mask);
+    case CompareOp::GT: return vector_int<_MM_CMPINT_NLE>(base, stride, n, key, mask);
+    case CompareOp::GE: return vector_int<_MM_CMPINT_NLT>(base, stride, n, key, mask);
+    }
+    return 0;
+}
+#elif defined(__AVX2__)
+// 只有 == 与 >：NE/LE/GE 取反（对整数是精确的）
+size_t vector_int(const uint8_t *base, size_t stride, size_t n, int32_t key, CompareOp op, uint64_t *mask) {
+    const __m256i k = _mm256_set1_epi32(key);
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                               _mm256_set1_epi32(static_cast<int>(stride)));
+    const unsigned invert = op == CompareOp::NE || op == CompareOp::LE || op == CompareOp::GE ? 0xFFu : 0u;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const uint8_t *p = base + i * stride;
+        const __m256i v = stride == sizeof(int32_t)
+                              ? _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))
+                              : _mm256_i32gather_epi32(reinterpret_cast<const int *>(p), offsets, 1);
+        __m256i r;
+        switch (op) {
+        case CompareOp::EQ:
+        case CompareOp::NE: r = _mm256_cmpeq_epi32(v, k); break;
+        case CompareOp::LT:
+        case CompareOp::GE: r = _mm256_cmpgt_epi32(k, v); break;
+        default: r = _mm256_cmpgt_epi32(v, k); break;
+        }
+        set_bits(mask, i, static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(r))) ^ invert);
+    }
+    return i;
+}
+
+template <int Cmp>
+size_t vector_double(const uint8_t *base, size_t stride, size_t n, double key, uint64_t *mask) {
+    const __m256d k = _mm256_set1_pd(key);
+    const __m128i offsets = _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(static_cast<int>(stride)));
+    const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const uint8_t *p = base + i * stride;
+        const __m256d v = stride == sizeof(double)
+                              ? _mm256_loadu_pd(reinterpret_cast<const double *>(p))
+                              : _mm256_mask_i32gather_pd(_mm256_setzero_pd(), reinterpret_cast<const double *>(p),
+                                                         offsets, all, 1);
+        set_bits(mask, i, static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(v, k, Cmp))));
+    }
+    return i;
+}
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+// 有序比较（NaN 不满足），NE 为无序比较（NaN 满足），与标量运算符一致
+size_t vector_double(const uint8_t *base, size_t stride, size_t n, double key, CompareOp op, uint64_t *mask) {
+    switch (op) {
+    case CompareOp::EQ: return vector_double<_CMP_EQ_OQ>(base, stride, n, key, mask);
+    case CompareOp::NE: return vector_double<_CMP_NEQ_UQ>(base, stride, n, key, mask);
+    case CompareOp::LT: return vector_double<_CMP_LT_OQ>(base, stride, n, key, mask);
+    case CompareOp::LE: return vector_double<_CMP_LE_OQ>(base, stride, n, key, mask);
+    case CompareOp::GT: return vector_double<_CMP_GT_OQ>(base, stride, n, key, mask);
+    case CompareOp::GE: return vector_double<_CMP_GE_OQ>(base, stride, n, key, mask);
+    }
+    return 0;
+}
+#endif
+
+template <typename T>
+bool compare(T v, CompareOp op, T key) {
+    switch (op) {
+    case CompareOp::EQ: return v == key;
+    case CompareOp::NE: return v != key;
+    case CompareOp::LT: return v < key;
+    case CompareOp::LE: return v <= key;
+    case CompareOp::GT: return v > key;
+    case CompareOp::GE: return v >= key;
+    }
+    return false;
+}
+} // namespace
+
+void Predicate::check(const TupleDesc &td) const {
+    if (field >= td.size()) {
+        throw std::logic_error("Predicate: field out of range");
+    }
+    const type_t type = td.type_of(field);
+    if (!(type == type_t::INT && std::holds_alternative<int>(value)) &&
+        !(type == type_t::DOUBLE && std::holds_alternative<double>(value))) {
+        throw std::logic_error("Predicate: value does not match an INT or DOUBLE field");
+    }
+}
+
+bool Predicate::matches(const Tuple &t) const {
+    const field_t &f = t.get_field(field);
+    if (const int *k = std::get_if<int>(&value)) {
+        return compare(std::get<int>(f), op, *k);
+    }
+    return compare(std::get<double>(f), op, std::get<double>(value));
+}
+
+bool Predicate::matches(const TupleView &v) const {
+    if (const int *k = std::get_if<int>(&value)) {
+        return compare(v.get_int(field), op, *k);
+    }
+    return compare(v.get_double(field), op, std::get<double>(value));
+}
+
+void Predicate::evaluate(const uint8_t *base, size_t stride, size_t n, uint64_t *mask) const {
+    std::fill_n(mask, (n + 63) / 64, 0);
+    size_t i = 0;
+    if (const int *k = std::get_if<int>(&value)) {
+#if defined(__AVX512F__) || defined(__AVX2__)
+        i = vector_int(base, stride, n, *k, op, mask);
+#endif
+        scalar<int32_t>(base, stride, i, n, *k, op, mask);
+        return;
+    }
+    const double k = std::get<double>(value);
+#if defined(__AVX512F__) || defined(__AVX2__)
+    i = vector_double(base, stride, n, k, op, mask);
+#endif
+    scalar<double>(base, stride, i, n, k, op, mask);
+}
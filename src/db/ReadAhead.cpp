@@ -0,0 +1,122 @@
+#include <db/BufferPool.hpp>
+#include <db/ReadAhead.hpp>
+#include <algorithm>
+#include <exception>
+#include <vector>
+
+using namespace db;
+
+ReadAhead::ReadAhead(BufferPool &pool, size_t max_window)
+    : pool(pool), max_window(std::max<size_t>(1, max_window)) {
+    worker = std::thread([this] { run(); });
+}
+
+ReadAhead::~ReadAhead() {
+    {
+        std::lock_guard lock(mtx);
+        stopping = true;
+        jobs.clear();
+    }
+    work_cv.notify_all();
+    worker.join();
+}
+
+void ReadAhead::onSequential(const PageId &pid, size_t num_pages) {
+    std::lock_guard lock(mtx);
+    auto [it, inserted] = streams.try_emplace(pid.file,
+                                              Stream{pid.page, std::min(INITIAL_WINDOW, max_window), pid.page + 1});
+    Stream &s = it->second;
+    if (inserted || pid.page == s.last) {
+        return;
+    }
+
+    if (pid.page != s.last + 1) {
+        // 跳读：窗口复位
+        s.window = std::min(INITIAL_WINDOW, max_window);
+        s.issued_until = pid.page + 1;
+        s.last = pid.page;
+        return;
+    }
+    s.last = pid.page;
+
+    // 游标进入已预读区间的后半段时，发起下一个窗口
+    if (pid.page + s.window / 2 + 1 < s.issued_until || s.issued_until >= num_pages) {
+        return;
+    }
+    const size_t from = std::max(s.issued_until, pid.page + 1);
+    const size_t to = std::min(from + s.window, num_pages);
+    if (from >= to) {
+        return;
+    }
+    jobs.push_back({{pid.file, from}, to - from, nullptr});
+    s.issued_until = to;
+    s.window = std::min(s.window * 2, max_window);
+    work_cv.notify_one();
+}
+
+void ReadAhead::onChain(const PageId &pid, NextPageFn next) {
+    std::lock_guard lock(mtx);
+    // 每前进半个窗口的页才沿链再预读一个窗口
+    const size_t step = chain_steps[pid.file]++;
+    if (step % std::max<size_t>(1, max_window / 2) != 0) {
+        return;
+    }
+    jobs.push_back({pid, max_window, next});
+    work_cv.notify_one();
+}
+
+void ReadAhead::drain() {
+    std::unique_lock lock(mtx);
+    idle_cv.wait(lock, [this] { return jobs.empty() && !busy; });
+}
+
+void ReadAhead::run() {
+    std::unique_lock lock(mtx);
+    while (true) {
+        work_cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (stopping) {
+            return;
+        }
+        Job job = jobs.front();
+        jobs.pop_front();
+        busy = true;
+        lock.unlock();
+
+        try {
+            execute(job);
+        } catch (const std::exception &) {
+            // 预读只是提示，失败（如文件已被移除、帧都被 pin 住）直接忽略
+        }
+
+        lock.lock();
+        busy = false;
+        if (jobs.empty()) {
+            idle_cv.notify_all();
+        }
+    }
+}
+
+void ReadAhead::execute(const Job &job) {
+    if (job.next == nullptr) {
+        std::vector<PageId> pids;
+        pids.reserve(job.count);
+        for (size_t i = 0; i < job.count; ++i) {
+            pids.push_back({job.first.file, job.first.page + i});
+        }
+        pool.prefetch(pids, AccessIntent::SCAN);
+        return;
+    }
+
+    PageId pid = job.first;
+    for (size_t i = 0; i < job.count; ++i) {
+        size_t next;
+        {
+            PageGuard guard = pool.pinPage(pid, AccessIntent::SCAN);
+            next = job.next(*guard);
+        }
+        if (next == static_cast<size_t>(-1)) {
+            return;
+        }
+        pid.page = next;
+    }
+}
@@ -0,0 +1,233 @@
+#include <db/BloomFilter.hpp>
+#include <db/Statistics.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+
+using namespace db;
+
+namespace {
+double to_double(const field_t &v) {
+    if (const int *i = std::get_if<int>(&v)) {
+        return *i;
+    }
+    return std::get<double>(v);
+}
+
+// v 在桶 [lo, hi] 中的相对位置；字符串无法插值，取桶中间
+double position(const field_t &lo, const field_t &hi, const field_t &v) {
+    if (std::holds_alternative<std::string>(v)) {
+        return v == lo ? 0.0 : 0.5;
+    }
+    const double l = to_double(lo);
+    const double h = to_double(hi);
+    return h > l ? std::clamp((to_double(v) - l) / (h - l), 0.0, 1.0) : 0.0;
+}
+
+bool is_nan(const field_t &v) {
+    const double *d = std::get_if<double>(&v);
+    return d != nullptr && std::isnan(*d);
+}
+} // namespace
+
+HyperLogLog::HyperLogLog(size_t precision) : precision(precision) {
+    if (precision < 4 || precision > 18) {
+        throw std::logic_error("HyperLogLog: precision must be in [4, 18]");
+    }
+    registers.assign(size_t{1} << precision, 0);
+}
+
+// 高 precision 位选寄存器，其余位的前导 0 个数加 1 为秩
+void HyperLogLog::add(uint64_t hash) {
+    const size_t index = hash >> (64 - precision);
+    const uint64_t rest = hash << precision;
+    const auto rank = static_cast<uint8_t>(rest == 0 ? 64 - precision + 1 : std::countl_zero(rest) + 1);
+    registers[index] = std::max(registers[index], rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+    if (other.precision != precision) {
+        throw std::logic_error("HyperLogLog::merge: precisions differ");
+    }
+    for (size_t i = 0; i < registers.size(); ++i) {
+        registers[i] = std::max(registers[i], other.registers[i]);
+    }
+}
+
+// 64 位哈希不会饱和，不需要大基数修正
+uint64_t HyperLogLog::estimate() const {
+    const auto m = static_cast<double>(registers.size());
+    double sum = 0;
+    size_t zeros = 0;
+    for (const uint8_t r : registers) {
+        sum += std::ldexp(1.0, -r);
+        zeros += r == 0;
+    }
+    const double alpha = 0.7213 / (1 + 1.079 / m);
+    double e = alpha * m * m / sum;
+    if (e <= 2.5 * m && zeros != 0) {
+        e = m * std::log(m / static_cast<double>(zeros));
+    }
+    return static_cast<uint64_t>(std::llround(e));
+}
+
+uint64_t HyperLogLog::hash(const field_t &value) {
+    if (const int *v = std::get_if<int>(&value)) {
+        return BloomFilter::hash(v, sizeof(*v));
+    }
+    if (const double *v = std::get_if<double>(&value)) {
+        const double d = *v == 0.0 ? 0.0 : *v;
+        return BloomFilter::hash(&d, sizeof(d));
+    }
+    const std::string &s = std::get<std::string>(value);
+    return BloomFilter::hash(s.data(), s.size());
+}
+
+// v 之前的整桶数加上 v 在所在桶中的位置；等值跨多个边界时 lower_bound 落在第一个
+double ColumnStats::fractionLess(const field_t &v) const {
+    if (bounds.empty() || !(bounds.front() < v)) {
+        return 0;
+    }
+    if (bounds.back() < v) {
+        return 1;
+    }
+    const size_t i = std::lower_bound(bounds.begin(), bounds.end(), v) - bounds.begin();
+    return (static_cast<double>(i - 1) + position(bounds[i - 1], bounds[i], v)) /
+           static_cast<double>(bounds.size() - 1);
+}
+
+double ColumnStats::fractionAtMost(const field_t &v) const {
+    if (bounds.empty() || v < bounds.front()) {
+        return 0;
+    }
+    if (!(v < bounds.back())) {
+        return 1;
+    }
+    const size_t i = std::upper_bound(bounds.begin(), bounds.end(), v) - bounds.begin();
+    return (static_cast<double>(i - 1) + position(bounds[i - 1], bounds[i], v)) /
+           static_cast<double>(bounds.size() - 1);
+}
+
+double ColumnStats::fractionEqual(const field_t &v) const {
+    if (bounds.empty() || v < bounds.front() || bounds.back() < v) {
+        return 0;
+    }
+    const double uniform = 1.0 / static_cast<double>(std::max<uint64_t>(distinct, 1));
+    return std::min(1.0, std::max(uniform, fractionAtMost(v) - fractionLess(v)));
+}
+
+double TableStats::selectivity(const Predicate &pred) const {
+    if (pred.field >= columns.size()) {
+        throw std::logic_error("TableStats::selectivity: no statistics for the field");
+    }
+    if (is_nan(pred.value)) {
+        return pred.op == CompareOp::NE ? 1 : 0;
+    }
+    const ColumnStats &c = columns[pred.field];
+    double s = 0;
+    switch (pred.op) {
+        case CompareOp::EQ: s = c.fractionEqual(pred.value); break;
+        case CompareOp::NE: s = 1 - c.fractionEqual(pred.value); break;
+        case CompareOp::LT: s = c.fractionLess(pred.value); break;
+        case CompareOp::LE: s = c.fractionAtMost(pred.value); break;
+        case CompareOp::GT: s = 1 - c.fractionAtMost(pred.value); break;
+        case CompareOp::GE: s = 1 - c.fractionLess(pred.value); break;
+    }
+    return std::clamp(s, 0.0, 1.0);
+}
+
+double TableStats::estimateRows(const Predicate &pred) const {
+    return selectivity(pred) * static_cast<double>(rows);
+}
+
+// 抽样时偶数号区间另记一份 HyperLogLog：从半数样本到全部样本的增长决定外推的幂次
+TableStats db::collectStats(const DbFile &file, size_t sample_pages, size_t buckets) {
+    if (sample_pages == 0 || buckets == 0) {
+        throw std::logic_error("collectStats: sample_pages and buckets must be positive");
+    }
+    const size_t columns = file.getTupleDesc().size();
+    TableStats stats;
+    stats.complete = file.getNumPages() <= sample_pages;
+
+    std::vector<HyperLogLog> all(columns);
+    std::vector<HyperLogLog> half(columns);
+    std::vector<std::vector<field_t>> values(columns);
+    std::vector<Tuple> rows;
+    size_t pages = 0;
+    const auto sample = [&](bool even) {
+        for (const Tuple &t : rows) {
+            for (size_t c = 0; c < columns; ++c) {
+                const field_t &v = t.get_field(c);
+                const uint64_t h = HyperLogLog::hash(v);
+                all[c].add(h);
+                if (even) {
+                    half[c].add(h);
+                }
+                if (!is_nan(v)) {
+                    values[c].push_back(v);
+                }
+            }
+        }
+        stats.sampled_rows += rows.size();
+        rows.clear();
+        ++pages;
+    };
+
+    if (stats.complete) {
+        Iterator it = file.begin();
+        const Iterator end = file.end();
+        while (it != end && file.scanPage(it, rows, SIZE_MAX) != 0) {
+            sample(true);
+        }
+    } else {
+        const std::vector<Iterator> starts = file.split(sample_pages);
+        for (size_t i = 0; i < starts.size(); ++i) {
+            Iterator it = starts[i];
+            if (file.scanPage(it, rows, SIZE_MAX) != 0) {
+                sample(i % 2 == 0);
+            }
+        }
+    }
+
+    // split 没有给出区间说明文件里没有元组
+    stats.rows_exact = true;
+    if (const auto known = file.getRowCount()) {
+        stats.rows = *known;
+    } else if (stats.complete || pages == 0) {
+        stats.rows = stats.sampled_rows;
+    } else {
+        stats.rows_exact = false;
+        stats.rows = stats.sampled_rows * file.getNumPages() / pages;
+    }
+
+    stats.columns.resize(columns);
+    for (size_t c = 0; c < columns; ++c) {
+        ColumnStats &col = stats.columns[c];
+        if (stats.sampled_rows == 0) {
+            continue;
+        }
+        const auto seen = static_cast<double>(all[c].estimate());
+        double distinct = seen;
+        if (!stats.complete && stats.rows > stats.sampled_rows) {
+            const auto seen_half = static_cast<double>(half[c].estimate());
+            const double growth = seen_half > 0 ? std::clamp(std::log2(seen / seen_half), 0.0, 1.0) : 0.0;
+            distinct = seen * std::pow(static_cast<double>(stats.rows) / static_cast<double>(stats.sampled_rows),
+                                       growth);
+        }
+        col.distinct = std::clamp<uint64_t>(static_cast<uint64_t>(std::llround(distinct)), 1,
+                                            std::max<uint64_t>(stats.rows, 1));
+
+        std::vector<field_t> &v = values[c];
+        if (v.empty()) {
+            continue;
+        }
+        std::sort(v.begin(), v.end());
+        const size_t n = std::min(buckets, v.size());
+        col.bounds.reserve(n + 1);
+        for (size_t k = 0; k <= n; ++k) {
+            col.bounds.push_back(v[k * (v.size() - 1) / n]);
+        }
+    }
+    return stats;
+}
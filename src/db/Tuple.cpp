@@ -1,25 +1,213 @@
 #include <db/Tuple.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
 #include <unordered_set>
 
 using namespace db;
 
+namespace {
+size_t size_of_fixed(type_t t) {
+  switch (t) {
+    case type_t::INT:    return INT_SIZE;
+    case type_t::DOUBLE: return DOUBLE_SIZE;
+    case type_t::CHAR:   return CHAR_SIZE;  // 固定 64 字节
+    case type_t::VARCHAR: return VARCHAR_SIZE; // 行内只放 (偏移, 长度)
+  }
+  throw std::logic_error("TupleDesc: unknown type");
+}
+
+inline uint16_t load_u16(const uint8_t* p) {
+  uint16_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline void store_u16(uint8_t* p, uint16_t v) { std::memcpy(p, &v, sizeof(v)); }
+
+// 类型在 field_t 中对应的 variant 下标；CHAR 与 VARCHAR 都是 std::string
+uint8_t variant_index(type_t t) {
+  switch (t) {
+    case type_t::INT:    return static_cast<uint8_t>(field_t(0).index());
+    case type_t::DOUBLE: return static_cast<uint8_t>(field_t(0.0).index());
+    case type_t::CHAR:
+    case type_t::VARCHAR: return static_cast<uint8_t>(field_t(std::string()).index());
+  }
+  throw std::logic_error("TupleDesc: unknown type");
+}
+} // namespace
+
 // ---------------- Tuple ----------------
-Tuple::Tuple(const std::vector<field_t>& fields) : fields_(fields) {}
+Tuple::Tuple(const std::vector<field_t>& fields) {
+  reserve(fields.size());
+  for (const field_t& f : fields) emplace(f);
+}
+
+Tuple::Tuple(std::vector<field_t>&& fields) {
+  if (fields.size() > INLINE_FIELDS) {
+    spill_ = std::move(fields);
+    spilled_ = true;
+    return;
+  }
+  for (field_t& f : fields) emplace(std::move(f));
+}
+
+Tuple::Tuple(std::initializer_list<field_t> fields) {
+  reserve(fields.size());
+  for (const field_t& f : fields) emplace(f);
+}
+
+Tuple::Tuple(const Tuple& other) { copy_from(other); }
+
+Tuple::Tuple(Tuple&& other) noexcept { move_from(std::move(other)); }
+
+Tuple& Tuple::operator=(const Tuple& other) {
+  if (this != &other) {
+    clear();
+    copy_from(other);
+  }
+  return *this;
+}
+
+Tuple& Tuple::operator=(Tuple&& other) noexcept {
+  if (this != &other) {
+    clear();
+    move_from(std::move(other));
+  }
+  return *this;
+}
+
+Tuple::~Tuple() { clear(); }
+
+// 放不进内联缓冲的元组一开始就用 spill_，避免先内联再搬移
+void Tuple::reserve(size_t n) {
+  if (n > INLINE_FIELDS && !spilled_) {
+    spill_.reserve(n);
+    spill();
+  }
+}
+
+void Tuple::spill() {
+  spill_.reserve(std::max(spill_.capacity(), INLINE_FIELDS * 2));
+  for (size_t i = 0; i < count_; ++i) {
+    spill_.push_back(std::move(inline_data()[i]));
+    inline_data()[i].~field_t();
+  }
+  count_ = 0;
+  spilled_ = true;
+}
+
+void Tuple::clear() {
+  for (size_t i = 0; i < count_; ++i) inline_data()[i].~field_t();
+  count_ = 0;
+  spill_.clear();
+  spilled_ = false;
+}
+
+void Tuple::copy_from(const Tuple& other) {
+  if (other.spilled_) {
+    spill_ = other.spill_;
+    spilled_ = true;
+    return;
+  }
+  for (size_t i = 0; i < other.count_; ++i) emplace(other.inline_data()[i]);
+}
+
+// 被移走的元组变为空元组
+void Tuple::move_from(Tuple&& other) noexcept {
+  if (other.spilled_) {
+    spill_ = std::move(other.spill_);
+    spilled_ = true;
+  } else {
+    for (size_t i = 0; i < other.count_; ++i) emplace(std::move(other.inline_data()[i]));
+  }
+  other.clear();
+}
 
 type_t Tuple::field_type(size_t i) const {
-  const field_t& f = fields_.at(i);
+  const field_t& f = get_field(i);
   if (std::holds_alternative<int>(f))            return type_t::INT;
   if (std::holds_alternative<double>(f))         return type_t::DOUBLE;
   if (std::holds_alternative<std::string>(f))    return type_t::CHAR;
   throw std::logic_error("Tuple: unknown field type");
 }
 
-size_t Tuple::size() const { return fields_.size(); }
+size_t Tuple::size() const { return spilled_ ? spill_.size() : count_; }
+
+const field_t& Tuple::get_field(size_t i) const {
+  if (spilled_) return spill_.at(i);
+  if (i >= count_) throw std::out_of_range("Tuple::get_field: index out of range");
+  return inline_data()[i];
+}
+
+// ---------------- TupleView ----------------
+TupleView::TupleView(const TupleDesc& td, const uint8_t* data) : td_(&td), data_(data) {}
+
+TupleView::TupleView(const TupleDesc& td, const uint8_t* data, size_t rows, size_t row)
+    : td_(&td), data_(data), rows_(rows), row_(row) {}
+
+// 行视图 rows_ == 1、row_ == 0，即 data_ + offset_of(i)
+const uint8_t* TupleView::field_ptr(size_t i) const {
+  return data_ + rows_ * td_->offset_of(i) + row_ * td_->size_of(i);
+}
+
+size_t TupleView::size() const { return td_->size(); }
+
+type_t TupleView::field_type(size_t i) const { return td_->type_of(i); }
+
+const uint8_t* TupleView::data() const { return data_; }
+
+int TupleView::get_int(size_t i) const {
+  if (td_->type_of(i) != type_t::INT) {
+    throw std::logic_error("TupleView::get_int: field is not INT");
+  }
+  int v;
+  std::memcpy(&v, field_ptr(i), INT_SIZE);
+  return v;
+}
+
+double TupleView::get_double(size_t i) const {
+  if (td_->type_of(i) != type_t::DOUBLE) {
+    throw std::logic_error("TupleView::get_double: field is not DOUBLE");
+  }
+  double v;
+  std::memcpy(&v, field_ptr(i), DOUBLE_SIZE);
+  return v;
+}
+
+std::string_view TupleView::get_char(size_t i) const {
+  if (td_->type_of(i) == type_t::VARCHAR) {
+    // 偏移相对于行首；列式视图没有行首，PAX 页不接受变长 schema
+    const uint8_t* desc = field_ptr(i);
+    return {reinterpret_cast<const char*>(data_ + load_u16(desc)), load_u16(desc + sizeof(uint16_t))};
+  }
+  if (td_->type_of(i) != type_t::CHAR) {
+    throw std::logic_error("TupleView::get_char: field is not CHAR");
+  }
+  const char* csrc = reinterpret_cast<const char*>(field_ptr(i));
+  const void* nul = std::memchr(csrc, '\0', CHAR_SIZE);
+  const size_t len = nul ? static_cast<size_t>(static_cast<const char*>(nul) - csrc) : CHAR_SIZE;
+  return {csrc, len};
+}
+
+field_t TupleView::get_field(size_t i) const {
+  switch (td_->type_of(i)) {
+    case type_t::INT:    return get_int(i);
+    case type_t::DOUBLE: return get_double(i);
+    case type_t::CHAR:
+    case type_t::VARCHAR: return std::string(get_char(i));
+  }
+  throw std::logic_error("TupleView: unknown field type");
+}
 
-const field_t& Tuple::get_field(size_t i) const { return fields_.at(i); }
+Tuple TupleView::to_tuple() const {
+  if (rows_ == 1) return td_->deserialize(data_);
+  Tuple out;
+  out.reserve(size());
+  for (size_t i = 0; i < size(); ++i) out.emplace(get_field(i));
+  return out;
+}
 
 // ---------------- TupleDesc ----------------
 TupleDesc::TupleDesc(const std::vector<type_t>& types,
@@ -39,29 +227,29 @@ TupleDesc::TupleDesc(const std::vector<type_t>& types,
   types_ = types;
   names_ = names;
   offsets_.resize(types_.size());
-
-  auto size_of_fixed = [](type_t t) -> size_t {
-    switch (t) {
-      case type_t::INT:    return INT_SIZE;
-      case type_t::DOUBLE: return DOUBLE_SIZE;
-      case type_t::CHAR:   return CHAR_SIZE;  // 固定 64 字节
-    }
-    throw std::logic_error("TupleDesc: unknown type");
-  };
+  codec_.resize(types_.size());
 
   size_t off = 0;
   for (size_t i = 0; i < types_.size(); ++i) {
     offsets_[i] = off;
+    codec_[i] = {static_cast<uint32_t>(off), types_[i], variant_index(types_[i])};
     off += size_of_fixed(types_[i]);
+    max_length_ += types_[i] == type_t::VARCHAR ? VARCHAR_MAX : 0;
     name2idx_.emplace(names_[i], i);
   }
   length_ = off;
+  max_length_ += off;
+  // 描述符里的偏移是 uint16
+  if (max_length_ > UINT16_MAX) {
+    throw std::logic_error("TupleDesc: row too long");
+  }
 }
 
 bool TupleDesc::compatible(const Tuple& tuple) const {
-  if (tuple.size() != types_.size()) return false;
-  for (size_t i = 0; i < types_.size(); ++i) {
-    if (tuple.field_type(i) != types_[i]) return false;
+  if (tuple.size() != codec_.size()) return false;
+  const field_t* f = tuple.fields();
+  for (size_t i = 0; i < codec_.size(); ++i) {
+    if (f[i].index() != codec_[i].index) return false;
   }
   return true;
 }
@@ -74,6 +262,13 @@ size_t TupleDesc::index_of(const std::string& name) const {
   return it->second;
 }
 
+const std::string& TupleDesc::name_of(size_t index) const {
+  if (index >= names_.size()) {
+    throw std::out_of_range("TupleDesc::name_of: index out of range");
+  }
+  return names_[index];
+}
+
 size_t TupleDesc::offset_of(const size_t& index) const {
   if (index >= offsets_.size()) {
     throw std::out_of_range("TupleDesc::offset_of: index out of range");
@@ -81,64 +276,111 @@ size_t TupleDesc::offset_of(const size_t& index) const {
   return offsets_[index];
 }
 
+type_t TupleDesc::type_of(size_t index) const {
+  if (index >= types_.size()) {
+    throw std::out_of_range("TupleDesc::type_of: index out of range");
+  }
+  return types_[index];
+}
+
+size_t TupleDesc::size_of(size_t index) const { return size_of_fixed(type_of(index)); }
+
 size_t TupleDesc::length() const { return length_; }
+
+bool TupleDesc::fixed() const { return max_length_ == length_; }
+
+size_t TupleDesc::max_length() const { return max_length_; }
+
+size_t TupleDesc::length_of(const Tuple& t) const {
+  if (fixed()) return length_;
+  size_t n = length_;
+  for (size_t i = 0; i < types_.size(); ++i) {
+    if (types_[i] == type_t::VARCHAR) {
+      n += std::min(std::get<std::string>(t.get_field(i)).size(), VARCHAR_MAX);
+    }
+  }
+  return n;
+}
+
+size_t TupleDesc::length_of(const uint8_t* data) const {
+  if (fixed()) return length_;
+  size_t n = length_;
+  for (size_t i = 0; i < types_.size(); ++i) {
+    if (types_[i] == type_t::VARCHAR) {
+      n += load_u16(data + offsets_[i] + sizeof(uint16_t));
+    }
+  }
+  return n;
+}
 size_t TupleDesc::size()   const { return types_.size(); }
 
 Tuple TupleDesc::deserialize(const uint8_t* data) const {
-  std::vector<field_t> out;
-  out.reserve(types_.size());
+  Tuple out;
+  out.reserve(codec_.size());
 
-  for (size_t i = 0; i < types_.size(); ++i) {
-    const uint8_t* ptr = data + offsets_[i];
-    switch (types_[i]) {
+  for (const FieldCodec& c : codec_) {
+    const uint8_t* ptr = data + c.offset;
+    switch (c.type) {
       case type_t::INT: {
         int v;
         std::memcpy(&v, ptr, INT_SIZE);
-        out.emplace_back(v);
+        out.emplace(v);
         break;
       }
       case type_t::DOUBLE: {
         double v;
         std::memcpy(&v, ptr, DOUBLE_SIZE);
-        out.emplace_back(v);
+        out.emplace(v);
         break;
       }
       case type_t::CHAR: {
         const char* csrc = reinterpret_cast<const char*>(ptr);
-        size_t len = 0;
-        while (len < CHAR_SIZE && csrc[len] != '\0') ++len;
-        out.emplace_back(std::string(csrc, len));
+        const void* nul = std::memchr(csrc, '\0', CHAR_SIZE);
+        const size_t len = nul ? static_cast<size_t>(static_cast<const char*>(nul) - csrc) : CHAR_SIZE;
+        out.emplace(std::in_place_type<std::string>, csrc, len);
+        break;
+      }
+      case type_t::VARCHAR: {
+        const char* csrc = reinterpret_cast<const char*>(data + load_u16(ptr));
+        out.emplace(std::in_place_type<std::string>, csrc, load_u16(ptr + sizeof(uint16_t)));
         break;
       }
     }
   }
-  return Tuple(out);
+  return out;
 }
 
+// 先整体校验（不写任何字节），再按预编译的步骤写出；校验通过后按 variant 下标直接取值
 void TupleDesc::serialize(uint8_t* data, const Tuple& t) const {
   if (!compatible(t)) {
     throw std::logic_error("TupleDesc::serialize: tuple incompatible with schema");
   }
 
-  for (size_t i = 0; i < types_.size(); ++i) {
-    uint8_t* ptr = data + offsets_[i];
-    switch (types_[i]) {
-      case type_t::INT: {
-        const int& v = std::get<int>(t.get_field(i));
-        std::memcpy(ptr, &v, INT_SIZE);
+  const field_t* f = t.fields();
+  size_t tail = length_;   // 变长字节依次追加在定长部分之后
+  for (size_t i = 0; i < codec_.size(); ++i) {
+    uint8_t* ptr = data + codec_[i].offset;
+    switch (codec_[i].type) {
+      case type_t::INT:
+        std::memcpy(ptr, std::get_if<int>(&f[i]), INT_SIZE);
         break;
-      }
-      case type_t::DOUBLE: {
-        const double& v = std::get<double>(t.get_field(i));
-        std::memcpy(ptr, &v, DOUBLE_SIZE);
+      case type_t::DOUBLE:
+        std::memcpy(ptr, std::get_if<double>(&f[i]), DOUBLE_SIZE);
         break;
-      }
       case type_t::CHAR: {
-        const std::string& s = std::get<std::string>(t.get_field(i));
-        size_t n = s.size();
-        if (n > CHAR_SIZE) n = CHAR_SIZE;               // 超长截断
+        const std::string& s = *std::get_if<std::string>(&f[i]);
+        const size_t n = std::min(s.size(), CHAR_SIZE);            // 超长截断
         std::memcpy(ptr, s.data(), n);
-        if (n < CHAR_SIZE) std::memset(ptr + n, 0, CHAR_SIZE - n); // 其余补 0
+        std::memset(ptr + n, 0, CHAR_SIZE - n);                     // 其余补 0
+        break;
+      }
+      case type_t::VARCHAR: {
+        const std::string& s = *std::get_if<std::string>(&f[i]);
+        const size_t n = std::min(s.size(), VARCHAR_MAX);           // 超长截断
+        std::memcpy(data + tail, s.data(), n);
+        store_u16(ptr, static_cast<uint16_t>(tail));
+        store_u16(ptr + sizeof(uint16_t), static_cast<uint16_t>(n));
+        tail += n;
         break;
       }
     }
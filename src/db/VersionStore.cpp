@@ -0,0 +1,122 @@
+#include <db/VersionStore.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace db;
+
+bool VersionStore::View::sees(ts_t ts) const {
+    return ts == 0 || (ts < high && !std::binary_search(in_flight.begin(), in_flight.end(), ts));
+}
+
+bool VersionStore::needed(ts_t ts) const {
+    if (ts == 0) {
+        return false;
+    }
+    if (in_flight.contains(ts)) {
+        return true;
+    }
+    return std::any_of(views.begin(), views.end(), [ts](const View &v) { return !v.sees(ts); });
+}
+
+// 只留下有人会读到的版本：各打开的快照从新到旧看到的第一个版本，
+// 以及比它新的版本全部在途时的那些版本（在途操作提交后，新打开的快照会读到它们）
+void VersionStore::prune(std::unordered_map<PageId, Chain>::iterator it) {
+    Chain &chain = it->second;
+    std::vector<uint8_t> keep(chain.old.size(), 0);
+    bool newer_in_flight = in_flight.contains(chain.current);
+    for (size_t i = 0; i < chain.old.size() && newer_in_flight; ++i) {
+        keep[i] = 1;
+        newer_in_flight = in_flight.contains(chain.old[i].first);
+    }
+    for (const View &v : views) {
+        if (v.sees(chain.current)) {
+            continue;
+        }
+        for (size_t i = 0; i < chain.old.size(); ++i) {
+            if (v.sees(chain.old[i].first)) {
+                keep[i] = 1;
+                break;
+            }
+        }
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < chain.old.size(); ++i) {
+        if (keep[i]) {
+            if (kept != i) {
+                chain.old[kept] = std::move(chain.old[i]);
+            }
+            ++kept;
+        }
+    }
+    images -= chain.old.size() - kept;
+    chain.old.resize(kept);
+    if (chain.old.empty() && !needed(chain.current)) {
+        chains.erase(it);
+    }
+}
+
+ts_t VersionStore::begin() {
+    std::lock_guard lock(mtx);
+    const ts_t ts = next++;
+    in_flight.insert(ts);
+    return ts;
+}
+
+void VersionStore::modified(const PageId &pid, ts_t op, std::shared_ptr<const Page> before) {
+    std::lock_guard lock(mtx);
+    Chain &chain = chains[pid];
+    if (chain.current == op) {
+        return;
+    }
+    chain.old.insert(chain.old.begin(), {chain.current, std::move(before)});
+    chain.current = op;
+    ++images;
+}
+
+void VersionStore::commit(ts_t op, const std::vector<PageId> &touched) {
+    std::lock_guard lock(mtx);
+    in_flight.erase(op);
+    for (const PageId &pid : touched) {
+        if (auto it = chains.find(pid); it != chains.end()) {
+            prune(it);
+        }
+    }
+}
+
+const VersionStore::View *VersionStore::open() {
+    std::lock_guard lock(mtx);
+    return &views.emplace_back(View{next, std::vector<ts_t>(in_flight.begin(), in_flight.end())});
+}
+
+void VersionStore::close(const View *view) {
+    std::lock_guard lock(mtx);
+    auto vit = std::find_if(views.begin(), views.end(), [view](const View &v) { return &v == view; });
+    if (vit == views.end()) {
+        throw std::logic_error("VersionStore::close: view is not open");
+    }
+    views.erase(vit);
+    for (auto it = chains.begin(); it != chains.end();) {
+        auto cur = it++;
+        prune(cur);
+    }
+}
+
+// 从新到旧找第一个快照看得到的版本
+std::shared_ptr<const Page> VersionStore::lookup(const PageId &pid, const View &view) const {
+    std::lock_guard lock(mtx);
+    auto it = chains.find(pid);
+    if (it == chains.end() || view.sees(it->second.current)) {
+        return nullptr;
+    }
+    for (const auto &[ts, image] : it->second.old) {
+        if (view.sees(ts)) {
+            return image;
+        }
+    }
+    return it->second.old.empty() ? nullptr : it->second.old.back().second;
+}
+
+size_t VersionStore::imageCount() const {
+    std::lock_guard lock(mtx);
+    return images;
+}
@@ -0,0 +1,106 @@
+// BTreeFile 的随机插入、删除与 lowerBound，逐步与 std::map 对照；缓冲池只有 8 帧，分裂、合并时页不断被换出。构建示例：
+//   g++ -std=c++20 -O1 -g -Iinclude tests/btree_random_test.cpp src/db/*.cpp -lpthread -o btree_random_test
+// 用法：btree_random_test [ops] [seed]；在可写的临时目录中运行，成功时退出码为 0。
+#include "check.hpp"
+#include <db/BTreeFile.hpp>
+#include <db/Database.hpp>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+
+using namespace db;
+
+namespace {
+const TupleDesc td({type_t::INT, type_t::INT, type_t::VARCHAR}, {"key", "version", "payload"});
+
+constexpr int KEY_RANGE = 20000;
+
+// 较长的负载让每页只放几十行，树很快长出多层
+Tuple row(int key, int version) {
+    return Tuple({key, version, std::string(static_cast<size_t>(24 + key % 40), static_cast<char>('a' + key % 26))});
+}
+
+void checkRow(const BTreeFile &file, const Iterator &it, const std::map<int, int> &expected,
+              std::map<int, int>::const_iterator e) {
+    CHECK(e != expected.end());
+    const Tuple t = file.getTuple(it);
+    CHECK(std::get<int>(t.get_field(0)) == e->first);
+    CHECK(std::get<int>(t.get_field(1)) == e->second);
+    CHECK(std::get<std::string>(t.get_field(2)) == std::get<std::string>(row(e->first, 0).get_field(2)));
+}
+
+void checkScan(const BTreeFile &file, const std::map<int, int> &expected) {
+    auto e = expected.cbegin();
+    for (Iterator it = file.begin(); it != file.end(); file.next(it), ++e) {
+        checkRow(file, it, expected, e);
+    }
+    CHECK(e == expected.cend());
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    const size_t ops = argc > 1 ? std::stoul(argv[1]) : 200'000;
+    const uint64_t seed = argc > 2 ? std::stoull(argv[2]) : 1;
+
+    const std::string name = "btree_random.dat";
+    std::remove(name.c_str());
+    getDatabase().getBufferPool().resize(8);
+    getDatabase().add(std::make_unique<BTreeFile>(name, td, 0));
+    auto &file = static_cast<BTreeFile &>(getDatabase().get(name));
+
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> pick_key(0, KEY_RANGE - 1);
+    std::uniform_int_distribution<int> pick_op(0, 99);
+    std::map<int, int> expected;
+    for (size_t i = 0; i < ops; ++i) {
+        const int key = pick_key(rng);
+        const int op = pick_op(rng);
+        // 前半段插入居多让树长高，后半段删除居多让树合并、收缩
+        const int insert_share = i < ops / 2 ? 60 : 30;
+        if (op < insert_share) {
+            const int version = static_cast<int>(i);
+            file.insertTuple(row(key, version));
+            expected[key] = version;
+        } else if (op < insert_share + 25) {
+            CHECK(file.erase(key) == (expected.erase(key) == 1));
+        } else if (op < insert_share + 30) {
+            const Iterator it = file.find(key);
+            const auto e = expected.find(key);
+            CHECK((it == file.end()) == (e == expected.end()));
+            if (e != expected.end()) {
+                file.deleteTuple(it);
+                expected.erase(e);
+            }
+        } else {
+            Iterator it = file.lowerBound(key);
+            auto e = expected.lower_bound(key);
+            for (int j = 0; j < 3 && e != expected.cend(); ++j, file.next(it), ++e) {
+                CHECK(it != file.end());
+                checkRow(file, it, expected, e);
+            }
+            if (e == expected.cend()) {
+                CHECK(it == file.end());
+            }
+        }
+        if (i % 20000 == 19999) {
+            checkScan(file, expected);
+        }
+    }
+    checkScan(file, expected);
+
+    // 全部删掉后树为空，还能再插入
+    for (const auto &[key, version] : std::map<int, int>(expected)) {
+        CHECK(file.erase(key));
+    }
+    expected.clear();
+    checkScan(file, expected);
+    file.insertTuple(row(7, 1));
+    expected[7] = 1;
+    checkScan(file, expected);
+
+    getDatabase().remove(name).reset();
+    std::remove(name.c_str());
+    std::puts("btree_random_test: ok");
+    return 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+// 测试程序共用的检查宏：不受 NDEBUG 影响，失败时打印位置并以非零状态退出。用 _Exit 而不是 exit：
+// 别的线程可能还在用 Database，不能让静态析构在它们脚下拆掉它
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(cond)                                                                                                   \
+    do {                                                                                                              \
+        if (!(cond)) {                                                                                                \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);                             \
+            std::_Exit(1);                                                                                            \
+        }                                                                                                             \
+    } while (0)
@@ -0,0 +1,114 @@
+// 多线程并发向同一个 HeapFile 插入（逐行与成批）并删除自己插入的部分行，最后核对每一行恰好出现一次。构建示例：
+//   g++ -std=c++20 -O1 -g -Iinclude tests/heap_concurrent_test.cpp src/db/*.cpp -lpthread -o heap_concurrent_test
+// 用法：heap_concurrent_test [threads] [rows per thread]；在可写的临时目录中运行，成功时退出码为 0。
+#include "check.hpp"
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace db;
+
+namespace {
+const TupleDesc td({type_t::INT, type_t::VARCHAR}, {"key", "value"});
+
+constexpr int BATCH = 50;
+
+Tuple row(int key) { return Tuple({key, std::string(static_cast<size_t>(key % 40), static_cast<char>('a' + key % 26))}); }
+
+// 每个线程插入 [t * rows, (t + 1) * rows)：偶数线程逐行插入，奇数线程成批插入；之后删掉自己 key % 10 == 0 的行
+void run(bool buffered, int threads, int rows) {
+    const std::string name = buffered ? "heap_concurrent_buffered.dat" : "heap_concurrent.dat";
+    std::remove(name.c_str());
+    std::remove((name + ".fsm").c_str());
+    getDatabase().add(std::make_unique<HeapFile>(name, td, buffered));
+    auto &file = getDatabase().get(name);
+
+    const auto insert = [&](int t) {
+        const int first = t * rows;
+        if (t % 2 == 0) {
+            for (int k = first; k < first + rows; ++k) {
+                file.insertTuple(row(k));
+            }
+            return;
+        }
+        std::vector<Tuple> batch;
+        for (int k = first; k < first + rows; k += BATCH) {
+            batch.clear();
+            for (int j = k; j < std::min(k + BATCH, first + rows); ++j) {
+                batch.push_back(row(j));
+            }
+            file.insertTuples(batch);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back(insert, t);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    // 先收集位置再删：删除不挪动别的行，位置在删除期间一直有效
+    std::vector<std::vector<Iterator>> doomed(static_cast<size_t>(threads));
+    for (Iterator it = file.begin(); it != file.end(); file.next(it)) {
+        const int key = std::get<int>(file.getTuple(it).get_field(0));
+        if (key % 10 == 0) {
+            doomed[static_cast<size_t>(key / rows)].push_back(it);
+        }
+    }
+    workers.clear();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (const Iterator &it : doomed[static_cast<size_t>(t)]) {
+                file.deleteTuple(it);
+            }
+            // 删出的空位与追加的新页同时被别的线程争用
+            for (int k = 0; k < rows / 10; ++k) {
+                file.insertTuple(row(threads * rows + t * rows + k));
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::set<int> keys;
+    for (Iterator it = file.begin(); it != file.end(); file.next(it)) {
+        const Tuple t = file.getTuple(it);
+        const int key = std::get<int>(t.get_field(0));
+        CHECK(std::get<std::string>(t.get_field(1)) == std::get<std::string>(row(key).get_field(1)));
+        CHECK(keys.insert(key).second);
+    }
+    size_t expected = 0;
+    for (int t = 0; t < threads; ++t) {
+        for (int k = t * rows; k < (t + 1) * rows; ++k) {
+            CHECK(keys.contains(k) == (k % 10 != 0));
+            expected += k % 10 != 0;
+        }
+        for (int k = 0; k < rows / 10; ++k) {
+            CHECK(keys.contains(threads * rows + t * rows + k));
+            ++expected;
+        }
+    }
+    CHECK(keys.size() == expected);
+
+    getDatabase().remove(name).reset();
+    std::remove(name.c_str());
+    std::remove((name + ".fsm").c_str());
+    std::printf("%s: %zu rows\n", buffered ? "buffered" : "unbuffered", keys.size());
+}
+} // namespace
+
+int main(int argc, char **argv) {
+    const int threads = argc > 1 ? std::stoi(argv[1]) : 4;
+    const int rows = argc > 2 ? std::stoi(argv[2]) : 20000;
+    run(true, threads, rows);
+    run(false, threads, rows / 10);
+    std::puts("heap_concurrent_test: ok");
+    return 0;
+}
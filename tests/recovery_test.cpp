@@ -0,0 +1,131 @@
+// 检查点与崩溃恢复：不同的检查点方式与重放线程数下，重放后提交的行都在，再次重启的结果不变。构建示例：
+//   g++ -std=c++20 -O1 -g -Iinclude tests/recovery_test.cpp src/db/*.cpp -lpthread -o recovery_test
+// 在可写的临时目录中运行；成功时退出码为 0。
+#include "check.hpp"
+#include <db/BTreeFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <cstdio>
+#include <functional>
+#include <set>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+const TupleDesc td({type_t::INT, type_t::VARCHAR}, {"key", "value"});
+
+constexpr int COMMITTED = 30000, WRITTEN = 34000;
+
+Tuple row(int key) { return Tuple({key, std::string(static_cast<size_t>(key % 40), static_cast<char>('a' + key % 26))}); }
+
+int treeKey(int i) { return i * 7 % 100003; }
+
+void removeFiles() {
+    for (const char *name : {"rec_tree.dat", "rec_heap.dat", "rec_heap.dat.fsm", "rec.log", "rec.log.ckpt"}) {
+        std::remove(name);
+    }
+}
+
+void openFiles() {
+    getDatabase().add(std::make_unique<BTreeFile>("rec_tree.dat", td, 0));
+    getDatabase().add(std::make_unique<HeapFile>("rec_heap.dat", td, true));
+}
+
+// 每个阶段在独立的进程里跑，像一次真实的启动；进程非正常结束或检查失败都算失败
+void inChild(const std::function<void()> &body) {
+    std::fflush(stdout);
+    const pid_t child = fork();
+    CHECK(child >= 0);
+    if (child == 0) {
+        body();
+        std::fflush(stdout);
+        _exit(0);
+    }
+    int status;
+    CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+// 每 every 行取一次检查点；提交后再写一些，然后不写回数据页就退出
+void crash(int every, bool write_pages) {
+    openFiles();
+    auto &pool = getDatabase().getBufferPool();
+    pool.enableLog("rec.log");
+    auto &tree = getDatabase().get("rec_tree.dat");
+    auto &heap = getDatabase().get("rec_heap.dat");
+    for (int i = 0; i < WRITTEN; ++i) {
+        tree.insertTuple(row(treeKey(i)));
+        heap.insertTuple(row(i));
+        if (every > 0 && i % every == every - 1) {
+            pool.checkpoint(write_pages);
+        }
+        if (i == COMMITTED - 1) {
+            pool.commit();
+        }
+    }
+}
+
+// 重放日志并检查文件；返回 B 树与堆文件的行数，供再次重启时比较
+std::pair<size_t, size_t> recover(size_t redo_threads) {
+    openFiles();
+    getDatabase().getBufferPool().enableLog("rec.log", redo_threads);
+    auto &tree = getDatabase().get("rec_tree.dat");
+    auto &heap = getDatabase().get("rec_heap.dat");
+    std::set<int> keys;
+    int prev = -1;
+    for (Iterator it = tree.begin(); it != tree.end(); tree.next(it)) {
+        const Tuple t = tree.getTuple(it);
+        const int key = std::get<int>(t.get_field(0));
+        CHECK(key > prev);
+        CHECK(std::get<std::string>(t.get_field(1)) == std::get<std::string>(row(key).get_field(1)));
+        prev = key;
+        keys.insert(key);
+    }
+    for (int i = 0; i < COMMITTED; ++i) {
+        CHECK(keys.contains(treeKey(i)));
+    }
+    std::set<int> heap_keys;
+    for (Iterator it = heap.begin(); it != heap.end(); heap.next(it)) {
+        const Tuple t = heap.getTuple(it);
+        const int key = std::get<int>(t.get_field(0));
+        CHECK(key >= 0 && key < WRITTEN);
+        CHECK(heap_keys.insert(key).second);
+    }
+    for (int i = 0; i < COMMITTED; ++i) {
+        CHECK(heap_keys.contains(i));
+    }
+    return {keys.size(), heap_keys.size()};
+}
+} // namespace
+
+int main() {
+    const struct {
+        int every;
+        bool write_pages;
+    } checkpoints[] = {{0, false}, {5000, false}, {5000, true}};
+    for (const auto &ckpt : checkpoints) {
+        for (size_t redo_threads : {1, 4}) {
+            removeFiles();
+            inChild([&] { crash(ckpt.every, ckpt.write_pages); });
+            // 第二次启动时日志已经重放过，结果必须与第一次相同
+            int pipe_fd[2];
+            CHECK(pipe(pipe_fd) == 0);
+            inChild([&] {
+                const auto counts = recover(redo_threads);
+                CHECK(write(pipe_fd[1], &counts, sizeof(counts)) == sizeof(counts));
+            });
+            std::pair<size_t, size_t> first;
+            CHECK(read(pipe_fd[0], &first, sizeof(first)) == sizeof(first));
+            close(pipe_fd[0]);
+            close(pipe_fd[1]);
+            inChild([&] { CHECK(recover(redo_threads) == first); });
+            std::printf("checkpoint every %d%s, %zu redo threads: %zu tree rows, %zu heap rows\n", ckpt.every,
+                        ckpt.write_pages ? " (write pages)" : "", redo_threads, first.first, first.second);
+        }
+    }
+    removeFiles();
+    std::puts("recovery_test: ok");
+    return 0;
+}
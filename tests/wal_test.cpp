@@ -0,0 +1,131 @@
+// 预写日志：BufferPool::markDirty 与 PageGuard::markDirty 的记录时机，以及提交后崩溃、重放日志的往返。构建示例：
+//   g++ -std=c++20 -O1 -g -Iinclude tests/wal_test.cpp src/db/*.cpp -lpthread -o wal_test
+// 在可写的临时目录中运行；成功时退出码为 0。
+#include "check.hpp"
+#include <db/BTreeFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+const TupleDesc td({type_t::INT, type_t::VARCHAR}, {"key", "value"});
+
+Tuple row(int key) { return Tuple({key, std::string(static_cast<size_t>(key % 40), static_cast<char>('a' + key % 26))}); }
+
+void removeFiles(std::initializer_list<const char *> names) {
+    for (const char *name : names) {
+        std::remove(name);
+    }
+}
+
+// 页由调用方 pin 住、改完再用 BufferPool::markDirty 置脏：unpin 之后必须能写回、丢弃
+void rawPinMarkDirty() {
+    removeFiles({"wal_raw.dat", "wal_raw.dat.fsm", "wal_raw.log", "wal_raw.log.ckpt"});
+    auto &pool = getDatabase().getBufferPool();
+    getDatabase().add(std::make_unique<HeapFile>("wal_raw.dat", td));
+    auto &file = getDatabase().get("wal_raw.dat");
+    file.insertTuple(row(1));
+    pool.enableLog("wal_raw.log");
+
+    const PageId pid{file.getFileId(), 0};
+    (void)pool.getPage(pid);
+    pool.pin(pid);
+    Page &page = pool.getPage(pid);
+    page[DEFAULT_PAGE_SIZE - 1] ^= 0xff;
+    const uint8_t changed = page[DEFAULT_PAGE_SIZE - 1];
+    pool.markDirty(pid);
+    pool.unpin(pid);
+    pool.flushFile("wal_raw.dat");
+    CHECK(!pool.isDirty(pid));
+    pool.discardPage(pid);
+    CHECK(pool.getPage(pid)[DEFAULT_PAGE_SIZE - 1] == changed);
+
+    // PageGuard 置脏在改动之前，释放 guard 时才记录
+    {
+        PageGuard guard = pool.pinPage(pid, AccessIntent::NORMAL, LatchMode::EXCLUSIVE);
+        guard.markDirty();
+        (*guard)[DEFAULT_PAGE_SIZE - 1] ^= 0xff;
+    }
+    pool.flushFile("wal_raw.dat");
+    CHECK(!pool.isDirty(pid));
+    pool.discardPage(pid);
+    CHECK(pool.getPage(pid)[DEFAULT_PAGE_SIZE - 1] != changed);
+
+    pool.disableLog();
+    getDatabase().remove("wal_raw.dat").reset();
+    removeFiles({"wal_raw.dat", "wal_raw.dat.fsm", "wal_raw.log", "wal_raw.log.ckpt"});
+}
+
+void openFiles() {
+    getDatabase().add(std::make_unique<BTreeFile>("wal_tree.dat", td, 0));
+    getDatabase().add(std::make_unique<HeapFile>("wal_heap.dat", td, true));
+}
+
+// 子进程提交前 committed 行后再写一些、不写回数据页就退出；重放日志后提交的行必须都在
+void crashAndRecover() {
+    constexpr int committed = 20000, written = 24000;
+    removeFiles({"wal_tree.dat", "wal_heap.dat", "wal_heap.dat.fsm", "wal.log", "wal.log.ckpt"});
+    const pid_t child = fork();
+    CHECK(child >= 0);
+    if (child == 0) {
+        openFiles();
+        auto &pool = getDatabase().getBufferPool();
+        pool.enableLog("wal.log");
+        auto &tree = getDatabase().get("wal_tree.dat");
+        auto &heap = getDatabase().get("wal_heap.dat");
+        for (int k = 0; k < written; ++k) {
+            tree.insertTuple(row(k * 7 % 100003));
+            heap.insertTuple(row(k));
+            if (k == committed - 1) {
+                pool.commit();
+            }
+        }
+        _exit(0);
+    }
+    int status;
+    CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    openFiles();
+    getDatabase().getBufferPool().enableLog("wal.log");
+    auto &tree = getDatabase().get("wal_tree.dat");
+    auto &heap = getDatabase().get("wal_heap.dat");
+    std::set<int> keys;
+    int prev = -1;
+    for (Iterator it = tree.begin(); it != tree.end(); tree.next(it)) {
+        const Tuple t = tree.getTuple(it);
+        const int key = std::get<int>(t.get_field(0));
+        CHECK(key > prev);
+        CHECK(std::get<std::string>(t.get_field(1)) == std::get<std::string>(row(key).get_field(1)));
+        prev = key;
+        keys.insert(key);
+    }
+    for (int k = 0; k < committed; ++k) {
+        CHECK(keys.contains(k * 7 % 100003));
+    }
+    std::set<int> heap_keys;
+    for (Iterator it = heap.begin(); it != heap.end(); heap.next(it)) {
+        CHECK(heap_keys.insert(std::get<int>(heap.getTuple(it).get_field(0))).second);
+    }
+    for (int k = 0; k < committed; ++k) {
+        CHECK(heap_keys.contains(k));
+    }
+
+    getDatabase().getBufferPool().disableLog();
+    getDatabase().remove("wal_tree.dat").reset();
+    getDatabase().remove("wal_heap.dat").reset();
+    removeFiles({"wal_tree.dat", "wal_heap.dat", "wal_heap.dat.fsm", "wal.log", "wal.log.ckpt"});
+}
+} // namespace
+
+int main() {
+    rawPinMarkDirty();
+    crashAndRecover();
+    std::puts("wal_test: ok");
+    return 0;
+}